@@ -0,0 +1,101 @@
+/**
+ * Measures the overhead a send of the relay paths pays to update the time tag
+ * of the transferred bytes, as the workers grow: reading the wall clock and
+ * storing the tag after every send (as generateAndUpdateTimeTag did before)
+ * versus reading the clock of the loop and storing the tag only when its
+ * second changed.
+ *
+ * Every thread stands for a worker and updates the same tag, as the workers
+ * of the proxy do. The clock of the loop is updated once per selector
+ * iteration, whatever the sends of the iteration, so its cost is measured
+ * apart, per iteration.
+ */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <loopClock.h>
+
+#define DEFAULT_SENDS 20000000
+#define MAX_THREADS 8
+
+static const unsigned threadQuantities[] = {1, 2, 4, MAX_THREADS};
+
+static unsigned long sendsPerThread = DEFAULT_SENDS;
+/* The time tag the workers share */
+static time_t timeTag;
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The time tag update of every send before the clock of the loop */
+static void *sendsBefore(void *data) {
+	for (unsigned long i = 0; i < sendsPerThread; i++) {
+		__atomic_store_n(&timeTag, time(NULL), __ATOMIC_RELAXED);
+	}
+	return NULL;
+}
+
+/* The time tag update of every send with the clock of the loop */
+static void *sendsAfter(void *data) {
+	loopClockUpdate();
+	for (unsigned long i = 0; i < sendsPerThread; i++) {
+		time_t tag = loopClockWallSeconds();
+
+		if (__atomic_load_n(&timeTag, __ATOMIC_RELAXED) != tag) {
+			__atomic_store_n(&timeTag, tag, __ATOMIC_RELAXED);
+		}
+	}
+	return NULL;
+}
+
+/* Returns the nanoseconds per send of sends run by threadQty threads */
+static double measure(void *(*sends)(void *), unsigned threadQty) {
+	pthread_t threads[MAX_THREADS];
+	double start = now();
+
+	for (unsigned i = 0; i < threadQty; i++) {
+		pthread_create(&threads[i], NULL, sends, NULL);
+	}
+	for (unsigned i = 0; i < threadQty; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	return (now() - start) * 1e9 / sendsPerThread;
+}
+
+/* Returns the nanoseconds of an update of the clock of the loop */
+static double measureUpdate(void) {
+	double start = now();
+
+	for (unsigned long i = 0; i < sendsPerThread; i++) {
+		loopClockUpdate();
+	}
+
+	return (now() - start) * 1e9 / sendsPerThread;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc > 1) {
+		sendsPerThread = strtoul(argv[1], NULL, 10);
+	}
+
+	printf("%8s %14s %14s %9s\n", "threads", "before ns/send",
+		   "after ns/send", "speedup");
+	for (size_t i = 0; i < sizeof(threadQuantities) / sizeof(unsigned); i++) {
+		double before = measure(sendsBefore, threadQuantities[i]);
+		double after  = measure(sendsAfter, threadQuantities[i]);
+
+		printf("%8u %14.2f %14.2f %8.2fx\n", threadQuantities[i], before,
+			   after, before / after);
+	}
+
+	printf("\nloop clock update: %.2f ns per selector iteration\n",
+		   measureUpdate());
+	return 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * Measures the resident memory the proxy uses per client connection, for
+ * connections that are idle and for connections in the middle of a request.
+ *
+ * It opens the connections to a running proxy and reads the VmRSS of its
+ * process before and after: first they only connect, as a keep-alive client
+ * waiting between requests does, then each one sends the start of a request
+ * and stops, as a slow client does. The proxy must allow that many clients
+ * and both processes that many open files.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#define DEFAULT_CONNECTIONS 10000
+#define DEFAULT_ADDRESS "127.0.0.1"
+#define DEFAULT_PORT 8080
+/* Time the proxy has to accept and read the connections */
+#define SETTLE_SECONDS 2
+
+static const char partialRequest[] = "GET http://127.0.0.1/ HTTP/1.1\r\n"
+									 "User-Agent: connectionMemoryBenchmark\r\n"
+									 "Accept: */*\r\n";
+
+/* Returns the resident memory of the process in KB, or -1 */
+static long residentKilobytes(const char *pid) {
+	char path[64], line[256];
+	long kilobytes = -1;
+	FILE *file;
+
+	snprintf(path, sizeof(path), "/proc/%s/status", pid);
+	if ((file = fopen(path, "r")) == NULL) {
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+		if (sscanf(line, "VmRSS: %ld kB", &kilobytes) == 1) {
+			break;
+		}
+	}
+
+	fclose(file);
+	return kilobytes;
+}
+
+static void printResult(const char *mode, long before, long after,
+						unsigned connections) {
+	printf("%-10s %10u %12ld %16.0f\n", mode, connections, after - before,
+		   (after - before) * 1024.0 / connections);
+}
+
+int main(int argc, char *argv[]) {
+	unsigned connections = DEFAULT_CONNECTIONS;
+	const char *address	 = DEFAULT_ADDRESS;
+	unsigned short port	 = DEFAULT_PORT;
+	struct sockaddr_in proxy;
+	struct rlimit limit;
+	long base, idle, busy;
+	unsigned opened;
+	int *fds;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <proxy pid> [connections] [address] "
+						"[port]\n",
+				argv[0]);
+		return 1;
+	}
+	if (argc > 2) {
+		connections = strtoul(argv[2], NULL, 10);
+	}
+	if (argc > 3) {
+		address = argv[3];
+	}
+	if (argc > 4) {
+		port = strtoul(argv[4], NULL, 10);
+	}
+
+	/* Each connection is a file */
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	memset(&proxy, 0, sizeof(proxy));
+	proxy.sin_family = AF_INET;
+	proxy.sin_port	 = htons(port);
+	if (inet_pton(AF_INET, address, &proxy.sin_addr) != 1) {
+		fprintf(stderr, "Invalid address %s\n", address);
+		return 1;
+	}
+
+	if ((fds = malloc(connections * sizeof(*fds))) == NULL ||
+		(base = residentKilobytes(argv[1])) == -1) {
+		fprintf(stderr, "Can not read the memory of process %s\n", argv[1]);
+		return 1;
+	}
+
+	for (opened = 0; opened < connections; opened++) {
+		fds[opened] = socket(AF_INET, SOCK_STREAM, 0);
+		if (fds[opened] == -1 ||
+			connect(fds[opened], (struct sockaddr *) &proxy, sizeof(proxy)) ==
+				-1) {
+			fprintf(stderr, "Connection %u: %s\n", opened, strerror(errno));
+			if (fds[opened] != -1) {
+				close(fds[opened]);
+			}
+			break;
+		}
+	}
+	if (opened == 0) {
+		return 1;
+	}
+
+	sleep(SETTLE_SECONDS);
+	idle = residentKilobytes(argv[1]);
+
+	for (unsigned i = 0; i < opened; i++) {
+		if (send(fds[i], partialRequest, sizeof(partialRequest) - 1, 0) ==
+			-1) {
+			fprintf(stderr, "Send %u: %s\n", i, strerror(errno));
+		}
+	}
+
+	sleep(SETTLE_SECONDS);
+	busy = residentKilobytes(argv[1]);
+
+	printf("%-10s %10s %12s %16s\n", "clients", "connections", "RSS KB",
+		   "bytes/connection");
+	printResult("idle", base, idle, opened);
+	printResult("in flight", base, busy, opened);
+
+	for (unsigned i = 0; i < opened; i++) {
+		close(fds[i]);
+	}
+	free(fds);
+	return 0;
+}
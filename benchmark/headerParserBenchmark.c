@@ -0,0 +1,280 @@
+/**
+ * Measures the header parsers over request and response headers like the
+ * ones browsers and web servers send, parsing them one byte at a time (the
+ * old loops) and with the spans found by byteScan().
+ *
+ * The response headers parser is the one HANDLE_REQUEST and HANDLE_RESPONSE
+ * use, run with the transformations on so that it censures and inspects the
+ * headers it would in the proxy. The host header parser is the one PARSE
+ * uses on the request headers, it stops at the Host header so it is measured
+ * with the Host header moved to the end. The configuration and the connection
+ * the parsers ask for are replaced by the stubs below.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <byteScan.h>
+#include <configuration.h>
+#include <headersParser.h>
+#include <hostHeaderParser.h>
+#include <management.h>
+
+#define DEFAULT_ITERATIONS 200000
+#define HOST_HEADER "Host: www.example.com\r\n"
+
+static const char requestHeaders[] =
+	"GET http://www.example.com/articles/2024/05/header-parsing?ref=home "
+	"HTTP/1.1\r\n"
+	HOST_HEADER
+	"Connection: keep-alive\r\n"
+	"Cache-Control: max-age=0\r\n"
+	"sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", "
+	"\"Not-A.Brand\";v=\"99\"\r\n"
+	"sec-ch-ua-mobile: ?0\r\n"
+	"sec-ch-ua-platform: \"Linux\"\r\n"
+	"Upgrade-Insecure-Requests: 1\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, "
+	"like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/"
+	"avif,image/webp,image/apng,*/*;q=0.8,application/signed-exchange;v=b3;"
+	"q=0.7\r\n"
+	"Sec-Fetch-Site: same-origin\r\n"
+	"Sec-Fetch-Mode: navigate\r\n"
+	"Sec-Fetch-User: ?1\r\n"
+	"Sec-Fetch-Dest: document\r\n"
+	"Referer: http://www.example.com/\r\n"
+	"Accept-Encoding: gzip, deflate\r\n"
+	"Accept-Language: en-US,en;q=0.9,es;q=0.8\r\n"
+	"Cookie: _ga=GA1.2.1234567890.1700000000; _gid=GA1.2.987654321.1714000000;"
+	" session=eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9.eyJzdWIiOiIxMjM0NTY3ODkwIiwi"
+	"bmFtZSI6IkpvaG4gRG9lIiwiaWF0IjoxNTE2MjM5MDIyfQ.SflKxwRJSMeKKF2QT4fwpMeJf36"
+	"POk6yJV_adQssw5c; theme=dark; consent=analytics%3Dtrue%26ads%3Dfalse\r\n"
+	"\r\n";
+
+static const char responseHeaders[] =
+	"HTTP/1.1 200 OK\r\n"
+	"Server: nginx/1.25.4\r\n"
+	"Date: Fri, 17 May 2024 12:00:00 GMT\r\n"
+	"Content-Type: text/html; charset=utf-8\r\n"
+	"Content-Length: 48213\r\n"
+	"Connection: keep-alive\r\n"
+	"Keep-Alive: timeout=5\r\n"
+	"Vary: Accept-Encoding, Cookie\r\n"
+	"Cache-Control: private, no-cache, no-store, must-revalidate\r\n"
+	"Expires: Thu, 01 Jan 1970 00:00:01 GMT\r\n"
+	"Last-Modified: Fri, 17 May 2024 11:58:31 GMT\r\n"
+	"ETag: W/\"bc55-18f86a3c1d8\"\r\n"
+	"Set-Cookie: session=eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9.eyJzdWIiOiIxMjM0"
+	"NTY3ODkwIn0.dozjgNryP4J3jVmNHl0w5N_XgL0n3I9PlFUP0THsR8U; Path=/; HttpOnly;"
+	" SameSite=Lax\r\n"
+	"Content-Security-Policy: default-src 'self'; script-src 'self' "
+	"https://cdn.example.com; style-src 'self' 'unsafe-inline'; img-src * "
+	"data:; frame-ancestors 'none'\r\n"
+	"Strict-Transport-Security: max-age=31536000; includeSubDomains\r\n"
+	"X-Content-Type-Options: nosniff\r\n"
+	"X-Frame-Options: DENY\r\n"
+	"Referrer-Policy: strict-origin-when-cross-origin\r\n"
+	"X-Request-Id: 5f0c7a1e-3b2d-4c8e-9f6a-1d2e3f4a5b6c\r\n"
+	"\r\n";
+
+static char lateHostHeaders[sizeof(requestHeaders)];
+static uint8_t requestLine[BUFFER_SIZE], responseLine[BUFFER_SIZE];
+static uint8_t stateBuffers[STATE_BUFFERS][STATE_BUFFER_SIZE];
+static buffer requestLineBuffer, responseLineBuffer;
+static MediaRangeMatcherPtr_t matcher;
+
+/* Stubs of the configuration and the connection */
+configurationADT getConfiguration() {
+	return NULL;
+}
+
+uint8_t getIsTransformationOn(configurationADT config) {
+	return TRUE;
+}
+
+unsigned getUpstreamMaxIdle(configurationADT config) {
+	return 0;
+}
+
+buffer *getRequestLineBuffer(struct http *s) {
+	buffer_reset(&requestLineBuffer);
+	return &requestLineBuffer;
+}
+
+buffer *getResponseLineBuffer(struct http *s) {
+	buffer_reset(&responseLineBuffer);
+	return &responseLineBuffer;
+}
+
+uint8_t *getStateBuffer(struct http *s, unsigned index) {
+	return stateBuffers[index];
+}
+
+MediaRangeMatcherPtr_t getMediaRangeMatcherHTTP(struct http *s) {
+	return matcher;
+}
+
+timeTag_t generateAndUpdateTimeTag(uint8_t id) {
+	return 0;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The loop of parseHeaders before the spans */
+static void parseHeadersBytes(struct headersParser *header, buffer *input) {
+	uint8_t l = buffer_read(input);
+
+	while (l) {
+		parseHeadersByChar(l, header);
+		if (header->state == HEADER_DONE) {
+			resetHeaderParser(header);
+		}
+		else if (header->state == BODY_START) {
+			addLastHeaders(header);
+			return;
+		}
+		l = buffer_read(input);
+	}
+}
+
+/* Returns the length of what the parser would send */
+static size_t runHeadersParser(const char *headers, uint8_t isRequest,
+							   int spans, struct headersParser *header) {
+	static uint8_t data[BUFFER_SIZE];
+	struct selector_key key = {.data = NULL};
+	size_t length			= strlen(headers);
+	buffer input;
+	size_t sent = 0;
+
+	memcpy(data, headers, length);
+	buffer_init(&input, sizeof(data), data);
+	buffer_write_adv(&input, length);
+	headersParserInit(header, &key, isRequest);
+
+	while (header->state != BODY_START && buffer_can_read(&input)) {
+		if (spans) {
+			parseHeaders(header, &input, 0, 0);
+		}
+		else {
+			parseHeadersBytes(header, &input);
+		}
+		// The proxy sends what was parsed before parsing more
+		buffer_read_ptr(&header->valueBuffer, &length);
+		sent += length;
+		if (header->state != BODY_START) {
+			buffer_reset(&header->valueBuffer);
+		}
+	}
+
+	return sent;
+}
+
+static int runHostParser(const char *headers, int spans) {
+	const uint8_t *data = (const uint8_t *) strstr(headers, "\r\n") + 2;
+	size_t length		= strlen((const char *) data);
+	static struct arena arena;
+	struct headerParser parser;
+	int found;
+
+	arenaInit(&arena, NULL, 0);
+	parseHeaderInit(&parser, &arena);
+	for (size_t i = 0; i < length; i++) {
+		if (spans) {
+			i += parseHeaderSpan(&parser, data + i, length - i);
+			if (i == length) {
+				break;
+			}
+		}
+		if (!parseHeaderChar(&parser, data[i])) {
+			break;
+		}
+	}
+
+	found = hasFoundHostHeaderParser(&parser);
+	arenaReset(&arena);
+	return found;
+}
+
+static void measure(const char *name, const char *headers, uint8_t isRequest,
+					unsigned iterations) {
+	static struct headersParser header;
+	size_t length = strlen(headers);
+	size_t sent[2];
+	double seconds[2];
+
+	for (int spans = 0; spans < 2; spans++) {
+		double start = now();
+		for (unsigned i = 0; i < iterations; i++) {
+			sent[spans] = runHeadersParser(headers, isRequest, spans, &header);
+		}
+		seconds[spans] = now() - start;
+	}
+
+	printf("%-16s %6zu %12.0f %12.0f %8.2fx\n", name, length,
+		   seconds[0] * 1e9 / iterations, seconds[1] * 1e9 / iterations,
+		   seconds[0] / seconds[1]);
+	if (sent[0] != sent[1]) {
+		printf("The parsed headers differ\n");
+	}
+}
+
+static void measureHost(const char *headers, unsigned iterations) {
+	double seconds[2];
+	int found[2];
+
+	for (int spans = 0; spans < 2; spans++) {
+		double start = now();
+		for (unsigned i = 0; i < iterations; i++) {
+			found[spans] = runHostParser(headers, spans);
+		}
+		seconds[spans] = now() - start;
+	}
+
+	printf("%-16s %6zu %12.0f %12.0f %8.2fx\n", "host (last)",
+		   strlen(headers), seconds[0] * 1e9 / iterations,
+		   seconds[1] * 1e9 / iterations, seconds[0] / seconds[1]);
+	if (!found[0] || !found[1]) {
+		printf("The host was not found\n");
+	}
+}
+
+int main(int argc, char *argv[]) {
+	unsigned iterations = DEFAULT_ITERATIONS;
+	MediaRangePtr_t mediaRange;
+	const char *host;
+	size_t before, after;
+
+	if (argc > 1) {
+		iterations = strtoul(argv[1], NULL, 10);
+	}
+
+	// The request headers with the Host header before the empty line
+	host   = strstr(requestHeaders, HOST_HEADER);
+	before = host - requestHeaders;
+	after  = strlen(host + sizeof(HOST_HEADER) - 1) - 2;
+	memcpy(lateHostHeaders, requestHeaders, before);
+	memcpy(lateHostHeaders + before, host + sizeof(HOST_HEADER) - 1, after);
+	strcpy(lateHostHeaders + before + after, HOST_HEADER "\r\n");
+
+	buffer_init(&requestLineBuffer, sizeof(requestLine), requestLine);
+	buffer_init(&responseLineBuffer, sizeof(responseLine), responseLine);
+	mediaRange = createMediaRange("text/html, application/json");
+	matcher	   = compileMediaRange(mediaRange);
+
+	printf("byteScan: %s\n", byteScanImplementation());
+	printf("%-16s %6s %12s %12s %9s\n", "parser", "bytes", "byte ns",
+		   "span ns", "speedup");
+	measureHost(lateHostHeaders, iterations);
+	measure("request", requestHeaders, TRUE, iterations);
+	measure("response", responseHeaders, FALSE, iterations);
+
+	releaseMediaRangeMatcher(matcher);
+	freeMediaRange(mediaRange);
+	return 0;
+}
@@ -0,0 +1,269 @@
+/**
+ * Compares the throughput of transforming a body with an in process plugin
+ * against piping it through a transform command, as TRANSFORM_BODY does.
+ *
+ * Both get the body in slices of the size of the proxy buffers. The plugin
+ * is loaded with dlopen and called on the slices, the command is launched
+ * with transformerSpawn() and fed through its non blocking pipes with poll.
+ * The CPU time includes the command, so it counts the context switches and
+ * copies through the pipes. The defaults compare the sample plugin with the
+ * command that does the same transformation.
+ */
+#include <dlfcn.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <httpdPlugin.h>
+#include <transformerSpawn.h>
+
+/* Same as BUFFER_SIZE in httpProxyADT.h */
+#define SLICE_SIZE 4000
+#define SOURCE_SIZE (1024 * 1024)
+#define DEFAULT_MEGABYTES 256
+#define DEFAULT_PLUGIN "./../plugins/uppercase.so"
+#define DEFAULT_COMMAND "tr a-z A-Z"
+#define LETTERS "abcdefghijklmnopqrstuvwxyz ABC"
+
+struct result {
+	double seconds;
+	double cpuSeconds;
+	/* Sum of the output, the same for both when they agree */
+	unsigned long long checksum;
+};
+
+static uint8_t source[SOURCE_SIZE];
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double cpuTime(int who) {
+	struct rusage usage;
+	getrusage(who, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+		   usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+/* Adds the output by words, so that checking it costs little */
+static unsigned long long sum(const uint8_t *data, size_t length) {
+	unsigned long long total = 0, word;
+	size_t i;
+
+	for (i = 0; i + sizeof(word) <= length; i += sizeof(word)) {
+		memcpy(&word, data + i, sizeof(word));
+		total += word;
+	}
+	for (; i < length; i++) {
+		total += data[i];
+	}
+	return total;
+}
+
+/* The slice of the body that starts at offset */
+static const uint8_t *slice(unsigned long long offset, size_t *length) {
+	size_t start = offset % SOURCE_SIZE;
+
+	if (*length > SOURCE_SIZE - start) {
+		*length = SOURCE_SIZE - start;
+	}
+	return source + start;
+}
+
+static int runPlugin(const struct httpdPlugin *plugin, unsigned long long total,
+					 struct result *result) {
+	uint8_t out[SLICE_SIZE];
+	unsigned long long offset = 0;
+	size_t length, consumed, produced;
+	const uint8_t *in;
+	void *state;
+	double start = now(), cpuStart = cpuTime(RUSAGE_SELF);
+	int status;
+
+	if ((state = plugin->init("")) == NULL) {
+		return -1;
+	}
+
+	result->checksum = 0;
+	while (offset < total) {
+		length = total - offset < SLICE_SIZE ? total - offset : SLICE_SIZE;
+		in	   = slice(offset, &length);
+
+		// What is left of the slice is given again, as the proxy does
+		while (length > 0) {
+			if (plugin->process(state, in, length, &consumed, out, sizeof(out),
+								&produced) != HTTPD_PLUGIN_OK ||
+				(consumed == 0 && produced == 0)) {
+				plugin->destroy(state);
+				return -1;
+			}
+			result->checksum += sum(out, produced);
+			in += consumed;
+			length -= consumed;
+			offset += consumed;
+		}
+	}
+
+	do {
+		status = plugin->finish(state, out, sizeof(out), &produced);
+		result->checksum += sum(out, produced);
+	} while (status == HTTPD_PLUGIN_MORE);
+	plugin->destroy(state);
+
+	result->seconds	   = now() - start;
+	result->cpuSeconds = cpuTime(RUSAGE_SELF) - cpuStart;
+	return status == HTTPD_PLUGIN_OK ? 0 : -1;
+}
+
+static int runCommand(const char *command, unsigned long long total,
+					  struct result *result) {
+	uint8_t out[SLICE_SIZE];
+	unsigned long long offset = 0;
+	struct pollfd fds[2];
+	int toFd, fromFd, status, ret = 0;
+	double start	= now();
+	double cpuStart = cpuTime(RUSAGE_SELF) + cpuTime(RUSAGE_CHILDREN);
+	pid_t pid		= transformerSpawn(command, 0, -1, &toFd, &fromFd);
+
+	if (pid == -1) {
+		return -1;
+	}
+
+	result->checksum = 0;
+	fds[0].fd		 = fromFd;
+	fds[0].events	 = POLLIN;
+	fds[1].fd		 = toFd;
+	fds[1].events	 = POLLOUT;
+
+	while (fds[0].fd != -1) {
+		if (poll(fds, 2, -1) == -1) {
+			ret = -1;
+			break;
+		}
+
+		if (fds[1].revents != 0) {
+			size_t length =
+				total - offset < SLICE_SIZE ? total - offset : SLICE_SIZE;
+			const uint8_t *in = slice(offset, &length);
+			ssize_t written	  = write(toFd, in, length);
+
+			if (written > 0) {
+				offset += written;
+			}
+			else if (errno != EAGAIN) {
+				ret = -1;
+				break;
+			}
+			if (offset == total) {
+				close(toFd);
+				fds[1].fd = toFd = -1;
+			}
+		}
+
+		if (fds[0].revents != 0) {
+			ssize_t bytesRead = read(fromFd, out, sizeof(out));
+
+			if (bytesRead > 0) {
+				result->checksum += sum(out, bytesRead);
+			}
+			else if (bytesRead == 0) {
+				fds[0].fd = -1;
+			}
+			else if (errno != EAGAIN) {
+				ret = -1;
+				break;
+			}
+		}
+	}
+
+	if (toFd != -1) {
+		close(toFd);
+	}
+	close(fromFd);
+	if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) ||
+		WEXITSTATUS(status) != 0) {
+		ret = -1;
+	}
+
+	result->seconds	   = now() - start;
+	result->cpuSeconds = cpuTime(RUSAGE_SELF) + cpuTime(RUSAGE_CHILDREN) -
+						 cpuStart;
+	return ret;
+}
+
+static void printResult(const char *mode, unsigned megabytes,
+						struct result *result) {
+	printf("%-8s %10.1f %14.2f\n", mode, megabytes / result->seconds,
+		   result->cpuSeconds * 1024 / megabytes);
+}
+
+int main(int argc, char *argv[]) {
+	unsigned megabytes	= DEFAULT_MEGABYTES;
+	const char *path	= DEFAULT_PLUGIN;
+	const char *command = DEFAULT_COMMAND;
+	const struct httpdPlugin *plugin;
+	struct result pluginResult, commandResult;
+	unsigned long long total;
+	void *handle;
+
+	if (argc > 1) {
+		megabytes = strtoul(argv[1], NULL, 10);
+	}
+	if (argc > 2) {
+		path = argv[2];
+	}
+	if (argc > 3) {
+		command = argv[3];
+	}
+	total = (unsigned long long) megabytes << 20;
+
+	/* Text, so that both transformations change part of it */
+	for (size_t i = 0; i < SOURCE_SIZE; i++) {
+		source[i] = i % 64 == 63 ? '\n' : LETTERS[i % (sizeof(LETTERS) - 1)];
+	}
+
+	/* The proxy ignores SIGPIPE */
+	signal(SIGPIPE, SIG_IGN);
+
+	handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if (handle == NULL) {
+		fprintf(stderr, "%s\n", dlerror());
+		return 1;
+	}
+	plugin = dlsym(handle, HTTPD_PLUGIN_SYMBOL);
+	if (plugin == NULL || plugin->apiVersion != HTTPD_PLUGIN_API_VERSION) {
+		fprintf(stderr, "%s does not export a valid %s\n", path,
+				HTTPD_PLUGIN_SYMBOL);
+		return 1;
+	}
+
+	if (runPlugin(plugin, total, &pluginResult) == -1) {
+		fprintf(stderr, "The plugin failed\n");
+		return 1;
+	}
+	if (runCommand(command, total, &commandResult) == -1) {
+		fprintf(stderr, "The command failed\n");
+		return 1;
+	}
+
+	printf("%-8s %10s %14s\n", "mode", "MB/s", "CPU s per GB");
+	printResult("plugin", megabytes, &pluginResult);
+	printResult("pipe", megabytes, &commandResult);
+	if (pluginResult.checksum != commandResult.checksum) {
+		printf("The outputs differ\n");
+	}
+
+	dlclose(handle);
+	return 0;
+}
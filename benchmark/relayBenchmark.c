@@ -0,0 +1,243 @@
+/**
+ * Compares the two ways the proxy relays a body between the origin and the
+ * client sockets: copying it through a user space buffer with recv()/send()
+ * and moving it through a pipe with splice().
+ *
+ * A writer thread pushes the body into a TCP loopback connection and a reader
+ * thread drains another one, the relay in between runs on the main thread so
+ * that its CPU time can be measured alone.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <spliceRelay.h>
+
+/* Same as BUFFER_SIZE in httpProxyADT.h */
+#define COPY_BUFFER_SIZE 4000
+#define WRITER_CHUNK (64 * 1024)
+#define DEFAULT_MEGABYTES 2048
+
+struct peer {
+	int fd;
+	unsigned long long bytes;
+};
+
+static double now(clockid_t clock) {
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Connects fds[0] to fds[1] through 127.0.0.1 */
+static int tcpPair(int fds[2]) {
+	struct sockaddr_in address = {.sin_family = AF_INET};
+	socklen_t length		   = sizeof(address);
+	int listenFd			   = socket(AF_INET, SOCK_STREAM, 0);
+	int ret					   = -1;
+
+	fds[0] = fds[1]			= -1;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (listenFd == -1 ||
+		bind(listenFd, (struct sockaddr *) &address, sizeof(address)) == -1 ||
+		listen(listenFd, 1) == -1 ||
+		getsockname(listenFd, (struct sockaddr *) &address, &length) == -1 ||
+		(fds[0] = socket(AF_INET, SOCK_STREAM, 0)) == -1 ||
+		connect(fds[0], (struct sockaddr *) &address, sizeof(address)) == -1 ||
+		(fds[1] = accept(listenFd, NULL, NULL)) == -1) {
+		goto finally;
+	}
+	ret = 0;
+
+finally:
+	if (listenFd != -1) {
+		close(listenFd);
+	}
+	return ret;
+}
+
+static void *writer(void *data) {
+	struct peer *peer = data;
+	static char chunk[WRITER_CHUNK];
+	unsigned long long left = peer->bytes;
+
+	memset(chunk, 'x', sizeof(chunk));
+
+	while (left > 0) {
+		size_t length = left < sizeof(chunk) ? left : sizeof(chunk);
+		ssize_t n	 = send(peer->fd, chunk, length, 0);
+		if (n <= 0) {
+			break;
+		}
+		left -= n;
+	}
+
+	shutdown(peer->fd, SHUT_WR);
+	return NULL;
+}
+
+static void *reader(void *data) {
+	struct peer *peer = data;
+	static char chunk[WRITER_CHUNK];
+	ssize_t n;
+
+	peer->bytes = 0;
+	while ((n = recv(peer->fd, chunk, sizeof(chunk), 0)) > 0) {
+		peer->bytes += n;
+	}
+
+	return NULL;
+}
+
+/* Waits until fd is ready for events, the relay fds do not block */
+static int waitFor(int fd, short events) {
+	struct pollfd pfd = {.fd = fd, .events = events};
+	return poll(&pfd, 1, -1) == 1 ? 0 : -1;
+}
+
+static int copyRelay(int in, int out) {
+	char buffer[COPY_BUFFER_SIZE];
+	ssize_t n, sent;
+
+	while (1) {
+		n = recv(in, buffer, sizeof(buffer), 0);
+		if (n == 0) {
+			return 0;
+		}
+		if (n < 0) {
+			if (errno != EAGAIN || waitFor(in, POLLIN) == -1) {
+				return -1;
+			}
+			continue;
+		}
+		for (ssize_t off = 0; off < n; off += sent) {
+			sent = send(out, buffer + off, n - off, 0);
+			if (sent < 0) {
+				if (errno != EAGAIN || waitFor(out, POLLOUT) == -1) {
+					return -1;
+				}
+				sent = 0;
+			}
+		}
+	}
+}
+
+static int spliceRelayLoop(int in, int out) {
+	struct spliceRelay relay;
+	ssize_t n;
+	int ret = -1;
+
+	spliceRelayInit(&relay);
+	if (spliceRelayOpen(&relay) == -1) {
+		return -1;
+	}
+
+	while (1) {
+		n = spliceRelayFill(&relay, in, SIZE_MAX);
+		if (n == 0) {
+			ret = 0;
+			break;
+		}
+		if (n < 0) {
+			if (errno != EAGAIN || waitFor(in, POLLIN) == -1) {
+				break;
+			}
+			continue;
+		}
+		while (relay.buffered > 0) {
+			if (spliceRelayDrain(&relay, out) < 0 &&
+				(errno != EAGAIN || waitFor(out, POLLOUT) == -1)) {
+				goto finally;
+			}
+		}
+	}
+
+finally:
+	spliceRelayClose(&relay);
+	return ret;
+}
+
+/*
+ * Relays megabytes through relayFunction, prints the throughput and the CPU
+ * the relay thread spent per GB
+ */
+static void runBenchmark(const char *name, int (*relayFunction)(int, int),
+						 unsigned long long megabytes) {
+	int origin[] = {-1, -1};
+	int client[] = {-1, -1};
+	struct peer source, sink;
+	pthread_t writerThread, readerThread;
+	double wall, cpu;
+	int status;
+
+	if (tcpPair(origin) == -1 || tcpPair(client) == -1) {
+		printf("%-8s %s (%s)\n", name, "failed", strerror(errno));
+		goto finally;
+	}
+
+	fcntl(origin[1], F_SETFL, O_NONBLOCK);
+	fcntl(client[0], F_SETFL, O_NONBLOCK);
+
+	source = (struct peer){.fd = origin[0], .bytes = megabytes << 20};
+	sink   = (struct peer){.fd = client[1], .bytes = 0};
+
+	wall = now(CLOCK_MONOTONIC);
+	cpu  = now(CLOCK_THREAD_CPUTIME_ID);
+
+	pthread_create(&writerThread, NULL, writer, &source);
+	pthread_create(&readerThread, NULL, reader, &sink);
+
+	status = relayFunction(origin[1], client[0]);
+	shutdown(client[0], SHUT_WR);
+
+	cpu  = now(CLOCK_THREAD_CPUTIME_ID) - cpu;
+	pthread_join(writerThread, NULL);
+	pthread_join(readerThread, NULL);
+	wall = now(CLOCK_MONOTONIC) - wall;
+
+	if (status == -1 || sink.bytes != source.bytes) {
+		printf("%-8s %s (%s)\n", name, "failed", strerror(errno));
+	}
+	else {
+		double gigabytes = sink.bytes / (double) (1 << 30);
+		printf("%-8s %10llu %12.0f %14.3f\n", name, megabytes,
+			   sink.bytes / wall / (1 << 20), cpu / gigabytes);
+	}
+
+finally:
+	for (unsigned i = 0; i < 2; i++) {
+		if (origin[i] != -1) {
+			close(origin[i]);
+		}
+		if (client[i] != -1) {
+			close(client[i]);
+		}
+	}
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long long megabytes = DEFAULT_MEGABYTES;
+
+	if (argc > 1) {
+		megabytes = strtoull(argv[1], NULL, 10);
+	}
+
+	printf("%-8s %10s %12s %14s\n", "relay", "MB", "MB/s", "cpu s/GB");
+	runBenchmark("copy", copyRelay, megabytes);
+	runBenchmark("splice", spliceRelayLoop, megabytes);
+
+	return 0;
+}
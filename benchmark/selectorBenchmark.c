@@ -0,0 +1,149 @@
+/**
+ * Measures the cost of one selector_select() iteration as the number of idle
+ * registered connections grows, for every available selector backend.
+ *
+ * Each idle connection is one end of a socketpair registered with OP_READ
+ * that never becomes ready. A single active pipe is written before every
+ * iteration so that each loop dispatches exactly one ready descriptor.
+ */
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include <selector.h>
+
+#define ITERATIONS 20000
+#define SELECT_MAX_IDLE 500 /* two fds per idle connection, FD_SETSIZE bound */
+
+static const unsigned idleQuantities[] = {0, 100, 250, 500, 1000, 2000, 5000, 10000};
+
+static void activeRead(struct selector_key *key) {
+	char c;
+	if (read(key->fd, &c, 1) < 0) {
+		perror("read");
+	}
+}
+
+static void idleRead(struct selector_key *key) {
+	fprintf(stderr, "idle fd %d became ready\n", key->fd);
+}
+
+static const struct fd_handler activeHandler = {.handle_read = activeRead};
+static const struct fd_handler idleHandler   = {.handle_read = idleRead};
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void raiseFdLimit(void) {
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+}
+
+/* Returns the mean nanoseconds per iteration or a negative value on error */
+static double runBenchmark(selector_backend backend, unsigned idleQuantity) {
+	const struct selector_init conf = {
+		.signal			= SIGALRM,
+		.select_timeout = {.tv_sec = 1, .tv_nsec = 0},
+		.backend		= backend,
+	};
+	double ret		 = -1;
+	int activePipe[] = {-1, -1};
+	int *idleFds	 = calloc(2 * idleQuantity + 1, sizeof(int));
+	unsigned opened	= 0;
+	fd_selector s	  = NULL;
+
+	if (idleFds == NULL || selector_init(&conf) != SELECTOR_SUCCESS ||
+		(s = selector_new(1024)) == NULL || pipe(activePipe) == -1) {
+		goto finally;
+	}
+
+	for (; opened < idleQuantity; opened++) {
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, idleFds + 2 * opened) == -1) {
+			goto finally;
+		}
+		if (selector_register(s, idleFds[2 * opened], &idleHandler, OP_READ,
+							  NULL) != SELECTOR_SUCCESS) {
+			close(idleFds[2 * opened]);
+			close(idleFds[2 * opened + 1]);
+			goto finally;
+		}
+	}
+
+	if (selector_register(s, activePipe[0], &activeHandler, OP_READ, NULL) !=
+		SELECTOR_SUCCESS) {
+		goto finally;
+	}
+
+	double start = now();
+	for (unsigned i = 0; i < ITERATIONS; i++) {
+		if (write(activePipe[1], "x", 1) != 1 ||
+			selector_select(s) != SELECTOR_SUCCESS) {
+			goto finally;
+		}
+	}
+	ret = (now() - start) * 1e9 / ITERATIONS;
+
+finally:
+	if (s != NULL) {
+		selector_destroy(s);
+	}
+	for (unsigned i = 0; i < 2 * opened; i++) {
+		close(idleFds[i]);
+	}
+	for (unsigned i = 0; i < 2; i++) {
+		if (activePipe[i] != -1) {
+			close(activePipe[i]);
+		}
+	}
+	free(idleFds);
+	selector_close();
+	return ret;
+}
+
+int main(void) {
+	const selector_backend backends[] = {SELECTOR_BACKEND_SELECT,
+										 SELECTOR_BACKEND_EPOLL};
+	selector_backend available;
+
+	raiseFdLimit();
+	printf("%-8s %12s %16s\n", "backend", "idle conns", "ns/iteration");
+
+	for (unsigned b = 0; b < N(backends); b++) {
+		const char *name = selector_backend_name(backends[b]);
+		if (selector_backend_from_name(name, &available) == -1) {
+			printf("%-8s %12s %16s\n", name, "-", "unsupported");
+			continue;
+		}
+		for (unsigned i = 0; i < N(idleQuantities); i++) {
+			if (backends[b] == SELECTOR_BACKEND_SELECT &&
+				idleQuantities[i] > SELECT_MAX_IDLE) {
+				printf("%-8s %12u %16s\n", name, idleQuantities[i],
+					   "over FD_SETSIZE");
+				continue;
+			}
+			double ns = runBenchmark(backends[b], idleQuantities[i]);
+			if (ns < 0) {
+				printf("%-8s %12u %16s (%s)\n", name, idleQuantities[i],
+					   "failed", strerror(errno));
+			}
+			else {
+				printf("%-8s %12u %16.0f\n", name, idleQuantities[i], ns);
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,150 @@
+/**
+ * Measures how long launching a transform command takes as the resident
+ * memory of the proxy grows, for fork()+exec() (the old launch) and for
+ * transformerSpawn(), that uses posix_spawn().
+ *
+ * The command is "exit 0", so the time until the child exits is mostly the
+ * launch. fork() copies the page tables of the parent and its cost grows with
+ * the resident memory, posix_spawn() does not copy them.
+ */
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+#include <transformerSpawn.h>
+
+#define DEFAULT_ITERATIONS 200
+#define COMMAND "exit 0"
+
+static const unsigned residentMegabytes[] = {0, 64, 256, 1024};
+
+struct launchTimes {
+	/* Until the launch call returns and until the child exits, in us */
+	double call;
+	double total;
+};
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* The launch used by executeTransformCommand() before posix_spawn */
+static pid_t forkExec(const char *command, int *toFd, int *fromFd) {
+	int inputPipe[2], outputPipe[2];
+	pid_t pid;
+
+	if (pipe(inputPipe) == -1) {
+		return -1;
+	}
+	if (pipe(outputPipe) == -1) {
+		close(inputPipe[0]);
+		close(inputPipe[1]);
+		return -1;
+	}
+
+	pid = fork();
+	if (pid == 0) {
+		dup2(inputPipe[0], STDIN_FILENO);
+		dup2(outputPipe[1], STDOUT_FILENO);
+		close(inputPipe[1]);
+		close(outputPipe[0]);
+		execl("/bin/sh", "sh", "-c", command, (char *) 0);
+		_exit(127);
+	}
+
+	close(inputPipe[0]);
+	close(outputPipe[1]);
+	*toFd   = inputPipe[1];
+	*fromFd = outputPipe[0];
+	return pid;
+}
+
+static pid_t posixSpawn(const char *command, int *toFd, int *fromFd) {
+	return transformerSpawn(command, 0, -1, toFd, fromFd);
+}
+
+static int runLaunches(pid_t (*launch)(const char *, int *, int *),
+					   unsigned iterations, struct launchTimes *times) {
+	double call = 0, total = 0;
+	int toFd, fromFd, status;
+
+	for (unsigned i = 0; i < iterations; i++) {
+		double start = now();
+		pid_t pid	= launch(COMMAND, &toFd, &fromFd);
+		double end;
+
+		if (pid == -1) {
+			return -1;
+		}
+		end = now();
+		close(toFd);
+		close(fromFd);
+
+		if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) ||
+			WEXITSTATUS(status) != 0) {
+			return -1;
+		}
+
+		call += end - start;
+		total += now() - start;
+	}
+
+	times->call  = call / iterations;
+	times->total = total / iterations;
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned iterations = DEFAULT_ITERATIONS;
+	char *resident		= NULL;
+	size_t residentSize = 0;
+	struct launchTimes forkTimes, spawnTimes;
+
+	if (argc > 1) {
+		iterations = strtoul(argv[1], NULL, 10);
+	}
+
+	/* The proxy ignores SIGPIPE, the children must not */
+	signal(SIGPIPE, SIG_IGN);
+
+	printf("%-8s %12s %12s %12s %12s\n", "RSS MB", "fork us", "fork+exit",
+		   "spawn us", "spawn+exit");
+
+	for (unsigned i = 0;
+		 i < sizeof(residentMegabytes) / sizeof(residentMegabytes[0]); i++) {
+		size_t size = (size_t) residentMegabytes[i] << 20;
+
+		/* Touches every page so that it is resident */
+		if (size > residentSize) {
+			char *grown = realloc(resident, size);
+			if (grown == NULL) {
+				printf("%-8u %s\n", residentMegabytes[i], strerror(errno));
+				break;
+			}
+			resident = grown;
+			memset(resident + residentSize, 1, size - residentSize);
+			residentSize = size;
+		}
+
+		if (runLaunches(forkExec, iterations, &forkTimes) == -1 ||
+			runLaunches(posixSpawn, iterations, &spawnTimes) == -1) {
+			printf("%-8u %s\n", residentMegabytes[i], "failed");
+			continue;
+		}
+
+		printf("%-8u %12.1f %12.1f %12.1f %12.1f\n", residentMegabytes[i],
+			   forkTimes.call, forkTimes.total, spawnTimes.call,
+			   spawnTimes.total);
+	}
+
+	free(resident);
+	return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * Measures the throughput of decoding a chunked body with the unchunkParser
+ * of TRANSFORM_BODY, walking every byte through parseChunkedInfoByChar (as
+ * it was decoded before) versus copying the data of the chunks in blocks with
+ * parseChunkedInfo.
+ *
+ * The body is random bytes, so that it holds NUL bytes, framed in chunks of
+ * a fixed size. It is given to the parser in reads of the size of the proxy
+ * buffers and the decoded bytes are consumed as the transform command would.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <unchunkParser.h>
+
+#define BODY_SIZE (4 * 1024 * 1024)
+#define DEFAULT_MEGABYTES 512
+
+static uint8_t body[BODY_SIZE];
+static uint8_t stateBuffer[STATE_BUFFER_SIZE];
+static uint8_t *chunked;
+static size_t chunkedLength;
+
+/* Stub of the connection, the parser only asks it for its buffer */
+uint8_t *getStateBuffer(struct http *s, unsigned index) {
+	return stateBuffer;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Frames body in chunks of chunkSize with an extension, as some origins do */
+static void frameBody(size_t chunkSize) {
+	size_t offset = 0, length;
+
+	free(chunked);
+	chunked		  = malloc(BODY_SIZE + (BODY_SIZE / chunkSize + 2) * 32);
+	chunkedLength = 0;
+
+	while (offset < BODY_SIZE) {
+		length = BODY_SIZE - offset < chunkSize ? BODY_SIZE - offset
+												: chunkSize;
+		chunkedLength += sprintf((char *) chunked + chunkedLength,
+								 "%zX;name=value\r\n", length);
+		memcpy(chunked + chunkedLength, body + offset, length);
+		chunkedLength += length;
+		memcpy(chunked + chunkedLength, "\r\n", 2);
+		chunkedLength += 2;
+		offset += length;
+	}
+	memcpy(chunked + chunkedLength, "0\r\n\r\n", 5);
+	chunkedLength += 5;
+}
+
+/* The loop of parseChunkedInfo before the blocks */
+static void parseChunkedBytes(struct unchunkParser *parser, buffer *input) {
+	while (buffer_can_read(input) &&
+		   buffer_can_write(&parser->unchunkedBuffer)) {
+		parseChunkedInfoByChar(buffer_read(input), parser);
+	}
+}
+
+/* Decodes the body once, returns FALSE if the output is not the body */
+static int decode(struct unchunkParser *parser, int blocks) {
+	struct selector_key key = {.data = NULL};
+	uint8_t data[BUFFER_SIZE];
+	size_t offset = 0, decoded = 0, length;
+	buffer input;
+	uint8_t *pointer;
+	int equal = TRUE;
+
+	unchunkParserInit(parser, &key);
+	buffer_init(&input, sizeof(data), data);
+
+	while (offset < chunkedLength || buffer_can_read(&input)) {
+		buffer_compact(&input);
+		pointer = buffer_write_ptr(&input, &length);
+		if (length > chunkedLength - offset) {
+			length = chunkedLength - offset;
+		}
+		memcpy(pointer, chunked + offset, length);
+		buffer_write_adv(&input, length);
+		offset += length;
+
+		if (blocks) {
+			parseChunkedInfo(parser, &input);
+		}
+		else {
+			parseChunkedBytes(parser, &input);
+		}
+
+		pointer = buffer_read_ptr(&parser->unchunkedBuffer, &length);
+		if (decoded + length > BODY_SIZE ||
+			memcmp(pointer, body + decoded, length) != 0) {
+			equal = FALSE;
+		}
+		decoded += length;
+		buffer_read_adv(&parser->unchunkedBuffer, length);
+	}
+
+	return equal && decoded == BODY_SIZE;
+}
+
+static void measure(size_t chunkSize, unsigned megabytes) {
+	static struct unchunkParser parser;
+	unsigned iterations = megabytes / (BODY_SIZE >> 20);
+	double seconds[2];
+	int equal = TRUE;
+
+	if (iterations == 0) {
+		iterations = 1;
+	}
+	frameBody(chunkSize);
+
+	for (int blocks = 0; blocks < 2; blocks++) {
+		double start = now();
+		for (unsigned i = 0; i < iterations; i++) {
+			equal &= decode(&parser, blocks);
+		}
+		seconds[blocks] = now() - start;
+	}
+
+	printf("%10zu %10.2f %10.2f %8.2fx\n", chunkSize,
+		   (double) chunkedLength * iterations / seconds[0] / 1e9,
+		   (double) chunkedLength * iterations / seconds[1] / 1e9,
+		   seconds[0] / seconds[1]);
+	if (!equal) {
+		printf("The decoded body differs\n");
+	}
+}
+
+int main(int argc, char *argv[]) {
+	static const size_t chunkSizes[] = {64, 1024, 4000, 16384, 65536};
+	unsigned megabytes				 = DEFAULT_MEGABYTES;
+
+	if (argc > 1) {
+		megabytes = strtoul(argv[1], NULL, 10);
+	}
+
+	srand(1);
+	for (size_t i = 0; i < BODY_SIZE; i++) {
+		body[i] = rand();
+	}
+
+	printf("%10s %10s %10s %9s\n", "chunk", "byte GB/s", "block GB/s",
+		   "speedup");
+	for (size_t i = 0; i < SIZE_OF_ARRAY(chunkSizes); i++) {
+		measure(chunkSizes[i], megabytes);
+	}
+
+	free(chunked);
+	return 0;
+}
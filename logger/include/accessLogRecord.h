@@ -0,0 +1,42 @@
+#ifndef ACCESS_LOG_RECORD_H
+#define ACCESS_LOG_RECORD_H
+
+#include <stdint.h>
+
+/* Layout of the records, changes if fields are added */
+#define ACCESS_LOG_RECORD_VERSION 1
+/* Durations of a request, in the order of enum latency of the proxy */
+#define ACCESS_LOG_DURATIONS 6
+#define ACCESS_LOG_FAMILY_UNKNOWN 0
+#define ACCESS_LOG_FAMILY_IPV4 4
+#define ACCESS_LOG_FAMILY_IPV6 6
+
+/*
+ * A served request in the binary access log, access.bin. The fields are
+ * big-endian and aligned so the layout has no padding: the file is the
+ * records one after the other and can be read on any host.
+ */
+struct accessLogRecord {
+	/* Microseconds since the epoch when the request was served */
+	uint64_t time;
+	uint64_t bytesToOrigin;
+	uint64_t bytesToClient;
+	/* Microseconds of parse, DNS, connect, first byte, transform and of the
+	 * whole request, 0 if it was not measured */
+	uint32_t durations[ACCESS_LOG_DURATIONS];
+	/* 4 bytes for IPv4 and 16 for IPv6 */
+	uint8_t clientAddress[16];
+	uint8_t originAddress[16];
+	uint16_t clientPort;
+	uint16_t originPort;
+	/* 0 if no response was sent */
+	uint16_t status;
+	uint8_t clientFamily;
+	uint8_t originFamily;
+	/* enum methodType */
+	uint8_t method;
+	uint8_t version;
+	uint8_t reserved[6];
+};
+
+#endif
@@ -2,27 +2,85 @@
 #define LOGGER_H
 
 #include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <httpProxyADT.h>
 
 #define FAILED 0
 #define OK 1
 
-#define LOG_TYPES 3
+#define LOG_TYPES 4
 
-enum logTypes { ACCESS_LOG, DEBUG_LOG, ERROR_LOG };
+/* Access log entries queued for the logger thread, a power of two */
+#define ACCESS_LOG_RING_SIZE 1024
+/* Most entries the logger thread writes at once */
+#define ACCESS_LOG_BATCH 64
+/* Longest first line of a request or response kept, longer ones are cut */
+#define ACCESS_LOG_LINE_SIZE 256
+
+/* Error log entries a call site can write at once, and per second after */
+#define ERROR_LOG_BURST 10
+#define ERROR_LOG_RATE 1
+
+enum logTypes { ACCESS_LOG, DEBUG_LOG, ERROR_LOG, ACCESS_BINARY_LOG };
 typedef enum logTypes log_t;
 
-enum communicationTypes { REQ, RESP };
+/* SERVED is the end of a request, only logged by the binary access log */
+enum communicationTypes { REQ, RESP, SERVED };
 typedef enum communicationTypes communication_t;
 
 enum errorOptions { SYS_ERROR, CUSTOM_ERROR };
 typedef enum errorOptions logError_t;
 
-/* Add a new entry (line) to an access log file called access.log */
+/* Starts the thread that writes the access log, returns -1 if it can not */
+int accessLogInit(void);
+
+/* Writes the queued access log entries and stops the logger thread, if it
+ * was started */
+void accessLogDestroy(void);
+
+/*
+ * Queues a new entry (line) for the access log file called access.log, the
+ * logger thread formats and writes it. When the access log is binary only
+ * the SERVED entries are queued, as records of access.bin. Only 1 of each
+ * sample rate requests is logged, plus the failed and the slow ones. If the
+ * queue is full the entry is dropped and counted, or the caller waits when
+ * the access log blocks.
+ */
 void logAccess(httpADT_t http, communication_t action);
 
-/* Add a new entry (line) to an error log file called error.log */
-void logError(char *errorMsg, logError_t errorType);
+/*
+ * Token bucket of a call site of logError, so that a failure repeated on
+ * every connection, as an origin going down, does not flood error.log
+ */
+struct errorLogLimit {
+	pthread_mutex_t mutex;
+	/* Millionths of an entry, up to ERROR_LOG_BURST entries */
+	uint64_t tokens;
+	/* Monotonic microseconds of the last refill, 0 before the first entry */
+	uint64_t lastRefill;
+	/* Entries dropped since the last one written */
+	uint64_t suppressed;
+};
+
+#define ERROR_LOG_LIMIT_INITIALIZER {PTHREAD_MUTEX_INITIALIZER, 0, 0, 0}
+
+/*
+ * Add a new entry (line) to an error log file called error.log, unless its
+ * call site used up its bucket. The first entry written after some were
+ * dropped is preceded by one with how many were.
+ */
+#define logError(errorMsg, errorType)                                          \
+	do {                                                                       \
+		static struct errorLogLimit errorLogLimit =                            \
+			ERROR_LOG_LIMIT_INITIALIZER;                                       \
+		logErrorLimited(&errorLogLimit, __FILE__, __LINE__, (errorMsg),        \
+						(errorType));                                          \
+	} while (0)
+
+/* What logError calls, limited by the bucket of its call site */
+void logErrorLimited(struct errorLogLimit *limit, const char *file, int line,
+					 char *errorMsg, logError_t errorType);
 
 /* Add a new entry (line) to a debug log file called debug.log */
 void logDebug(const char *debugMsg);
@@ -4,26 +4,78 @@
 #include <arpa/inet.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
 #include <logger.h>
+#include <accessLogRecord.h>
+#include <endian.h>
+#include <errno.h>
 #include <stdio.h>
 #include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
 #include <http.h>
+#include <loopClock.h>
 
 #define MAX_ENTRY_SIZE 512
 #define MAX_ADDR_SIZE 128
 #define MAX_PATH_SIZE 256
 #define MAX_TIME_SIZE 128
+#define RING_MASK (ACCESS_LOG_RING_SIZE - 1)
+#define TOKENS_PER_ENTRY 1000000
 
 char **logFilesPaths = NULL;
-char *client		 = NULL;
-char *host			 = NULL;
 char *dir			 = "./logs/";
 
+static pthread_mutex_t logFilesMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * What a worker knows of an access log entry, copied as it is so that the
+ * logger thread does the formatting
+ */
+struct accessRecord {
+	/* Microseconds since the epoch */
+	uint64_t time;
+	/* The logger thread finishes when it takes it */
+	uint8_t isLast;
+	communication_t action;
+	struct sockaddr_storage client;
+	/* AF_UNSPEC if the origin was not resolved */
+	struct sockaddr_storage origin;
+	char firstLine[ACCESS_LOG_LINE_SIZE];
+	/* Only for SERVED */
+	uint8_t method;
+	uint16_t status;
+	uint64_t bytesToOrigin;
+	uint64_t bytesToClient;
+	uint64_t durations[LATENCY_QTY];
+};
+
+/*
+ * Bounded multi-producer queue (D. Vyukov), as the one of the resolver. The
+ * workers take a cell with a CAS on the position and fill the record in
+ * place, the logger thread is the only consumer. The semaphore only makes
+ * the logger thread sleep while the ring is empty.
+ */
+struct ringCell {
+	uint64_t sequence;
+	struct accessRecord record;
+};
+
+static struct ringCell ring[ACCESS_LOG_RING_SIZE];
+static uint64_t enqueuePosition;
+static uint64_t dequeuePosition;
+static sem_t pendingRecords;
+static pthread_t loggerThread;
+static int isLoggerStarted = FALSE;
+/* Requests seen by the access log, to keep 1 of each sample rate */
+static uint64_t sampledRequests;
+
 int checkLogFileExistence(log_t type);
-int createAccessLogEntry(char *beginning, httpADT_t s, communication_t action);
+int createAccessLogEntry(char *beginning, const struct accessRecord *record);
 int createErrorLogEntry(char *beginning, char *errorMsg, logError_t errorType);
 int createDebugLogEntry(char *beginning, const char *debugMsg);
 int existsLogFilesArray();
@@ -32,35 +84,221 @@ int existsLogFile(log_t logType);
 int createLogFile(log_t type);
 int createDir();
 int createPath(char *newLogFilePath, log_t type);
-int writeTime(char **curr, const char *end);
-int writeFirstLine(httpADT_t s, communication_t action, char **curr,
-				   const char *end);
-int setClientAndHost(httpADT_t s, communication_t action);
-int writeClientAndHost(char **curr, const char *end, char *client, char *host,
-					   communication_t action);
+int writeTime(char **curr, const char *end, time_t t);
+int writeClientAndHost(char **curr, const char *end,
+					   const struct accessRecord *record);
 int writeCustomError(char *errorMsg, char **curr, const char *beginning);
 int writeSystemError(char **curr, const char *beginning, logError_t errorType);
 int writeLogElemToLogEntry(char **curr, const char *end, const char *format,
 						   const char *data);
 void writeToLog(log_t type, const char *logEntry);
+static int isAccessSampled(void);
+static int isAccessNotable(httpADT_t s, uint64_t duration);
+static void queueAccessRecord(httpADT_t http, communication_t action);
+static int takeErrorLogToken(struct errorLogLimit *limit,
+							 uint64_t *suppressed);
+static void writeErrorLogEntry(char *errorMsg, logError_t errorType);
+static struct ringCell *ringReserve(uint64_t *position);
+static void ringPublish(struct ringCell *cell, uint64_t position);
+static void fillAccessRecord(struct accessRecord *record, httpADT_t s,
+							 communication_t action);
+static void *accessLogRun(void *data);
+static void writeAccessLines(int *fd, struct iovec *lines, unsigned count);
+static size_t createBinaryAccessLogEntry(char *beginning,
+										 const struct accessRecord *record);
+static uint8_t getRawAddress(const struct sockaddr_storage *addr,
+							 uint8_t *raw, uint16_t *port);
+
+int accessLogInit(void) {
+	for (uint64_t i = 0; i < ACCESS_LOG_RING_SIZE; i++) {
+		ring[i].sequence = i;
+	}
+
+	enqueuePosition = 0;
+	dequeuePosition = 0;
+
+	if (sem_init(&pendingRecords, 0, 0) == -1) {
+		return -1;
+	}
+
+	if (pthread_create(&loggerThread, NULL, accessLogRun, NULL) != 0) {
+		sem_destroy(&pendingRecords);
+		return -1;
+	}
+
+	isLoggerStarted = TRUE;
+	return 0;
+}
+
+void accessLogDestroy(void) {
+	struct ringCell *cell;
+	uint64_t position;
+
+	if (!isLoggerStarted) {
+		return;
+	}
+
+	/* Queued after every entry, so they are written before it finishes */
+	while ((cell = ringReserve(&position)) == NULL) {
+		sched_yield();
+	}
+	cell->record.isLast = TRUE;
+	ringPublish(cell, position);
+
+	pthread_join(loggerThread, NULL);
+	sem_destroy(&pendingRecords);
+	isLoggerStarted = FALSE;
+}
 
 void logAccess(httpADT_t http, communication_t action) {
-	if (checkLogFileExistence(ACCESS_LOG) == FAILED) {
+	if (!isLoggerStarted ||
+		(action == SERVED) != getIsAccessLogBinary(getConfiguration())) {
+		return;
+	}
+
+	switch (action) {
+		case REQ:
+			// The response decides for the requests left out of the sample
+			setIsAccessLogged(http, isAccessSampled());
+			if (!getIsAccessLogged(http)) {
+				return;
+			}
+			break;
+		case RESP:
+			if (!getIsAccessLogged(http)) {
+				if (!isAccessNotable(http, getLatencyElapsed(
+											   http, REQUEST_LATENCY))) {
+					return;
+				}
+				queueAccessRecord(http, REQ);
+			}
+			break;
+		case SERVED:
+			if (!isAccessSampled() &&
+				!isAccessNotable(http, getLatency(http, REQUEST_LATENCY))) {
+				return;
+			}
+			break;
+	}
+
+	queueAccessRecord(http, action);
+}
+
+void logErrorLimited(struct errorLogLimit *limit, const char *file, int line,
+					 char *errorMsg, logError_t errorType) {
+	// Kept for SYS_ERROR, writing the suppressed entry can change it
+	int error = errno;
+	uint64_t suppressed;
+	char message[MAX_ENTRY_SIZE / 2];
+
+	if (!takeErrorLogToken(limit, &suppressed)) {
+		return;
+	}
+
+	if (suppressed > 0) {
+		snprintf(message, sizeof(message),
+				 "Suppressed %lu similar messages of %s:%d",
+				 (unsigned long) suppressed, file, line);
+		writeErrorLogEntry(message, CUSTOM_ERROR);
+	}
+
+	errno = error;
+	writeErrorLogEntry(errorMsg, errorType);
+}
+
+void logDebug(const char *debugMsg) {
+	if (checkLogFileExistence(DEBUG_LOG) == FAILED) {
 		return;
 	}
 
 	char *logEntry = malloc(MAX_ENTRY_SIZE);
 
-	if (createAccessLogEntry(logEntry, http, action) == FAILED) {
+	if (createDebugLogEntry(logEntry, debugMsg) == FAILED) {
 		free(logEntry);
 		return;
 	}
 
-	writeToLog(ACCESS_LOG, logEntry);
+	writeToLog(DEBUG_LOG, logEntry);
 	free(logEntry);
 }
 
-void logError(char *errorMsg, logError_t errorType) {
+/* Whether the request is the 1 of each sample rate that is logged */
+static int isAccessSampled(void) {
+	unsigned rate = getAccessLogSampleRate(getConfiguration());
+
+	return rate <= 1 ||
+		   __atomic_fetch_add(&sampledRequests, 1, __ATOMIC_RELAXED) % rate ==
+			   0;
+}
+
+/* Whether the request failed or took duration (us) from the slow threshold,
+ * which are logged out of the sample */
+static int isAccessNotable(httpADT_t s, uint64_t duration) {
+	int status = getResponseStatus(s);
+
+	return status == 0 || status >= 400 ||
+		   duration >=
+			   (uint64_t) getAccessLogSlowThreshold(getConfiguration()) * 1000;
+}
+
+static void queueAccessRecord(httpADT_t http, communication_t action) {
+	struct ringCell *cell;
+	uint64_t position;
+
+	while ((cell = ringReserve(&position)) == NULL) {
+		if (!getIsAccessLogBlocking(getConfiguration())) {
+			increaseAccessLogDrops();
+			return;
+		}
+		// Waits for the logger thread to free a cell
+		sched_yield();
+	}
+
+	fillAccessRecord(&cell->record, http, action);
+	ringPublish(cell, position);
+}
+
+/*
+ * Refills the bucket for the time since the last entry and takes an entry
+ * from it. Returns FALSE if it is empty, otherwise suppressed is how many
+ * entries were dropped before this one.
+ */
+static int takeErrorLogToken(struct errorLogLimit *limit,
+							 uint64_t *suppressed) {
+	const uint64_t capacity = (uint64_t) ERROR_LOG_BURST * TOKENS_PER_ENTRY;
+	uint64_t micros			= loopClockMonotonicMicros();
+	int isTaken				= FALSE;
+
+	pthread_mutex_lock(&limit->mutex);
+	if (limit->lastRefill == 0) {
+		limit->tokens	  = capacity;
+		limit->lastRefill = micros;
+	}
+	else if (micros > limit->lastRefill) {
+		// A second has as many microseconds as an entry has tokens. The clock
+		// of another worker can be behind, then nothing is refilled.
+		limit->tokens += (micros - limit->lastRefill) * ERROR_LOG_RATE;
+		if (limit->tokens > capacity) {
+			limit->tokens = capacity;
+		}
+		limit->lastRefill = micros;
+	}
+
+	if (limit->tokens >= TOKENS_PER_ENTRY) {
+		limit->tokens -= TOKENS_PER_ENTRY;
+		*suppressed		  = limit->suppressed;
+		limit->suppressed = 0;
+		isTaken			  = TRUE;
+	}
+	else {
+		limit->suppressed++;
+	}
+	pthread_mutex_unlock(&limit->mutex);
+
+	return isTaken;
+}
+
+static void writeErrorLogEntry(char *errorMsg, logError_t errorType) {
 	if (checkLogFileExistence(ERROR_LOG) == FAILED) {
 		return;
 	}
@@ -76,64 +314,273 @@ void logError(char *errorMsg, logError_t errorType) {
 	free(logEntry);
 }
 
-void logDebug(const char *debugMsg) {
-	if (checkLogFileExistence(DEBUG_LOG) == FAILED) {
+/*
+ * Takes the next free cell of the ring, or returns NULL if it is full. The
+ * cell is given to the logger thread by ringPublish once it is filled.
+ */
+static struct ringCell *ringReserve(uint64_t *position) {
+	uint64_t current = __atomic_load_n(&enqueuePosition, __ATOMIC_RELAXED);
+	struct ringCell *cell;
+
+	while (TRUE) {
+		cell			  = &ring[current & RING_MASK];
+		uint64_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+		int64_t diff	  = (int64_t) sequence - (int64_t) current;
+
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&enqueuePosition, &current,
+											current + 1, TRUE,
+											__ATOMIC_RELAXED,
+											__ATOMIC_RELAXED)) {
+				break;
+			}
+		}
+		else if (diff < 0) {
+			/* Full */
+			return NULL;
+		}
+		else {
+			current = __atomic_load_n(&enqueuePosition, __ATOMIC_RELAXED);
+		}
+	}
+
+	*position = current;
+	return cell;
+}
+
+static void ringPublish(struct ringCell *cell, uint64_t position) {
+	__atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+	sem_post(&pendingRecords);
+}
+
+/* Only copies, the time and the addresses are formatted by the logger */
+static void fillAccessRecord(struct accessRecord *record, httpADT_t s,
+							 communication_t action) {
+	buffer *line = action == REQ ? getRequestLineBuffer(s) :
+								   getResponseLineBuffer(s);
+	struct addrinfo *origin = getOriginResolutions(s);
+	size_t length = 0, count;
+	const char *data;
+
+	record->time   = loopClockWallMicros();
+	record->isLast = FALSE;
+	record->action = action;
+	memcpy(&record->client, getClientAddress(s), sizeof(record->client));
+	record->origin.ss_family = AF_UNSPEC;
+	if (origin != NULL) {
+		memcpy(&record->origin, origin->ai_addr, origin->ai_addrlen);
+	}
+
+	if (action == SERVED) {
+		// The address connected to, with its port, AF_UNSPEC if none was
+		memcpy(&record->origin, getOriginAddress(s), sizeof(record->origin));
+		record->method		  = getRequestMethod(s);
+		record->status		  = getResponseStatus(s);
+		record->bytesToOrigin = getBytesToOrigin(s);
+		record->bytesToClient = getBytesToClient(s);
+		for (unsigned i = 0; i < LATENCY_QTY; i++) {
+			record->durations[i] = getLatency(s, i);
+		}
 		return;
 	}
 
-	char *logEntry = malloc(MAX_ENTRY_SIZE);
+	// The first line without its end, cut if it does not fit
+	data = (const char *) buffer_read_ptr(line, &count);
+	while (length < count && length < ACCESS_LOG_LINE_SIZE - 1 &&
+		   data[length] != '\r' && data[length] != '\n' &&
+		   data[length] != '\0') {
+		length++;
+	}
+	memcpy(record->firstLine, data, length);
+	record->firstLine[length] = '\0';
+}
 
-	if (createDebugLogEntry(logEntry, debugMsg) == FAILED) {
-		free(logEntry);
+static void *accessLogRun(void *data) {
+	static char entries[ACCESS_LOG_BATCH][MAX_ENTRY_SIZE];
+	struct iovec lines[ACCESS_LOG_BATCH];
+	struct ringCell *cell;
+	int isLast = FALSE, fd = -1;
+	unsigned count;
+	size_t length;
+
+	while (!isLast) {
+		sem_wait(&pendingRecords);
+		count = 0;
+
+		// Takes the entries already queued, up to a batch, for one write
+		do {
+			cell = &ring[dequeuePosition & RING_MASK];
+
+			/* A producer may have taken the cell but not yet filled it */
+			while (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) !=
+				   dequeuePosition + 1) {
+				sched_yield();
+			}
+
+			isLast = cell->record.isLast;
+			if (isLast) {
+				length = 0;
+			}
+			else if (cell->record.action == SERVED) {
+				length =
+					createBinaryAccessLogEntry(entries[count], &cell->record);
+			}
+			else if (createAccessLogEntry(entries[count], &cell->record) ==
+					 OK) {
+				length = strlen(entries[count]);
+			}
+			else {
+				length = 0;
+			}
+
+			if (length > 0) {
+				lines[count].iov_base = entries[count];
+				lines[count].iov_len  = length;
+				count++;
+			}
+
+			__atomic_store_n(&cell->sequence,
+							 dequeuePosition + ACCESS_LOG_RING_SIZE,
+							 __ATOMIC_RELEASE);
+			dequeuePosition++;
+		} while (!isLast && count < ACCESS_LOG_BATCH &&
+				 sem_trywait(&pendingRecords) == 0);
+
+		writeAccessLines(&fd, lines, count);
+	}
+
+	if (fd != -1) {
+		close(fd);
+	}
+
+	return NULL;
+}
+
+/* The access log is opened once and kept open by the logger thread */
+static void writeAccessLines(int *fd, struct iovec *lines, unsigned count) {
+	log_t type = getIsAccessLogBinary(getConfiguration()) ? ACCESS_BINARY_LOG :
+															ACCESS_LOG;
+
+	if (count == 0) {
 		return;
 	}
 
-	writeToLog(DEBUG_LOG, logEntry);
-	free(logEntry);
+	if (*fd == -1) {
+		if (checkLogFileExistence(type) == FAILED) {
+			return;
+		}
+
+		pthread_mutex_lock(&logFilesMutex);
+		*fd = open(logFilesPaths[type], (O_WRONLY | O_APPEND));
+		pthread_mutex_unlock(&logFilesMutex);
+
+		if (*fd == -1) {
+			fprintf(stderr, "[LOG] Error: failed attempting to open the log "
+							"file in order to write to it\n");
+			return;
+		}
+	}
+
+	if (writev(*fd, lines, count) < 0) {
+		fprintf(stderr, "[LOG] Error: failed attempting to write a new entry "
+						"to the log file\n");
+	}
 }
 
 int checkLogFileExistence(log_t type) {
+	int ret = OK;
+
+	pthread_mutex_lock(&logFilesMutex);
+
 	if (!existsLogFilesArray()) {
 		createLogFilesArray();
 	}
 
 	if (!existsLogFile(type)) {
 		if (createLogFile(type) == FAILED) {
-			return FAILED;
+			ret = FAILED;
 		}
 	}
 
-	return OK;
-}
+	pthread_mutex_unlock(&logFilesMutex);
 
-int createAccessLogEntry(char *beginning, httpADT_t s, communication_t action) {
-	if (setClientAndHost(s, action) == FAILED) {
-		return FAILED;
-	}
+	return ret;
+}
 
+int createAccessLogEntry(char *beginning, const struct accessRecord *record) {
 	char **curr		= &beginning;
 	const char *end = beginning + MAX_ENTRY_SIZE;
 
-	if (writeTime(curr, end) == FAILED) {
+	if (writeTime(curr, end, record->time / 1000000) == FAILED) {
 		return FAILED;
 	}
 
-	if (writeClientAndHost(curr, end, client, host, action) == FAILED) {
+	if (writeClientAndHost(curr, end, record) == FAILED) {
 		return FAILED;
 	}
 
-	if (writeFirstLine(s, action, curr, end) == FAILED) {
+	if (writeLogElemToLogEntry(curr, end, "'%s'\n", record->firstLine) ==
+		FAILED) {
 		return FAILED;
 	}
 
 	return *curr < end ? OK : FAILED;
 }
 
+/* Returns the length of the record, the durations are cut to 32 bits */
+static size_t createBinaryAccessLogEntry(char *beginning,
+										 const struct accessRecord *record) {
+	struct accessLogRecord *binary = (struct accessLogRecord *) beginning;
+	uint16_t clientPort, originPort;
+
+	memset(binary, 0, sizeof(*binary));
+	binary->time		  = htobe64(record->time);
+	binary->bytesToOrigin = htobe64(record->bytesToOrigin);
+	binary->bytesToClient = htobe64(record->bytesToClient);
+	for (unsigned i = 0; i < ACCESS_LOG_DURATIONS; i++) {
+		uint64_t duration = record->durations[i];
+		binary->durations[i] =
+			htobe32(duration > UINT32_MAX ? UINT32_MAX : duration);
+	}
+	binary->clientFamily =
+		getRawAddress(&record->client, binary->clientAddress, &clientPort);
+	binary->originFamily =
+		getRawAddress(&record->origin, binary->originAddress, &originPort);
+	binary->clientPort = clientPort;
+	binary->originPort = originPort;
+	binary->status	   = htobe16(record->status);
+	binary->method	   = record->method;
+	binary->version	   = ACCESS_LOG_RECORD_VERSION;
+
+	return sizeof(*binary);
+}
+
+/* Copies the address and the port, which stays big-endian, of addr */
+static uint8_t getRawAddress(const struct sockaddr_storage *addr,
+							 uint8_t *raw, uint16_t *port) {
+	const struct sockaddr_in *ipv4	= (const struct sockaddr_in *) addr;
+	const struct sockaddr_in6 *ipv6 = (const struct sockaddr_in6 *) addr;
+
+	switch (addr->ss_family) {
+		case AF_INET:
+			memcpy(raw, &ipv4->sin_addr, sizeof(ipv4->sin_addr));
+			*port = ipv4->sin_port;
+			return ACCESS_LOG_FAMILY_IPV4;
+		case AF_INET6:
+			memcpy(raw, &ipv6->sin6_addr, sizeof(ipv6->sin6_addr));
+			*port = ipv6->sin6_port;
+			return ACCESS_LOG_FAMILY_IPV6;
+		default:
+			*port = 0;
+			return ACCESS_LOG_FAMILY_UNKNOWN;
+	}
+}
+
 int createErrorLogEntry(char *beginning, char *errorMsg, logError_t errorType) {
 	char **curr		= &beginning;
 	const char *end = beginning + MAX_ENTRY_SIZE;
 
-	if (writeTime(curr, end) == FAILED) {
+	if (writeTime(curr, end, loopClockWallSeconds()) == FAILED) {
 		return FAILED;
 	}
 
@@ -152,7 +599,7 @@ int createDebugLogEntry(char *beginning, const char *debugMsg) {
 	char **curr		= &beginning;
 	const char *end = beginning + MAX_ENTRY_SIZE;
 
-	if (writeTime(curr, end) == FAILED) {
+	if (writeTime(curr, end, loopClockWallSeconds()) == FAILED) {
 		return FAILED;
 	}
 
@@ -234,8 +681,11 @@ int createPath(char *newLogFilePath, log_t type) {
 	}
 
 	const char *log =
-		(type == ACCESS_LOG ? "access.log" :
-							  (type == DEBUG_LOG ? "debug.log" : "error.log"));
+		(type == ACCESS_LOG ?
+			 "access.log" :
+			 (type == ACCESS_BINARY_LOG ?
+				  "access.bin" :
+				  (type == DEBUG_LOG ? "debug.log" : "error.log")));
 
 	bytesWritten = snprintf(newLogFilePath + strlen(dir),
 							MAX_PATH_SIZE - strlen(dir), "%s", log);
@@ -249,78 +699,55 @@ int createPath(char *newLogFilePath, log_t type) {
 	return OK;
 }
 
-int getTime(char *buffer) {
-	time_t now		 = time(0);
-	int bytesWritten = snprintf(buffer, MAX_TIME_SIZE, "%s", ctime(&now));
+/*
+ * Formats t as ctime does, without the new line. The lines of a batch are
+ * mostly of the same second, so each thread keeps the last second formatted
+ * instead of converting it to local time for every line.
+ */
+int getTime(char *buffer, time_t t) {
+	static __thread time_t formattedSecond = -1;
+	static __thread char formattedTime[MAX_TIME_SIZE];
+
+	if (t != formattedSecond) {
+		char now[MAX_TIME_SIZE];
+		int bytesWritten =
+			snprintf(formattedTime, MAX_TIME_SIZE, "%s", ctime_r(&t, now));
+
+		if (bytesWritten >= MAX_TIME_SIZE) {
+			formattedSecond = -1;
+			return FAILED;
+		}
 
-	if (bytesWritten >= MAX_TIME_SIZE) {
-		return FAILED;
+		formattedTime[strlen(formattedTime) - 1] = '\0';
+		formattedSecond							 = t;
 	}
 
-	int len			= strlen(buffer);
-	buffer[len - 1] = '\0';
+	memcpy(buffer, formattedTime, MAX_TIME_SIZE);
 	return OK;
 }
 
-int writeTime(char **curr, const char *end) {
-	char *time = calloc(MAX_TIME_SIZE, sizeof(char));
+int writeTime(char **curr, const char *end, time_t t) {
+	char time[MAX_TIME_SIZE];
 
-	if (getTime(time) == FAILED) {
-		free(time);
+	if (getTime(time, t) == FAILED) {
 		return FAILED;
 	}
 
-	int couldWriteTime = writeLogElemToLogEntry(curr, end, "[%s] ", time);
-	free(time);
-	return couldWriteTime;
+	return writeLogElemToLogEntry(curr, end, "[%s] ", time);
 }
 
-char *determineCommunication(httpADT_t s, communication_t action) {
-	if (action == REQ) {
-		return (char *) ((getRequestLineBuffer(s))->data);
-	}
-	else { // RESP
-		return (char *) ((getResponseLineBuffer(s))->data);
-	}
-}
-
-int setFirstLine(httpADT_t s, communication_t action, char *firstLine) {
-	int bytesWritten = snprintf(firstLine, MAX_FIRST_LINE_LENGTH, "%s",
-								determineCommunication(s, action));
-
-	if (bytesWritten >= MAX_FIRST_LINE_LENGTH) {
-		fprintf(stderr,
-				"[LOG] Error: failed attempting to get the first line in "
-				"the request/response\n");
-		return FAILED;
-	}
-
-	return OK;
-}
+int getIpAddress(const struct sockaddr_storage *addr, char *buff) {
+	const void *ip = &((const struct sockaddr_in *) addr)->sin_addr;
 
-int writeFirstLine(httpADT_t s, communication_t action, char **curr,
-				   const char *end) {
-	char *firstLine = calloc(MAX_FIRST_LINE_LENGTH, sizeof(char));
-
-	if (setFirstLine(s, action, firstLine) == FAILED) {
-		free(firstLine);
-		return FAILED;
+	if (addr->ss_family == AF_INET6) {
+		ip = &((const struct sockaddr_in6 *) addr)->sin6_addr;
 	}
-
-	if (writeLogElemToLogEntry(curr, end, "'%s'\n", firstLine) == FAILED) {
-		free(firstLine);
-		return FAILED;
+	else if (addr->ss_family != AF_INET) {
+		snprintf(buff, MAX_ADDR_SIZE, "-");
+		return OK;
 	}
 
-	free(firstLine);
-	return OK;
-}
-
-int getIpAddress(struct sockaddr_in *addr, char *buff) {
-	int bytesWritten =
-		snprintf(buff, MAX_ADDR_SIZE, "%s", inet_ntoa(addr->sin_addr));
-
-	if (bytesWritten >= MAX_ADDR_SIZE) {
+	if (inet_ntop(addr->ss_family, ip, buff, MAX_ADDR_SIZE) == NULL) {
 		fprintf(stderr, "[LOG] Error: failed attempting to get the client "
 						"and host addresses\n");
 		return FAILED;
@@ -329,48 +756,26 @@ int getIpAddress(struct sockaddr_in *addr, char *buff) {
 	return OK;
 }
 
-int setClientAndHost(httpADT_t s, communication_t action) {
-	if (client == NULL) {
-		client = malloc(MAX_ADDR_SIZE);
-	}
-
-	if (host == NULL) {
-		host = malloc(MAX_ADDR_SIZE);
-	}
-
-	if (action == REQ) {
-		if (getIpAddress((struct sockaddr_in *) getClientAddress(s), client) ==
-			FAILED) {
-			free(client);
-			free(host);
-			return FAILED;
-		}
+int writeClientAndHost(char **curr, const char *end,
+					   const struct accessRecord *record) {
+	char client[MAX_ADDR_SIZE], host[MAX_ADDR_SIZE];
+	char *from = client, *to = host;
 
-		struct sockaddr *originIP = getOriginResolutions(s)->ai_addr;
-
-		if (getIpAddress((struct sockaddr_in *) originIP, host) == FAILED) {
-			free(client);
-			free(host);
-			return FAILED;
-		}
+	if (getIpAddress(&record->client, client) == FAILED ||
+		getIpAddress(&record->origin, host) == FAILED) {
+		return FAILED;
 	}
 
-	return OK;
-}
-
-int writeClientAndHost(char **curr, const char *end, char *client, char *host,
-					   communication_t action) {
-	if (action == RESP) {
-		char *aux = client;
-		client	= host;
-		host	  = aux;
+	if (record->action == RESP) {
+		from = host;
+		to	 = client;
 	}
 
-	if (writeLogElemToLogEntry(curr, end, "[%s --> ", client) == FAILED) {
+	if (writeLogElemToLogEntry(curr, end, "[%s --> ", from) == FAILED) {
 		return FAILED;
 	}
 
-	if (writeLogElemToLogEntry(curr, end, "%s] - ", host) == FAILED) {
+	if (writeLogElemToLogEntry(curr, end, "%s] - ", to) == FAILED) {
 		return FAILED;
 	}
 
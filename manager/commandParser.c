@@ -1,11 +1,27 @@
 #include <commandParser.h>
 #include <colors.h>
+#include <endian.h>
+
+/* The numbers of *set pool* and *set smp*, as big-endian 32-bits integers */
+static void setPairData(void **data, size_t *dataLength,
+						const uint32_t *numbers) {
+	uint32_t *pairData = malloc(2 * sizeof(*pairData));
+
+	pairData[0] = htobe32(numbers[0]);
+	pairData[1] = htobe32(numbers[1]);
+	*data		= pairData;
+	*dataLength = 2 * sizeof(*pairData);
+}
 
 int parseCommand(operation_t *operation, resId_t *id, void **data,
 				 size_t *dataLength) {
 	returnCode_t returnCode = IGNORE;
 	state_t currentState	= NOTHING;
 	char currentChar;
+	/* Watermarks of *set pool*, or rate and threshold of *set smp* */
+	uint32_t numbers[2] = {0, 0};
+	/* Resource the numbers are for */
+	resId_t pairId = NO_ID;
 	*data		= NULL;
 	*dataLength = 0;
 	*id			= NO_ID;
@@ -87,6 +103,15 @@ int parseCommand(operation_t *operation, resId_t *id, void **data,
 					case 'c':
 						currentState = GET_C;
 						break;
+					case 'p':
+						currentState = GET_P;
+						break;
+					case 'l':
+						currentState = GET_L;
+						break;
+					case 's':
+						currentState = GET_S;
+						break;
 					default:
 						returnCode = INVALID;
 				}
@@ -106,6 +131,12 @@ int parseCommand(operation_t *operation, resId_t *id, void **data,
 					case 'c':
 						currentState = SET_C;
 						break;
+					case 'p':
+						currentState = SET_P;
+						break;
+					case 's':
+						currentState = SET_S;
+						break;
 					default:
 						returnCode = INVALID;
 				}
@@ -150,6 +181,27 @@ int parseCommand(operation_t *operation, resId_t *id, void **data,
 					case 'b':
 						currentState = GET_MTR_B;
 						break;
+					case 'd':
+						currentState = GET_MTR_D;
+						break;
+					case 'u':
+						currentState = GET_MTR_U;
+						break;
+					case 't':
+						currentState = GET_MTR_T;
+						break;
+					case 'p':
+						currentState = GET_MTR_P;
+						break;
+					case 'l':
+						currentState = GET_MTR_L;
+						break;
+					case 'r':
+						currentState = GET_MTR_R;
+						break;
+					case 's':
+						currentState = GET_MTR_S;
+						break;
 					default:
 						returnCode = INVALID;
 				}
@@ -163,6 +215,72 @@ int parseCommand(operation_t *operation, resId_t *id, void **data,
 			case GET_MTR_B:
 				EXPECTS('t', GET_MTR_BT);
 				break;
+			case GET_MTR_D:
+				switch (currentChar) {
+					case 'q':
+						currentState = GET_MTR_DQ;
+						break;
+					case 'l':
+						currentState = GET_MTR_DL;
+						break;
+					case 'h':
+						currentState = GET_MTR_DH;
+						break;
+					case 'm':
+						currentState = GET_MTR_DM;
+						break;
+					default:
+						returnCode = INVALID;
+				}
+				break;
+			case GET_MTR_U:
+				switch (currentChar) {
+					case 'h':
+						currentState = GET_MTR_UH;
+						break;
+					case 'm':
+						currentState = GET_MTR_UM;
+						break;
+					default:
+						returnCode = INVALID;
+				}
+				break;
+			case GET_MTR_T:
+				switch (currentChar) {
+					case 'o':
+						currentState = GET_MTR_TO;
+						break;
+					case 'u':
+						currentState = GET_MTR_TU;
+						break;
+					default:
+						returnCode = INVALID;
+				}
+				break;
+			case GET_MTR_R:
+				EXPECTS('m', GET_MTR_RM);
+				break;
+			case GET_MTR_S:
+				EXPECTS('c', GET_MTR_SC);
+				break;
+			case GET_MTR_P:
+				switch (currentChar) {
+					case 's':
+						currentState = GET_MTR_PS;
+						break;
+					case 'h':
+						currentState = GET_MTR_PH;
+						break;
+					case 'm':
+						currentState = GET_MTR_PM;
+						break;
+					default:
+						returnCode = INVALID;
+				}
+				break;
+			case GET_MTR_L:
+				EXPECTS('d', GET_MTR_LD);
+				break;
 			case GET_MTR_CN:
 				EXPECTS_ENTER_ALLOWING_SPACES({
 					/* Set command information to *get mtr cn* */
@@ -187,6 +305,259 @@ int parseCommand(operation_t *operation, resId_t *id, void **data,
 					returnCode = NEW;
 				});
 				break;
+			case GET_MTR_DQ:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr dq* */
+					*operation = GET_OP;
+					*id		   = MTR_DQ_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_MTR_DL:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr dl* */
+					*operation = GET_OP;
+					*id		   = MTR_DL_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_MTR_DH:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr dh* */
+					*operation = GET_OP;
+					*id		   = MTR_DH_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_MTR_DM:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr dm* */
+					*operation = GET_OP;
+					*id		   = MTR_DM_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_MTR_UH:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr uh* */
+					*operation = GET_OP;
+					*id		   = MTR_UH_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_MTR_UM:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr um* */
+					*operation = GET_OP;
+					*id		   = MTR_UM_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_MTR_TO:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr to* */
+					*operation = GET_OP;
+					*id		   = MTR_TO_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_MTR_PS:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr ps* */
+					*operation = GET_OP;
+					*id		   = MTR_PS_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_MTR_PH:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr ph* */
+					*operation = GET_OP;
+					*id		   = MTR_PH_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_MTR_PM:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr pm* */
+					*operation = GET_OP;
+					*id		   = MTR_PM_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_MTR_LD:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr ld* */
+					*operation = GET_OP;
+					*id		   = MTR_LD_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_MTR_TU:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr tu* */
+					*operation = GET_OP;
+					*id		   = MTR_TU_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_MTR_RM:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr rm* */
+					*operation = GET_OP;
+					*id		   = MTR_RM_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_MTR_SC:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get mtr sc* */
+					*operation = GET_OP;
+					*id		   = MTR_SC_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_P:
+				EXPECTS('o', GET_PO);
+				break;
+			case GET_PO:
+				EXPECTS('o', GET_POO);
+				break;
+			case GET_POO:
+				EXPECTS('l', GET_POOL);
+				break;
+			case GET_POOL:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get pool* */
+					*operation = GET_OP;
+					*id		   = POOL_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_S:
+				EXPECTS('m', GET_SM);
+				break;
+			case GET_SM:
+				EXPECTS('p', GET_SMP);
+				break;
+			case GET_SMP:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get smp* */
+					*operation = GET_OP;
+					*id		   = SMP_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_L:
+				EXPECTS('a', GET_LA);
+				break;
+			case GET_LA:
+				EXPECTS('t', GET_LAT);
+				break;
+			case GET_LAT:
+				switch (currentChar) {
+					case '\t':
+					case ' ': /* space */
+						currentState = GET_LAT_;
+						break;
+					default:
+						returnCode = INVALID;
+				}
+				break;
+			case GET_LAT_:
+				switch (currentChar) {
+					case '\t':
+					case ' ': /* space */
+						/* Keeps current state */
+						break;
+					case 'p':
+						currentState = GET_LAT_P;
+						break;
+					case 'd':
+						currentState = GET_LAT_D;
+						break;
+					case 'c':
+						currentState = GET_LAT_C;
+						break;
+					case 'f':
+						currentState = GET_LAT_F;
+						break;
+					case 't':
+						currentState = GET_LAT_T;
+						break;
+					case 'r':
+						currentState = GET_LAT_R;
+						break;
+					default:
+						returnCode = INVALID;
+				}
+				break;
+			case GET_LAT_P:
+				EXPECTS('r', GET_LAT_PR);
+				break;
+			case GET_LAT_D:
+				EXPECTS('n', GET_LAT_DN);
+				break;
+			case GET_LAT_C:
+				EXPECTS('n', GET_LAT_CN);
+				break;
+			case GET_LAT_F:
+				EXPECTS('b', GET_LAT_FB);
+				break;
+			case GET_LAT_T:
+				EXPECTS('r', GET_LAT_TR);
+				break;
+			case GET_LAT_R:
+				EXPECTS('q', GET_LAT_RQ);
+				break;
+			case GET_LAT_PR:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get lat pr* */
+					*operation = GET_OP;
+					*id		   = LAT_PR_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_LAT_DN:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get lat dn* */
+					*operation = GET_OP;
+					*id		   = LAT_DN_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_LAT_CN:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get lat cn* */
+					*operation = GET_OP;
+					*id		   = LAT_CN_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_LAT_FB:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get lat fb* */
+					*operation = GET_OP;
+					*id		   = LAT_FB_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_LAT_TR:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get lat tr* */
+					*operation = GET_OP;
+					*id		   = LAT_TR_ID;
+					returnCode = NEW;
+				});
+				break;
+			case GET_LAT_RQ:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command information to *get lat rq* */
+					*operation = GET_OP;
+					*id		   = LAT_RQ_ID;
+					returnCode = NEW;
+				});
+				break;
 			case GET_C:
 				EXPECTS('m', GET_CM);
 				break;
@@ -363,6 +734,109 @@ int parseCommand(operation_t *operation, resId_t *id, void **data,
 						}
 				}
 				break;
+			case SET_P:
+				EXPECTS('o', SET_PO);
+				break;
+			case SET_PO:
+				EXPECTS('o', SET_POO);
+				break;
+			case SET_POO:
+				EXPECTS('l', SET_POOL);
+				break;
+			case SET_POOL:
+				pairId = POOL_ID;
+				EXPECTS_SPACE(SET_PAIR_);
+				break;
+			case SET_S:
+				EXPECTS('m', SET_SM);
+				break;
+			case SET_SM:
+				EXPECTS('p', SET_SMP);
+				break;
+			case SET_SMP:
+				pairId = SMP_ID;
+				EXPECTS_SPACE(SET_PAIR_);
+				break;
+			case SET_PAIR_:
+				switch (currentChar) {
+					case '\t':
+					case ' ': /* space */
+						/* Keeps current state */
+						break;
+					default:
+						if (isdigit(currentChar)) {
+							numbers[0] = currentChar - '0';
+							currentState  = SET_PAIR_FIRST;
+						}
+						else {
+							returnCode = INVALID;
+						}
+				}
+				break;
+			case SET_PAIR_FIRST:
+				switch (currentChar) {
+					case '\t':
+					case ' ': /* space */
+						currentState = SET_PAIR_FIRST_;
+						break;
+					default:
+						if (isdigit(currentChar)) {
+							numbers[0] =
+								numbers[0] * 10 + currentChar - '0';
+						}
+						else {
+							returnCode = INVALID;
+						}
+				}
+				break;
+			case SET_PAIR_FIRST_:
+				switch (currentChar) {
+					case '\t':
+					case ' ': /* space */
+						/* Keeps current state */
+						break;
+					default:
+						if (isdigit(currentChar)) {
+							numbers[1] = currentChar - '0';
+							currentState  = SET_PAIR_SECOND;
+						}
+						else {
+							returnCode = INVALID;
+						}
+				}
+				break;
+			case SET_PAIR_SECOND:
+				switch (currentChar) {
+					case '\t':
+					case ' ': /* space */
+						currentState = SET_PAIR_SECOND_;
+						break;
+					case '\n':
+						/* Set command info *set pool|smp first second* */
+						setPairData(data, dataLength, numbers);
+						*operation = SET_OP;
+						*id		   = pairId;
+						returnCode = NEW;
+						break;
+					default:
+						if (isdigit(currentChar)) {
+							numbers[1] =
+								numbers[1] * 10 + currentChar - '0';
+						}
+						else {
+							returnCode = INVALID;
+						}
+				}
+				break;
+			case SET_PAIR_SECOND_:
+				EXPECTS_ENTER_ALLOWING_SPACES({
+					/* Set command info *set pool|smp first second* */
+					setPairData(data, dataLength, numbers);
+					*operation = SET_OP;
+					*id		   = pairId;
+					returnCode = NEW;
+				});
+				break;
 			case SET_C:
 				EXPECTS('m', SET_CM);
 				break;
@@ -65,6 +65,27 @@ enum state_t {
 	GET_MTR_CN,
 	GET_MTR_H,
 	GET_MTR_HS,
+	GET_MTR_D,
+	GET_MTR_DQ,
+	GET_MTR_DL,
+	GET_MTR_DH,
+	GET_MTR_DM,
+	GET_MTR_U,
+	GET_MTR_UH,
+	GET_MTR_UM,
+	GET_MTR_T,
+	GET_MTR_TO,
+	GET_MTR_TU,
+	GET_MTR_R,
+	GET_MTR_RM,
+	GET_MTR_S,
+	GET_MTR_SC,
+	GET_MTR_P,
+	GET_MTR_PS,
+	GET_MTR_PH,
+	GET_MTR_PM,
+	GET_MTR_L,
+	GET_MTR_LD,
 	GET_C,
 	GET_CM,
 	GET_CMD,
@@ -73,6 +94,29 @@ enum state_t {
 	GET_MIME,
 	GET_T,
 	GET_TF,
+	GET_P,
+	GET_PO,
+	GET_POO,
+	GET_POOL,
+	GET_S,
+	GET_SM,
+	GET_SMP,
+	GET_L,
+	GET_LA,
+	GET_LAT,
+	GET_LAT_,
+	GET_LAT_P,
+	GET_LAT_PR,
+	GET_LAT_D,
+	GET_LAT_DN,
+	GET_LAT_C,
+	GET_LAT_CN,
+	GET_LAT_F,
+	GET_LAT_FB,
+	GET_LAT_T,
+	GET_LAT_TR,
+	GET_LAT_R,
+	GET_LAT_RQ,
 	S,
 	SE,
 	SET,
@@ -94,7 +138,19 @@ enum state_t {
 	SET_CM,
 	SET_CMD,
 	SET_CMD_,
-	SET_CMD_DATA
+	SET_CMD_DATA,
+	SET_P,
+	SET_PO,
+	SET_POO,
+	SET_POOL,
+	SET_S,
+	SET_SM,
+	SET_SMP,
+	SET_PAIR_,
+	SET_PAIR_FIRST,
+	SET_PAIR_FIRST_,
+	SET_PAIR_SECOND,
+	SET_PAIR_SECOND_
 };
 typedef enum state_t state_t;
 enum returnCode_t { IGNORE, INVALID, NEW, SEND };
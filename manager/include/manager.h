@@ -3,7 +3,37 @@
 #include <stdlib.h>
 #include <protocol.h>
 
-enum resId_t { NO_ID, MIME_ID, CMD_ID, MTR_CN_ID, MTR_HS_ID, MTR_BT_ID, TF_ID };
+enum resId_t {
+	NO_ID,
+	MIME_ID,
+	CMD_ID,
+	MTR_CN_ID,
+	MTR_HS_ID,
+	MTR_BT_ID,
+	TF_ID,
+	MTR_DQ_ID,
+	MTR_DL_ID,
+	MTR_DH_ID,
+	MTR_DM_ID,
+	MTR_UH_ID,
+	MTR_UM_ID,
+	MTR_TO_ID,
+	MTR_PS_ID,
+	MTR_PH_ID,
+	MTR_PM_ID,
+	POOL_ID,
+	LAT_PR_ID,
+	LAT_DN_ID,
+	LAT_CN_ID,
+	LAT_FB_ID,
+	LAT_TR_ID,
+	LAT_RQ_ID,
+	MTR_LD_ID,
+	SMP_ID,
+	MTR_RM_ID,
+	MTR_SC_ID,
+	MTR_TU_ID
+};
 typedef enum resId_t resId_t;
 
 #define ON 0x01
@@ -17,6 +47,6 @@ typedef enum resId_t resId_t;
 #define SET_STREAM 1
 #define BYE_STREAM 1
 
-#define ID_QUANTITY 9
+#define ID_QUANTITY 29
 
 #endif
@@ -11,6 +11,15 @@ timeTag_t timeTags[ID_QUANTITY] = {0};
 
 void *storedData[ID_QUANTITY] = {0};
 
+#define N(x) (sizeof(x) / sizeof((x)[0]))
+
+/* Labels of the counters of get mtr rm, get mtr sc and get mtr tu */
+static const char *const methodLabels[] = {"GET", "HEAD",	"POST",
+										   "PUT", "DELETE", "other"};
+static const char *const statusClassLabels[] = {"1xx", "2xx", "3xx", "4xx",
+												"5xx"};
+static const char *const transformUseLabels[] = {"command", "plugin"};
+
 typedef struct {
 	returnCode_t code;
 	operation_t operation;
@@ -36,6 +45,9 @@ static void printInvalidCommand();
 static void manageAndPrintResponse(response_t response);
 static void manageAndPrintGetResponse(response_t response);
 static void manageAndPrintSetResponse(response_t response);
+static void printLatency(const char *name, const uint64_t *percentiles);
+static void printCounters(const char *name, const char *const *labels,
+						  const uint64_t *counters, unsigned qty);
 static void printResponseHeader();
 static void printDottedSeparator();
 static void printContinuousSeparator();
@@ -423,6 +435,119 @@ static void manageAndPrintGetResponse(response_t response) {
 			printf("%ld\n\n", be64toh(*((uint64_t *) storedData[response.id])));
 			resetPrintStyle();
 			break;
+		case MTR_DQ_ID:
+			printf("Queued DNS resolutions = ");
+			setPrintStyle(BOLD_BLUE);
+			printf("%ld\n\n", be64toh(*((uint64_t *) storedData[response.id])));
+			resetPrintStyle();
+			break;
+		case MTR_DL_ID:
+			printf("Average DNS resolution latency = ");
+			setPrintStyle(BOLD_BLUE);
+			printf("%ld us\n\n",
+				   be64toh(*((uint64_t *) storedData[response.id])));
+			resetPrintStyle();
+			break;
+		case MTR_DH_ID:
+			printf("DNS cache hits = ");
+			setPrintStyle(BOLD_BLUE);
+			printf("%ld\n\n", be64toh(*((uint64_t *) storedData[response.id])));
+			resetPrintStyle();
+			break;
+		case MTR_DM_ID:
+			printf("DNS cache misses = ");
+			setPrintStyle(BOLD_BLUE);
+			printf("%ld\n\n", be64toh(*((uint64_t *) storedData[response.id])));
+			resetPrintStyle();
+			break;
+		case MTR_UH_ID:
+			printf("Requests over a reused origin connection = ");
+			setPrintStyle(BOLD_BLUE);
+			printf("%ld\n\n", be64toh(*((uint64_t *) storedData[response.id])));
+			resetPrintStyle();
+			break;
+		case MTR_UM_ID:
+			printf("Requests over a new origin connection = ");
+			setPrintStyle(BOLD_BLUE);
+			printf("%ld\n\n", be64toh(*((uint64_t *) storedData[response.id])));
+			resetPrintStyle();
+			break;
+		case MTR_TO_ID:
+			printf("Expired deadlines = ");
+			setPrintStyle(BOLD_BLUE);
+			printf("%ld\n\n", be64toh(*((uint64_t *) storedData[response.id])));
+			resetPrintStyle();
+			break;
+		case MTR_PS_ID:
+			printf("Free objects in the connection pools = ");
+			setPrintStyle(BOLD_BLUE);
+			printf("%ld\n\n", be64toh(*((uint64_t *) storedData[response.id])));
+			resetPrintStyle();
+			break;
+		case MTR_PH_ID:
+			printf("Objects taken from the connection pools = ");
+			setPrintStyle(BOLD_BLUE);
+			printf("%ld\n\n", be64toh(*((uint64_t *) storedData[response.id])));
+			resetPrintStyle();
+			break;
+		case MTR_PM_ID:
+			printf("Objects the connection pools did not have = ");
+			setPrintStyle(BOLD_BLUE);
+			printf("%ld\n\n", be64toh(*((uint64_t *) storedData[response.id])));
+			resetPrintStyle();
+			break;
+		case MTR_LD_ID:
+			printf("Dropped access log entries = ");
+			setPrintStyle(BOLD_BLUE);
+			printf("%ld\n\n", be64toh(*((uint64_t *) storedData[response.id])));
+			resetPrintStyle();
+			break;
+		case POOL_ID:
+			printf("Connection pool watermarks = ");
+			setPrintStyle(BOLD_BLUE);
+			printf("low %u, high %u\n\n",
+				   be32toh(((uint32_t *) storedData[response.id])[0]),
+				   be32toh(((uint32_t *) storedData[response.id])[1]));
+			resetPrintStyle();
+			break;
+		case SMP_ID:
+			printf("Access log sampling = ");
+			setPrintStyle(BOLD_BLUE);
+			printf("1 in %u, slow from %u ms\n\n",
+				   be32toh(((uint32_t *) storedData[response.id])[0]),
+				   be32toh(((uint32_t *) storedData[response.id])[1]));
+			resetPrintStyle();
+			break;
+		case MTR_RM_ID:
+			printCounters("Requests by method", methodLabels,
+						  storedData[response.id], N(methodLabels));
+			break;
+		case MTR_SC_ID:
+			printCounters("Responses by status class", statusClassLabels,
+						  storedData[response.id], N(statusClassLabels));
+			break;
+		case MTR_TU_ID:
+			printCounters("Transformed bodies", transformUseLabels,
+						  storedData[response.id], N(transformUseLabels));
+			break;
+		case LAT_PR_ID:
+			printLatency("Request parse latency", storedData[response.id]);
+			break;
+		case LAT_DN_ID:
+			printLatency("DNS latency", storedData[response.id]);
+			break;
+		case LAT_CN_ID:
+			printLatency("Origin connect latency", storedData[response.id]);
+			break;
+		case LAT_FB_ID:
+			printLatency("Origin first byte latency", storedData[response.id]);
+			break;
+		case LAT_TR_ID:
+			printLatency("Transform latency", storedData[response.id]);
+			break;
+		case LAT_RQ_ID:
+			printLatency("Request latency", storedData[response.id]);
+			break;
 		case TF_ID:
 			printf("Transformations state = ");
 			setPrintStyle(BOLD_BLUE);
@@ -441,6 +566,28 @@ static void manageAndPrintGetResponse(response_t response) {
 	resetPrintStyle();
 }
 
+/* The percentiles come as big-endian 64-bits integers of microseconds */
+static void printLatency(const char *name, const uint64_t *percentiles) {
+	printf("%s = ", name);
+	setPrintStyle(BOLD_BLUE);
+	printf("p50 %ld us, p90 %ld us, p99 %ld us, p999 %ld us\n\n",
+		   be64toh(percentiles[0]), be64toh(percentiles[1]),
+		   be64toh(percentiles[2]), be64toh(percentiles[3]));
+	resetPrintStyle();
+}
+
+static void printCounters(const char *name, const char *const *labels,
+						  const uint64_t *counters, unsigned qty) {
+	printf("%s = ", name);
+	setPrintStyle(BOLD_BLUE);
+	for (unsigned i = 0; i < qty; i++) {
+		printf("%s%s %ld", i == 0 ? "" : ", ", labels[i],
+			   be64toh(counters[i]));
+	}
+	printf("\n\n");
+	resetPrintStyle();
+}
+
 static void manageAndPrintSetResponse(response_t response) {
 	if (response.status.timeTagStatus == OK_STATUS) {
 		setPrintStyle(GREEN);
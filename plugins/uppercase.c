@@ -0,0 +1,48 @@
+/**
+ * Sample transformation plugin: converts the ASCII letters of the body to
+ * upper case, like the command "tr a-z A-Z". Build it with make on the
+ * plugins folder and select it with
+ *
+ *     httpd -t "plugin:./plugins/uppercase.so"
+ *
+ * It keeps no state between slices, so init returns the same state for every
+ * body and destroy has nothing to release.
+ */
+#include <httpdPlugin.h>
+
+static int state;
+
+static void *uppercaseInit(const char *arguments) {
+	return &state;
+}
+
+static int uppercaseProcess(void *state, const uint8_t *in, size_t inLength,
+							size_t *consumed, uint8_t *out, size_t outLength,
+							size_t *produced) {
+	size_t length = inLength < outLength ? inLength : outLength;
+
+	for (size_t i = 0; i < length; i++) {
+		out[i] = in[i] >= 'a' && in[i] <= 'z' ? in[i] - 'a' + 'A' : in[i];
+	}
+
+	*consumed = length;
+	*produced = length;
+	return HTTPD_PLUGIN_OK;
+}
+
+static int uppercaseFinish(void *state, uint8_t *out, size_t outLength,
+						   size_t *produced) {
+	*produced = 0;
+	return HTTPD_PLUGIN_OK;
+}
+
+static void uppercaseDestroy(void *state) {
+}
+
+const struct httpdPlugin httpdPlugin = {
+	.apiVersion = HTTPD_PLUGIN_API_VERSION,
+	.init		= uppercaseInit,
+	.process	= uppercaseProcess,
+	.finish		= uppercaseFinish,
+	.destroy	= uppercaseDestroy,
+};
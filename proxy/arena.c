@@ -0,0 +1,108 @@
+#include <arena.h>
+#include <utilities.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Alignment of every allocation, enough for pointers and integers */
+#define ARENA_ALIGN sizeof(void *)
+
+#define alignUp(a) (((a) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+static int addBlock(struct arena *arena, size_t size);
+
+void arenaInit(struct arena *arena, uint8_t *first, size_t size) {
+	arena->first	 = first;
+	arena->firstSize = first == NULL ? 0 : size;
+	arena->data		 = arena->first;
+	arena->size		 = arena->firstSize;
+	arena->used		 = 0;
+	arena->last		 = NULL;
+	arena->blocks	 = NULL;
+}
+
+void *arenaAlloc(struct arena *arena, size_t size) {
+	size_t start = alignUp(arena->used);
+
+	if (start > arena->size || size > arena->size - start) {
+		if (!addBlock(arena, size)) {
+			return NULL;
+		}
+		start = 0;
+	}
+
+	arena->last = arena->data + start;
+	arena->used = start + size;
+	return arena->last;
+}
+
+void *arenaGrow(struct arena *arena, void *pointer, size_t size,
+				size_t newSize) {
+	uint8_t *grown;
+
+	if (pointer != NULL && pointer == arena->last &&
+		newSize <= arena->size - (arena->last - arena->data)) {
+		arena->used = (arena->last - arena->data) + newSize;
+		return pointer;
+	}
+
+	grown = arenaAlloc(arena, newSize);
+	if (grown != NULL && pointer != NULL) {
+		memcpy(grown, pointer, size);
+	}
+	return grown;
+}
+
+char *arenaAddChar(struct arena *arena, char *string, unsigned int *sizeString,
+				   char c) {
+	unsigned int size = *sizeString;
+	char *ret		  = string;
+
+	// It is full when its size reaches a power of two from the first block
+	if (size == 0) {
+		ret = arenaGrow(arena, NULL, 0, ARENA_STRING_BLOCK);
+	}
+	else if (size >= ARENA_STRING_BLOCK && (size & (size - 1)) == 0) {
+		ret = arenaGrow(arena, string, size, 2 * size);
+	}
+
+	if (ret == NULL) {
+		*sizeString = 0;
+		return NULL;
+	}
+
+	ret[size]	= c;
+	*sizeString = size + 1;
+	return ret;
+}
+
+void arenaReset(struct arena *arena) {
+	struct arenaBlock *block, *next;
+
+	for (block = arena->blocks; block != NULL; block = next) {
+		next = block->next;
+		free(block);
+	}
+	arenaInit(arena, arena->first, arena->firstSize);
+}
+
+static int addBlock(struct arena *arena, size_t size) {
+	struct arenaBlock *block;
+
+	if (size < ARENA_SIZE) {
+		size = ARENA_SIZE;
+	}
+
+	block = malloc(sizeof(*block) + size);
+	if (block == NULL) {
+		return FALSE;
+	}
+
+	block->next	  = arena->blocks;
+	block->size	  = size;
+	arena->blocks = block;
+	arena->data	  = block->data;
+	arena->size	  = size;
+	arena->used	  = 0;
+	return TRUE;
+}
@@ -0,0 +1,26 @@
+#include <bufferPool.h>
+#include <slabPool.h>
+
+/* Each worker has its own pool, so it is not locked */
+static __thread struct slabPool pool =
+	SLAB_POOL_INITIALIZER(struct connectionBuffers);
+
+struct connectionBuffers *bufferPoolGet(void) {
+	return slabPoolGet(&pool);
+}
+
+void bufferPoolPut(struct connectionBuffers *buffers) {
+	slabPoolPut(&pool, buffers);
+}
+
+int bufferPoolFill(void) {
+	return slabPoolFill(&pool);
+}
+
+void bufferPoolTrim(void) {
+	slabPoolTrim(&pool);
+}
+
+void bufferPoolDestroy(void) {
+	slabPoolDestroy(&pool);
+}
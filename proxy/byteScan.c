@@ -0,0 +1,111 @@
+#include <byteScan.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define SCAN_HAS_SSE2
+#endif
+
+#if defined(SCAN_HAS_SSE2) && defined(__GNUC__) && defined(__x86_64__)
+/* Built without -mavx2, it is chosen at run time if the CPU has it */
+#define SCAN_HAS_AVX2
+#endif
+
+static size_t scanScalar(const uint8_t *data, size_t length,
+						 const uint8_t *set, unsigned setLength) {
+	for (size_t i = 0; i < length; i++) {
+		for (unsigned j = 0; j < setLength; j++) {
+			if (data[i] == set[j]) {
+				return i;
+			}
+		}
+	}
+	return length;
+}
+
+#ifdef SCAN_HAS_SSE2
+static size_t scanSse2(const uint8_t *data, size_t length,
+					   const uint8_t *set, unsigned setLength) {
+	__m128i targets[BYTE_SCAN_MAX_SET];
+	size_t i = 0;
+
+	for (unsigned j = 0; j < setLength; j++) {
+		targets[j] = _mm_set1_epi8((char) set[j]);
+	}
+
+	for (; i + sizeof(__m128i) <= length; i += sizeof(__m128i)) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *) (data + i));
+		__m128i found = _mm_cmpeq_epi8(chunk, targets[0]);
+		int mask;
+
+		for (unsigned j = 1; j < setLength; j++) {
+			found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, targets[j]));
+		}
+
+		mask = _mm_movemask_epi8(found);
+		if (mask != 0) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+
+	return i + scanScalar(data + i, length - i, set, setLength);
+}
+#endif
+
+#ifdef SCAN_HAS_AVX2
+__attribute__((target("avx2"))) static size_t
+scanAvx2(const uint8_t *data, size_t length, const uint8_t *set,
+		 unsigned setLength) {
+	__m256i targets[BYTE_SCAN_MAX_SET];
+	size_t i = 0;
+
+	for (unsigned j = 0; j < setLength; j++) {
+		targets[j] = _mm256_set1_epi8((char) set[j]);
+	}
+
+	for (; i + sizeof(__m256i) <= length; i += sizeof(__m256i)) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i *) (data + i));
+		__m256i found = _mm256_cmpeq_epi8(chunk, targets[0]);
+		unsigned mask;
+
+		for (unsigned j = 1; j < setLength; j++) {
+			found =
+				_mm256_or_si256(found, _mm256_cmpeq_epi8(chunk, targets[j]));
+		}
+
+		mask = (unsigned) _mm256_movemask_epi8(found);
+		if (mask != 0) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+
+	// The tail is shorter than 32 bytes, 16 of them may still be compared
+	return i + scanSse2(data + i, length - i, set, setLength);
+}
+#endif
+
+size_t byteScan(const uint8_t *data, size_t length, const uint8_t *set,
+				unsigned setLength) {
+#ifdef SCAN_HAS_AVX2
+	if (__builtin_cpu_supports("avx2")) {
+		return scanAvx2(data, length, set, setLength);
+	}
+#endif
+#ifdef SCAN_HAS_SSE2
+	return scanSse2(data, length, set, setLength);
+#else
+	return scanScalar(data, length, set, setLength);
+#endif
+}
+
+const char *byteScanImplementation(void) {
+#ifdef SCAN_HAS_AVX2
+	if (__builtin_cpu_supports("avx2")) {
+		return "avx2";
+	}
+#endif
+#ifdef SCAN_HAS_SSE2
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,131 @@
+#include <chunkWriter.h>
+#include <utilities.h>
+
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+static const char hexaDigits[] = "0123456789abcdef";
+
+static void addToTrailer(struct chunkWriter *writer, const char *bytes,
+						 size_t length) {
+	memcpy(writer->trailer + writer->trailerLength, bytes, length);
+	writer->trailerLength += length;
+}
+
+void chunkWriterInit(struct chunkWriter *writer) {
+	memset(writer, 0, sizeof(*writer));
+	writer->payload = NULL;
+}
+
+void chunkWriterPrepare(struct chunkWriter *writer, buffer *payload) {
+	uint8_t digits[2 * sizeof(size_t)];
+	size_t length;
+	int i = 0;
+
+	if (writer->isFinished || chunkWriterHasData(writer)) {
+		return;
+	}
+
+	buffer_read_ptr(payload, &length);
+
+	if (length == 0) {
+		/* An empty chunk would be taken as the last one */
+		return;
+	}
+
+	writer->payload		  = payload;
+	writer->payloadLength = length;
+
+	do {
+		digits[i++] = hexaDigits[length & 0xF];
+		length >>= 4;
+	} while (length > 0);
+
+	writer->headerLength = 0;
+	while (i > 0) {
+		writer->header[writer->headerLength++] = digits[--i];
+	}
+	writer->header[writer->headerLength++] = '\r';
+	writer->header[writer->headerLength++] = '\n';
+	writer->headerSent					   = 0;
+
+	writer->trailerLength = 0;
+	writer->trailerSent	  = 0;
+	addToTrailer(writer, "\r\n", 2);
+}
+
+void chunkWriterFinish(struct chunkWriter *writer) {
+	if (writer->isFinished) {
+		return;
+	}
+
+	if (!chunkWriterHasData(writer)) {
+		writer->trailerLength = 0;
+		writer->trailerSent	  = 0;
+	}
+
+	addToTrailer(writer, "0\r\n\r\n", 5);
+	writer->isFinished = TRUE;
+}
+
+int chunkWriterHasData(struct chunkWriter *writer) {
+	return writer->headerSent < writer->headerLength ||
+		   writer->payloadLength > 0 ||
+		   writer->trailerSent < writer->trailerLength;
+}
+
+int chunkWriterIsFinished(struct chunkWriter *writer) {
+	return writer->isFinished;
+}
+
+ssize_t chunkWriterSend(struct chunkWriter *writer, int fd) {
+	struct iovec iov[3];
+	struct msghdr message = {0};
+	size_t count		  = 0;
+	size_t readable, consumed;
+	ssize_t bytesSent, left;
+
+	if (writer->headerSent < writer->headerLength) {
+		iov[count].iov_base  = writer->header + writer->headerSent;
+		iov[count++].iov_len = writer->headerLength - writer->headerSent;
+	}
+
+	if (writer->payloadLength > 0) {
+		iov[count].iov_base  = buffer_read_ptr(writer->payload, &readable);
+		iov[count++].iov_len = writer->payloadLength;
+	}
+
+	if (writer->trailerSent < writer->trailerLength) {
+		iov[count].iov_base  = writer->trailer + writer->trailerSent;
+		iov[count++].iov_len = writer->trailerLength - writer->trailerSent;
+	}
+
+	message.msg_iov	   = iov;
+	message.msg_iovlen = count;
+	bytesSent		   = sendmsg(fd, &message, 0);
+
+	if (bytesSent <= 0) {
+		return bytesSent;
+	}
+
+	/* Consumes the sent bytes from the header, the data and the trailer */
+	left = bytesSent;
+
+	consumed = writer->headerLength - writer->headerSent;
+	consumed = (size_t) left < consumed ? (size_t) left : consumed;
+	writer->headerSent += consumed;
+	left -= consumed;
+
+	consumed = writer->payloadLength;
+	consumed = (size_t) left < consumed ? (size_t) left : consumed;
+	if (consumed > 0) {
+		buffer_read_adv(writer->payload, consumed);
+		writer->payloadLength -= consumed;
+		left -= consumed;
+	}
+
+	writer->trailerSent += left;
+
+	return bytesSent;
+}
@@ -7,9 +7,18 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <limits.h>
+
+/* Options whose argument is a non negative number */
+#define NUMERIC_OPTIONS "acdHikKnNopPrRsTuw"
+
+/* Highest TCP or SCTP port */
+#define MAX_PORT 65535
 
 void printfDefaultMessage(int option, char *value);
-static unsigned stringToNumber(char *stringNumber);
+static int stringToNumber(const char *stringNumber, unsigned *number);
 
 int readOptions(const int argc, char *const *argv) {
 	initializeConfigBaseValues(getConfiguration());
@@ -17,12 +26,74 @@ int readOptions(const int argc, char *const *argv) {
 	int i			   = 1;
 	int params		   = 0;
 	opterr			   = 0;
-	char *validOptions = "e:hl:L:M:o:p:t:v";
+	char *validOptions =
+		"a:A:c:d:e:F:hH:i:k:K:l:L:M:n:N:o:p:P:r:R:s:S:t:T:u:vw:";
+	selector_backend backend;
+	unsigned number;
 
 	while (i < argc && (option = getopt(argc, argv, validOptions)) != -1) {
+		if (strchr(NUMERIC_OPTIONS, option) != NULL &&
+			stringToNumber(optarg, &number) == -1) {
+			fprintf(stderr, "Invalid number for option -%c: %s\n", option,
+					optarg);
+			return -1;
+		}
+
 		switch (option) {
+			case 'a':
+				if (number < 1) {
+					fprintf(stderr, "Invalid access log sample rate: %s\n",
+							optarg);
+					return -1;
+				}
+				setAccessLogSampleRate(getConfiguration(), number);
+				params++;
+				break;
+
+			case 'A':
+				if (strcmp(optarg, "block") == 0) {
+					setIsAccessLogBlocking(getConfiguration(), TRUE);
+				}
+				else if (strcmp(optarg, "drop") == 0) {
+					setIsAccessLogBlocking(getConfiguration(), FALSE);
+				}
+				else {
+					fprintf(stderr, "Invalid access log policy: %s\n", optarg);
+					return -1;
+				}
+				params++;
+				break;
+
+			case 'c':
+				setConnectTimeout(getConfiguration(), number);
+				params++;
+				break;
+
+			case 'd':
+				setDnsCacheTtl(getConfiguration(), number);
+				params++;
+				break;
+
 			case 'e':
-				setCommandStderrFd(getConfiguration(), open(optarg, O_WRONLY));
+				if (openCommandStderr(getConfiguration(), optarg) == -1) {
+					fprintf(stderr, "Can not open %s: %s\n", optarg,
+							strerror(errno));
+					return -1;
+				}
+				params++;
+				break;
+
+			case 'F':
+				if (strcmp(optarg, "binary") == 0) {
+					setIsAccessLogBinary(getConfiguration(), TRUE);
+				}
+				else if (strcmp(optarg, "text") == 0) {
+					setIsAccessLogBinary(getConfiguration(), FALSE);
+				}
+				else {
+					fprintf(stderr, "Invalid access log format: %s\n", optarg);
+					return -1;
+				}
 				params++;
 				break;
 
@@ -30,6 +101,26 @@ int readOptions(const int argc, char *const *argv) {
 				printHelpMessage();
 				break;
 
+			case 'H':
+				setHeaderTimeout(getConfiguration(), number);
+				params++;
+				break;
+
+			case 'i':
+				setClientIdleTimeout(getConfiguration(), number);
+				params++;
+				break;
+
+			case 'k':
+				setUpstreamMaxIdle(getConfiguration(), number);
+				params++;
+				break;
+
+			case 'K':
+				setUpstreamIdleTimeout(getConfiguration(), number);
+				params++;
+				break;
+
 			case 'l':
 				setHttpInterfaces(getConfiguration(), optarg);
 				params++;
@@ -45,12 +136,59 @@ int readOptions(const int argc, char *const *argv) {
 				params++;
 				break;
 
+			case 'n':
+				setPoolLowWatermark(getConfiguration(), number);
+				params++;
+				break;
+
+			case 'N':
+				setPoolHighWatermark(getConfiguration(), number);
+				params++;
+				break;
+
 			case 'o':
-				setManagementPort(getConfiguration(), stringToNumber(optarg));
+				if (number > MAX_PORT) {
+					fprintf(stderr, "Invalid management port: %s\n", optarg);
+					return -1;
+				}
+				setManagementPort(getConfiguration(), number);
 				params++;
 				break;
 			case 'p':
-				setHttpPort(getConfiguration(), stringToNumber(optarg));
+				if (number > MAX_PORT) {
+					fprintf(stderr, "Invalid proxy port: %s\n", optarg);
+					return -1;
+				}
+				setHttpPort(getConfiguration(), number);
+				params++;
+				break;
+
+			case 'P':
+				setTransformPoolSize(getConfiguration(), number);
+				params++;
+				break;
+
+			case 'r':
+				setClientMaxRequests(getConfiguration(), number);
+				params++;
+				break;
+
+			case 'R':
+				setResponseTimeout(getConfiguration(), number);
+				params++;
+				break;
+
+			case 's':
+				setAccessLogSlowThreshold(getConfiguration(), number);
+				params++;
+				break;
+
+			case 'S':
+				if (selector_backend_from_name(optarg, &backend) == -1) {
+					fprintf(stderr, "Invalid selector backend: %s\n", optarg);
+					return -1;
+				}
+				setSelectorBackend(getConfiguration(), backend);
 				params++;
 				break;
 
@@ -59,10 +197,29 @@ int readOptions(const int argc, char *const *argv) {
 				params++;
 				break;
 
+			case 'T':
+				setTransformTimeout(getConfiguration(), number);
+				params++;
+				break;
+
+			case 'u':
+				setUpstreamMaxPerOrigin(getConfiguration(), number);
+				params++;
+				break;
+
 			case 'v':
 				printVersion(option, NULL);
 				break;
 
+			case 'w':
+				if (number < 1 || number > MAX_WORKERS) {
+					fprintf(stderr, "Invalid workers quantity: %s\n", optarg);
+					return -1;
+				}
+				setWorkers(getConfiguration(), number);
+				params++;
+				break;
+
 			case '?':
 				if (NEEDS_ARGUMENT(optopt)) {
 					fprintf(stderr, "Option -%c requires an argument.\n",
@@ -79,6 +236,12 @@ int readOptions(const int argc, char *const *argv) {
 		params++;
 	}
 
+	if (getPoolLowWatermark(getConfiguration()) >
+		getPoolHighWatermark(getConfiguration())) {
+		fprintf(stderr, "The pool low watermark exceeds the high one\n");
+		return -1;
+	}
+
 	// returns the quantity of parameters read
 	return params;
 }
@@ -96,12 +259,25 @@ void printVersion() {
 	printf("HTTPPROXY version 1.0.0 (Ubuntu 16.04.10)\n\n");
 }
 
-static unsigned stringToNumber(char *stringNumber) {
-	unsigned number = stringNumber[0] - '0';
-	int i			= 1;
-	while (stringNumber[i]) {
-		number = number * 10 + stringNumber[i] - '0';
-		i++;
+/* Returns -1 if stringNumber is not a number that fits in an unsigned */
+static int stringToNumber(const char *stringNumber, unsigned *number) {
+	unsigned long long value = 0;
+
+	if (*stringNumber == '\0') {
+		return -1;
+	}
+
+	for (; *stringNumber; stringNumber++) {
+		if (!isdigit((unsigned char) *stringNumber)) {
+			return -1;
+		}
+
+		value = value * 10 + (*stringNumber - '0');
+		if (value > UINT_MAX) {
+			return -1;
+		}
 	}
-	return number;
+
+	*number = value;
+	return 0;
 }
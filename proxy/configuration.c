@@ -3,6 +3,8 @@
 #include <netinet/in.h>
 #include <utilities.h>
 #include <management.h>
+#include <unistd.h>
+#include <pthread.h>
 
 struct configuration {
 	unsigned short httpPort;
@@ -10,10 +12,34 @@ struct configuration {
 	char *httpInterfaces;
 	char *managementInterfaces;
 	MediaRangePtr_t mediaRange;
-	char *command;
+	/* Compiled from mediaRange, replaced as a whole when the list changes */
+	MediaRangeMatcherPtr_t mediaRangeMatcher;
+	unsigned mediaRangeGeneration;
+	/* Replaced as a whole when management sets another command */
+	TransformCommandPtr_t command;
+	unsigned commandGeneration;
 	uint8_t isTransformationOn;
 	int commandStderrFd;
 	char *commandStderrPath;
+	selector_backend selectorBackend;
+	unsigned workers;
+	unsigned connectTimeout;
+	unsigned dnsCacheTtl;
+	unsigned upstreamMaxIdle;
+	unsigned upstreamIdleTimeout;
+	unsigned upstreamMaxPerOrigin;
+	unsigned clientIdleTimeout;
+	unsigned clientMaxRequests;
+	unsigned headerTimeout;
+	unsigned responseTimeout;
+	unsigned transformTimeout;
+	unsigned transformPoolSize;
+	unsigned poolLowWatermark;
+	unsigned poolHighWatermark;
+	uint8_t isAccessLogBlocking;
+	uint8_t isAccessLogBinary;
+	unsigned accessLogSampleRate;
+	unsigned accessLogSlowThreshold;
 };
 
 static struct configuration config = {
@@ -22,15 +48,62 @@ static struct configuration config = {
 	.httpInterfaces		  = NULL,
 	.managementInterfaces = NULL,
 	.mediaRange			  = NULL,
+	.mediaRangeMatcher	  = NULL,
+	.mediaRangeGeneration = 0,
 	.command			  = NULL,
+	.commandGeneration	  = 0,
 	.commandStderrFd	  = INVALID_FD,
 	.commandStderrPath	= "/dev/null",
 	.isTransformationOn   = FALSE,
+	.selectorBackend	  = SELECTOR_BACKEND_DEFAULT,
+	.workers			  = DEFAULT_WORKERS,
+	.connectTimeout		  = DEFAULT_CONNECT_TIMEOUT,
+	.dnsCacheTtl		  = DEFAULT_DNS_CACHE_TTL,
+	.upstreamMaxIdle	  = DEFAULT_UPSTREAM_MAX_IDLE,
+	.upstreamIdleTimeout  = DEFAULT_UPSTREAM_IDLE_TIMEOUT,
+	.upstreamMaxPerOrigin = DEFAULT_UPSTREAM_MAX_PER_ORIGIN,
+	.clientIdleTimeout	= DEFAULT_CLIENT_IDLE_TIMEOUT,
+	.clientMaxRequests	= DEFAULT_CLIENT_MAX_REQUESTS,
+	.headerTimeout		  = DEFAULT_HEADER_TIMEOUT,
+	.responseTimeout	  = DEFAULT_RESPONSE_TIMEOUT,
+	.transformTimeout	  = DEFAULT_TRANSFORM_TIMEOUT,
+	.transformPoolSize	  = DEFAULT_TRANSFORM_POOL_SIZE,
+	.poolLowWatermark	  = DEFAULT_POOL_LOW_WATERMARK,
+	.poolHighWatermark	  = DEFAULT_POOL_HIGH_WATERMARK,
+	.isAccessLogBlocking  = FALSE,
+	.isAccessLogBinary	  = FALSE,
+	.accessLogSampleRate	= DEFAULT_ACCESS_LOG_SAMPLE_RATE,
+	.accessLogSlowThreshold = DEFAULT_ACCESS_LOG_SLOW_THRESHOLD,
 };
 
+/* Guards the swap of the matcher against workers taking a reference */
+static pthread_mutex_t matcherMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* The matcher each worker took last and the generation it belongs to */
+static __thread MediaRangeMatcherPtr_t workerMatcher;
+static __thread unsigned workerMatcherGeneration;
+
+/* The command line, freed when its last reference is released */
+struct transformCommand {
+	unsigned references;
+	char *line;
+};
+
+/* Guards the swap of the command against workers taking a reference */
+static pthread_mutex_t commandMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* The command each worker took last and the generation it belongs to */
+static __thread TransformCommandPtr_t workerCommand;
+static __thread unsigned workerCommandGeneration;
+
+static void updateMediaRangeMatcher(configurationADT config);
+static void replaceCommand(configurationADT config, char *line);
+
 void initializeConfigBaseValues(configurationADT config) {
-	config->commandStderrFd = open(STDERR_REDIRECT_DEFAULT, O_WRONLY);
+	config->commandStderrFd =
+		open(STDERR_REDIRECT_DEFAULT, O_WRONLY | O_CLOEXEC);
 	config->mediaRange		= createMediaRange(";");
+	updateMediaRangeMatcher(config);
 }
 
 configurationADT getConfiguration() {
@@ -40,10 +113,52 @@ configurationADT getConfiguration() {
 void resetMediaRangeList(configurationADT config) {
 	freeMediaRange(config->mediaRange);
 	config->mediaRange = createMediaRange(";");
+	updateMediaRangeMatcher(config);
 
 	generateAndUpdateTimeTag(MIME_ID);
 }
 
+void addToMediaRangeList(configurationADT config, char const *mediaRange) {
+	addMediaRange(config->mediaRange, mediaRange);
+	updateMediaRangeMatcher(config);
+}
+
+MediaRangeMatcherPtr_t getMediaRangeMatcher(configurationADT config) {
+	unsigned generation =
+		__atomic_load_n(&config->mediaRangeGeneration, __ATOMIC_ACQUIRE);
+
+	// The lock is only taken when management changed the list
+	if (workerMatcher == NULL || workerMatcherGeneration != generation) {
+		releaseMediaRangeMatcher(workerMatcher);
+		pthread_mutex_lock(&matcherMutex);
+		workerMatcher			= config->mediaRangeMatcher;
+		workerMatcherGeneration = config->mediaRangeGeneration;
+		retainMediaRangeMatcher(workerMatcher);
+		pthread_mutex_unlock(&matcherMutex);
+	}
+
+	retainMediaRangeMatcher(workerMatcher);
+	return workerMatcher;
+}
+
+/* Compiles the list again, the connections keep the matcher they have */
+static void updateMediaRangeMatcher(configurationADT config) {
+	MediaRangeMatcherPtr_t matcher = compileMediaRange(config->mediaRange);
+	MediaRangeMatcherPtr_t previous;
+
+	if (matcher == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&matcherMutex);
+	previous				  = config->mediaRangeMatcher;
+	config->mediaRangeMatcher = matcher;
+	__atomic_add_fetch(&config->mediaRangeGeneration, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&matcherMutex);
+
+	releaseMediaRangeMatcher(previous);
+}
+
 int getCommandStderrFd(configurationADT config) {
 	return config->commandStderrFd;
 }
@@ -60,6 +175,23 @@ void setCommandStderrPath(configurationADT config, char *errorPath) {
 	config->commandStderrPath = errorPath;
 }
 
+int openCommandStderr(configurationADT config, char *errorPath) {
+	int errorFd =
+		open(errorPath, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+	if (errorFd == -1) {
+		return -1;
+	}
+
+	if (config->commandStderrFd != INVALID_FD) {
+		close(config->commandStderrFd);
+	}
+
+	config->commandStderrFd   = errorFd;
+	config->commandStderrPath = errorPath;
+	return 0;
+}
+
 unsigned short getHttpPort(configurationADT config) {
 	return config->httpPort;
 }
@@ -99,7 +231,7 @@ void setCommandAndTransformations(configurationADT config, char *command) {
 	if (strLength > 0) {
 		char *newCommand = malloc(strLength + 1);
 		memcpy(newCommand, command, strLength + 1);
-		config->command			   = newCommand;
+		replaceCommand(config, newCommand);
 		config->isTransformationOn = TRUE;
 	}
 	else {
@@ -118,29 +250,243 @@ uint8_t getIsTransformationOn(configurationADT config) {
 }
 
 void setCommand(configurationADT config, char *command) {
-	if (config->command != NULL) {
-		free(config->command);
+	replaceCommand(config, command);
+
+	generateAndUpdateTimeTag(CMD_ID);
+}
+
+TransformCommandPtr_t getCommand(configurationADT config) {
+	unsigned generation =
+		__atomic_load_n(&config->commandGeneration, __ATOMIC_ACQUIRE);
+
+	// The lock is only taken when management changed the command
+	if (workerCommandGeneration != generation) {
+		releaseCommand(workerCommand);
+		pthread_mutex_lock(&commandMutex);
+		workerCommand			= config->command;
+		workerCommandGeneration = config->commandGeneration;
+		retainCommand(workerCommand);
+		pthread_mutex_unlock(&commandMutex);
 	}
 
-	config->command = command;
+	retainCommand(workerCommand);
+	return workerCommand;
+}
 
-	generateAndUpdateTimeTag(CMD_ID);
+const char *getCommandLine(TransformCommandPtr_t command) {
+	return command == NULL ? "" : command->line;
+}
+
+void retainCommand(TransformCommandPtr_t command) {
+	if (command != NULL) {
+		__atomic_add_fetch(&command->references, 1, __ATOMIC_RELAXED);
+	}
+}
+
+void releaseCommand(TransformCommandPtr_t command) {
+	if (command != NULL &&
+		__atomic_sub_fetch(&command->references, 1, __ATOMIC_ACQ_REL) == 0) {
+		free(command->line);
+		free(command);
+	}
 }
 
-char *getCommand(configurationADT config) {
-	char *command = config->command;
+/* Takes line, the workers keep the command they have until they release it */
+static void replaceCommand(configurationADT config, char *line) {
+	TransformCommandPtr_t command = malloc(sizeof(*command));
+	TransformCommandPtr_t previous;
 
 	if (command == NULL) {
-		command = "";
+		free(line);
+		return;
 	}
+	command->references = 1;
+	command->line		= line;
+
+	pthread_mutex_lock(&commandMutex);
+	previous		= config->command;
+	config->command = command;
+	__atomic_add_fetch(&config->commandGeneration, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&commandMutex);
 
-	return command;
+	releaseCommand(previous);
 }
 
 void setMediaRange(configurationADT config, MediaRangePtr_t mediaRange) {
+	if (config->mediaRange != NULL) {
+		freeMediaRange(config->mediaRange);
+	}
 	config->mediaRange = mediaRange;
+	updateMediaRangeMatcher(config);
 }
 
 MediaRangePtr_t getMediaRange(configurationADT config) {
 	return config->mediaRange;
 }
+
+void setSelectorBackend(configurationADT config, selector_backend backend) {
+	config->selectorBackend = backend;
+}
+
+selector_backend getSelectorBackend(configurationADT config) {
+	return config->selectorBackend;
+}
+
+void setWorkers(configurationADT config, unsigned workers) {
+	config->workers = workers;
+}
+
+unsigned getWorkers(configurationADT config) {
+	return config->workers;
+}
+
+void setConnectTimeout(configurationADT config, unsigned connectTimeout) {
+	config->connectTimeout = connectTimeout;
+}
+
+unsigned getConnectTimeout(configurationADT config) {
+	return config->connectTimeout;
+}
+
+void setDnsCacheTtl(configurationADT config, unsigned dnsCacheTtl) {
+	config->dnsCacheTtl = dnsCacheTtl;
+}
+
+unsigned getDnsCacheTtl(configurationADT config) {
+	return config->dnsCacheTtl;
+}
+
+void setUpstreamMaxIdle(configurationADT config, unsigned upstreamMaxIdle) {
+	config->upstreamMaxIdle = upstreamMaxIdle;
+}
+
+unsigned getUpstreamMaxIdle(configurationADT config) {
+	return config->upstreamMaxIdle;
+}
+
+void setUpstreamIdleTimeout(configurationADT config,
+							unsigned upstreamIdleTimeout) {
+	config->upstreamIdleTimeout = upstreamIdleTimeout;
+}
+
+unsigned getUpstreamIdleTimeout(configurationADT config) {
+	return config->upstreamIdleTimeout;
+}
+
+void setUpstreamMaxPerOrigin(configurationADT config,
+							 unsigned upstreamMaxPerOrigin) {
+	config->upstreamMaxPerOrigin = upstreamMaxPerOrigin;
+}
+
+unsigned getUpstreamMaxPerOrigin(configurationADT config) {
+	return config->upstreamMaxPerOrigin;
+}
+
+void setClientIdleTimeout(configurationADT config, unsigned clientIdleTimeout) {
+	config->clientIdleTimeout = clientIdleTimeout;
+}
+
+unsigned getClientIdleTimeout(configurationADT config) {
+	return config->clientIdleTimeout;
+}
+
+void setClientMaxRequests(configurationADT config, unsigned clientMaxRequests) {
+	config->clientMaxRequests = clientMaxRequests;
+}
+
+unsigned getClientMaxRequests(configurationADT config) {
+	return config->clientMaxRequests;
+}
+
+void setHeaderTimeout(configurationADT config, unsigned headerTimeout) {
+	config->headerTimeout = headerTimeout;
+}
+
+unsigned getHeaderTimeout(configurationADT config) {
+	return config->headerTimeout;
+}
+
+void setResponseTimeout(configurationADT config, unsigned responseTimeout) {
+	config->responseTimeout = responseTimeout;
+}
+
+unsigned getResponseTimeout(configurationADT config) {
+	return config->responseTimeout;
+}
+
+void setTransformTimeout(configurationADT config, unsigned transformTimeout) {
+	config->transformTimeout = transformTimeout;
+}
+
+unsigned getTransformTimeout(configurationADT config) {
+	return config->transformTimeout;
+}
+
+void setTransformPoolSize(configurationADT config,
+						  unsigned transformPoolSize) {
+	config->transformPoolSize = transformPoolSize;
+}
+
+unsigned getTransformPoolSize(configurationADT config) {
+	return config->transformPoolSize;
+}
+
+void setPoolLowWatermark(configurationADT config, unsigned poolLowWatermark) {
+	config->poolLowWatermark = poolLowWatermark;
+
+	generateAndUpdateTimeTag(POOL_ID);
+}
+
+unsigned getPoolLowWatermark(configurationADT config) {
+	return config->poolLowWatermark;
+}
+
+void setPoolHighWatermark(configurationADT config,
+						  unsigned poolHighWatermark) {
+	config->poolHighWatermark = poolHighWatermark;
+
+	generateAndUpdateTimeTag(POOL_ID);
+}
+
+unsigned getPoolHighWatermark(configurationADT config) {
+	return config->poolHighWatermark;
+}
+
+void setIsAccessLogBlocking(configurationADT config,
+							uint8_t isAccessLogBlocking) {
+	config->isAccessLogBlocking = isAccessLogBlocking;
+}
+
+uint8_t getIsAccessLogBlocking(configurationADT config) {
+	return config->isAccessLogBlocking;
+}
+
+void setIsAccessLogBinary(configurationADT config, uint8_t isAccessLogBinary) {
+	config->isAccessLogBinary = isAccessLogBinary;
+}
+
+uint8_t getIsAccessLogBinary(configurationADT config) {
+	return config->isAccessLogBinary;
+}
+
+void setAccessLogSampleRate(configurationADT config,
+							unsigned accessLogSampleRate) {
+	config->accessLogSampleRate = accessLogSampleRate;
+
+	generateAndUpdateTimeTag(SMP_ID);
+}
+
+unsigned getAccessLogSampleRate(configurationADT config) {
+	return config->accessLogSampleRate;
+}
+
+void setAccessLogSlowThreshold(configurationADT config,
+							   unsigned accessLogSlowThreshold) {
+	config->accessLogSlowThreshold = accessLogSlowThreshold;
+
+	generateAndUpdateTimeTag(SMP_ID);
+}
+
+unsigned getAccessLogSlowThreshold(configurationADT config) {
+	return config->accessLogSlowThreshold;
+}
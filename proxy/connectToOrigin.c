@@ -3,144 +3,414 @@
 #include <connectToOrigin.h>
 #include <stdio.h>
 #include <selector.h>
+#include <resolver.h>
+#include <originPool.h>
+#include <configuration.h>
+#include <loopClock.h>
 #include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Deadline of a connection without connect timeout */
+#define NO_DEADLINE UINT64_MAX
+
+static void sortCandidates(struct connectOrigin *connectOrigin,
+						   struct addrinfo *res);
+static unsigned startNextAttempt(struct selector_key *key);
+static unsigned armConnectTimer(struct selector_key *key);
+static void closeAttempt(fd_selector s, struct connectOrigin *connectOrigin,
+						 struct connectAttempt *attempt);
+static struct connectAttempt *findAttempt(struct connectOrigin *connectOrigin,
+										  int fd);
+static int takePooledOrigin(struct selector_key *key);
 
 int blockingToResolvName(struct selector_key *key, int fdClient) {
+	struct connectOrigin *connectOrigin = getConnectOriginState(GET_DATA(key));
+	unsigned timeout = getConnectTimeout(getConfiguration());
+
 	if (SELECTOR_SUCCESS != selector_set_interest(key->s, fdClient, OP_NOOP)) {
 		return ERROR;
 	}
-	httpADT_t currentState = GET_DATA(key);
-	pthread_t tid;
-	void **args = malloc(2 * sizeof(void *));
-	args[0]		= currentState;
-	args[1]		= malloc(sizeof(struct selector_key));
-	memcpy(args[1], key, sizeof(struct selector_key));
-	((struct selector_key *) (args[1]))->fd = fdClient;
-	setSelectorCopy(GET_DATA(key), args);
-
-	if (-1 == pthread_create(&tid, NULL,
-							 (void *(*) (void *) )(addressResolvName),
-							 (void *) args)) {
-		return ERROR;
+
+	/* The connect timeout also covers the resolution, 0 does not limit it */
+	if (timeout == 0) {
+		connectOrigin->deadline = NO_DEADLINE;
+		selector_clear_timeout(key->s, fdClient);
+	}
+	else {
+		connectOrigin->deadline = loopClockMonotonicMillis() + timeout;
+		if (SELECTOR_SUCCESS !=
+			selector_set_timeout(key->s, fdClient, timeout)) {
+			return ERROR;
+		}
 	}
+
+	startLatency(GET_DATA(key), DNS_LATENCY);
+	resolverJobADT job =
+		resolverSubmit(key->s, fdClient, getOriginHost(GET_DATA(key)));
+
+	if (job == NULL) {
+		/* Resolver queue is full */
+		setErrorType(GET_DATA(key), FAIL_TO_CONNECT);
+		return ERROR_CLIENT;
+	}
+
+	setResolverJob(GET_DATA(key), job);
+
+	if (resolverJobIsDone(job)) {
+		/* Cached, there is nothing to wait for */
+		return addressResolvNameDone(key);
+	}
+
 	return CONNECT_TO_ORIGIN;
 }
 
-void *addressResolvName(void **data) {
-	pthread_detach(pthread_self());
-	httpADT_t currentState   = data[0];
-	struct selector_key *key = data[1];
+unsigned addressResolvNameDone(struct selector_key *key) {
+	httpADT_t currentState				= GET_DATA(key);
+	struct connectOrigin *connectOrigin = getConnectOriginState(currentState);
+	resolverJobADT job					= getResolverJob(currentState);
+	unsigned ret;
 
-	setOriginResolutions(currentState, NULL);
+	if (job == NULL || !resolverJobIsDone(job)) {
+		/* Stale notification for a previous owner of this fd */
+		return CONNECT_TO_ORIGIN;
+	}
 
-	struct addrinfo hints, *res;
-	int errcode;
-	char *host = getOriginHost(currentState);
+	stopLatency(currentState, DNS_LATENCY);
+	connectOrigin->nextCandidate	  = 0;
+	connectOrigin->attemptsInProgress = 0;
 
-	memset(&hints, 0, sizeof(hints));
-	hints.ai_family   = AF_UNSPEC;
-	hints.ai_socktype = SOCK_STREAM;
-	hints.ai_flags	= AI_PASSIVE;
+	for (unsigned i = 0; i < MAX_CONNECT_CANDIDATES; i++) {
+		connectOrigin->attempts[i].fd = -1;
+	}
 
-	errcode = getaddrinfo(host, NULL, &hints, &res);
+	sortCandidates(connectOrigin, getOriginResolutions(currentState));
 
-	if (errcode != 0) {
-		selector_notify_block(key->s, key->fd);
-		return (void *) -1;
+	if (takePooledOrigin(key)) {
+		increaseUpstreamPoolHits();
+		selector_clear_timeout(key->s, getClientFd(currentState));
+		return HANDLE_REQUEST;
 	}
 
-	setOriginResolutions(currentState, res);
-
-	selector_notify_block(key->s, key->fd);
-	return (void *) 0;
-}
+	increaseUpstreamPoolMisses();
+	startLatency(currentState, CONNECT_LATENCY);
 
-unsigned addressResolvNameDone(struct selector_key *key) {
-	int flag			 = ERROR_CLIENT;
-	struct addrinfo *res = getOriginResolutions(GET_DATA(key));
+	ret = startNextAttempt(key);
 
-	while (res && flag == ERROR_CLIENT) {
-		flag = connectToOrigin(key, res);
-		res  = res->ai_next;
+	if (ret == CONNECTING) {
+		ret = armConnectTimer(key);
 	}
 
-	if (flag == ERROR_CLIENT) {
-		setErrorType(GET_DATA(key), FAIL_TO_CONNECT);
+	if (ret == ERROR) {
+		/* CONNECTING is never reached, so its departure would not run */
+		connectingDestroy(CONNECT_TO_ORIGIN, key);
+	}
+	else if (ret == ERROR_CLIENT) {
+		setErrorType(currentState, FAIL_TO_CONNECT);
 	}
 
-	return flag;
+	return ret;
+}
+
+unsigned resolvingTimeout(struct selector_key *key) {
+	increaseDeadlineExpiries();
+	setErrorType(GET_DATA(key), FAIL_TO_CONNECT);
+	return ERROR_CLIENT;
 }
 
 int connectToOrigin(struct selector_key *key, struct addrinfo *ipEntry) {
-	httpADT_t currentState = GET_DATA(key);
+	httpADT_t currentState				= GET_DATA(key);
+	struct connectOrigin *connectOrigin = getConnectOriginState(currentState);
+	unsigned short originPort			= getOriginPort(currentState);
+	struct sockaddr_storage serverAddr;
 
-	void *ptr;
-	char serverIP[100];
-	inet_ntop(ipEntry->ai_family, ipEntry->ai_addr->sa_data, serverIP, 100);
+	if (ipEntry->ai_addrlen > sizeof(serverAddr)) {
+		return ERROR_CLIENT;
+	}
+
+	memcpy(&serverAddr, ipEntry->ai_addr, ipEntry->ai_addrlen);
 
 	switch (ipEntry->ai_family) {
 		case AF_INET:
-			ptr = &((struct sockaddr_in *) ipEntry->ai_addr)->sin_addr;
+			((struct sockaddr_in *) &serverAddr)->sin_port = htons(originPort);
 			break;
 		case AF_INET6:
-			ptr = &((struct sockaddr_in6 *) ipEntry->ai_addr)->sin6_addr;
+			((struct sockaddr_in6 *) &serverAddr)->sin6_port =
+				htons(originPort);
 			break;
+		default:
+			return ERROR_CLIENT;
 	}
-	inet_ntop(ipEntry->ai_family, ptr, serverIP, 100);
 
-	unsigned short originPort = getOriginPort(currentState);
 	int socketFd = socket(ipEntry->ai_family, SOCK_STREAM, IPPROTO_TCP);
 
 	if (socketFd < 0) {
 		return ERROR_CLIENT;
 	}
 
-	struct sockaddr *serverAddr;
-	uint8_t serverAddrLenght;
-	struct sockaddr_in6 serverAddr6;
-	struct sockaddr_in serverAddr4;
-	switch (ipEntry->ai_family) {
-		case AF_INET:
-			memset(&serverAddr4, 0, sizeof(serverAddr4));
-			serverAddr4.sin_family = ipEntry->ai_family;
-			serverAddr4.sin_port   = htons(originPort);
-			if (inet_pton(ipEntry->ai_family, serverIP,
-						  &(serverAddr4.sin_addr)) <= 0) {
-				return ERROR_CLIENT;
-			}
-			serverAddr		 = (struct sockaddr *) &serverAddr4;
-			serverAddrLenght = sizeof(serverAddr4);
-			break;
-		case AF_INET6:
-			memset(&serverAddr6, 0, sizeof(serverAddr6));
-			serverAddr6.sin6_family = ipEntry->ai_family;
-			serverAddr6.sin6_port   = htons(originPort);
-			if (inet_pton(ipEntry->ai_family, serverIP,
-						  &(serverAddr6.sin6_addr)) <= 0) {
-				return ERROR_CLIENT;
-			}
-			serverAddr		 = (struct sockaddr *) &serverAddr6;
-			serverAddrLenght = sizeof(serverAddr6);
-			break;
-	}
-
-	if (connect(socketFd, (const struct sockaddr *) (serverAddr),
-				serverAddrLenght) < 0) {
+	if (selector_fd_set_nio(socketFd) == -1) {
+		close(socketFd);
 		return ERROR_CLIENT;
 	}
 
-	if (selector_fd_set_nio(socketFd) == -1) {
+	/* Does not block, completion is reported as writability */
+	if (connect(socketFd, (const struct sockaddr *) &serverAddr,
+				ipEntry->ai_addrlen) < 0 &&
+		errno != EINPROGRESS) {
+		close(socketFd);
 		return ERROR_CLIENT;
 	}
 
-	setOriginFd(currentState, socketFd);
-
 	if (SELECTOR_SUCCESS != selector_register(key->s, socketFd,
 											  getHttpHandler(), OP_WRITE,
 											  currentState)) {
+		close(socketFd);
 		return ERROR_CLIENT;
 	}
 	incrementReferences(currentState);
 
-	return HANDLE_REQUEST;
+	struct connectAttempt *attempt = findAttempt(connectOrigin, -1);
+	attempt->fd					   = socketFd;
+	attempt->address			   = ipEntry;
+	connectOrigin->attemptsInProgress++;
+
+	return CONNECTING;
+}
+
+unsigned connectingWrite(struct selector_key *key) {
+	httpADT_t currentState				= GET_DATA(key);
+	struct connectOrigin *connectOrigin = getConnectOriginState(currentState);
+	struct connectAttempt *attempt		= findAttempt(connectOrigin, key->fd);
+	int error							= 0;
+	socklen_t errorLength				= sizeof(error);
+	unsigned ret;
+
+	if (attempt == NULL) {
+		return ERROR;
+	}
+
+	if (getsockopt(key->fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) < 0) {
+		error = errno;
+	}
+
+	if (error == 0) {
+		/* This attempt wins, the rest are closed when leaving the state */
+		socklen_t addressLength = sizeof(struct sockaddr_storage);
+		getpeername(key->fd, (struct sockaddr *) getOriginAddress(currentState),
+					&addressLength);
+		setOriginFd(currentState, key->fd);
+		attempt->fd = -1;
+		connectOrigin->attemptsInProgress--;
+		stopLatency(currentState, CONNECT_LATENCY);
+
+		return HANDLE_REQUEST;
+	}
+
+	closeAttempt(key->s, connectOrigin, attempt);
+
+	/* Do not wait for the attempt delay, race the next address right away */
+	ret = startNextAttempt(key);
+
+	if (ret == CONNECTING) {
+		ret = armConnectTimer(key);
+	}
+
+	if (ret == ERROR_CLIENT) {
+		setErrorType(currentState, FAIL_TO_CONNECT);
+	}
+
+	return ret;
+}
+
+unsigned connectingTimeout(struct selector_key *key) {
+	httpADT_t currentState				= GET_DATA(key);
+	struct connectOrigin *connectOrigin = getConnectOriginState(currentState);
+	unsigned ret;
+
+	if (loopClockMonotonicMillis() >= connectOrigin->deadline) {
+		increaseDeadlineExpiries();
+		setErrorType(currentState, FAIL_TO_CONNECT);
+		return ERROR_CLIENT;
+	}
+
+	ret = startNextAttempt(key);
+
+	if (ret == CONNECTING) {
+		ret = armConnectTimer(key);
+	}
+
+	if (ret == ERROR_CLIENT) {
+		setErrorType(currentState, FAIL_TO_CONNECT);
+	}
+
+	return ret;
+}
+
+void connectingDestroy(const unsigned state, struct selector_key *key) {
+	httpADT_t currentState				= GET_DATA(key);
+	struct connectOrigin *connectOrigin = getConnectOriginState(currentState);
+
+	for (unsigned i = 0; i < MAX_CONNECT_CANDIDATES; i++) {
+		if (connectOrigin->attempts[i].fd != -1) {
+			closeAttempt(key->s, connectOrigin, &connectOrigin->attempts[i]);
+		}
+	}
+
+	selector_clear_timeout(key->s, getClientFd(currentState));
+}
+
+/*
+ * Keeps the resolver order but alternates address families, starting with
+ * the family of the first resolved address (RFC 8305 section 4)
+ */
+static void sortCandidates(struct connectOrigin *connectOrigin,
+						   struct addrinfo *res) {
+	struct addrinfo *preferred[MAX_CONNECT_CANDIDATES];
+	struct addrinfo *others[MAX_CONNECT_CANDIDATES];
+	unsigned preferredQty = 0;
+	unsigned othersQty	= 0;
+	int family			  = AF_UNSPEC;
+
+	for (; res != NULL; res = res->ai_next) {
+		if (res->ai_family != AF_INET && res->ai_family != AF_INET6) {
+			continue;
+		}
+
+		if (family == AF_UNSPEC) {
+			family = res->ai_family;
+		}
+
+		if (res->ai_family == family) {
+			if (preferredQty < MAX_CONNECT_CANDIDATES) {
+				preferred[preferredQty++] = res;
+			}
+		}
+		else if (othersQty < MAX_CONNECT_CANDIDATES) {
+			others[othersQty++] = res;
+		}
+	}
+
+	connectOrigin->candidateQty = 0;
+
+	for (unsigned i = 0; i < preferredQty || i < othersQty; i++) {
+		if (i < preferredQty &&
+			connectOrigin->candidateQty < MAX_CONNECT_CANDIDATES) {
+			connectOrigin->candidates[connectOrigin->candidateQty++] =
+				preferred[i];
+		}
+
+		if (i < othersQty &&
+			connectOrigin->candidateQty < MAX_CONNECT_CANDIDATES) {
+			connectOrigin->candidates[connectOrigin->candidateQty++] =
+				others[i];
+		}
+	}
+}
+
+/*
+ * Starts the next candidate that can be started. Returns ERROR_CLIENT if
+ * there are no candidates left and no attempt in progress.
+ */
+static unsigned startNextAttempt(struct selector_key *key) {
+	struct connectOrigin *connectOrigin = getConnectOriginState(GET_DATA(key));
+
+	while (connectOrigin->nextCandidate < connectOrigin->candidateQty) {
+		struct addrinfo *candidate =
+			connectOrigin->candidates[connectOrigin->nextCandidate++];
+
+		if (connectToOrigin(key, candidate) == CONNECTING) {
+			return CONNECTING;
+		}
+	}
+
+	return connectOrigin->attemptsInProgress > 0 ? CONNECTING : ERROR_CLIENT;
+}
+
+/*
+ * Wakes up on the client fd when the next candidate should be raced or,
+ * if there are no candidates left, when the connect timeout expires
+ */
+static unsigned armConnectTimer(struct selector_key *key) {
+	httpADT_t currentState				= GET_DATA(key);
+	struct connectOrigin *connectOrigin = getConnectOriginState(currentState);
+	uint64_t now						= loopClockMonotonicMillis();
+	uint64_t wait						= 0;
+
+	if (connectOrigin->deadline > now) {
+		wait = connectOrigin->deadline - now;
+	}
+
+	if (connectOrigin->nextCandidate < connectOrigin->candidateQty &&
+		wait > CONNECT_ATTEMPT_DELAY) {
+		wait = CONNECT_ATTEMPT_DELAY;
+	}
+	else if (connectOrigin->deadline == NO_DEADLINE) {
+		/* Nothing left to race and no timeout, waits for the attempts */
+		selector_clear_timeout(key->s, getClientFd(currentState));
+		return CONNECTING;
+	}
+
+	if (SELECTOR_SUCCESS !=
+		selector_set_timeout(key->s, getClientFd(currentState), wait)) {
+		return ERROR;
+	}
+
+	return CONNECTING;
+}
+
+static void closeAttempt(fd_selector s, struct connectOrigin *connectOrigin,
+						 struct connectAttempt *attempt) {
+	int fd		= attempt->fd;
+	attempt->fd = -1;
+	connectOrigin->attemptsInProgress--;
+
+	selector_unregister_fd(s, fd);
+	close(fd);
+}
+
+static struct connectAttempt *findAttempt(struct connectOrigin *connectOrigin,
+										  int fd) {
+	for (unsigned i = 0; i < MAX_CONNECT_CANDIDATES; i++) {
+		if (connectOrigin->attempts[i].fd == fd) {
+			return &connectOrigin->attempts[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Uses an idle connection to one of the candidates, if there is any.
+ * Returns TRUE if one was taken.
+ */
+static int takePooledOrigin(struct selector_key *key) {
+	httpADT_t currentState				= GET_DATA(key);
+	struct connectOrigin *connectOrigin = getConnectOriginState(currentState);
+
+	if (getUpstreamMaxIdle(getConfiguration()) == 0) {
+		return FALSE;
+	}
+
+	while (TRUE) {
+		int originFd = originPoolTake(
+			key->s, getOriginHost(currentState), getOriginPort(currentState),
+			connectOrigin->candidates, connectOrigin->candidateQty,
+			getOriginAddress(currentState));
+
+		if (originFd == -1) {
+			return FALSE;
+		}
+
+		/* Same as a connection attempt that has just connected */
+		if (SELECTOR_SUCCESS == selector_register(key->s, originFd,
+												  getHttpHandler(), OP_WRITE,
+												  currentState)) {
+			incrementReferences(currentState);
+			setOriginFd(currentState, originFd);
+			return TRUE;
+		}
+
+		close(originFd);
+	}
 }
@@ -54,11 +54,26 @@ Content-Type: text/html; charset=UTF-8\n\
     <meta name=viewport content=\"initial-scale=1, minimum-scale=1, width=device-width\">\n\
     <title>Error 502 (Bad Gateway)!!!</title>\n\
     <p><b>502.</b> <ins>That is the error.</ins>\n\
-    <p>Invalid host or port <ins>That’s all we know.</ins>\n"};
+    <p>Invalid host or port <ins>That’s all we know.</ins>\n",
+
+						 "HTTP/1.0 408 Request Timeout\n\
+Content-Type: text/html; charset=UTF-8\n\
+\n\
+<!DOCTYPE html>\n\
+<html lang=en>\n\
+  <meta charset=utf-8>\n\
+  <meta name=viewport content=\"initial-scale=1, minimum-scale=1, width=device-width\">\n\
+  <title>Error 408 (Request Timeout)!!!</title>\n\
+  <p><b>408.</b> <ins>That is the error.</ins>\n\
+  <p>The client did not send the request in time.  <ins>That’s all we know.</ins>\n"};
+
+/* Status of each response of errorResposes */
+static const int errorStatuses[] = {400, 405, 505, 400, 502, 408};
 
 void errorInit(const unsigned state, struct selector_key *key) {
 	enum errorType errorTypeFound = getErrorType(GET_DATA(key));
 	int sizeErrorMessage		  = strlen(errorResposes[errorTypeFound]);
+	setResponseStatus(GET_DATA(key), errorStatuses[errorTypeFound]);
 	setErrorBuffer(GET_DATA(key), (uint8_t *) errorResposes[errorTypeFound],
 				   sizeErrorMessage);
 	buffer_write_adv(getErrorBuffer(GET_DATA(key)), sizeErrorMessage);
@@ -82,6 +97,7 @@ unsigned errorHandleWrite(struct selector_key *key) {
 
 	if (bytesRead > 0) {
 		buffer_read_adv(writeBuffer, bytesRead);
+		addBytesToClient(GET_DATA(key), bytesRead);
 	}
 
 	return ret;
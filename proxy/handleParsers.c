@@ -2,7 +2,8 @@
 #include <connectToOrigin.h>
 
 static int parse(struct parseRequest *parseRequest, buffer *input, int *flag,
-				 int (*parseChar)(struct parseRequest *, char));
+				 int (*parseChar)(struct parseRequest *, char),
+				 size_t (*parseSpan)(struct parseRequest *, buffer *));
 static int handleMethod(struct selector_key *key,
 						struct parseRequest *parseRequest, buffer *readBuffer,
 						unsigned *ret);
@@ -23,31 +24,46 @@ static int parseVersionCharWrapper(struct parseRequest *parseRequest,
 								   char letter);
 static int parseHeaderCharWrapper(struct parseRequest *parseRequest,
 								  char letter);
+static size_t parseHeaderSpanWrapper(struct parseRequest *parseRequest,
+									 buffer *input);
 static unsigned parseProcess(struct selector_key *key, buffer *readBuffer,
 							 size_t bytesRead);
-static int consumeRestOfBuffer(struct parseRequest *parseRequest,
-							   buffer *input);
+static void consumeRestOfBuffer(struct parseRequest *parseRequest,
+								buffer *input);
 static int handleExitToConnect(struct selector_key *key,
 							   struct parseRequest *parseRequest,
 							   buffer *readBuffer);
+static void startHeaderTimer(struct selector_key *key,
+							 struct parseRequest *parseRequest);
 
 void parseInit(const unsigned state, struct selector_key *key) {
 	struct parseRequest *parseRequest = getParseRequestState(GET_DATA(key));
+	struct arena *arena				  = getArena(GET_DATA(key));
 
 	parseRequest->input				 = getReadBuffer(GET_DATA(key));
 	parseRequest->finishParserBuffer = getFinishParserBuffer(GET_DATA(key));
+	parseRequest->isRequestStarted	 = FALSE;
 
 	parseMethodInit(&(parseRequest->methodParser));
-	parseTargetInit(&(parseRequest->targetParser));
-	parseVersionInit(&(parseRequest->versionParser));
-	parseHeaderInit(&(parseRequest->headerParser));
+	parseTargetInit(&(parseRequest->targetParser), arena);
+	parseVersionInit(&(parseRequest->versionParser), arena);
+	parseHeaderInit(&(parseRequest->headerParser), arena);
 }
 
 void parseDestroy(const unsigned state, struct selector_key *key) {
 	struct parseRequest *parseRequest = getParseRequestState(GET_DATA(key));
+	unsigned maxRequests = getClientMaxRequests(getConfiguration());
+	int *version = getVersionVersionParser(&parseRequest->versionParser);
+
 	setRequestMethod(GET_DATA(key), getMethod(&(parseRequest->methodParser)));
-	parseVersionDestroy(&parseRequest->versionParser);
-	parseTargetDestroy(&parseRequest->targetParser);
+	// Not when an idle connection was closed before a request
+	if (parseRequest->isRequestStarted) {
+		increaseRequestsByMethod(getRequestMethod(GET_DATA(key)));
+	}
+	/* HTTP/1.0 clients close after each response */
+	setClientKeepAlive(GET_DATA(key),
+					   version[0] == 1 && version[1] == 1 &&
+						   getRequestCount(GET_DATA(key)) + 1 < maxRequests);
 }
 
 unsigned parseRead(struct selector_key *key) {
@@ -57,11 +73,17 @@ unsigned parseRead(struct selector_key *key) {
 	size_t count;
 	ssize_t bytesRead;
 
+	// An idle connection gets its buffers when the client sends something
+	if (!httpAcquireBuffers(GET_DATA(key))) {
+		return ERROR;
+	}
+
 	if (buffer_can_write(readBuffer)) {
 		pointer   = buffer_write_ptr(readBuffer, &count);
 		bytesRead = recv(key->fd, pointer, count, 0);
 
 		if (bytesRead > 0) {
+			startHeaderTimer(key, getParseRequestState(GET_DATA(key)));
 			buffer_write_adv(readBuffer, bytesRead);
 			ret = parseProcess(key, readBuffer, bytesRead);
 		}
@@ -73,6 +95,40 @@ unsigned parseRead(struct selector_key *key) {
 	return ret;
 }
 
+unsigned parsePending(struct selector_key *key) {
+	buffer *readBuffer = getReadBuffer(GET_DATA(key));
+	unsigned ret	   = PARSE;
+	size_t count;
+
+	buffer_read_ptr(readBuffer, &count);
+
+	if (count > 0) {
+		startHeaderTimer(key, getParseRequestState(GET_DATA(key)));
+		ret = parseProcess(key, readBuffer, count);
+	}
+
+	if (ret == PARSE &&
+		SELECTOR_SUCCESS != selector_set_interest_key(key, OP_READ)) {
+		ret = ERROR;
+	}
+
+	return ret;
+}
+
+unsigned parseTimeout(struct selector_key *key) {
+	struct parseRequest *parseRequest = getParseRequestState(GET_DATA(key));
+
+	increaseDeadlineExpiries();
+
+	if (!parseRequest->isRequestStarted) {
+		/* Idle client, it is closed without answer */
+		return DONE;
+	}
+
+	setErrorType(GET_DATA(key), REQUEST_TIMEOUT);
+	return ERROR_CLIENT;
+}
+
 unsigned parseProcess(struct selector_key *key, buffer *readBuffer,
 					  size_t bytesRead) {
 	struct parseRequest *parseRequest = getParseRequestState(GET_DATA(key));
@@ -107,7 +163,8 @@ int handleMethod(struct selector_key *key, struct parseRequest *parseRequest,
 				 buffer *readBuffer, unsigned *ret) {
 	int state = 0;
 	int bytesFromAParser =
-		parse(parseRequest, readBuffer, &state, &parseMethodCharWrapper);
+		parse(parseRequest, readBuffer, &state, &parseMethodCharWrapper,
+			  NULL);
 	if (state == 1) {
 		parseRequest->state = PARSE_TARGET;
 		if (getState(&(parseRequest->methodParser)) == ERROR_METHOD_STATE) {
@@ -126,7 +183,8 @@ int handleTarget(struct selector_key *key, struct parseRequest *parseRequest,
 				 buffer *readBuffer, unsigned *ret) {
 	int state = 0;
 	int bytesFromAParser =
-		parse(parseRequest, readBuffer, &state, &parseTargetCharWrapper);
+		parse(parseRequest, readBuffer, &state, &parseTargetCharWrapper,
+			  NULL);
 	if (state == 1) {
 		if (getTargetState(&(parseRequest->targetParser)) == ERROR_T) {
 			*ret = ERROR_CLIENT;
@@ -152,7 +210,8 @@ int handleVersion(struct selector_key *key, struct parseRequest *parseRequest,
 				  buffer *readBuffer, unsigned *ret) {
 	int state = 0;
 	int bytesFromAParser =
-		parse(parseRequest, readBuffer, &state, &parseVersionCharWrapper);
+		parse(parseRequest, readBuffer, &state, &parseVersionCharWrapper,
+			  NULL);
 	if (state == 1) {
 		if (getVersionState(&parseRequest->versionParser) == ERROR_V) {
 			*ret = ERROR_CLIENT;
@@ -182,7 +241,8 @@ int handleHeader(struct selector_key *key, struct parseRequest *parseRequest,
 				 buffer *readBuffer, unsigned *ret) {
 	int state = 0;
 	int bytesFromAParser =
-		parse(parseRequest, readBuffer, &state, &parseHeaderCharWrapper);
+		parse(parseRequest, readBuffer, &state, &parseHeaderCharWrapper,
+			  &parseHeaderSpanWrapper);
 	if (state == 1) {
 		if (hasFoundHostHeaderParser(&parseRequest->headerParser)) {
 			char *host = getHostHeaderParser(&(parseRequest->headerParser));
@@ -206,12 +266,22 @@ int handleHeader(struct selector_key *key, struct parseRequest *parseRequest,
 }
 
 int parse(struct parseRequest *parseRequest, buffer *input, int *flag,
-		  int (*parseChar)(struct parseRequest *, char)) {
+		  int (*parseChar)(struct parseRequest *, char),
+		  size_t (*parseSpan)(struct parseRequest *, buffer *)) {
 	uint8_t letter;
+	size_t spanLength;
 	int ret = 0;
 	*flag   = 1;
 
 	do {
+		// The bytes that only need to be copied are not parsed one by one,
+		// they leave the parser unfinished
+		if (parseSpan != NULL &&
+			(spanLength = parseSpan(parseRequest, input)) > 0) {
+			ret += spanLength;
+			*flag = 0;
+		}
+
 		letter = buffer_read(input);
 
 		if (letter) {
@@ -250,34 +320,57 @@ int parseHeaderCharWrapper(struct parseRequest *parseRequest, char letter) {
 	return parseHeaderChar(&parseRequest->headerParser, letter);
 }
 
-int consumeRestOfBuffer(struct parseRequest *parseRequest, buffer *input) {
-	int state = 0;
-	char letter;
-	do {
-		letter = buffer_read(input);
+size_t parseHeaderSpanWrapper(struct parseRequest *parseRequest,
+							  buffer *input) {
+	size_t readable, writable, n;
+	uint8_t *from = buffer_read_ptr(input, &readable);
+	uint8_t *to	  = buffer_write_ptr(parseRequest->finishParserBuffer, &writable);
 
-		if (letter) {
-			if (buffer_can_write(parseRequest->finishParserBuffer)) {
-				buffer_write(parseRequest->finishParserBuffer, letter);
-			}
-			else {
-				state = 2;
-			}
-		}
-	} while (state != 2 && letter);
-	return state;
+	n = parseHeaderSpan(&parseRequest->headerParser, from,
+						readable < writable ? readable : writable);
+	memcpy(to, from, n);
+	buffer_write_adv(parseRequest->finishParserBuffer, n);
+	buffer_read_adv(input, n);
+	return n;
+}
+
+/* What does not fit is parsed later from the read buffer */
+void consumeRestOfBuffer(struct parseRequest *parseRequest, buffer *input) {
+	size_t readable, writable;
+	buffer *output = parseRequest->finishParserBuffer;
+	uint8_t *from  = buffer_read_ptr(input, &readable);
+	uint8_t *to	   = buffer_write_ptr(output, &writable);
+	size_t n	   = readable < writable ? readable : writable;
+
+	memcpy(to, from, n);
+	buffer_write_adv(output, n);
+	buffer_read_adv(input, n);
 }
 
 int handleExitToConnect(struct selector_key *key,
 						struct parseRequest *parseRequest, buffer *readBuffer) {
-	int state = consumeRestOfBuffer(parseRequest, readBuffer);
-	int ret;
-	if (state == 2) {
-		setErrorType(GET_DATA(key), NOT_FOUND_HOST);
-		ret = ERROR_CLIENT;
+	consumeRestOfBuffer(parseRequest, readBuffer);
+	stopLatency(GET_DATA(key), PARSE_LATENCY);
+	return blockingToResolvName(key, key->fd);
+}
+
+/* The client is no longer idle, it has the header timeout to finish */
+void startHeaderTimer(struct selector_key *key,
+					  struct parseRequest *parseRequest) {
+	unsigned timeout = getHeaderTimeout(getConfiguration());
+
+	if (parseRequest->isRequestStarted) {
+		return;
+	}
+
+	parseRequest->isRequestStarted = TRUE;
+	startLatency(GET_DATA(key), PARSE_LATENCY);
+	startLatency(GET_DATA(key), REQUEST_LATENCY);
+
+	if (timeout == 0) {
+		selector_clear_timeout(key->s, key->fd);
 	}
 	else {
-		ret = blockingToResolvName(key, key->fd);
+		selector_set_timeout(key->s, key->fd, timeout);
 	}
-	return ret;
 }
@@ -6,16 +6,101 @@
 #include <configuration.h>
 #include <headersParser.h>
 #include <utilities.h>
+#include <spliceRelay.h>
+#include <handleResponse.h>
+#include <errno.h>
 
 /*
  * Returns buffer to read from to write on originFd
  */
 static buffer *getCurrentBuffer(httpADT_t state);
 
+/*
+ * Parses the request headers that were already read, in order
+ */
+static void parseRequestHeaders(struct selector_key *key);
+
+/*
+ * Decides how the request body is delimited once headers are parsed
+ */
+static void startRequestBody(httpADT_t state);
+
+/*
+ * Returns how many of the count bytes at data can be sent to origin
+ */
+static size_t requestBodyCount(httpADT_t state, uint8_t *data, size_t count);
+
+/*
+ * Returns TRUE if there is something to send to origin
+ */
+static int hasDataForOrigin(httpADT_t state);
+
+/*
+ * Relays the rest of a long body with splice once the buffers are empty
+ */
+static void startRequestSplice(httpADT_t state);
+
+/*
+ * Moves body bytes from client fd into the splice relay
+ */
+static unsigned requestSpliceRead(struct selector_key *key);
+
+/*
+ * Moves body bytes from the splice relay to origin fd
+ */
+static unsigned requestSpliceWrite(struct selector_key *key);
+
+/*
+ * Arms the header timeout on the client fd until the request headers are
+ * parsed, then the response timeout
+ */
+static void armRequestTimer(struct selector_key *key);
+
 void requestInit(const unsigned state, struct selector_key *key) {
 	struct handleRequest *handleRequest = getHandleRequestState(GET_DATA(key));
+	struct requestBody *requestBody		= getRequestBody(GET_DATA(key));
 	headersParserInit(&(handleRequest->parseHeaders), key, TRUE);
-	handleRequest->requestState = FIRST_BUFFER;
+	handleRequest->bodySent		= FALSE;
+	handleRequest->isTimerArmed = FALSE;
+	requestBody->isFramingKnown = FALSE;
+	requestBody->pending		= 0;
+	requestBody->isSpliced		= FALSE;
+	startLatency(GET_DATA(key), FIRST_BYTE_LATENCY);
+	armRequestTimer(key);
+}
+
+void requestDestroy(const unsigned state, struct selector_key *key) {
+	httpADT_t http						= GET_DATA(key);
+	struct handleRequest *handleRequest = getHandleRequestState(http);
+
+	/* Only what belongs to the request was sent, the rest waits in the
+	 * buffers for the next one */
+	setOriginKeepAlive(http, handleRequest->parseHeaders.keepAlive &&
+								 !handleRequest->bodySent &&
+								 isRequestSent(http));
+
+	if (!isRequestSent(http)) {
+		/* Origin answered before the body ended, the rest is relayed as is */
+		getRequestBody(http)->isFramingKnown = FALSE;
+		setClientKeepAlive(http, FALSE);
+	}
+
+	if (getRequestBody(http)->isSpliced) {
+		struct spliceRelay *relay = getSpliceRelay(http);
+
+		/* The origin is given what it still takes of the body in the pipe */
+		while (relay->buffered > 0 &&
+			   spliceRelayDrain(relay, getOriginFd(http)) > 0) {
+		}
+
+		/* What it does not take is dropped: it answered without reading the
+		 * whole body and neither connection is kept alive. The rest of the
+		 * body, if any, is relayed by copy */
+		if (relay->buffered > 0) {
+			spliceRelayClose(relay);
+		}
+		getRequestBody(http)->isSpliced = FALSE;
+	}
 }
 
 unsigned requestRead(struct selector_key *key) {
@@ -30,6 +115,12 @@ unsigned requestRead(struct selector_key *key) {
 		return HANDLE_RESPONSE;
 	}
 
+	armRequestTimer(key);
+
+	if (getRequestBody(GET_DATA(key))->isSpliced) {
+		return requestSpliceRead(key);
+	}
+
 	// if there is no space to read should write what i already read
 	if (!buffer_can_write(readBuffer)) {
 		// set interest no op on fd an write on origin fd
@@ -40,11 +131,9 @@ unsigned requestRead(struct selector_key *key) {
 	bytesRead = recv(key->fd, pointer, count, 0);
 
 	if (bytesRead > 0) {
-		int begining = pointer - readBuffer->data;
 		buffer_write_adv(readBuffer, bytesRead);
 		if (handleRequest->parseHeaders.state != BODY_START) {
-			parseHeaders(&handleRequest->parseHeaders, readBuffer, begining,
-						 begining + bytesRead);
+			parseRequestHeaders(key);
 		}
 
 		ret = setAdecuateFdInterests(key);
@@ -64,28 +153,41 @@ unsigned requestWrite(struct selector_key *key) {
 	size_t count;
 	ssize_t bytesRead;
 
-	if (handleRequest->requestState == FIRST_BUFFER &&
-		!buffer_can_read(&handleRequest->parseHeaders.valueBuffer) &&
+	armRequestTimer(key);
+
+	if (!buffer_can_read(&handleRequest->parseHeaders.valueBuffer) &&
 		handleRequest->parseHeaders.state != BODY_START) {
-		parseHeaders(&handleRequest->parseHeaders,
-					 getFinishParserBuffer(GET_DATA(key)), 0, 0);
-		if (!buffer_can_read(getFinishParserBuffer(GET_DATA(key)))) {
-			handleRequest->requestState = LAST_BUFFER;
-		}
+		parseRequestHeaders(key);
+		readBuffer = getCurrentBuffer(GET_DATA(key));
+	}
+
+	if (getRequestBody(GET_DATA(key))->isSpliced) {
+		return requestSpliceWrite(key);
+	}
+
+	pointer = buffer_read_ptr(readBuffer, &count);
+	if (readBuffer != &handleRequest->parseHeaders.valueBuffer) {
+		count = requestBodyCount(GET_DATA(key), pointer, count);
 	}
 
 	// if everything is read on buffer
-	if (!buffer_can_read(readBuffer)) {
+	if (count == 0) {
 		// set interest no op on fd an read on client fd
 		return setAdecuateFdInterests(key);
 	}
 
-	pointer   = buffer_read_ptr(readBuffer, &count);
 	bytesRead = send(key->fd, pointer, count, 0);
 
 	if (bytesRead > 0) {
+		if (readBuffer != &handleRequest->parseHeaders.valueBuffer) {
+			struct requestBody *requestBody = getRequestBody(GET_DATA(key));
+			handleRequest->bodySent			= TRUE;
+			if (requestBody->isFramingKnown) {
+				requestBody->pending -= bytesRead;
+			}
+		}
 		buffer_read_adv(readBuffer, bytesRead);
-		increaseTransferBytes(bytesRead);
+		addBytesToOrigin(GET_DATA(key), bytesRead);
 		ret = setAdecuateFdInterests(key);
 	}
 	else {
@@ -95,6 +197,26 @@ unsigned requestWrite(struct selector_key *key) {
 	return ret;
 }
 
+unsigned requestTimeout(struct selector_key *key) {
+	httpADT_t state						= GET_DATA(key);
+	struct handleRequest *handleRequest = getHandleRequestState(state);
+
+	increaseDeadlineExpiries();
+
+	if (handleRequest->parseHeaders.state == BODY_START) {
+		return ERROR;
+	}
+
+	/* Nothing was answered yet, origin is not listened while the error is
+	 * sent */
+	if (SELECTOR_SUCCESS !=
+		selector_set_interest(key->s, getOriginFd(state), OP_NOOP)) {
+		return ERROR;
+	}
+	setErrorType(state, REQUEST_TIMEOUT);
+	return ERROR_CLIENT;
+}
+
 unsigned setAdecuateFdInterests(struct selector_key *key) {
 	httpADT_t state						= GET_DATA(key);
 	struct handleRequest *handleRequest = getHandleRequestState(state);
@@ -102,12 +224,23 @@ unsigned setAdecuateFdInterests(struct selector_key *key) {
 	buffer *readBuffer					= getReadBuffer(state);
 	buffer *parsedBuffer = &(handleRequest->parseHeaders.valueBuffer);
 	buffer *writeBuffer  = getWriteBuffer(state);
-	unsigned ret		 = HANDLE_REQUEST;
-	int clientInterest   = OP_NOOP;
-	int originInterest   = OP_NOOP;
+	struct requestBody *requestBody = getRequestBody(state);
+	unsigned ret					= HANDLE_REQUEST;
+	int clientInterest				= OP_NOOP;
+	int originInterest				= OP_NOOP;
 
-	if (buffer_can_write(readBuffer) && !buffer_can_read(parsedBuffer) &&
-		!buffer_can_read(finishBuffer)) {
+	startRequestSplice(state);
+
+	if (requestBody->isSpliced) {
+		if (spliceRelayCanFill(getSpliceRelay(state)) &&
+			!messageFramingIsDone(&requestBody->framing)) {
+			clientInterest |= OP_READ;
+		}
+	}
+	/* What follows a complete request waits for the next one */
+	else if (buffer_can_write(readBuffer) && !buffer_can_read(parsedBuffer) &&
+			 !buffer_can_read(finishBuffer) &&
+			 !(getClientKeepAlive(state) && isRequestSent(state))) {
 		clientInterest |= OP_READ;
 	}
 
@@ -115,9 +248,7 @@ unsigned setAdecuateFdInterests(struct selector_key *key) {
 		originInterest |= OP_READ;
 	}
 
-	if (buffer_can_read(parsedBuffer) ||
-		(!handleRequest->parseHeaders.censure && buffer_can_read(readBuffer)) ||
-		buffer_can_read(finishBuffer)) {
+	if (hasDataForOrigin(state)) {
 		originInterest |= OP_WRITE;
 	}
 
@@ -146,3 +277,174 @@ static buffer *getCurrentBuffer(httpADT_t state) {
 		return getReadBuffer(state);
 	}
 }
+
+int isRequestSent(httpADT_t state) {
+	struct requestBody *requestBody = getRequestBody(state);
+
+	return requestBody->isFramingKnown &&
+		   messageFramingIsDone(&requestBody->framing) &&
+		   requestBody->pending == 0 &&
+		   (!requestBody->isSpliced || getSpliceRelay(state)->buffered == 0);
+}
+
+static void parseRequestHeaders(struct selector_key *key) {
+	httpADT_t state						= GET_DATA(key);
+	struct handleRequest *handleRequest = getHandleRequestState(state);
+	buffer *input						= getFinishParserBuffer(state);
+
+	/* The finish parser buffer has what was read first */
+	if (!buffer_can_read(input)) {
+		input = getReadBuffer(state);
+	}
+
+	parseHeaders(&handleRequest->parseHeaders, input, 0, 0);
+
+	if (handleRequest->parseHeaders.state == BODY_START) {
+		startRequestBody(state);
+		armResponseTimer(key);
+	}
+}
+
+static void startRequestBody(httpADT_t state) {
+	struct handleRequest *handleRequest = getHandleRequestState(state);
+	struct headersParser *headers		= &handleRequest->parseHeaders;
+	struct requestBody *requestBody		= getRequestBody(state);
+
+	requestBody->pending		= 0;
+	requestBody->isFramingKnown = hasKnownLength(headers);
+
+	if (!requestBody->isFramingKnown) {
+		/* Relayed until either side closes */
+		setClientKeepAlive(state, FALSE);
+	}
+	else if (headers->isChunked) {
+		messageFramingChunked(&requestBody->framing);
+	}
+	else {
+		messageFramingLength(&requestBody->framing,
+							 headers->contentLength > 0 ?
+								 headers->contentLength :
+								 0);
+	}
+
+	if (headers->connectionClose) {
+		setClientKeepAlive(state, FALSE);
+	}
+}
+
+static size_t requestBodyCount(httpADT_t state, uint8_t *data, size_t count) {
+	struct requestBody *requestBody = getRequestBody(state);
+
+	if (!requestBody->isFramingKnown) {
+		return count;
+	}
+
+	if (requestBody->pending == 0 &&
+		!messageFramingIsDone(&requestBody->framing)) {
+		requestBody->pending =
+			messageFramingConsume(&requestBody->framing, data, count);
+
+		if (messageFramingHasError(&requestBody->framing)) {
+			requestBody->isFramingKnown = FALSE;
+			setClientKeepAlive(state, FALSE);
+			return count;
+		}
+	}
+
+	return requestBody->pending < count ? requestBody->pending : count;
+}
+
+static int hasDataForOrigin(httpADT_t state) {
+	struct handleRequest *handleRequest = getHandleRequestState(state);
+	buffer *finishBuffer				= getFinishParserBuffer(state);
+	buffer *readBuffer					= getReadBuffer(state);
+
+	if (buffer_can_read(&handleRequest->parseHeaders.valueBuffer)) {
+		return TRUE;
+	}
+
+	if (getRequestBody(state)->isSpliced) {
+		return getSpliceRelay(state)->buffered > 0;
+	}
+
+	if (handleRequest->parseHeaders.state != BODY_START) {
+		/* Headers left to parse */
+		return buffer_can_read(finishBuffer) || buffer_can_read(readBuffer);
+	}
+
+	return !isRequestSent(state) &&
+		   (buffer_can_read(finishBuffer) || buffer_can_read(readBuffer));
+}
+
+static void startRequestSplice(httpADT_t state) {
+	struct handleRequest *handleRequest = getHandleRequestState(state);
+	struct requestBody *requestBody		= getRequestBody(state);
+
+	if (requestBody->isSpliced || !requestBody->isFramingKnown ||
+		requestBody->pending != 0 ||
+		handleRequest->parseHeaders.state != BODY_START ||
+		buffer_can_read(&handleRequest->parseHeaders.valueBuffer) ||
+		buffer_can_read(getFinishParserBuffer(state)) ||
+		buffer_can_read(getReadBuffer(state)) ||
+		messageFramingSkippable(&requestBody->framing) < SPLICE_MIN_LENGTH) {
+		return;
+	}
+
+	requestBody->isSpliced = spliceRelayOpen(getSpliceRelay(state)) == 0;
+}
+
+static unsigned requestSpliceRead(struct selector_key *key) {
+	struct requestBody *requestBody = getRequestBody(GET_DATA(key));
+	size_t max = messageFramingSkippable(&requestBody->framing);
+	ssize_t bytesRead =
+		spliceRelayFill(getSpliceRelay(GET_DATA(key)), key->fd, max);
+
+	if (bytesRead > 0) {
+		messageFramingSkip(&requestBody->framing, bytesRead);
+	}
+	else if (bytesRead == 0 || errno != EAGAIN) {
+		return ERROR;
+	}
+
+	return setAdecuateFdInterests(key);
+}
+
+static unsigned requestSpliceWrite(struct selector_key *key) {
+	struct handleRequest *handleRequest = getHandleRequestState(GET_DATA(key));
+	struct spliceRelay *relay			= getSpliceRelay(GET_DATA(key));
+	ssize_t bytesSent;
+
+	if (relay->buffered == 0) {
+		return setAdecuateFdInterests(key);
+	}
+
+	bytesSent = spliceRelayDrain(relay, key->fd);
+
+	if (bytesSent > 0) {
+		handleRequest->bodySent = TRUE;
+		addBytesToOrigin(GET_DATA(key), bytesSent);
+	}
+	else if (bytesSent == 0 || errno != EAGAIN) {
+		return ERROR;
+	}
+
+	return setAdecuateFdInterests(key);
+}
+
+static void armRequestTimer(struct selector_key *key) {
+	struct handleRequest *handleRequest = getHandleRequestState(GET_DATA(key));
+	unsigned timeout					= getHeaderTimeout(getConfiguration());
+	int clientFd						= getClientFd(GET_DATA(key));
+
+	if (handleRequest->parseHeaders.state == BODY_START) {
+		armResponseTimer(key);
+	}
+	else if (timeout == 0) {
+		selector_clear_timeout(key->s, clientFd);
+	}
+	else if (!handleRequest->isTimerArmed) {
+		/* The header timeout is not restarted by each read */
+		selector_set_timeout(key->s, clientFd, timeout);
+		handleRequest->isTimerArmed = TRUE;
+	}
+}
@@ -8,19 +8,62 @@
 #include <configuration.h>
 #include <utilities.h>
 #include <logger.h>
+#include <spliceRelay.h>
+#include <errno.h>
 
 /*
  * Returns buffer to read from to write on clientFd
  */
 static buffer *getCurrentResponseBuffer(httpADT_t state);
 
+/*
+ * Decides how the response body is delimited once headers are parsed
+ */
+static void startResponseBody(struct selector_key *key);
+
+/*
+ * Follows n body bytes read from origin
+ */
+static void trackResponseBody(struct selector_key *key, uint8_t *data,
+							  size_t n);
+
+/*
+ * Returns TRUE if the whole response has been read and sent to client
+ */
+static int isResponseSent(httpADT_t state);
+
+/*
+ * Decides which connections are kept once the response has been sent
+ */
+static unsigned responseSent(struct selector_key *key);
+
+/*
+ * Relays the rest of the body with splice once the buffers are empty
+ */
+static void startResponseSplice(httpADT_t state);
+
+/*
+ * Moves body bytes from origin fd into the splice relay
+ */
+static unsigned responseSpliceRead(struct selector_key *key);
+
+/*
+ * Moves body bytes from the splice relay to client fd
+ */
+static unsigned responseSpliceWrite(struct selector_key *key);
+
 void responseInit(const unsigned state, struct selector_key *key) {
 	struct handleResponse *handleResponse =
 		getHandleResponseState(GET_DATA(key));
 	headersParserInit(&(handleResponse->parseHeaders), key, FALSE);
+	handleResponse->parseHeaders.clientKeepAlive =
+		getClientKeepAlive(GET_DATA(key));
 	buffer_init(&(handleResponse->requestDataBuffer), BUFFER_SIZE,
-				handleResponse->requestData);
+				getStateBuffer(GET_DATA(key), 1));
 	handleResponse->responseFinished = FALSE;
+	handleResponse->isFramingKnown   = FALSE;
+	handleResponse->isSpliced		 = FALSE;
+	armResponseTimer(key);
 	logAccess(GET_DATA(key), REQ);
 }
 
@@ -35,6 +78,7 @@ void responseDestroy(const unsigned state, struct selector_key *key) {
 		setTransformContent(GET_DATA(key), FALSE);
 	}
 	setIsChunked(GET_DATA(key), handleResponse->parseHeaders.isChunked);
+	selector_clear_timeout(key->s, getClientFd(GET_DATA(key)));
 	logAccess(GET_DATA(key), RESP);
 }
 
@@ -47,14 +91,22 @@ unsigned responseRead(struct selector_key *key) {
 	size_t count;
 	ssize_t bytesRead;
 
+	armResponseTimer(key);
+
 	if (key->fd == getClientFd(GET_DATA(key))) {
 		return readFromClient(key);
 	}
 
+	/* A spliced body is not looked at, it can not be transformed */
 	if (handleResponse->parseHeaders.state == BODY_START &&
-		getIsTransformationOn(getConfiguration())) {
+		getIsTransformationOn(getConfiguration()) &&
+		!handleResponse->isSpliced) {
 		return TRANSFORM_BODY;
 	}
+	if (handleResponse->isSpliced) {
+		return responseSpliceRead(key);
+	}
+
 	// if there is no space to read should write what i already read
 	if (!buffer_can_write(writeBuffer)) {
 		// set interest no op on fd an write on origin fd
@@ -66,14 +118,22 @@ unsigned responseRead(struct selector_key *key) {
 
 	if (bytesRead > 0) {
 		int begining = pointer - writeBuffer->data;
+		stopLatency(GET_DATA(key), FIRST_BYTE_LATENCY);
 		buffer_write_adv(writeBuffer, bytesRead);
 		if (handleResponse->parseHeaders.state != BODY_START) {
 			parseHeaders(&handleResponse->parseHeaders, writeBuffer, begining,
 						 begining + bytesRead);
+			if (handleResponse->parseHeaders.state == BODY_START) {
+				startResponseBody(key);
+			}
+		}
+		else {
+			trackResponseBody(key, pointer, bytesRead);
 		}
 		ret = setResponseFdInterests(key);
 	}
 	else if (bytesRead == 0) {
+		setOriginKeepAlive(GET_DATA(key), FALSE);
 		handleResponse->responseFinished = TRUE;
 		if (!buffer_can_read(writeBuffer)) {
 			setErrorDoneFd(key);
@@ -109,6 +169,8 @@ unsigned readFromClient(struct selector_key *key) {
 	bytesRead = recv(key->fd, pointer, count, 0);
 
 	if (bytesRead > 0) {
+		/* Origin would take it as the beginning of another request */
+		setOriginKeepAlive(GET_DATA(key), FALSE);
 		buffer_write_adv(writeBuffer, bytesRead);
 		ret = setResponseFdInterests(key);
 	}
@@ -134,16 +196,27 @@ unsigned responseWrite(struct selector_key *key) {
 	uint8_t *pointer;
 	size_t count;
 	ssize_t bytesRead;
+
+	armResponseTimer(key);
+
 	if (key->fd == getOriginFd(GET_DATA(key))) {
 		return writeToOrigin(key);
 	}
 
 	if (handleResponse->parseHeaders.state == BODY_START &&
 		getIsTransformationOn(getConfiguration()) &&
-		!buffer_can_read(parsedBuffer)) {
+		!buffer_can_read(parsedBuffer) && !handleResponse->isSpliced) {
 		return TRANSFORM_BODY;
 	}
 
+	if (isResponseSent(GET_DATA(key))) {
+		return responseSent(key);
+	}
+
+	if (handleResponse->isSpliced) {
+		return responseSpliceWrite(key);
+	}
+
 	// if everything is read on buffer
 	if (!buffer_can_read(writeBuffer)) {
 		// set interest no op on fd an read on client fd
@@ -155,7 +228,12 @@ unsigned responseWrite(struct selector_key *key) {
 
 	if (bytesRead > 0) {
 		buffer_read_adv(writeBuffer, bytesRead);
-		increaseTransferBytes(bytesRead);
+		addBytesToClient(GET_DATA(key), bytesRead);
+
+		if (isResponseSent(GET_DATA(key))) {
+			return responseSent(key);
+		}
+
 		ret = setResponseFdInterests(key);
 	}
 	else if (handleResponse->responseFinished == TRUE &&
@@ -191,7 +269,7 @@ unsigned writeToOrigin(struct selector_key *key) {
 
 	if (bytesRead > 0) {
 		buffer_read_adv(writeBuffer, bytesRead);
-		increaseTransferBytes(bytesRead);
+		addBytesToClient(GET_DATA(key), bytesRead);
 		ret = setResponseFdInterests(key);
 	}
 	else {
@@ -209,13 +287,17 @@ unsigned setResponseFdInterests(struct selector_key *key) {
 	buffer *parsedBuffer  = &(handleResponse->parseHeaders.valueBuffer);
 	buffer *requestBuffer = &(handleResponse->requestDataBuffer);
 	;
-	unsigned ret	   = HANDLE_RESPONSE;
-	int clientInterest = OP_NOOP;
-	int originInterest = OP_NOOP;
+	struct spliceRelay *relay = getSpliceRelay(state);
+	unsigned ret			  = HANDLE_RESPONSE;
+	int clientInterest		  = OP_NOOP;
+	int originInterest		  = OP_NOOP;
+
+	startResponseSplice(state);
 
 	if (buffer_can_read(parsedBuffer) ||
 		(handleResponse->parseHeaders.state == BODY_START &&
-		 buffer_can_read(writeBuffer))) {
+		 buffer_can_read(writeBuffer)) ||
+		(handleResponse->isSpliced && relay->buffered > 0)) {
 		clientInterest |= OP_WRITE;
 	}
 
@@ -223,11 +305,15 @@ unsigned setResponseFdInterests(struct selector_key *key) {
 		originInterest |= OP_WRITE;
 	}
 
-	if (buffer_can_write(writeBuffer) && !buffer_can_read(parsedBuffer)) {
+	if (buffer_can_write(writeBuffer) && !buffer_can_read(parsedBuffer) &&
+		!handleResponse->responseFinished &&
+		(!handleResponse->isSpliced || spliceRelayCanFill(relay))) {
 		originInterest |= OP_READ;
 	}
 
-	if (buffer_can_write(requestBuffer) && !buffer_can_read(requestBuffer)) {
+	/* A kept client may already be sending its next request */
+	if (buffer_can_write(requestBuffer) && !buffer_can_read(requestBuffer) &&
+		!getClientKeepAlive(state)) {
 		clientInterest |= OP_READ;
 	}
 
@@ -251,3 +337,196 @@ static buffer *getCurrentResponseBuffer(httpADT_t state) {
 		return getWriteBuffer(state);
 	}
 }
+
+static void startResponseBody(struct selector_key *key) {
+	httpADT_t state						  = GET_DATA(key);
+	struct handleResponse *handleResponse = getHandleResponseState(state);
+	struct headersParser *headers		  = &handleResponse->parseHeaders;
+	buffer *writeBuffer					  = getWriteBuffer(state);
+	int status							  = headers->statusCode;
+	uint8_t *pointer;
+	size_t count;
+
+	handleResponse->isFramingKnown = TRUE;
+	setResponseStatus(state, status);
+
+	if (status < 200 || headers->framingError) {
+		/* An interim response, the final one comes later */
+		handleResponse->isFramingKnown = FALSE;
+	}
+	else if (getRequestMethod(state) == HEAD_METHOD || status == 204 ||
+			 status == 304) {
+		messageFramingLength(&handleResponse->framing, 0);
+	}
+	else if (!hasKnownLength(headers)) {
+		handleResponse->isFramingKnown = FALSE;
+	}
+	else if (headers->isChunked) {
+		messageFramingChunked(&handleResponse->framing);
+	}
+	else {
+		messageFramingLength(&handleResponse->framing, headers->contentLength);
+	}
+
+	if (!handleResponse->isFramingKnown || !headers->isHttp11 ||
+		headers->connectionClose) {
+		setOriginKeepAlive(state, FALSE);
+	}
+
+	/* What is left after the headers is the beginning of the body */
+	pointer = buffer_read_ptr(writeBuffer, &count);
+	trackResponseBody(key, pointer, count);
+}
+
+static void trackResponseBody(struct selector_key *key, uint8_t *data,
+							  size_t n) {
+	httpADT_t state						  = GET_DATA(key);
+	struct handleResponse *handleResponse = getHandleResponseState(state);
+	struct messageFraming *framing		  = &handleResponse->framing;
+
+	if (!handleResponse->isFramingKnown) {
+		return;
+	}
+
+	size_t used = messageFramingConsume(framing, data, n);
+
+	if (messageFramingHasError(framing)) {
+		/* Relayed as is until origin closes */
+		handleResponse->isFramingKnown = FALSE;
+		setOriginKeepAlive(state, FALSE);
+	}
+	else if (messageFramingIsDone(framing)) {
+		handleResponse->responseFinished = TRUE;
+
+		if (used < n) {
+			setOriginKeepAlive(state, FALSE);
+		}
+	}
+}
+
+static int isResponseSent(httpADT_t state) {
+	struct handleResponse *handleResponse = getHandleResponseState(state);
+
+	return handleResponse->isFramingKnown &&
+		   messageFramingIsDone(&handleResponse->framing) &&
+		   !buffer_can_read(&handleResponse->parseHeaders.valueBuffer) &&
+		   !buffer_can_read(getWriteBuffer(state)) &&
+		   getSpliceRelay(state)->buffered == 0;
+}
+
+static unsigned responseSent(struct selector_key *key) {
+	httpADT_t state						  = GET_DATA(key);
+	struct handleResponse *handleResponse = getHandleResponseState(state);
+
+	setOriginReusable(state, getOriginKeepAlive(state));
+	setClientReusable(state, handleResponse->parseHeaders.keepAlive &&
+								 getClientKeepAlive(state));
+
+	return DONE;
+}
+
+static void startResponseSplice(httpADT_t state) {
+	struct handleResponse *handleResponse = getHandleResponseState(state);
+	struct messageFraming *framing		  = &handleResponse->framing;
+
+	if (handleResponse->isSpliced || handleResponse->responseFinished ||
+		handleResponse->parseHeaders.state != BODY_START ||
+		getIsTransformationOn(getConfiguration()) ||
+		buffer_can_read(&handleResponse->parseHeaders.valueBuffer) ||
+		buffer_can_read(getWriteBuffer(state))) {
+		return;
+	}
+
+	/* A chunked body is copied, its framing has to be looked at */
+	if (handleResponse->isFramingKnown &&
+		messageFramingSkippable(framing) < SPLICE_MIN_LENGTH) {
+		return;
+	}
+
+	handleResponse->isSpliced = spliceRelayOpen(getSpliceRelay(state)) == 0;
+}
+
+static unsigned responseSpliceRead(struct selector_key *key) {
+	httpADT_t state						  = GET_DATA(key);
+	struct handleResponse *handleResponse = getHandleResponseState(state);
+	struct spliceRelay *relay			  = getSpliceRelay(state);
+	size_t max							  = SIZE_MAX;
+	ssize_t bytesRead;
+
+	if (handleResponse->isFramingKnown) {
+		max = messageFramingSkippable(&handleResponse->framing);
+	}
+
+	bytesRead = spliceRelayFill(relay, key->fd, max);
+
+	if (bytesRead > 0) {
+		if (handleResponse->isFramingKnown) {
+			messageFramingSkip(&handleResponse->framing, bytesRead);
+			handleResponse->responseFinished =
+				messageFramingIsDone(&handleResponse->framing);
+		}
+	}
+	else if (bytesRead == 0) {
+		setOriginKeepAlive(state, FALSE);
+		handleResponse->responseFinished = TRUE;
+		if (relay->buffered == 0) {
+			setErrorDoneFd(key);
+			return DONE;
+		}
+	}
+	else if (errno != EAGAIN) {
+		return ERROR;
+	}
+
+	return setResponseFdInterests(key);
+}
+
+unsigned responseTimeout(struct selector_key *key) {
+	/* Headers may already be sent, the connection is closed */
+	increaseDeadlineExpiries();
+	return ERROR;
+}
+
+void armResponseTimer(struct selector_key *key) {
+	unsigned timeout = getResponseTimeout(getConfiguration());
+
+	if (timeout == 0) {
+		selector_clear_timeout(key->s, getClientFd(GET_DATA(key)));
+	}
+	else {
+		selector_set_timeout(key->s, getClientFd(GET_DATA(key)), timeout);
+	}
+}
+
+static unsigned responseSpliceWrite(struct selector_key *key) {
+	httpADT_t state						  = GET_DATA(key);
+	struct handleResponse *handleResponse = getHandleResponseState(state);
+	struct spliceRelay *relay			  = getSpliceRelay(state);
+	ssize_t bytesSent;
+
+	if (relay->buffered == 0) {
+		return setResponseFdInterests(key);
+	}
+
+	bytesSent = spliceRelayDrain(relay, key->fd);
+
+	if (bytesSent > 0) {
+		addBytesToClient(GET_DATA(key), bytesSent);
+
+		if (isResponseSent(state)) {
+			return responseSent(key);
+		}
+
+		if (handleResponse->responseFinished && relay->buffered == 0) {
+			/* Origin closed, that was the end of the body */
+			setErrorDoneFd(key);
+			return DONE;
+		}
+	}
+	else if (bytesSent == 0 || errno != EAGAIN) {
+		setErrorDoneFd(key);
+		return ERROR;
+	}
+
+	return setResponseFdInterests(key);
+}
@@ -7,10 +7,15 @@
 #include <ctype.h>
 #include <http.h>
 #include <httpProxyADT.h>
+#include <byteScan.h>
 
 #define isOWS(a) (a == ' ' || a == '\t')
 
 static void isCensureHeader(struct headersParser *header);
+static void isFramingHeader(struct headersParser *header);
+static void handleFramingValue(char l, struct headersParser *header);
+static void handleStatusLine(char l, struct headersParser *header);
+static void copyHeaderSpan(struct headersParser *header, buffer *input);
 
 void headersParserInit(struct headersParser *header, struct selector_key *key,
 					   uint8_t isRequest) {
@@ -27,7 +32,9 @@ void headersParserInit(struct headersParser *header, struct selector_key *key,
 	header->isRequest		   = isRequest;
 	header->transformContent   = FALSE;
 	header->mediaRangeCurrent  = 0;
-	header->mediaRange		   = getMediaRangeHTTP(GET_DATA(key));
+	header->mediaRangeState	   = MEDIA_RANGE_MATCH_START;
+	header->mediaRangeMatcher  = getMediaRangeMatcherHTTP(GET_DATA(key));
+	header->valueBuf		   = getStateBuffer(GET_DATA(key), 0);
 	header->tranferIndex	   = 0;
 	header->contentIndex	   = 0;
 	header->isEncoded		   = FALSE;
@@ -37,21 +44,35 @@ void headersParserInit(struct headersParser *header, struct selector_key *key,
 
 	header->firstLine = 0;
 
+	header->contentLength		= -1;
+	header->isContentLength		= FALSE;
+	header->hasTransferEncoding = FALSE;
+	header->framingError		= FALSE;
+	header->isConnection		= FALSE;
+	header->connectionClose		= FALSE;
+	header->connectionIndex		= 0;
+	header->firstLineIndex		= 0;
+	header->isHttp11			= TRUE;
+	header->statusCode			= 0;
+	header->keepAlive			= FALSE;
+	header->clientKeepAlive		= FALSE;
+
 	memset(header->mimeValue, 0, MAX_MIME_HEADER);
 	memset(header->transferValue, 0, CHUNKED_LENGTH + 1);
 	memset(header->contentValue, 0, IDENTITY_LENGTH + 1);
 
 	buffer_init(&(header->headerBuffer), MAX_HEADER_LENGTH, header->headerBuf);
-	buffer_init(&(header->valueBuffer),
-				BUFFER_SIZE + 30 + 20 + MAX_HOP_BY_HOP_HEADER_LENGTH,
-				header->valueBuf);
+	buffer_init(&(header->valueBuffer), VALUE_BUFFER_SIZE, header->valueBuf);
 }
 
 void parseHeaders(struct headersParser *header, buffer *input, int begining,
 				  int end) {
-	uint8_t l = buffer_read(input);
+	uint8_t l;
 	size_t spaceLeft;
 
+	copyHeaderSpan(header, input);
+	l = buffer_read(input);
+
 	while (l) {
 		parseHeadersByChar(l, header);
 		if (header->state == HEADER_DONE) {
@@ -65,10 +86,58 @@ void parseHeaders(struct headersParser *header, buffer *input, int begining,
 		if (spaceLeft <= MAX_HOP_BY_HOP_HEADER_LENGTH) {
 			return;
 		}
+		copyHeaderSpan(header, input);
 		l = buffer_read(input);
 	}
 }
 
+/*
+ * Consumes at once the bytes the state machine would only copy: the rest of
+ * a header name, or of a value that is not inspected. The byte that ends
+ * them, and the last one that fits in the value buffer, go through
+ * parseHeadersByChar.
+ */
+static void copyHeaderSpan(struct headersParser *header, buffer *input) {
+	static const uint8_t nameEnd[]	= {':', '\0'};
+	static const uint8_t valueEnd[] = {'\n', '\0'};
+	size_t length, spaceLeft, n;
+	uint8_t *data = buffer_read_ptr(input, &length);
+	uint8_t *to;
+
+	if (header->state == HEADER_NAME) {
+		// The name that reaches MAX_HOP_BY_HOP_HEADER_LENGTH is copied as is
+		if (header->headerIndex + 1 >= MAX_HOP_BY_HOP_HEADER_LENGTH) {
+			return;
+		}
+		n = MAX_HOP_BY_HOP_HEADER_LENGTH - 1 - header->headerIndex;
+		n = byteScan(data, length < n ? length : n, nameEnd, sizeof(nameEnd));
+		for (size_t i = 0; i < n; i++) {
+			header->currHeader[header->headerIndex++] = tolower(data[i]);
+		}
+	}
+	else if (header->state == HEADER_VALUE && !header->isMime &&
+			 !header->isTransfer && !header->isEncoded &&
+			 !header->isContentLength && !header->isConnection) {
+		n = byteScan(data, length, valueEnd, sizeof(valueEnd));
+		if (!header->censure) {
+			to = buffer_write_ptr(&header->valueBuffer, &spaceLeft);
+			if (spaceLeft <= MAX_HOP_BY_HOP_HEADER_LENGTH + 1) {
+				return;
+			}
+			if (n > spaceLeft - MAX_HOP_BY_HOP_HEADER_LENGTH - 1) {
+				n = spaceLeft - MAX_HOP_BY_HOP_HEADER_LENGTH - 1;
+			}
+			memcpy(to, data, n);
+			buffer_write_adv(&header->valueBuffer, n);
+		}
+	}
+	else {
+		return;
+	}
+
+	buffer_read_adv(input, n);
+}
+
 void parseHeadersByChar(char l, struct headersParser *header) {
 	int state = header->state;
 	switch (state) {
@@ -114,9 +183,50 @@ void resetHeaderParser(struct headersParser *header) {
 	header->isTransfer   = FALSE;
 	header->isChar		 = FALSE;
 	header->isEncoded	= FALSE;
+	header->isContentLength = FALSE;
+	header->isConnection	= FALSE;
+}
+
+static void isFramingHeader(struct headersParser *header) {
+	if (strcmp(header->currHeader, "content-length") == 0) {
+		if (header->contentLength != -1) {
+			/* Repeated, may disagree */
+			header->framingError = TRUE;
+		}
+		header->contentLength   = 0;
+		header->isContentLength = TRUE;
+	}
+	else if (strcmp(header->currHeader, "transfer-encoding") == 0) {
+		header->hasTransferEncoding = TRUE;
+		header->isTransfer			= TRUE;
+	}
+	else if (strcmp(header->currHeader, "connection") == 0) {
+		header->isConnection	= TRUE;
+		header->connectionIndex = 0;
+	}
+}
+
+static void handleFramingValue(char l, struct headersParser *header) {
+	if (header->isContentLength) {
+		if (isdigit(l) && header->contentLength < MAX_CONTENT_LENGTH) {
+			header->contentLength = header->contentLength * 10 + l - '0';
+		}
+		else if (!isOWS(l) && l != '\r') {
+			header->framingError = TRUE;
+		}
+	}
+	else if (header->isConnection && l != '\r' &&
+			 header->connectionIndex < CONNECTION_VALUE_LENGTH) {
+		header->connectionValue[header->connectionIndex++] = tolower(l);
+	}
 }
 
 static void isCensureHeader(struct headersParser *header) {
+	if (header->headerIndex < MAX_HOP_BY_HOP_HEADER_LENGTH &&
+		header->headerIndex != 0) {
+		isFramingHeader(header);
+	}
+
 	if (header->headerIndex >= MAX_HOP_BY_HOP_HEADER_LENGTH ||
 		header->headerIndex == 0) {
 		header->censure = FALSE;
@@ -164,8 +274,44 @@ int getTransformContentParser(struct headersParser *header) {
 	return header->transformContent;
 }
 
+uint8_t hasKnownLength(struct headersParser *header) {
+	if (header->framingError) {
+		return FALSE;
+	}
+
+	if (header->hasTransferEncoding) {
+		/* Chunked must be the last coding, otherwise it ends on close */
+		return header->isChunked;
+	}
+
+	return header->isRequest || header->contentLength >= 0;
+}
+
+uint8_t hasBody(struct headersParser *header) {
+	return header->hasTransferEncoding || header->contentLength > 0;
+}
+
 void addLastHeaders(struct headersParser *header) {
 	size_t count, size;
+	char *newHeader = "connection: close\r\n\r\n";
+
+	if (header->isRequest && getUpstreamMaxIdle(getConfiguration()) > 0 &&
+		!getIsTransformationOn(getConfiguration()) && !hasBody(header) &&
+		!header->framingError) {
+		/* The transformation path reads the response until origin closes */
+		newHeader		  = "connection: keep-alive\r\n\r\n";
+		header->keepAlive = TRUE;
+	}
+	else if (!header->isRequest && header->clientKeepAlive &&
+			 !getIsTransformationOn(getConfiguration()) &&
+			 header->statusCode >= 200 &&
+			 (hasKnownLength(header) || header->statusCode == 204 ||
+			  header->statusCode == 304)) {
+		/* The client finds where it ends, so it can send another request */
+		newHeader		  = "connection: keep-alive\r\n\r\n";
+		header->keepAlive = TRUE;
+	}
+
 	if (!header->isRequest && getIsTransformationOn(getConfiguration())) {
 		char *newHeader2 = "transfer-encoding: chunked\r\n";
 		size			 = strlen(newHeader2);
@@ -174,8 +320,7 @@ void addLastHeaders(struct headersParser *header) {
 		buffer_write_adv(&header->valueBuffer, size);
 	}
 
-	char *newHeader = "connection: close\r\n\r\n";
-	size			= strlen(newHeader);
+	size = strlen(newHeader);
 	memcpy(buffer_write_ptr(&header->valueBuffer, &count), newHeader, size);
 	buffer_write_adv(&header->valueBuffer, size);
 }
@@ -214,10 +359,34 @@ uint8_t getTransformEncode(struct headersParser *header) {
 	}
 }
 
+/* Keeps the version and the status code of "HTTP/1.1 200 OK" */
+static void handleStatusLine(char l, struct headersParser *header) {
+	static const char http11[] = "HTTP/1.1 ";
+	int index					= header->firstLineIndex++;
+
+	if (index < (int) sizeof(http11) - 1) {
+		if (l != http11[index]) {
+			header->isHttp11 = FALSE;
+		}
+	}
+	else if (index < (int) sizeof(http11) - 1 + 3) {
+		if (isdigit(l)) {
+			header->statusCode = header->statusCode * 10 + l - '0';
+		}
+		else {
+			header->framingError = TRUE;
+		}
+	}
+}
+
 inline void handleFirstLine(char l, struct headersParser *header) {
 	if (l == '\n') {
 		if (header->firstLine == IS_100) {
-			header->state = FIRST_LINE;
+			/* The status of the final response is read again */
+			header->state		   = FIRST_LINE;
+			header->firstLineIndex = 0;
+			header->statusCode	   = 0;
+			header->isHttp11	   = TRUE;
 		}
 		else {
 			header->state = HEADERS_START;
@@ -228,6 +397,7 @@ inline void handleFirstLine(char l, struct headersParser *header) {
 	}
 	else {
 		buffer_write(header->responseLineBuffer, l);
+		handleStatusLine(l, header);
 		if (header->firstLine <= 0) {
 			header->firstLine++;
 			if ((header->firstLine == 10 && l != '1') ||
@@ -279,16 +449,26 @@ inline void handleHeadersName(char l, struct headersParser *header) {
 
 inline void handleHeaderValue(char l, struct headersParser *header) {
 	if (l == '\n') {
+		if (header->isConnection) {
+			header->connectionValue[header->connectionIndex] = 0;
+			if (strstr(header->connectionValue, "close") != NULL) {
+				header->connectionClose = TRUE;
+			}
+		}
 		header->state = HEADER_DONE;
 	}
 	else {
+		handleFramingValue(l, header);
 		if (l != '\t' && l != ' ') {
 			header->isChar = TRUE;
 		}
 		if (header->isMime && l != '\r') {
 			if (!isOWS(l) && l != ';' && header->mediaRangeCurrent != -1) {
-				header->transformContent = doesMatchAt(
-					(header->mediaRangeCurrent)++, l, header->mediaRange);
+				header->mediaRangeCurrent++;
+				header->mediaRangeState = mediaRangeMatcherStep(
+					header->mediaRangeMatcher, header->mediaRangeState, l);
+				header->transformContent = mediaRangeMatcherAccepts(
+					header->mediaRangeMatcher, header->mediaRangeState);
 			}
 			else if (header->mediaRangeCurrent != 0) {
 				header->mediaRangeCurrent = -1;
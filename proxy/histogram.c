@@ -0,0 +1,65 @@
+#include <histogram.h>
+
+#define HALF_SUB_BUCKETS (HISTOGRAM_SUB_BUCKETS / 2)
+
+static unsigned bucketOf(uint64_t value) {
+	unsigned shift;
+
+	if (value < HISTOGRAM_SUB_BUCKETS) {
+		return value;
+	}
+
+	// Keeps the HISTOGRAM_SUB_BITS most significant bits of the value
+	shift = 64 - __builtin_clzll(value) - HISTOGRAM_SUB_BITS;
+	return HISTOGRAM_SUB_BUCKETS + (shift - 1) * HALF_SUB_BUCKETS +
+		   ((value >> shift) - HALF_SUB_BUCKETS);
+}
+
+/* Returns the highest value that falls in the bucket */
+static uint64_t bucketEnd(unsigned bucket) {
+	unsigned shift;
+	uint64_t sub;
+
+	if (bucket < HISTOGRAM_SUB_BUCKETS) {
+		return bucket;
+	}
+
+	bucket -= HISTOGRAM_SUB_BUCKETS;
+	shift = bucket / HALF_SUB_BUCKETS + 1;
+	sub	  = bucket % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+	// Wraps to UINT64_MAX for the last bucket
+	return ((sub + 1) << shift) - 1;
+}
+
+void histogramRecord(struct histogram *histogram, uint64_t value) {
+	__atomic_add_fetch(&histogram->counts[bucketOf(value)], 1,
+					   __ATOMIC_RELAXED);
+	__atomic_add_fetch(&histogram->total, 1, __ATOMIC_RELAXED);
+}
+
+uint64_t histogramPercentile(struct histogram *histogram, unsigned perMille) {
+	uint64_t total = __atomic_load_n(&histogram->total, __ATOMIC_RELAXED);
+	uint64_t rank  = (total * perMille + 999) / 1000;
+	uint64_t seen  = 0, last = 0;
+
+	if (total == 0) {
+		return 0;
+	}
+
+	// The counts can be ahead of the total while a value is being recorded
+	for (unsigned i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		uint64_t count =
+			__atomic_load_n(&histogram->counts[i], __ATOMIC_RELAXED);
+
+		if (count == 0) {
+			continue;
+		}
+		last = bucketEnd(i);
+		seen += count;
+		if (seen >= rank) {
+			break;
+		}
+	}
+
+	return last;
+}
@@ -1,4 +1,5 @@
 #include <hostHeaderParser.h>
+#include <byteScan.h>
 #include <stdio.h>
 
 #define isDigit(a) ('0' <= a && a <= '9')
@@ -23,13 +24,14 @@ static enum headerState notHeaderHostTransition(struct headerParser *parser,
 												char l);
 static enum headerState owsHTransition(struct headerParser *parser, char l);
 
-void parseHeaderInit(struct headerParser *parser) {
+void parseHeaderInit(struct headerParser *parser, struct arena *arena) {
 	parser->state		   = START_H;
 	parser->charactersRead = 0;
 	parser->host		   = NULL;
 	parser->sizeHost	   = 0;
 	parser->port		   = -1; // not found
 	parser->hasFoundHost   = FALSE;
+	parser->arena		   = arena;
 }
 
 unsigned getHeaderState(struct headerParser *parser) {
@@ -111,6 +113,20 @@ int parseHeaderChar(struct headerParser *parser, char l) {
 	return flag;
 }
 
+size_t parseHeaderSpan(struct headerParser *parser, const uint8_t *data,
+					   size_t length) {
+	static const uint8_t lineEnd[] = {'\r', '\n', '\0'};
+	size_t n;
+
+	if (parser->state != NOT_HEADER_HOST) {
+		return 0;
+	}
+
+	n = byteScan(data, length, lineEnd, sizeof(lineEnd));
+	parser->charactersRead += n;
+	return n;
+}
+
 enum headerState startTransition(struct headerParser *parser, char l) {
 	enum headerState state = NOT_HEADER_HOST;
 	if (l == 'H' || l == 'h') {
@@ -158,7 +174,8 @@ enum headerState hostDDotsTransition(struct headerParser *parser, char l) {
 	}
 	else if (!isOWS(l)) {
 		state		 = IPFOUR_OR_HOST_NAME;
-		parser->host = addCharToString(parser->host, &parser->sizeHost, l);
+		parser->host =
+			arenaAddChar(parser->arena, parser->host, &parser->sizeHost, l);
 	}
 	return state;
 }
@@ -169,7 +186,8 @@ enum headerState ipSixTransition(struct headerParser *parser, char l) {
 		state = END_IPSIX;
 		l	 = '\0';
 	}
-	parser->host = addCharToString(parser->host, &parser->sizeHost, l);
+	parser->host =
+		arenaAddChar(parser->arena, parser->host, &parser->sizeHost, l);
 	return state;
 }
 
@@ -204,7 +222,8 @@ enum headerState ipFourOrHostNameTransition(struct headerParser *parser,
 		state = OWS_H;
 		l	 = '\0';
 	}
-	parser->host = addCharToString(parser->host, &parser->sizeHost, l);
+	parser->host =
+		arenaAddChar(parser->arena, parser->host, &parser->sizeHost, l);
 	return state;
 }
 
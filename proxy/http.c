@@ -5,6 +5,9 @@
 #include <configuration.h>
 #include <connectToOrigin.h>
 #include <handleRequest.h>
+#include <originPool.h>
+#include <resolver.h>
+#include <logger.h>
 
 #include <assert.h>
 #include <errno.h>
@@ -22,12 +25,17 @@ static void httpWrite(struct selector_key *key);
 static void httpDone(struct selector_key *key);
 static void httpClose(struct selector_key *key);
 static void httpBlock(struct selector_key *key);
+static void httpTimeout(struct selector_key *key);
+static void httpReleaseOrigin(struct selector_key *key);
+static int httpNextRequest(struct selector_key *key);
+static selector_status armIdleTimer(fd_selector s, int clientFd);
 
 static const struct fd_handler httpHandler = {
-	.handle_read  = httpRead,
-	.handle_write = httpWrite,
-	.handle_close = httpClose,
-	.handle_block = httpBlock,
+	.handle_read	= httpRead,
+	.handle_write   = httpWrite,
+	.handle_close   = httpClose,
+	.handle_block   = httpBlock,
+	.handle_timeout = httpTimeout,
 };
 
 const struct fd_handler *getHttpHandler() {
@@ -63,6 +71,8 @@ void httpPassiveAccept(struct selector_key *key) {
 		goto fail;
 	}
 
+	armIdleTimer(key->s, client);
+
 	return;
 
 fail:
@@ -101,45 +111,105 @@ static void httpBlock(struct selector_key *key) {
 	}
 }
 
+static void httpTimeout(struct selector_key *key) {
+	struct state_machine *stm = getStateMachine(GET_DATA(key));
+	const enum httpState st   = stm_handler_timeout(stm, key);
+
+	if (ERROR == st || DONE == st) {
+		httpDone(key);
+	}
+}
+
 static void httpClose(struct selector_key *key) {
 	httpDestroy(GET_DATA(key));
 }
 
 static void httpDone(struct selector_key *key) {
-	const int fds[] = {
-		getClientFd(GET_DATA(key)),
-		getOriginFd(GET_DATA(key)),
-	};
+	if (stopLatency(GET_DATA(key), REQUEST_LATENCY)) {
+		increaseResponsesByStatus(getResponseStatus(GET_DATA(key)));
+		logAccess(GET_DATA(key), SERVED);
+	}
+	httpReleaseOrigin(key);
+
+	if (getResolverJob(GET_DATA(key)) != NULL) {
+		resolverJobRelease(getResolverJob(GET_DATA(key)));
+		setResolverJob(GET_DATA(key), NULL);
+	}
+
+	// The origin host and the strings of the parsers go with the request
+	setOriginHost(GET_DATA(key), NULL);
+	arenaReset(getArena(GET_DATA(key)));
+
+	if (getClientReusable(GET_DATA(key)) && httpNextRequest(key)) {
+		return;
+	}
 
 	decreaseConcurrentConections();
+	spliceRelayClose(getSpliceRelay(GET_DATA(key)));
+
+	releaseMediaRangeMatcher(getMediaRangeMatcherHTTP(GET_DATA(key)));
 
-	if (getSelectorCopy(GET_DATA(key)) != NULL) {
-		void **aux = getSelectorCopy(GET_DATA(key));
-		free(aux[1]);
-		free(aux);
-		setSelectorCopy(GET_DATA(key), NULL);
+	const int clientFd = getClientFd(GET_DATA(key));
+
+	if (SELECTOR_SUCCESS != selector_unregister_fd(key->s, clientFd)) {
+		abort();
 	}
+	close(clientFd);
+}
 
-	if (getOriginHost(GET_DATA(key)) != NULL) {
-		free(getOriginHost(GET_DATA(key)));
-		setOriginHost(GET_DATA(key), NULL);
+/* Pools the origin connection if it can be reused, otherwise closes it */
+static void httpReleaseOrigin(struct selector_key *key) {
+	const int originFd = getOriginFd(GET_DATA(key));
+
+	if (originFd == -1) {
+		return;
 	}
 
-	if (getMediaRangeHTTP(GET_DATA(key)) != NULL) {
-		freeMediaRange(getMediaRangeHTTP(GET_DATA(key)));
+	setOriginFd(GET_DATA(key), -1);
+
+	/* The client fd keeps the struct http alive */
+	if (SELECTOR_SUCCESS != selector_unregister_fd(key->s, originFd)) {
+		abort();
+	}
+
+	if (getOriginReusable(GET_DATA(key))) {
+		originPoolPut(key->s, originFd, getOriginHost(GET_DATA(key)),
+					  getOriginPort(GET_DATA(key)),
+					  getOriginAddress(GET_DATA(key)));
+	}
+	else {
+		close(originFd);
 	}
+}
+
+/*
+ * Keeps the client connection open for its next request. Returns FALSE if
+ * it has to be closed instead.
+ */
+static int httpNextRequest(struct selector_key *key) {
+	const int clientFd = getClientFd(GET_DATA(key));
+	fd_interest interest;
 
-	if (getOriginResolutions((GET_DATA(key))) != NULL) {
-		freeaddrinfo(getOriginResolutions((GET_DATA(key))));
-		setOriginResolutions(GET_DATA(key), NULL);
+	if (!httpReset(GET_DATA(key))) {
+		return FALSE;
 	}
 
-	for (unsigned i = 0; i < SIZE_OF_ARRAY(fds); i++) {
-		if (fds[i] != -1) {
-			if (SELECTOR_SUCCESS != selector_unregister_fd(key->s, fds[i])) {
-				abort();
-			}
-			close(fds[i]);
-		}
+	/* Pipelined requests are parsed as soon as the client is writable */
+	interest =
+		buffer_can_read(getReadBuffer(GET_DATA(key))) ? OP_WRITE : OP_READ;
+
+	return SELECTOR_SUCCESS ==
+			   selector_set_interest(key->s, clientFd, interest) &&
+		   SELECTOR_SUCCESS == armIdleTimer(key->s, clientFd);
+}
+
+/* Waits for the next request of the client, 0 does not limit the wait */
+static selector_status armIdleTimer(fd_selector s, int clientFd) {
+	unsigned timeout = getClientIdleTimeout(getConfiguration());
+
+	if (timeout == 0) {
+		return selector_clear_timeout(s, clientFd);
 	}
+
+	return selector_set_timeout(s, clientFd, timeout);
 }
@@ -5,8 +5,11 @@
 #include <handleResponse.h>
 #include <headersParser.h>
 #include <transformBody.h>
+#include <bufferPool.h>
+#include <slabPool.h>
 
 static const struct state_definition *httpDescribeStates(void);
+static void detachBuffers(struct http *s);
 
 struct http {
 	// Client info
@@ -14,9 +17,6 @@ struct http {
 	socklen_t clientAddrLen;
 	int clientFd;
 
-	// Origin server address resolution
-	struct addrinfo *originResolution;
-
 	// Origin server info
 	struct sockaddr_storage originAddr;
 	socklen_t originAddrLen;
@@ -30,22 +30,26 @@ struct http {
 
 	// Request method
 	unsigned requestMethod;
+	// Status sent to the client, by the origin or by the proxy, 0 if none
+	int responseStatus;
+	// Bytes of the request sent to the origin and of the response to the client
+	uint64_t bytesToOrigin;
+	uint64_t bytesToClient;
+	// The request entry of the access log was queued
+	uint8_t isAccessLogged;
 
 	// States Structures
 	union {
 		struct parseRequest parseRequest;
+		struct connectOrigin connectOrigin;
 		struct handleRequest handleRequest;
 		struct handleResponse handleResponse;
 		struct transformBody transformBody;
 	} clientState;
 
-	// buffers to use: readBuffer and writeBuffer.
-	uint8_t raWRequest[MAX_FIRST_LINE_LENGTH],
-		rawResponse[MAX_FIRST_LINE_LENGTH];
-	uint8_t rawBuffA[BUFFER_SIZE], rawBuffB[BUFFER_SIZE];
+	// Borrowed from the pool while a request is in flight, NULL when idle
+	struct connectionBuffers *buffers;
 	buffer readBuffer, writeBuffer, requestLine, responseLine;
-
-	uint8_t finishParserData[MAX_PARSER];
 	buffer finishParserBuffer;
 
 	buffer errorBuffer;
@@ -56,28 +60,84 @@ struct http {
 
 	int transformContent;
 	uint8_t isChunked;
-	MediaRangePtr_t mediaRanges;
+	MediaRangeMatcherPtr_t mediaRangeMatcher;
+
+	// Origin was asked to keep the connection open after the response
+	uint8_t originKeepAlive;
+	// Origin connection can go back to the origin pool
+	uint8_t originReusable;
+
+	// Client may send another request after this response
+	uint8_t clientKeepAlive;
+	// Response sent, client connection goes back to PARSE
+	uint8_t clientReusable;
+	// Requests already served on the client connection
+	unsigned requestCount;
+	// Where the request body ends
+	struct requestBody requestBody;
+
+	// Pipe to relay bodies with splice, kept while the client is
+	struct spliceRelay spliceRelay;
+
+	// Name resolution of the origin host, owns the resolved addresses
+	resolverJobADT resolverJob;
+
+	// Strings of the request, the origin host among them
+	struct arena arena;
+
+	// When each latency of the request started, 0 if it is not running
+	uint64_t latencyStarts[LATENCY_QTY];
+	// What each latency of the request took, 0 if it was not recorded
+	uint64_t latencies[LATENCY_QTY];
+};
 
-	void **selectorCopyForOtherThread;
+static uint64_t nowMicros(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
 
-	// Next in pool
-	struct http *next;
-};
+void startLatency(struct http *s, enum latency latency) {
+	s->latencyStarts[latency] = nowMicros();
+}
 
-void setSelectorCopy(struct http *s, void **selectorCopyForOtherThread) {
-	s->selectorCopyForOtherThread = selectorCopyForOtherThread;
+int stopLatency(struct http *s, enum latency latency) {
+	if (s->latencyStarts[latency] == 0) {
+		return FALSE;
+	}
+
+	s->latencies[latency]	  = nowMicros() - s->latencyStarts[latency];
+	s->latencyStarts[latency] = 0;
+	recordLatency(latency, s->latencies[latency]);
+	return TRUE;
 }
 
-void **getSelectorCopy(struct http *s) {
-	return s->selectorCopyForOtherThread;
+uint64_t getLatency(struct http *s, enum latency latency) {
+	return s->latencies[latency];
 }
 
-struct addrinfo *getOriginResolutions(struct http *s) {
-	return s->originResolution;
+uint64_t getLatencyElapsed(struct http *s, enum latency latency) {
+	if (s->latencyStarts[latency] == 0) {
+		return 0;
+	}
+
+	return nowMicros() - s->latencyStarts[latency];
+}
+
+void setResolverJob(struct http *s, resolverJobADT resolverJob) {
+	s->resolverJob = resolverJob;
 }
 
-void setOriginResolutions(struct http *s, struct addrinfo *originResolution) {
-	s->originResolution = originResolution;
+resolverJobADT getResolverJob(struct http *s) {
+	return s->resolverJob;
+}
+
+struct addrinfo *getOriginResolutions(struct http *s) {
+	if (s->resolverJob == NULL || !resolverJobIsDone(s->resolverJob)) {
+		return NULL;
+	}
+
+	return resolverJobAddresses(s->resolverJob);
 }
 
 struct state_machine *getStateMachine(struct http *s) {
@@ -108,6 +168,14 @@ struct parseRequest *getParseRequestState(httpADT_t s) {
 	return &((s->clientState).parseRequest);
 }
 
+struct sockaddr_storage *getOriginAddress(httpADT_t s) {
+	return &(s->originAddr);
+}
+
+struct connectOrigin *getConnectOriginState(httpADT_t s) {
+	return &((s->clientState).connectOrigin);
+}
+
 struct handleRequest *getHandleRequestState(httpADT_t s) {
 	return &((s->clientState).handleRequest);
 }
@@ -168,6 +236,40 @@ unsigned getRequestMethod(httpADT_t s) {
 	return s->requestMethod;
 }
 
+void setResponseStatus(httpADT_t s, int status) {
+	s->responseStatus = status;
+}
+
+int getResponseStatus(httpADT_t s) {
+	return s->responseStatus;
+}
+
+void addBytesToOrigin(httpADT_t s, uint64_t n) {
+	s->bytesToOrigin += n;
+	increaseTransferBytes(n);
+}
+
+uint64_t getBytesToOrigin(httpADT_t s) {
+	return s->bytesToOrigin;
+}
+
+void addBytesToClient(httpADT_t s, uint64_t n) {
+	s->bytesToClient += n;
+	increaseTransferBytes(n);
+}
+
+uint64_t getBytesToClient(httpADT_t s) {
+	return s->bytesToClient;
+}
+
+void setIsAccessLogged(httpADT_t s, uint8_t isAccessLogged) {
+	s->isAccessLogged = isAccessLogged;
+}
+
+uint8_t getIsAccessLogged(httpADT_t s) {
+	return s->isAccessLogged;
+}
+
 char *getOriginHost(struct http *s) {
 	return s->host;
 }
@@ -196,8 +298,60 @@ void setIsChunked(struct http *s, uint8_t isChunked) {
 	s->isChunked = isChunked;
 }
 
-MediaRangePtr_t getMediaRangeHTTP(struct http *s) {
-	return s->mediaRanges;
+uint8_t getOriginKeepAlive(struct http *s) {
+	return s->originKeepAlive;
+}
+
+void setOriginKeepAlive(struct http *s, uint8_t originKeepAlive) {
+	s->originKeepAlive = originKeepAlive;
+}
+
+uint8_t getOriginReusable(struct http *s) {
+	return s->originReusable;
+}
+
+void setOriginReusable(struct http *s, uint8_t originReusable) {
+	s->originReusable = originReusable;
+}
+
+uint8_t getClientKeepAlive(struct http *s) {
+	return s->clientKeepAlive;
+}
+
+void setClientKeepAlive(struct http *s, uint8_t clientKeepAlive) {
+	s->clientKeepAlive = clientKeepAlive;
+}
+
+uint8_t getClientReusable(struct http *s) {
+	return s->clientReusable;
+}
+
+void setClientReusable(struct http *s, uint8_t clientReusable) {
+	s->clientReusable = clientReusable;
+}
+
+unsigned getRequestCount(struct http *s) {
+	return s->requestCount;
+}
+
+struct requestBody *getRequestBody(struct http *s) {
+	return &(s->requestBody);
+}
+
+struct spliceRelay *getSpliceRelay(struct http *s) {
+	return &(s->spliceRelay);
+}
+
+struct arena *getArena(struct http *s) {
+	return &(s->arena);
+}
+
+uint8_t *getStateBuffer(struct http *s, unsigned index) {
+	return s->buffers->state[index];
+}
+
+MediaRangeMatcherPtr_t getMediaRangeMatcherHTTP(struct http *s) {
+	return s->mediaRangeMatcher;
 }
 
 int getErrorType(struct http *s) {
@@ -208,33 +362,44 @@ void incrementReferences(struct http *s) {
 	s->references = s->references + 1;
 }
 
-// Pool of struct http, to be reused.
-static const unsigned maxPool = MAX_POOL_SIZE;
-static unsigned poolSize	  = 0; // current size
-static struct http *pool	  = 0;
+// Pool of struct http, to be reused. One per worker thread.
+static __thread struct slabPool pool =
+	SLAB_POOL_MEASURED_INITIALIZER(struct http);
 
 static const struct state_definition clientStatbl[] = {
 	{
 		.state		   = PARSE,
-		.on_arrival	= parseInit,
-		.on_read_ready = parseRead,
-		.on_departure  = parseDestroy,
+		.on_arrival		= parseInit,
+		.on_read_ready  = parseRead,
+		.on_write_ready = parsePending,
+		.on_timeout		= parseTimeout,
+		.on_departure   = parseDestroy,
 	},
 	{
 		.state			= CONNECT_TO_ORIGIN,
 		.on_block_ready = addressResolvNameDone,
+		.on_timeout		= resolvingTimeout,
+	},
+	{
+		.state			= CONNECTING,
+		.on_write_ready = connectingWrite,
+		.on_timeout		= connectingTimeout,
+		.on_departure   = connectingDestroy,
 	},
 	{
 		.state			= HANDLE_REQUEST,
 		.on_arrival		= requestInit,
 		.on_read_ready  = requestRead,
 		.on_write_ready = requestWrite,
+		.on_timeout		= requestTimeout,
+		.on_departure   = requestDestroy,
 	},
 	{
 		.state			= HANDLE_RESPONSE,
 		.on_arrival		= responseInit,
 		.on_read_ready  = responseRead,
 		.on_write_ready = responseWrite,
+		.on_timeout		= responseTimeout,
 		.on_departure   = responseDestroy,
 	},
 	{
@@ -242,6 +407,7 @@ static const struct state_definition clientStatbl[] = {
 		.on_arrival		= transformBodyInit,
 		.on_read_ready  = transformBodyRead,
 		.on_write_ready = transformBodyWrite,
+		.on_timeout		= transformBodyTimeout,
 		.on_departure   = transformBodyDestroy,
 	},
 	{
@@ -262,16 +428,7 @@ static const struct state_definition *httpDescribeStates(void) {
 }
 
 struct http *httpNew(int clientFd) {
-	struct http *ret;
-
-	if (pool == NULL) {
-		ret = malloc(sizeof(*ret));
-	}
-	else {
-		ret		  = pool;
-		pool	  = pool->next;
-		ret->next = 0;
-	}
+	struct http *ret = slabPoolGet(&pool);
 
 	if (ret == NULL) {
 		goto finally;
@@ -286,9 +443,14 @@ struct http *httpNew(int clientFd) {
 	ret->clientAddrLen	= sizeof(ret->clientAddr);
 	ret->transformContent = FALSE;
 	ret->isChunked		  = FALSE;
-	ret->mediaRanges =
-		createMediaRangeFromListOfMediaType(getMediaRange(getConfiguration()));
-	ret->selectorCopyForOtherThread = NULL;
+	ret->originKeepAlive  = FALSE;
+	ret->originReusable	  = FALSE;
+	ret->clientKeepAlive  = FALSE;
+	ret->clientReusable	  = FALSE;
+	ret->requestCount	  = 0;
+	spliceRelayInit(&ret->spliceRelay);
+	ret->mediaRangeMatcher = getMediaRangeMatcher(getConfiguration());
+	ret->resolverJob	   = NULL;
 
 	// setting state machine
 	ret->stm.initial   = PARSE_METHOD;
@@ -297,14 +459,8 @@ struct http *httpNew(int clientFd) {
 	ret->stm.states = httpDescribeStates();
 	stm_init(&ret->stm);
 
-	buffer_init(&ret->readBuffer, SIZE_OF_ARRAY(ret->rawBuffA), ret->rawBuffA);
-	buffer_init(&ret->writeBuffer, SIZE_OF_ARRAY(ret->rawBuffB), ret->rawBuffB);
-	buffer_init(&ret->finishParserBuffer, SIZE_OF_ARRAY(ret->finishParserData),
-				ret->finishParserData);
-	buffer_init(&ret->requestLine, SIZE_OF_ARRAY(ret->raWRequest),
-				ret->raWRequest);
-	buffer_init(&ret->responseLine, SIZE_OF_ARRAY(ret->rawResponse),
-				ret->rawResponse);
+	// The buffers are borrowed when the client sends something
+	detachBuffers(ret);
 
 	ret->errorTypeFound = DEFAULT;
 
@@ -316,21 +472,127 @@ finally:
 	return ret;
 }
 
+int httpAcquireBuffers(struct http *s) {
+	struct connectionBuffers *buffers;
+
+	if (s->buffers != NULL) {
+		return TRUE;
+	}
+
+	if ((buffers = bufferPoolGet()) == NULL) {
+		return FALSE;
+	}
+
+	s->buffers = buffers;
+	buffer_init(&s->readBuffer, SIZE_OF_ARRAY(buffers->read), buffers->read);
+	buffer_init(&s->writeBuffer, SIZE_OF_ARRAY(buffers->write),
+				buffers->write);
+	buffer_init(&s->finishParserBuffer, SIZE_OF_ARRAY(buffers->finishParser),
+				buffers->finishParser);
+	buffer_init(&s->requestLine, SIZE_OF_ARRAY(buffers->requestLine),
+				buffers->requestLine);
+	buffer_init(&s->responseLine, SIZE_OF_ARRAY(buffers->responseLine),
+				buffers->responseLine);
+	arenaInit(&s->arena, buffers->arena, SIZE_OF_ARRAY(buffers->arena));
+	return TRUE;
+}
+
+void httpReleaseBuffers(struct http *s) {
+	if (s->buffers == NULL) {
+		return;
+	}
+
+	bufferPoolPut(s->buffers);
+	detachBuffers(s);
+}
+
+/* Leaves the buffers empty and without space, and the arena on malloc */
+static void detachBuffers(struct http *s) {
+	s->buffers = NULL;
+	buffer_init(&s->readBuffer, 0, NULL);
+	buffer_init(&s->writeBuffer, 0, NULL);
+	buffer_init(&s->finishParserBuffer, 0, NULL);
+	buffer_init(&s->requestLine, 0, NULL);
+	buffer_init(&s->responseLine, 0, NULL);
+	arenaReset(&s->arena);
+	arenaInit(&s->arena, NULL, 0);
+}
+
+int httpReset(struct http *s) {
+	size_t parsedCount, readCount;
+	uint8_t *parsed = buffer_read_ptr(&s->finishParserBuffer, &parsedCount);
+	uint8_t *read	= buffer_read_ptr(&s->readBuffer, &readCount);
+
+	if (s->buffers != NULL) {
+		if (parsedCount + readCount > SIZE_OF_ARRAY(s->buffers->read)) {
+			return FALSE;
+		}
+
+		/* Pipelined bytes, the ones in the finish parser buffer came first */
+		memmove(s->buffers->read + parsedCount, read, readCount);
+		memcpy(s->buffers->read, parsed, parsedCount);
+		buffer_init(&s->readBuffer, SIZE_OF_ARRAY(s->buffers->read),
+					s->buffers->read);
+		buffer_write_adv(&s->readBuffer, parsedCount + readCount);
+	}
+
+	buffer_reset(&s->writeBuffer);
+	buffer_reset(&s->finishParserBuffer);
+	buffer_reset(&s->requestLine);
+	buffer_reset(&s->responseLine);
+	memset(&s->clientState, 0x00, sizeof(s->clientState));
+	memset(&s->originAddr, 0x00, sizeof(s->originAddr));
+	memset(s->latencyStarts, 0x00, sizeof(s->latencyStarts));
+	memset(s->latencies, 0x00, sizeof(s->latencies));
+
+	s->originAddrLen	= 0;
+	s->host				= NULL;
+	s->originPort		= 80;
+	s->originFd			= -1;
+	s->requestMethod	= 0;
+	s->responseStatus	= 0;
+	s->bytesToOrigin	= 0;
+	s->bytesToClient	= 0;
+	s->isAccessLogged	= FALSE;
+	s->transformContent = FALSE;
+	s->isChunked		= FALSE;
+	s->originKeepAlive  = FALSE;
+	s->originReusable	= FALSE;
+	s->clientKeepAlive  = FALSE;
+	s->clientReusable	= FALSE;
+	s->resolverJob		= NULL;
+	s->errorTypeFound   = DEFAULT;
+	s->requestCount++;
+
+	/* Bytes left from an unfinished body must not reach the next one */
+	if (s->spliceRelay.buffered > 0) {
+		spliceRelayClose(&s->spliceRelay);
+	}
+
+	/* The media ranges could have been changed by management */
+	releaseMediaRangeMatcher(s->mediaRangeMatcher);
+	s->mediaRangeMatcher = getMediaRangeMatcher(getConfiguration());
+
+	stm_init(&s->stm);
+
+	/* Nothing was pipelined, the buffers wait for the next request */
+	if (parsedCount + readCount == 0) {
+		httpReleaseBuffers(s);
+	}
+
+	return TRUE;
+}
+
 void httpDestroyData(struct http *s) {
+	httpReleaseBuffers(s);
 	free(s);
 }
 
 void httpDestroy(struct http *s) {
 	if (s != NULL) {
 		if (s->references == 1) {
-			if (poolSize < maxPool) {
-				s->next = pool;
-				pool	= s;
-				poolSize++;
-			}
-			else {
-				httpDestroyData(s);
-			}
+			httpReleaseBuffers(s);
+			slabPoolPut(&pool, s);
 		}
 		else {
 			s->references -= 1;
@@ -338,11 +600,16 @@ void httpDestroy(struct http *s) {
 	}
 }
 
-void httpPoolDestroy(void) {
-	struct http *next, *s;
+int httpPoolFill(void) {
+	return slabPoolFill(&pool) == -1 || bufferPoolFill() == -1 ? -1 : 0;
+}
 
-	for (s = pool; s != NULL; s = next) {
-		next = s->next;
-		free(s);
-	}
+void httpPoolTrim(void) {
+	slabPoolTrim(&pool);
+	bufferPoolTrim();
+}
+
+void httpPoolDestroy(void) {
+	slabPoolDestroy(&pool);
+	bufferPoolDestroy();
 }
@@ -0,0 +1,70 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bytes of the connection buffers for the arena, enough for most requests */
+#define ARENA_SIZE 2048
+
+/* First capacity of a string, it doubles each time it fills */
+#define ARENA_STRING_BLOCK 16
+
+/*
+ * Bump allocator for what lives until the end of a request: the strings and
+ * scratch of the parsers. Nothing is freed on its own, everything is released
+ * at once by arenaReset. When the bytes it was given are used up blocks are
+ * taken from malloc, so that a long request still fits.
+ */
+struct arenaBlock {
+	struct arenaBlock *next;
+	size_t size;
+	uint8_t data[];
+};
+
+struct arena {
+	/* Block being allocated from, first or the last one taken from malloc */
+	uint8_t *data;
+	size_t size;
+	size_t used;
+	/* Last allocation, it can grow in place */
+	uint8_t *last;
+	/* Blocks taken from malloc, the newest first */
+	struct arenaBlock *blocks;
+	/* Bytes given by arenaInit, NULL if everything comes from malloc */
+	uint8_t *first;
+	size_t firstSize;
+};
+
+/*
+ * Initializes an empty arena that allocates from the size bytes of first
+ * before taking blocks from malloc. First may be NULL.
+ */
+void arenaInit(struct arena *arena, uint8_t *first, size_t size);
+
+/*
+ * Returns size bytes aligned as a pointer or NULL if malloc fails
+ */
+void *arenaAlloc(struct arena *arena, size_t size);
+
+/*
+ * Returns pointer, that has size bytes, grown to newSize. It is grown in place
+ * if it is the last allocation and there is space, otherwise it is copied.
+ * Returns NULL if malloc fails. A NULL pointer is allocated.
+ */
+void *arenaGrow(struct arena *arena, void *pointer, size_t size,
+				size_t newSize);
+
+/*
+ * Same as addCharToString but allocating from the arena. If it can not grow
+ * the string it returns NULL and sets its size to 0.
+ */
+char *arenaAddChar(struct arena *arena, char *string, unsigned int *sizeString,
+				   char c);
+
+/*
+ * Releases everything allocated and frees the blocks taken from malloc
+ */
+void arenaReset(struct arena *arena);
+
+#endif
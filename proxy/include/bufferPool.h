@@ -0,0 +1,51 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stdint.h>
+#include <arena.h>
+#include <httpProxyADT.h>
+
+/*
+ * The buffers of a connection. They are borrowed from the pool of the worker
+ * when a request starts and given back once it is served and nothing else
+ * was sent, so that an idle connection only keeps its struct http.
+ */
+struct connectionBuffers {
+	uint8_t arena[ARENA_SIZE];
+	uint8_t read[BUFFER_SIZE];
+	uint8_t write[BUFFER_SIZE];
+	uint8_t requestLine[MAX_FIRST_LINE_LENGTH];
+	uint8_t responseLine[MAX_FIRST_LINE_LENGTH];
+	uint8_t finishParser[MAX_PARSER];
+	/* Used by the current state in place of arrays of its struct */
+	uint8_t state[STATE_BUFFERS][STATE_BUFFER_SIZE];
+};
+
+/*
+ * Returns free buffers from the pool of the worker, or from malloc if it is
+ * empty. Returns NULL if malloc fails.
+ */
+struct connectionBuffers *bufferPoolGet(void);
+
+/*
+ * Gives the buffers back to the pool of the worker, or to free if it is full
+ */
+void bufferPoolPut(struct connectionBuffers *buffers);
+
+/*
+ * Fills the pool of the worker up to the low watermark, returns -1 if
+ * malloc fails
+ */
+int bufferPoolFill(void);
+
+/*
+ * Frees the buffers of the pool of the worker that were not used for a while
+ */
+void bufferPoolTrim(void);
+
+/*
+ * Frees the buffers in the pool of the worker
+ */
+void bufferPoolDestroy(void);
+
+#endif
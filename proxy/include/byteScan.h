@@ -0,0 +1,24 @@
+#ifndef BYTE_SCAN_H
+#define BYTE_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Most bytes a scan looks for at once */
+#define BYTE_SCAN_MAX_SET 4
+
+/*
+ * Returns the offset of the first byte of data that is one of the setLength
+ * bytes of set, or length if there is none. It compares 32 bytes at a time
+ * with AVX2 when the CPU has it, 16 with SSE2, and one at a time elsewhere,
+ * so that the parsers only run their state machine on the bytes they stop at.
+ */
+size_t byteScan(const uint8_t *data, size_t length, const uint8_t *set,
+				unsigned setLength);
+
+/*
+ * Returns the name of the implementation byteScan uses: avx2, sse2 or scalar
+ */
+const char *byteScanImplementation(void);
+
+#endif
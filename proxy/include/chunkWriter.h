@@ -0,0 +1,66 @@
+#ifndef CHUNK_WRITER_H
+#define CHUNK_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <buffer.h>
+
+/* Size in hexa of a size_t plus CRLF */
+#define CHUNK_HEADER_SIZE (2 * sizeof(size_t) + 2)
+
+/* CRLF after the data and "0\r\n\r\n" if it is the last chunk */
+#define CHUNK_TRAILER_SIZE 7
+
+/*
+ * Frames a body as chunks without copying it. The data of the chunk is left
+ * in the buffer it was read into and it is sent together with its size line
+ * and CRLF in a single sendmsg.
+ */
+struct chunkWriter {
+	/* Buffer with the data of the chunk, NULL if there is no chunk */
+	buffer *payload;
+	/* Bytes of the chunk not sent yet */
+	size_t payloadLength;
+	uint8_t header[CHUNK_HEADER_SIZE];
+	uint8_t headerLength;
+	uint8_t headerSent;
+	uint8_t trailer[CHUNK_TRAILER_SIZE];
+	uint8_t trailerLength;
+	uint8_t trailerSent;
+	uint8_t isFinished;
+};
+
+/*
+ * Initializes the writer without chunks
+ */
+void chunkWriterInit(struct chunkWriter *writer);
+
+/*
+ * Frames the bytes that can be read from payload as a chunk. The payload
+ * must not be written until the chunk is sent.
+ */
+void chunkWriterPrepare(struct chunkWriter *writer, buffer *payload);
+
+/*
+ * Adds the last chunk (0\r\n\r\n) after the one being sent, only once
+ */
+void chunkWriterFinish(struct chunkWriter *writer);
+
+/*
+ * Returns TRUE if there are bytes to send
+ */
+int chunkWriterHasData(struct chunkWriter *writer);
+
+/*
+ * Returns TRUE if the last chunk was added
+ */
+int chunkWriterIsFinished(struct chunkWriter *writer);
+
+/*
+ * Sends what can be sent of the chunk to fd and consumes the sent data from
+ * its buffer. Returns what send would.
+ */
+ssize_t chunkWriterSend(struct chunkWriter *writer, int fd);
+
+#endif
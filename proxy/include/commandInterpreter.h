@@ -2,9 +2,15 @@
 #define COMMAND_INTERPRETER_H
 
 #define NEEDS_ARGUMENT(option)                                                 \
-	(((option) == 'e') || ((option) == 'l') || ((option) == 'L') ||            \
-	 ((option) == 'm') || ((option) == 'o') || ((option) == 'p') ||            \
-	 ((option) == 't'))
+	(((option) == 'a') || ((option) == 'A') || ((option) == 'c') ||            \
+	 ((option) == 'd') || ((option) == 'e') || ((option) == 'F') ||            \
+	 ((option) == 'H') || ((option) == 'i') || ((option) == 'k') ||            \
+	 ((option) == 'K') || ((option) == 'l') || ((option) == 'L') ||            \
+	 ((option) == 'm') || ((option) == 'n') || ((option) == 'N') ||            \
+	 ((option) == 'o') || ((option) == 'p') || ((option) == 'P') ||            \
+	 ((option) == 'r') || ((option) == 'R') || ((option) == 's') ||            \
+	 ((option) == 't') || ((option) == 'T') || ((option) == 'S') ||            \
+	 ((option) == 'u') || ((option) == 'w'))
 
 int readOptions(const int argc, char *const *argv);
 void printHelpMessage();
@@ -6,6 +6,7 @@
 #include <fcntl.h>
 #include <utilities.h>
 #include <mediaRange.h>
+#include <selector.h>
 
 #define DEFAULT_PROXY_HTTP_PORT 8080
 #define DEFAULT_MANAGEMENT_PORT 9090
@@ -14,10 +15,28 @@
 #define DEFAULT_MANAGEMENT_IPV4_INTERFACE "127.0.0.1"
 #define DEFAULT_MANAGEMENT_IPV6_INTERFACE "::1"
 #define STDERR_REDIRECT_DEFAULT "/dev/null"
+#define DEFAULT_WORKERS 1
+#define MAX_WORKERS 64
+#define DEFAULT_CONNECT_TIMEOUT 10000
+#define DEFAULT_DNS_CACHE_TTL 60
+#define DEFAULT_UPSTREAM_MAX_IDLE 64
+#define DEFAULT_UPSTREAM_IDLE_TIMEOUT 4000
+#define DEFAULT_UPSTREAM_MAX_PER_ORIGIN 8
+#define DEFAULT_CLIENT_IDLE_TIMEOUT 5000
+#define DEFAULT_CLIENT_MAX_REQUESTS 100
+#define DEFAULT_HEADER_TIMEOUT 10000
+#define DEFAULT_RESPONSE_TIMEOUT 30000
+#define DEFAULT_TRANSFORM_TIMEOUT 30000
+#define DEFAULT_TRANSFORM_POOL_SIZE 2
+#define DEFAULT_POOL_LOW_WATERMARK 8
+#define DEFAULT_POOL_HIGH_WATERMARK 64
+#define DEFAULT_ACCESS_LOG_SAMPLE_RATE 1
+#define DEFAULT_ACCESS_LOG_SLOW_THRESHOLD 1000
 
 #define INVALID_FD -1
 
 typedef struct configuration *configurationADT;
+typedef struct transformCommand *TransformCommandPtr_t;
 
 /* Returns configuration ADT */
 configurationADT getConfiguration();
@@ -39,6 +58,10 @@ char *getCommandStderrPath(configurationADT config);
  * program */
 void setCommandStderrPath(configurationADT config, char *errorPath);
 
+/* Opens, once, the file where the executed program stderr is redirected
+ * and keeps its path. Returns -1 if it can not be opened. */
+int openCommandStderr(configurationADT config, char *errorPath);
+
 /* Returs http proxy server port */
 unsigned short getHttpPort(configurationADT config);
 
@@ -64,11 +87,23 @@ char *getManagementInterfaces(configurationADT config);
 void setManagementInterfaces(configurationADT config,
 							 char *managementInterfaces);
 
-/* Sets transform command */
+/* Sets transform command, it takes the command string */
 void setCommand(configurationADT config, char *command);
 
-/* Returns transform command */
-char *getCommand(configurationADT config);
+/*
+ * Returns a reference to the transform command, it must be released with
+ * releaseCommand
+ */
+TransformCommandPtr_t getCommand(configurationADT config);
+
+/* Returns the command line of the transform command, "" if none was set */
+const char *getCommandLine(TransformCommandPtr_t command);
+
+/* Takes another reference to the transform command */
+void retainCommand(TransformCommandPtr_t command);
+
+/* Releases a reference, the last one frees the transform command */
+void releaseCommand(TransformCommandPtr_t command);
 
 /* Returns TRUE if transformations are enabled or FALSE otherwise */
 uint8_t getIsTransformationOn(configurationADT config);
@@ -82,10 +117,151 @@ MediaRangePtr_t getMediaRange(configurationADT config);
 /* Resets media range list, leaving it empty */
 void resetMediaRangeList(configurationADT config);
 
+/* Adds media ranges to the list */
+void addToMediaRangeList(configurationADT config, char const *mediaRange);
+
+/*
+ * Returns a reference to the matcher compiled from the media range list, it
+ * must be released with releaseMediaRangeMatcher
+ */
+MediaRangeMatcherPtr_t getMediaRangeMatcher(configurationADT config);
+
 /* Sets cmd and enable/disable transformation depending cmd length */
 void setCommandAndTransformations(configurationADT config, char *command);
 
 /* Sets transformation state to the given state */
 void setTransformationState(configurationADT config, uint8_t state);
 
+/* Sets the I/O multiplexing implementation used by the selector */
+void setSelectorBackend(configurationADT config, selector_backend backend);
+
+/* Returns the I/O multiplexing implementation used by the selector */
+selector_backend getSelectorBackend(configurationADT config);
+
+/* Sets the quantity of reactor threads serving http connections */
+void setWorkers(configurationADT config, unsigned workers);
+
+/* Returns the quantity of reactor threads serving http connections */
+unsigned getWorkers(configurationADT config);
+
+/* Sets the time (ms) given to connect to an origin server */
+void setConnectTimeout(configurationADT config, unsigned connectTimeout);
+
+/* Returns the time (ms) given to connect to an origin server */
+unsigned getConnectTimeout(configurationADT config);
+
+/* Sets the time (s) an origin host resolution is cached, 0 disables it */
+void setDnsCacheTtl(configurationADT config, unsigned dnsCacheTtl);
+
+/* Returns the time (s) an origin host resolution is cached */
+unsigned getDnsCacheTtl(configurationADT config);
+
+/* Sets the maximum idle origin connections kept by each worker, 0 disables
+ * origin connection reuse */
+void setUpstreamMaxIdle(configurationADT config, unsigned upstreamMaxIdle);
+
+/* Returns the maximum idle origin connections kept by each worker */
+unsigned getUpstreamMaxIdle(configurationADT config);
+
+/* Sets the time (ms) an idle origin connection is kept */
+void setUpstreamIdleTimeout(configurationADT config,
+							unsigned upstreamIdleTimeout);
+
+/* Returns the time (ms) an idle origin connection is kept */
+unsigned getUpstreamIdleTimeout(configurationADT config);
+
+/* Sets the maximum idle connections kept to the same origin host and port */
+void setUpstreamMaxPerOrigin(configurationADT config,
+							 unsigned upstreamMaxPerOrigin);
+
+/* Returns the maximum idle connections kept to the same origin host and
+ * port */
+unsigned getUpstreamMaxPerOrigin(configurationADT config);
+
+/* Sets the time (ms) a client connection waits for its next request */
+void setClientIdleTimeout(configurationADT config, unsigned clientIdleTimeout);
+
+/* Returns the time (ms) a client connection waits for its next request */
+unsigned getClientIdleTimeout(configurationADT config);
+
+/* Sets the maximum requests served on a client connection, 0 or 1 disables
+ * client connection reuse */
+void setClientMaxRequests(configurationADT config, unsigned clientMaxRequests);
+
+/* Returns the maximum requests served on a client connection */
+unsigned getClientMaxRequests(configurationADT config);
+
+/* Sets the time (ms) a client has to send the whole request head once it
+ * started sending it, 0 disables it */
+void setHeaderTimeout(configurationADT config, unsigned headerTimeout);
+
+/* Returns the time (ms) a client has to send the whole request head */
+unsigned getHeaderTimeout(configurationADT config);
+
+/* Sets the time (ms) a response can go without data moving between the
+ * origin and the client, 0 disables it */
+void setResponseTimeout(configurationADT config, unsigned responseTimeout);
+
+/* Returns the time (ms) a response can go without data moving */
+unsigned getResponseTimeout(configurationADT config);
+
+/* Sets the time (ms) a transformed response can go without progress, 0
+ * disables it */
+void setTransformTimeout(configurationADT config, unsigned transformTimeout);
+
+/* Returns the time (ms) a transformed response can go without progress */
+unsigned getTransformTimeout(configurationADT config);
+
+/* Sets the maximum transformer processes kept running by each worker, 0
+ * disables them and the command runs once per response */
+void setTransformPoolSize(configurationADT config, unsigned transformPoolSize);
+
+/* Returns the maximum transformer processes kept running by each worker */
+unsigned getTransformPoolSize(configurationADT config);
+
+/* Sets the free connection objects each worker allocates at start and keeps
+ * after freeing the ones it does not use, it must not exceed the high one */
+void setPoolLowWatermark(configurationADT config, unsigned poolLowWatermark);
+
+/* Returns the free connection objects each worker keeps at least */
+unsigned getPoolLowWatermark(configurationADT config);
+
+/* Sets the maximum free connection objects each worker keeps, the ones it
+ * gets back beyond are freed */
+void setPoolHighWatermark(configurationADT config,
+						  unsigned poolHighWatermark);
+
+/* Returns the maximum free connection objects each worker keeps */
+unsigned getPoolHighWatermark(configurationADT config);
+
+/* Sets whether a worker waits for the logger thread when the access log
+ * queue is full, instead of dropping the entry */
+void setIsAccessLogBlocking(configurationADT config,
+							uint8_t isAccessLogBlocking);
+
+/* Returns whether a worker waits when the access log queue is full */
+uint8_t getIsAccessLogBlocking(configurationADT config);
+
+/* Sets whether the access log is written as records of access.bin, one per
+ * served request, instead of the lines of access.log */
+void setIsAccessLogBinary(configurationADT config, uint8_t isAccessLogBinary);
+
+/* Returns whether the access log is binary */
+uint8_t getIsAccessLogBinary(configurationADT config);
+
+/* Sets the access log to keep 1 of each accessLogSampleRate requests, the
+ * failed and the slow ones are always kept */
+void setAccessLogSampleRate(configurationADT config,
+							unsigned accessLogSampleRate);
+
+/* Returns the requests of which the access log keeps 1 */
+unsigned getAccessLogSampleRate(configurationADT config);
+
+/* Sets the time (ms) from which a request is slow and always logged */
+void setAccessLogSlowThreshold(configurationADT config,
+							   unsigned accessLogSlowThreshold);
+
+/* Returns the time (ms) from which a request is always logged */
+unsigned getAccessLogSlowThreshold(configurationADT config);
+
 #endif
@@ -10,24 +10,66 @@
 #include <arpa/inet.h>
 #include <metric.h>
 
+/* Maximum quantity of resolved addresses that are tried */
+#define MAX_CONNECT_CANDIDATES 16
+
+/* Delay before racing the next address if the previous one has not
+ * connected yet (RFC 8305 "Connection Attempt Delay") */
+#define CONNECT_ATTEMPT_DELAY 250
+
+struct connectAttempt {
+	int fd;
+	struct addrinfo *address;
+};
+
+struct connectOrigin {
+	/* Resolved addresses, interleaving address families */
+	struct addrinfo *candidates[MAX_CONNECT_CANDIDATES];
+	unsigned candidateQty;
+	unsigned nextCandidate;
+
+	/* Attempts in progress, fd is -1 if the slot is free */
+	struct connectAttempt attempts[MAX_CONNECT_CANDIDATES];
+	unsigned attemptsInProgress;
+
+	/* Monotonic time (ms) when the whole connection gives up */
+	uint64_t deadline;
+};
+
 /*
- * Connects to origin server
+ * Starts a non blocking connection attempt to ipEntry
  */
 int connectToOrigin(struct selector_key *key, struct addrinfo *ipEntry);
 
 /*
- * Create a thred that resolves the DNS query
+ * Queues the DNS query in the resolver pool, or starts connecting right
+ * away if the host is cached
  */
 int blockingToResolvName(struct selector_key *key, int fdClient);
 
 /*
- * Resolves the dns query
+ * Orders the resolved addresses and starts the first connection attempt
  */
-void *addressResolvName(void **data);
+unsigned addressResolvNameDone(struct selector_key *key);
 
 /*
- * Iterates from the list of resolves and trys to connect to each
+ * The connect timeout expired while the host was being resolved
  */
-unsigned addressResolvNameDone(struct selector_key *key);
+unsigned resolvingTimeout(struct selector_key *key);
+
+/*
+ * An attempt finished connecting, checks whether it succeeded
+ */
+unsigned connectingWrite(struct selector_key *key);
+
+/*
+ * Starts the next attempt or gives up when the connect timeout expires
+ */
+unsigned connectingTimeout(struct selector_key *key);
+
+/*
+ * Closes every attempt that did not win and disarms the timer
+ */
+void connectingDestroy(const unsigned state, struct selector_key *key);
 
 #endif
@@ -10,7 +10,8 @@ enum errorType {
 	METHOD_NOT_ALLOW,
 	VERSION_NOT_SUPPORTED,
 	NOT_FOUND_HOST,
-	FAIL_TO_CONNECT
+	FAIL_TO_CONNECT,
+	REQUEST_TIMEOUT
 };
 
 /*
@@ -12,6 +12,17 @@
  */
 unsigned parseRead(struct selector_key *key);
 
+/*
+ * Parses what a pipelining client sent after its previous request, which is
+ * already in the read buffer
+ */
+unsigned parsePending(struct selector_key *key);
+
+/*
+ * Closes a client connection that did not send its next request in time
+ */
+unsigned parseTimeout(struct selector_key *key);
+
 /*
  * Initialize all the parsers
  */
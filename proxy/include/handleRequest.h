@@ -3,19 +3,40 @@
 
 #include <selector.h>
 #include <headersParser.h>
+#include <messageFraming.h>
 
 struct handleRequest {
 	struct headersParser parseHeaders;
-	unsigned requestState;
+	/* Some body bytes were sent to origin */
+	uint8_t bodySent;
+	/* The header timeout was armed on the client fd */
+	uint8_t isTimerArmed;
 };
 
-enum requestState { FIRST_BUFFER = 0, LAST_BUFFER };
+/*
+ * Where the request body ends, what follows it is the next request of the
+ * client. It outlives HANDLE_REQUEST so it is kept in struct http.
+ */
+struct requestBody {
+	struct messageFraming framing;
+	uint8_t isFramingKnown;
+	/* Bytes at the head of the buffer being sent that belong to the body */
+	size_t pending;
+	/* The rest of the body goes through the splice relay */
+	uint8_t isSpliced;
+};
 
 /*
  * Initialize headers parser struct
  */
 void requestInit(const unsigned state, struct selector_key *key);
 
+/*
+ * Decides whether the origin and client connections may be reused after the
+ * response
+ */
+void requestDestroy(const unsigned state, struct selector_key *key);
+
 /*
  * Reads request from client fd into readBuffer
  */
@@ -26,11 +47,22 @@ unsigned requestRead(struct selector_key *key);
  */
 unsigned requestWrite(struct selector_key *key);
 
+/*
+ * The header timeout expired before the request headers were read or the
+ * response timeout expired while sending the body
+ */
+unsigned requestTimeout(struct selector_key *key);
+
 /*
  * Set corresponding interests to client fd and origin fd
  */
 unsigned setAdecuateFdInterests(struct selector_key *key);
 
+/*
+ * Returns TRUE if the whole request, body included, has been sent to origin
+ */
+int isRequestSent(httpADT_t state);
+
 /*
  * Returns response state based on transformations, if transformations
  * are enabled returns HANDLE_RESPONSE_WITH_TRANSFORMATION otherwise
@@ -3,12 +3,18 @@
 
 #include <selector.h>
 #include <headersParser.h>
+#include <messageFraming.h>
 
 struct handleResponse {
 	struct headersParser parseHeaders;
+	/* Uses the second state buffer of the connection */
 	buffer requestDataBuffer;
-	uint8_t requestData[BUFFER_SIZE];
 	uint8_t responseFinished;
+	/* Where the body ends, if it is not known origin closes the connection */
+	struct messageFraming framing;
+	uint8_t isFramingKnown;
+	/* The rest of the body goes through the splice relay */
+	uint8_t isSpliced;
 };
 
 /*
@@ -46,4 +52,14 @@ unsigned writeToOrigin(struct selector_key *key);
  */
 unsigned setResponseFdInterests(struct selector_key *key);
 
+/*
+ * Restarts the response timeout on the client fd, data is moving
+ */
+void armResponseTimer(struct selector_key *key);
+
+/*
+ * The response timeout expired without data moving
+ */
+unsigned responseTimeout(struct selector_key *key);
+
 #endif
@@ -17,12 +17,17 @@
 #define CONNECTION_CLOSE_LENGTH 20
 #define EXTRA_SPACE TRANSFER_ENCODING_LENGTH + CONNECTION_CLOSE_LENGTH
 #define MAX_TOTAL_HEADER_LENGTH MAX_HEADER_LENGTH + 1024
+#define CONNECTION_VALUE_LENGTH 32
+#define MAX_CONTENT_LENGTH 1000000000000000LL
+#define VALUE_BUFFER_SIZE                                                      \
+	(BUFFER_SIZE + EXTRA_SPACE + MAX_HOP_BY_HOP_HEADER_LENGTH)
 
 struct headersParser {
 	char currHeader[MAX_HEADER_LENGTH];
 	uint8_t headerBuf[MAX_HEADER_LENGTH];
 	uint8_t mimeValue[MAX_MIME_HEADER];
-	uint8_t valueBuf[BUFFER_SIZE + EXTRA_SPACE + MAX_HOP_BY_HOP_HEADER_LENGTH];
+	/* A state buffer of the connection, it fits VALUE_BUFFER_SIZE */
+	uint8_t *valueBuf;
 	uint8_t transferValue[CHUNKED_LENGTH + 1];
 	uint8_t contentValue[IDENTITY_LENGTH + 1];
 
@@ -44,12 +49,32 @@ struct headersParser {
 	int contentIndex;
 	int firstLine;
 
-	MediaRangePtr_t mediaRange;
+	MediaRangeMatcherPtr_t mediaRangeMatcher;
+	/* Characters of the content type matched, -1 after its end */
 	int mediaRangeCurrent;
+	int mediaRangeState;
 	int transformContent;
 	buffer *requestLineBuffer;
 	buffer *responseLineBuffer;
 	uint8_t isRequest;
+
+	/* Message framing, -1 if there is no content-length header */
+	long long contentLength;
+	uint8_t isContentLength;
+	uint8_t hasTransferEncoding;
+	uint8_t framingError;
+	uint8_t isConnection;
+	uint8_t connectionClose;
+	char connectionValue[CONNECTION_VALUE_LENGTH + 1];
+	int connectionIndex;
+	/* Status line of responses */
+	int firstLineIndex;
+	uint8_t isHttp11;
+	int statusCode;
+	/* Whether connection: keep-alive was sent instead of connection: close */
+	uint8_t keepAlive;
+	/* Responses: whether the client asked to keep its connection open */
+	uint8_t clientKeepAlive;
 };
 
 enum headersState {
@@ -90,7 +115,10 @@ void headersParserInit(struct headersParser *header, struct selector_key *key,
 					   uint8_t isRequest);
 
 /*
- * Adds header connection: close to either request or response
+ * Adds header connection: close to either request or response. Requests
+ * without body ask for connection: keep-alive when origin connections are
+ * pooled, responses keep the client connection open if the client asked so
+ * and the response says how long it is.
  */
 void addLastHeaders(struct headersParser *header);
 
@@ -121,6 +149,17 @@ void compareWithChunked(struct headersParser *header);
  */
 void compareWithIdentity(struct headersParser *header);
 
+/*
+ * Returns TRUE if the message says how long its body is: no body, a valid
+ * content-length or a chunked transfer-encoding
+ */
+uint8_t hasKnownLength(struct headersParser *header);
+
+/*
+ * Returns TRUE if the message declares a body
+ */
+uint8_t hasBody(struct headersParser *header);
+
 /*
  * Returns true if will transform given encode and false if wont transform
  */
@@ -0,0 +1,36 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+/* Values below 2^HISTOGRAM_SUB_BITS have a bucket each */
+#define HISTOGRAM_SUB_BITS 6
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS                                                      \
+	(HISTOGRAM_SUB_BUCKETS +                                                   \
+	 (64 - HISTOGRAM_SUB_BITS) * (HISTOGRAM_SUB_BUCKETS / 2))
+
+/*
+ * Counts of values in log-linear buckets, as HDR histograms keep them: each
+ * power of two is split in HISTOGRAM_SUB_BUCKETS / 2 buckets of the same
+ * width, so a bucket is never wider than about 3% of the values it holds.
+ * Every worker records in the same histograms, the counts are relaxed atomics
+ * since they are only read to be reported.
+ */
+struct histogram {
+	uint64_t total;
+	uint64_t counts[HISTOGRAM_BUCKETS];
+};
+
+/*
+ * Adds value to the histogram
+ */
+void histogramRecord(struct histogram *histogram, uint64_t value);
+
+/*
+ * Returns the value below which perMille thousandths of the recorded values
+ * are, rounded up to the end of its bucket. Returns 0 if nothing was recorded.
+ */
+uint64_t histogramPercentile(struct histogram *histogram, unsigned perMille);
+
+#endif
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <buffer.h>
 #include <utilities.h>
+#include <arena.h>
 
 enum headerState {
 	START_H,
@@ -31,15 +32,17 @@ struct headerParser {
 	unsigned int sizeHost;
 	int port;
 	int hasFoundHost;
+	/* Where the host is allocated */
+	struct arena *arena;
 };
 
 #define BLOCK 10
 #define PORT_DEFAULT 80
 
 /*
- * Initialize parser
+ * Initialize parser, the host is allocated from arena
  */
-void parseHeaderInit(struct headerParser *parser);
+void parseHeaderInit(struct headerParser *parser, struct arena *arena);
 
 /*
  * Parse a char
@@ -47,6 +50,14 @@ void parseHeaderInit(struct headerParser *parser);
  */
 int parseHeaderChar(struct headerParser *parser, char l);
 
+/*
+ * Parses at once the bytes at the start of data that would not change the
+ * state, the rest of a header that is not host. A NUL byte stops it too.
+ * Returns how many were parsed.
+ */
+size_t parseHeaderSpan(struct headerParser *parser, const uint8_t *data,
+					   size_t length);
+
 /*
  * Returns the current state of the header parser
  */
@@ -17,12 +17,17 @@
 #include <mediaRange.h>
 #include <configuration.h>
 #include <metric.h>
+#include <resolver.h>
+#include <spliceRelay.h>
+#include <arena.h>
 
 #define SIZE_OF_ARRAY(x) (sizeof(x) / sizeof((x)[0]))
-#define MAX_POOL_SIZE 50
 #define BUFFER_SIZE 4000
 #define MAX_PARSER 1000
 #define MAX_FIRST_LINE_LENGTH 2048
+/* Buffers a state can use, each fits the value buffer of the headers parser */
+#define STATE_BUFFERS 2
+#define STATE_BUFFER_SIZE (BUFFER_SIZE + 128)
 
 typedef struct http *httpADT_t;
 
@@ -37,11 +42,20 @@ enum httpState {
 	 *
 	 *      - OP_READ       Until client sends end of line and has found host.
 	 *
+	 *      - OP_WRITE      If a pipelining client already sent the request,
+	 *                      it is parsed from the read buffer.
+	 *
+	 *      Timer armed with the idle timeout until the first bytes of the
+	 *      request arrive, then with the header timeout.
+	 *
 	 * Transitions:
 	 *
 	 *   - CONNECT_TO_ORIGIN    If is a valid method and host.
 	 *
-	 *   - ERROR_CLIENT         If any error to be send to the client
+	 *   - ERROR_CLIENT         If any error to be send to the client or the
+	 *                          header timeout expires.
+	 *
+	 *   - DONE                 If the client was idle for too long.
 	 *
 	 *   - ERROR                Any other error.
 	 *
@@ -49,20 +63,54 @@ enum httpState {
 	PARSE,
 
 	/*
-	 * Resolves address and connects to origin
+	 * Resolves address and starts connecting to origin
+	 *
+	 * Interests:
+	 *
+	 *  ClientFd:
+	 *      - OP_NOOP           Timer armed with the connect timeout, that
+	 *                          also covers the resolution.
 	 *
 	 * Transitions:
 	 *
-	 *  - HANDLE_REQUEST        If it can connecto correctly to origin
-	 *                          server.
+	 *  - CONNECTING            If a connection attempt to origin has been
+	 *                          started.
 	 *
-	 *  - ERROR_CLIENT          If there is any problem in address resolution
-	 *                          or in connecting to origin.
+	 *  - ERROR_CLIENT          If there is any problem in address resolution,
+	 *                          no connection attempt could be started or the
+	 *                          connect timeout expires.
 	 *
 	 *  - ERROR                 If any other error occurs.
 	 */
 	CONNECT_TO_ORIGIN,
 
+	/*
+	 * Waits for the non blocking connections to origin. Resolved addresses
+	 * are raced Happy Eyeballs style (RFC 8305): a new attempt is started
+	 * every CONNECT_ATTEMPT_DELAY ms, or as soon as one fails, alternating
+	 * address families. The first one to connect wins.
+	 *
+	 * Interests:
+	 *
+	 *  ClientFd:
+	 *      - OP_NOOP           Timer armed for the next attempt or the
+	 *                          connect timeout.
+	 *
+	 *  AttemptFds:
+	 *      - OP_WRITE          Until connect finishes, then SO_ERROR is
+	 *                          checked.
+	 *
+	 * Transitions:
+	 *
+	 *  - HANDLE_REQUEST        When an attempt connects.
+	 *
+	 *  - ERROR_CLIENT          If every attempt fails or the connect timeout
+	 *                          expires.
+	 *
+	 *  - ERROR                 If any other error occurs.
+	 */
+	CONNECTING,
+
 	/**
 	 * Parse requests headers, filters some of them and modify its value and
 	 * send them to origin.
@@ -80,11 +128,17 @@ enum httpState {
 	 *
 	 *      - OP_WRITE          If there is something to send to origin.
 	 *
+	 *  ClientFd has the header timeout armed until the request headers are
+	 *  read, then the response timeout restarted on every event.
+	 *
 	 * Transitions:
 	 *
 	 *   - HANDLE_RESPONSE      If something has been read from server.
 	 *
-	 *   - ERROR                If an error occurs.
+	 *   - ERROR_CLIENT         If the header timeout expires.
+	 *
+	 *   - ERROR                If an error occurs or the response timeout
+	 *                          expires.
 	 */
 	HANDLE_REQUEST,
 
@@ -110,6 +164,8 @@ enum httpState {
 	 *
 	 *      - OP_WRITE          If there is something to write to client.
 	 *
+	 *  The response timeout is armed on ClientFd and restarted on every event.
+	 *
 	 * Transitions:
 	 *
 	 *   - TRANSFORM_BODY       If transformations are enabled and all response
@@ -119,7 +175,8 @@ enum httpState {
 	 *                          origin to client and transformations are
 	 *                          disabled.
 	 *
-	 *   - ERROR                If an error occurs.
+	 *   - ERROR                If an error occurs or the response timeout
+	 *                          expires.
 	 */
 	HANDLE_RESPONSE,
 
@@ -152,12 +209,14 @@ enum httpState {
 	 *      - OP_READ           If it has space to read transform command
 	 * response.
 	 *
+	 *  The transform timeout is armed on ClientFd and restarted on every event.
 	 *
 	 * Transitions:
 	 *
 	 *   - DONE                 When it finishes sendind response to client.
 	 *
-	 *   - ERROR                If an error occurs.
+	 *   - ERROR                If an error occurs or the transform timeout
+	 *                          expires.
 	 */
 	TRANSFORM_BODY,
 
@@ -179,7 +238,7 @@ enum httpState {
 	 */
 	ERROR_CLIENT,
 
-	// final states
+	// final states, a kept client connection goes from DONE back to PARSE
 	DONE,
 	ERROR,
 };
@@ -191,6 +250,8 @@ struct parseRequest {
 	buffer *input;
 	buffer *finishParserBuffer;
 	enum parserState state;
+	/* TRUE once the first bytes of the request arrived */
+	int isRequestStarted;
 	struct methodParser methodParser;
 	struct targetParser targetParser;
 	struct versionParser versionParser;
@@ -202,6 +263,54 @@ struct parseRequest {
  */
 httpADT_t httpNew(int clientFd);
 
+/*
+ * Prepares a struct http for the next request of its client: keeps the
+ * client fd and the bytes it already sent. The origin fd, host and name
+ * resolution must have been released. Returns FALSE if the pipelined bytes
+ * do not fit in the read buffer.
+ */
+int httpReset(httpADT_t s);
+
+/*
+ * Starts measuring latency for the current request, from now
+ */
+void startLatency(httpADT_t s, enum latency latency);
+
+/*
+ * Records the time since latency was started in its histogram and in the
+ * request. Returns FALSE if it was not started or was already recorded.
+ */
+int stopLatency(httpADT_t s, enum latency latency);
+
+/*
+ * Returns the microseconds latency took for the current request, 0 if it
+ * was not recorded
+ */
+uint64_t getLatency(httpADT_t s, enum latency latency);
+
+/*
+ * Returns the microseconds since latency was started, 0 if it is not running
+ */
+uint64_t getLatencyElapsed(httpADT_t s, enum latency latency);
+
+/*
+ * Borrows the buffers of the connection from the pool if it does not have
+ * them. Returns FALSE if they can not be allocated.
+ */
+int httpAcquireBuffers(httpADT_t s);
+
+/*
+ * Gives the buffers of the connection back to the pool, what they and the
+ * arena hold is lost
+ */
+void httpReleaseBuffers(httpADT_t s);
+
+/*
+ * Returns one of the STATE_BUFFERS buffers of STATE_BUFFER_SIZE bytes that
+ * the current state uses in place of arrays of its struct
+ */
+uint8_t *getStateBuffer(httpADT_t s, unsigned index);
+
 /*
  * Efectively destroys a struct http
  */
@@ -213,7 +322,19 @@ void httpDestroyData(httpADT_t s);
 void httpDestroy(httpADT_t s);
 
 /*
- * Cleans the pool
+ * Fills the pools of struct http and of buffers of the calling worker up to
+ * the low watermark. Returns -1 if memory runs out.
+ */
+int httpPoolFill(void);
+
+/*
+ * Frees what the pools of the calling worker did not use for a while, called
+ * on each iteration of its selector
+ */
+void httpPoolTrim(void);
+
+/*
+ * Cleans the pools of the calling worker
  */
 void httpPoolDestroy(void);
 
@@ -287,6 +408,11 @@ buffer *getFinishParserBuffer(httpADT_t s);
  */
 struct parseRequest *getParseRequestState(httpADT_t s);
 
+/*
+ * Returns http connect origin structure
+ */
+struct connectOrigin *getConnectOriginState(httpADT_t s);
+
 /*
  * Returns http handle request structure
  */
@@ -313,6 +439,48 @@ void setRequestMethod(httpADT_t s, unsigned method);
  */
 unsigned getRequestMethod(httpADT_t s);
 
+/*
+ * Sets the status of the response sent to the client
+ */
+void setResponseStatus(httpADT_t s, int status);
+
+/*
+ * Returns the status of the response sent to the client, 0 if none was
+ */
+int getResponseStatus(httpADT_t s);
+
+/*
+ * Counts n bytes of the request sent to the origin, for the request and for
+ * the transfered bytes metric
+ */
+void addBytesToOrigin(httpADT_t s, uint64_t n);
+
+/*
+ * Returns the bytes of the request sent to the origin
+ */
+uint64_t getBytesToOrigin(httpADT_t s);
+
+/*
+ * Counts n bytes of the response sent to the client, for the request and for
+ * the transfered bytes metric
+ */
+void addBytesToClient(httpADT_t s, uint64_t n);
+
+/*
+ * Returns the bytes of the response sent to the client
+ */
+uint64_t getBytesToClient(httpADT_t s);
+
+/*
+ * Sets whether the request entry of the access log was queued
+ */
+void setIsAccessLogged(httpADT_t s, uint8_t isAccessLogged);
+
+/*
+ * Returns whether the request entry of the access log was queued
+ */
+uint8_t getIsAccessLogged(httpADT_t s);
+
 /*
  * Returns origin server port
  */
@@ -329,7 +497,7 @@ void setOriginPort(struct http *s, unsigned short originPort);
 char *getOriginHost(struct http *s);
 
 /*
- * Sets origin server host
+ * Sets origin server host, a string of the arena that lives until httpDone
  */
 void setOriginHost(struct http *s, char *requestHost);
 
@@ -369,14 +537,70 @@ uint8_t getIsChunked(struct http *s);
 void setIsChunked(struct http *s, uint8_t isChunked);
 
 /*
- *	Returns the set of resolutions of the origin found in the DNS query or null
+ * Returns TRUE if origin was asked to keep the connection open
  */
-struct addrinfo *getOriginResolutions(struct http *s);
+uint8_t getOriginKeepAlive(struct http *s);
+
+/*
+ * Sets whether origin was asked to keep the connection open
+ */
+void setOriginKeepAlive(struct http *s, uint8_t originKeepAlive);
+
+/*
+ * Returns TRUE if the origin connection can be reused by other requests
+ */
+uint8_t getOriginReusable(struct http *s);
 
 /*
- *	Sets the oring host resolutions
+ * Sets whether the origin connection can be reused by other requests
  */
-void setOriginResolutions(struct http *s, struct addrinfo *originResolution);
+void setOriginReusable(struct http *s, uint8_t originReusable);
+
+/*
+ * Returns TRUE if the client may send another request after this response
+ */
+uint8_t getClientKeepAlive(struct http *s);
+
+/*
+ * Sets whether the client may send another request after this response
+ */
+void setClientKeepAlive(struct http *s, uint8_t clientKeepAlive);
+
+/*
+ * Returns TRUE if the client connection waits for another request once
+ * done
+ */
+uint8_t getClientReusable(struct http *s);
+
+/*
+ * Sets whether the client connection waits for another request once done
+ */
+void setClientReusable(struct http *s, uint8_t clientReusable);
+
+/*
+ * Returns the quantity of requests already served on the client connection
+ */
+unsigned getRequestCount(struct http *s);
+
+/*
+ * Returns where the request body ends
+ */
+struct requestBody *getRequestBody(httpADT_t s);
+
+/*
+ * Returns the pipe used to relay bodies with splice
+ */
+struct spliceRelay *getSpliceRelay(httpADT_t s);
+
+/*
+ * Returns the arena of the strings of the request, it is reset in httpDone
+ */
+struct arena *getArena(httpADT_t s);
+
+/*
+ *	Returns the set of resolutions of the origin found in the DNS query or null
+ */
+struct addrinfo *getOriginResolutions(struct http *s);
 
 /*
  * Returns 1 if there must be transformation or 0 otherwise
@@ -389,19 +613,19 @@ int getTransformContent(struct http *s);
 void setTransformContent(struct http *s, int transformContent);
 
 /*
- * Return the media range that is compare with the content length in
+ * Return the media range matcher that is compare with the content type in
  * order to determine if there is transformations
  */
-MediaRangePtr_t getMediaRangeHTTP(struct http *s);
+MediaRangeMatcherPtr_t getMediaRangeMatcherHTTP(struct http *s);
 
 /*
- * Set selector copy that is given to the child process in order to free it
+ * Sets the name resolution of the origin host, it is released in httpDone
  */
-void setSelectorCopy(struct http *s, void **selectorCopyForOtherThread);
+void setResolverJob(struct http *s, resolverJobADT resolverJob);
 
 /*
- * Get selector copy
+ * Returns the name resolution of the origin host or NULL
  */
-void **getSelectorCopy(struct http *s);
+resolverJobADT getResolverJob(struct http *s);
 
 #endif
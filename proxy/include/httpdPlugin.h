@@ -0,0 +1,61 @@
+#ifndef HTTPD_PLUGIN_H
+#define HTTPD_PLUGIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Interface of the transformation plugins: shared objects loaded with dlopen
+ * that filter a body inside the proxy, without pipes or processes. A plugin
+ * is selected with the command "plugin:<shared object path> [arguments]" and
+ * exports a struct httpdPlugin named as HTTPD_PLUGIN_SYMBOL.
+ *
+ * The callbacks of a body run in the worker thread serving it, several
+ * workers may run the same plugin at once so the state of a body must be
+ * kept in what init returns.
+ */
+
+#define HTTPD_PLUGIN_API_VERSION 1
+
+#define HTTPD_PLUGIN_SYMBOL "httpdPlugin"
+
+enum httpdPluginStatus {
+	HTTPD_PLUGIN_OK	= 0,
+	HTTPD_PLUGIN_MORE  = 1,
+	HTTPD_PLUGIN_ERROR = -1,
+};
+
+struct httpdPlugin {
+	/* HTTPD_PLUGIN_API_VERSION the plugin was built with */
+	unsigned apiVersion;
+
+	/*
+	 * Starts a body, arguments is what follows the path in the command.
+	 * Returns the state of the body or NULL on error.
+	 */
+	void *(*init)(const char *arguments);
+
+	/*
+	 * Transforms the start of in into out. Sets consumed to the bytes of in
+	 * used and produced to the bytes written to out, one of them at least
+	 * must be greater than 0. Returns HTTPD_PLUGIN_OK or HTTPD_PLUGIN_ERROR.
+	 */
+	int (*process)(void *state, const uint8_t *in, size_t inLength,
+				   size_t *consumed, uint8_t *out, size_t outLength,
+				   size_t *produced);
+
+	/*
+	 * The body ended: writes what is left to out and sets produced. Returns
+	 * HTTPD_PLUGIN_MORE if out was not big enough, it is called again once
+	 * out is sent, HTTPD_PLUGIN_OK when done or HTTPD_PLUGIN_ERROR.
+	 */
+	int (*finish)(void *state, uint8_t *out, size_t outLength,
+				  size_t *produced);
+
+	/*
+	 * Releases the state, after finish or if the body is abandoned
+	 */
+	void (*destroy)(void *state);
+};
+
+#endif
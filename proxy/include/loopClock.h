@@ -0,0 +1,35 @@
+#ifndef LOOP_CLOCK_H
+#define LOOP_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Monotonic and wall clocks read once per iteration of the selector loop of
+ * each thread, for the reads that do not need to be more precise than what an
+ * iteration takes: time tags, timers, pool trims and log entries. Reading
+ * them costs a load instead of a clock call per send. The wall clock is the
+ * monotonic one plus an offset read again every second, so a change of the
+ * system time shows up within a second. A thread that never updated its
+ * clock, as the resolver and logger threads, reads the clocks on every call.
+ */
+
+/*
+ * Reads the clocks into the cache of the calling thread, the selector does it
+ * each time it wakes up
+ */
+void loopClockUpdate(void);
+
+/* Returns the monotonic time in microseconds */
+uint64_t loopClockMonotonicMicros(void);
+
+/* Returns the monotonic time in milliseconds */
+uint64_t loopClockMonotonicMillis(void);
+
+/* Returns the microseconds since the epoch */
+uint64_t loopClockWallMicros(void);
+
+/* Returns the seconds since the epoch, as time(NULL) */
+time_t loopClockWallSeconds(void);
+
+#endif
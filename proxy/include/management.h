@@ -11,7 +11,7 @@
 #include <configuration.h>
 #include <mediaRange.h>
 
-#define ID_QUANTITY 9
+#define ID_QUANTITY 29
 #define ON 1
 #define OFF 0
 
@@ -25,7 +25,29 @@ enum resourceId_t {
 	MTR_CN_ID,
 	MTR_HS_ID,
 	MTR_BT_ID,
-	TF_ID
+	TF_ID,
+	MTR_DQ_ID,
+	MTR_DL_ID,
+	MTR_DH_ID,
+	MTR_DM_ID,
+	MTR_UH_ID,
+	MTR_UM_ID,
+	MTR_TO_ID,
+	MTR_PS_ID,
+	MTR_PH_ID,
+	MTR_PM_ID,
+	POOL_ID,
+	LAT_PR_ID,
+	LAT_DN_ID,
+	LAT_CN_ID,
+	LAT_FB_ID,
+	LAT_TR_ID,
+	LAT_RQ_ID,
+	MTR_LD_ID,
+	SMP_ID,
+	MTR_RM_ID,
+	MTR_SC_ID,
+	MTR_TU_ID
 };
 typedef enum resourceId_t resId_t;
 
@@ -4,15 +4,20 @@
 #include <stdlib.h>
 #include <string.h>
 
-enum matchResult { NO, YES, ALL };
 #define BLOCK 10
 
+/* States of a match that do not depend on the next characters */
+#define MEDIA_RANGE_MATCH_START 0
+#define MEDIA_RANGE_NO_MATCH -1
+#define MEDIA_RANGE_MATCH_ALL -2
+
 typedef struct MediaRanges *MediaRangePtr_t;
 
-/**
- *  Initialize a new mediaRange, from another media range
+/*
+ * Immutable matcher compiled from a list of media ranges, shared by the
+ * connections with a reference count
  */
-MediaRangePtr_t createMediaRangeFromListOfMediaType(MediaRangePtr_t mediaRange);
+typedef struct MediaRangeMatcher *MediaRangeMatcherPtr_t;
 
 /**
  *  Initialize a mediaRange, the string must respect the format of the
@@ -26,22 +31,6 @@ MediaRangePtr_t createMediaRange(char const *string);
  */
 void addMediaRange(MediaRangePtr_t mediaRange, char const *string);
 
-/**
- *  Returns if a mediaType (section 3.1.1.1 of the RFC7231) until the n
- *  position can match the media range.
- *  WARNING: Before using with n it is expected that you already use
- *  it with n-1 and if you want to use it with another media type you
- *  must use the reset function
- */
-enum matchResult doesMatchAt(int n, char mediaTypeCharAtN,
-							 MediaRangePtr_t mediaRange);
-
-/**
- *  Reset the structure so it can be use for another media types
- *  WARNING: it lose the progress of the doesMatchAt function
- */
-void resetMediaRange(MediaRangePtr_t mediaRange);
-
 /*
  * Free the media range structure
  */
@@ -52,4 +41,33 @@ void freeMediaRange(MediaRangePtr_t mrp);
  */
 char *getMediaRangeAsString(MediaRangePtr_t mrp);
 
+/*
+ * Compiles the media ranges of the list into a trie, ignoring their
+ * parameters and case. Returns it with one reference, or NULL on error.
+ */
+MediaRangeMatcherPtr_t compileMediaRange(MediaRangePtr_t mrp);
+
+/*
+ * Adds a reference to the matcher
+ */
+void retainMediaRangeMatcher(MediaRangeMatcherPtr_t matcher);
+
+/*
+ * Removes a reference to the matcher, freeing it with the last one
+ */
+void releaseMediaRangeMatcher(MediaRangeMatcherPtr_t matcher);
+
+/*
+ * Advances the match of a media type (section 3.1.1.1 of the RFC7231),
+ * without its parameters, by one character. A match starts at
+ * MEDIA_RANGE_MATCH_START.
+ */
+int mediaRangeMatcherStep(MediaRangeMatcherPtr_t matcher, int state,
+						  char mediaTypeChar);
+
+/*
+ * Returns TRUE if the media type matched until state is in the media ranges
+ */
+int mediaRangeMatcherAccepts(MediaRangeMatcherPtr_t matcher, int state);
+
 #endif
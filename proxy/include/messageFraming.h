@@ -0,0 +1,73 @@
+#ifndef MESSAGE_FRAMING_H
+#define MESSAGE_FRAMING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Follows an HTTP message body as it is relayed, without copying it, to know
+ * where the message ends (RFC 7230 section 3.3.3). Only Content-Length and
+ * chunked bodies have a known end.
+ */
+enum messageFramingState {
+	FRAMING_LENGTH,
+	FRAMING_CHUNK_SIZE,
+	FRAMING_CHUNK_EXTENSION,
+	FRAMING_CHUNK_SIZE_LF,
+	FRAMING_CHUNK_DATA,
+	FRAMING_CHUNK_DATA_CR,
+	FRAMING_CHUNK_DATA_LF,
+	FRAMING_TRAILER_START,
+	FRAMING_TRAILER,
+	FRAMING_TRAILER_LF,
+	FRAMING_DONE,
+	FRAMING_ERROR,
+};
+
+struct messageFraming {
+	unsigned state;
+	/* Body or chunk bytes left */
+	unsigned long long remaining;
+	unsigned sizeDigits;
+};
+
+/*
+ * Initialize the framing of a body of length bytes
+ */
+void messageFramingLength(struct messageFraming *framing,
+						  unsigned long long length);
+
+/*
+ * Initialize the framing of a chunked body
+ */
+void messageFramingChunked(struct messageFraming *framing);
+
+/*
+ * Consumes n body bytes. Returns how many of them belong to the message,
+ * the rest (if it is done) come after it.
+ */
+size_t messageFramingConsume(struct messageFraming *framing,
+							 const uint8_t *data, size_t n);
+
+/*
+ * Returns how many of the next body bytes can be consumed without looking at
+ * them: the rest of a content-length body, 0 otherwise
+ */
+unsigned long long messageFramingSkippable(struct messageFraming *framing);
+
+/*
+ * Consumes n body bytes that were not looked at, at most the skippable ones
+ */
+void messageFramingSkip(struct messageFraming *framing, size_t n);
+
+/*
+ * Returns TRUE if the whole body has been consumed
+ */
+int messageFramingIsDone(struct messageFraming *framing);
+
+/*
+ * Returns TRUE if a chunked body is malformed
+ */
+int messageFramingHasError(struct messageFraming *framing);
+
+#endif
@@ -4,6 +4,41 @@
 #include <stdint.h>
 #include <management.h>
 
+/* Percentiles reported for each latency: p50, p90, p99 and p999 */
+#define LATENCY_PERCENTILES 4
+/* Requests counted by method, one per enum methodType, NO_METHOD for the
+ * methods the proxy does not support */
+#define METHOD_COUNTERS 6
+/* Responses counted by status class, from 1xx to 5xx */
+#define STATUS_CLASS_COUNTERS 5
+
+/* How a response body was transformed, in the order of get mtr tu */
+enum transformUse {
+	COMMAND_TRANSFORM_USE,
+	PLUGIN_TRANSFORM_USE,
+	TRANSFORM_USE_QTY
+};
+
+/*
+ * The steps of a request that have their latency recorded, in the order of
+ * their resources from LAT_PR_ID
+ */
+enum latency {
+	/* From the first byte of the request to the end of its headers */
+	PARSE_LATENCY,
+	/* Resolution of the origin host, including the wait for a thread */
+	DNS_LATENCY,
+	/* Connection to the origin, when there was none in the pool */
+	CONNECT_LATENCY,
+	/* From the start of the request to the origin to its first response byte */
+	FIRST_BYTE_LATENCY,
+	/* Transformation of the response body */
+	TRANSFORM_LATENCY,
+	/* From the first byte of the request to the end of the response */
+	REQUEST_LATENCY,
+	LATENCY_QTY
+};
+
 /*
  * Increase by one the number of ConcurrentConections
  */
@@ -39,4 +74,174 @@ void increaseTransferBytes(uint64_t n);
  */
 uint64_t getTransferBytes();
 
+/*
+ * Increase by one the number of queued DNS resolutions
+ */
+void increaseDnsQueueDepth();
+
+/*
+ * Decrease by one the number of queued DNS resolutions
+ */
+void decreaseDnsQueueDepth();
+
+/*
+ * Returns the number of DNS resolutions waiting for a resolver thread
+ */
+uint64_t getDnsQueueDepth();
+
+/*
+ * Accounts a finished DNS resolution that took micros microseconds since
+ * it was queued
+ */
+void addDnsResolution(uint64_t micros);
+
+/*
+ * Returns the average DNS resolution latency in microseconds
+ */
+uint64_t getDnsResolutionLatency();
+
+/*
+ * Increase by one the number of origin host lookups that did not need a new
+ * resolution (cached or joined to one in progress)
+ */
+void increaseDnsCacheHits();
+
+/*
+ * Increase by one the number of origin host lookups that needed a new
+ * resolution
+ */
+void increaseDnsCacheMisses();
+
+/*
+ * Returns the number of DNS cache hits
+ */
+uint64_t getDnsCacheHits();
+
+/*
+ * Returns the number of DNS cache misses
+ */
+uint64_t getDnsCacheMisses();
+
+/*
+ * Increase by one the number of requests sent over a pooled origin
+ * connection
+ */
+void increaseUpstreamPoolHits();
+
+/*
+ * Increase by one the number of requests that needed a new origin connection
+ */
+void increaseUpstreamPoolMisses();
+
+/*
+ * Returns the number of origin connection pool hits
+ */
+uint64_t getUpstreamPoolHits();
+
+/*
+ * Returns the number of origin connection pool misses
+ */
+uint64_t getUpstreamPoolMisses();
+
+/*
+ * Increase by one the number of connections closed or answered with an error
+ * because a deadline expired
+ */
+void increaseDeadlineExpiries();
+
+/*
+ * Returns the number of expired deadlines
+ */
+uint64_t getDeadlineExpiries();
+
+/*
+ * Increase by n the number of free objects kept by the connection pools
+ */
+void increasePoolSize(uint64_t n);
+
+/*
+ * Decrease by n the number of free objects kept by the connection pools
+ */
+void decreasePoolSize(uint64_t n);
+
+/*
+ * Increase by one the number of objects taken from a connection pool
+ */
+void increasePoolHits();
+
+/*
+ * Increase by one the number of objects that a connection pool did not have
+ */
+void increasePoolMisses();
+
+/*
+ * Returns the number of free objects kept by the connection pools
+ */
+uint64_t getPoolSize();
+
+/*
+ * Returns the number of connection pool hits
+ */
+uint64_t getPoolHits();
+
+/*
+ * Returns the number of connection pool misses
+ */
+uint64_t getPoolMisses();
+
+/*
+ * Increase by one the number of access log entries dropped because the
+ * logger thread queue was full
+ */
+void increaseAccessLogDrops();
+
+/*
+ * Returns the number of dropped access log entries
+ */
+uint64_t getAccessLogDrops();
+
+/*
+ * Increase by one the number of requests of method, an enum methodType
+ */
+void increaseRequestsByMethod(unsigned method);
+
+/*
+ * Increase by one the number of responses of the class of status, a status
+ * out of 1xx to 5xx is not counted
+ */
+void increaseResponsesByStatus(int status);
+
+/*
+ * Increase by one the number of response bodies transformed as use says
+ */
+void increaseTransformUses(enum transformUse use);
+
+/*
+ * Fills counters with the number of requests of each method
+ */
+void getRequestsByMethod(uint64_t counters[METHOD_COUNTERS]);
+
+/*
+ * Fills counters with the number of responses of each status class
+ */
+void getResponsesByStatusClass(uint64_t counters[STATUS_CLASS_COUNTERS]);
+
+/*
+ * Fills counters with the number of response bodies transformed by a command
+ * and by a plugin
+ */
+void getTransformUses(uint64_t counters[TRANSFORM_USE_QTY]);
+
+/*
+ * Adds micros microseconds to the histogram of latency
+ */
+void recordLatency(enum latency latency, uint64_t micros);
+
+/*
+ * Fills percentiles with the p50, p90, p99 and p999 of latency in
+ * microseconds
+ */
+void getLatencyPercentiles(enum latency latency,
+						   uint64_t percentiles[LATENCY_PERCENTILES]);
+
 #endif
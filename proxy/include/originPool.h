@@ -0,0 +1,32 @@
+#ifndef ORIGIN_POOL_H
+#define ORIGIN_POOL_H
+
+#include <netdb.h>
+#include <selector.h>
+#include <sys/socket.h>
+
+/*
+ * Idle connections to origin servers kept open to be reused, keyed by
+ * (host, port, address). Each worker has its own pool since the sockets
+ * are registered in its selector: an idle socket is closed when origin
+ * closes it or sends anything, or when the idle timeout expires.
+ */
+
+/*
+ * Returns an idle connection to host:port whose address is one of the
+ * candidates, or -1 if there is none. The socket is unregistered from the
+ * selector and its address is copied into address.
+ */
+int originPoolTake(fd_selector s, const char *host, unsigned short port,
+				   struct addrinfo **candidates, unsigned candidateQty,
+				   struct sockaddr_storage *address);
+
+/*
+ * Keeps fd, a connection to host:port at address, to be reused. Evicts the
+ * oldest idle connection if a cap is reached. Closes fd if it can not be
+ * kept.
+ */
+void originPoolPut(fd_selector s, int fd, const char *host,
+				   unsigned short port, const struct sockaddr_storage *address);
+
+#endif
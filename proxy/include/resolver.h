@@ -0,0 +1,58 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <netdb.h>
+#include <selector.h>
+
+/* Quantity of threads running getaddrinfo */
+#define RESOLVER_THREADS 4
+
+/* Maximum quantity of queued resolutions, must be a power of 2 */
+#define RESOLVER_QUEUE_SIZE 1024
+
+/* Buckets of the host cache, must be a power of 2 */
+#define DNS_CACHE_BUCKETS 1024
+
+/* Maximum quantity of cached hosts, the one expiring first makes room */
+#define DNS_CACHE_MAX_ENTRIES 4096
+
+/* Seconds a name that does not exist is remembered, at most the TTL */
+#define DNS_NEGATIVE_TTL 5
+
+/*
+ * A name resolution handed to the resolver pool. Resolutions are cached
+ * for the configured TTL and concurrent lookups of the same host share a
+ * single getaddrinfo. When it finishes the selector is notified with
+ * selector_notify_block for the fd it was submitted with.
+ */
+typedef struct resolverJob *resolverJobADT;
+
+/* Starts the resolver threads, returns -1 on error */
+int resolverPoolInit(unsigned threads);
+
+/* Stops and waits for the resolver threads */
+void resolverPoolDestroy(void);
+
+/*
+ * Looks host up in the cache or queues its resolution. If it was cached
+ * the job is already done and no notification is sent. Returns NULL if
+ * the queue is full or there is no memory.
+ */
+resolverJobADT resolverSubmit(fd_selector s, int fd, const char *host);
+
+/* Returns TRUE if the resolution has finished */
+int resolverJobIsDone(resolverJobADT job);
+
+/*
+ * Returns the resolutions of a finished job (NULL if the name could not be
+ * resolved). They are valid until the job is released.
+ */
+struct addrinfo *resolverJobAddresses(resolverJobADT job);
+
+/*
+ * Releases a job and its resolutions, it may still be running. Must not
+ * be used after this call.
+ */
+void resolverJobRelease(resolverJobADT job);
+
+#endif
@@ -88,6 +88,24 @@ typedef enum {
 /** retorna una descripción humana del fallo */
 const char *selector_error(const selector_status status);
 
+/**
+ * Implementación de multiplexado a utilizar.
+ *
+ * SELECTOR_BACKEND_SELECT está limitado a FD_SETSIZE descriptores y en cada
+ * iteración recorre todos los descriptores hasta el máximo registrado.
+ *
+ * SELECTOR_BACKEND_EPOLL (solo Linux) no tiene ese límite y despacha
+ * únicamente los descriptores que están listos.
+ *
+ * SELECTOR_BACKEND_DEFAULT usa el definido al compilar con
+ * -DSELECTOR_DEFAULT_BACKEND=... (epoll si la plataforma lo soporta).
+ */
+typedef enum {
+	SELECTOR_BACKEND_DEFAULT = 0,
+	SELECTOR_BACKEND_SELECT  = 1,
+	SELECTOR_BACKEND_EPOLL   = 2,
+} selector_backend;
+
 /** opciones de inicialización del selector */
 struct selector_init {
 	/** señal a utilizar para notificaciones internas */
@@ -95,11 +113,23 @@ struct selector_init {
 
 	/** tiempo máximo de bloqueo durante `selector_iteratate' */
 	struct timespec select_timeout;
+
+	/** implementación de multiplexado para los selectores que se creen */
+	selector_backend backend;
 };
 
 /** inicializa la librería */
 selector_status selector_init(const struct selector_init *c);
 
+/** retorna un nombre humano de la implementación de multiplexado */
+const char *selector_backend_name(const selector_backend backend);
+
+/**
+ * obtiene la implementación a partir de su nombre ("select" / "epoll").
+ * retorna -1 si el nombre es inválido o no está soportado en la plataforma.
+ */
+int selector_backend_from_name(const char *name, selector_backend *backend);
+
 /** deshace la incialización de la librería */
 selector_status selector_close(void);
 
@@ -154,6 +184,12 @@ typedef struct fd_handler {
 	 */
 	void (*handle_close)(struct selector_key *key);
 
+	/**
+	 * llamado cuando vence el timeout armado con `selector_set_timeout'.
+	 * El timeout se desarma antes de llamarlo.
+	 */
+	void (*handle_timeout)(struct selector_key *key);
+
 } fd_handler;
 
 /**
@@ -205,4 +241,15 @@ int IsFdSet(int fd, fd_selector s);
 /** notifica que un trabajo bloqueante terminó */
 selector_status selector_notify_block(fd_selector s, const int fd);
 
+/**
+ * arma (o rearma) un timeout de `ms' milisegundos para `fd'. Al vencer se
+ * llama a `handle_timeout' de su handler, que no puede ser NULL.
+ * Desregistrar el fd desarma el timeout. Armar y desarmar es O(1).
+ */
+selector_status selector_set_timeout(fd_selector s, const int fd,
+									 const unsigned ms);
+
+/** desarma el timeout de `fd', si lo tuviera */
+selector_status selector_clear_timeout(fd_selector s, const int fd);
+
 #endif
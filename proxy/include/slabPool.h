@@ -0,0 +1,67 @@
+#ifndef SLAB_POOL_H
+#define SLAB_POOL_H
+
+#include <stddef.h>
+#include <time.h>
+
+/* Seconds between trims, the selector wakes up at least this often */
+#define SLAB_POOL_TRIM_INTERVAL 10
+
+/*
+ * Free objects of one size, kept to be reused instead of going back to
+ * malloc. Each worker has its own pools, so they are not locked. How many
+ * free objects a pool keeps is set by the watermarks of the configuration:
+ * it is filled up to the low one at start and never holds more than the high
+ * one. Every SLAB_POOL_TRIM_INTERVAL the objects that stayed free since the
+ * last trim are freed, down to the low watermark.
+ */
+struct slabPool {
+	size_t objectSize;
+	/* Free objects, each one holds the address of the next one */
+	void *free;
+	unsigned size;
+	/* Fewest free objects since the last trim, the ones nobody used */
+	unsigned idle;
+	time_t lastTrim;
+	/* TRUE if the pool metrics count this pool */
+	int isMeasured;
+};
+
+#define SLAB_POOL_INITIALIZER(type)                                            \
+	{ .objectSize = sizeof(type) }
+
+/* A pool whose size, hits and misses are reported by the pool metrics */
+#define SLAB_POOL_MEASURED_INITIALIZER(type)                                   \
+	{ .objectSize = sizeof(type), .isMeasured = 1 }
+
+/*
+ * Returns a free object of the pool, or one from malloc if it is empty.
+ * Returns NULL if malloc fails.
+ */
+void *slabPoolGet(struct slabPool *pool);
+
+/*
+ * Gives the object back to the pool, or to free if the pool is at its high
+ * watermark
+ */
+void slabPoolPut(struct slabPool *pool, void *object);
+
+/*
+ * Allocates free objects until the pool is at its low watermark. Returns
+ * -1 if malloc fails.
+ */
+int slabPoolFill(struct slabPool *pool);
+
+/*
+ * Frees the objects that were not used since the last trim, keeping the low
+ * watermark, and the ones above the high watermark. Does nothing until
+ * SLAB_POOL_TRIM_INTERVAL passed since the last trim.
+ */
+void slabPoolTrim(struct slabPool *pool);
+
+/*
+ * Frees every object of the pool
+ */
+void slabPoolDestroy(struct slabPool *pool);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef SPLICE_RELAY_H
+#define SPLICE_RELAY_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Size asked for the pipe, the kernel may give less */
+#define SPLICE_PIPE_SIZE (256 * 1024)
+
+/* Shorter bodies are copied, opening a pipe is not worth it */
+#define SPLICE_MIN_LENGTH (16 * 1024)
+
+/*
+ * Moves bytes between two sockets through a pipe with splice(2), so that
+ * bodies are relayed without being copied to user space. Only available on
+ * Linux, elsewhere spliceRelayOpen fails and the copy path is used.
+ */
+struct spliceRelay {
+	/* -1 if the pipe has not been opened */
+	int pipe[2];
+	/* Bytes read into the pipe and not yet written out */
+	size_t buffered;
+	size_t capacity;
+};
+
+/*
+ * Initializes the relay without opening the pipe
+ */
+void spliceRelayInit(struct spliceRelay *relay);
+
+/*
+ * Opens the pipe if it is not open. Returns -1 if splice can not be used.
+ */
+int spliceRelayOpen(struct spliceRelay *relay);
+
+/*
+ * Returns TRUE if the pipe is open
+ */
+int spliceRelayIsOpen(struct spliceRelay *relay);
+
+/*
+ * Returns TRUE if there is space left in the pipe
+ */
+int spliceRelayCanFill(struct spliceRelay *relay);
+
+/*
+ * Moves up to max bytes from fd into the pipe. Returns what recv would: the
+ * bytes moved, 0 if fd was closed or -1 on error (errno EAGAIN if fd has
+ * nothing to read).
+ */
+ssize_t spliceRelayFill(struct spliceRelay *relay, int fd, size_t max);
+
+/*
+ * Moves the bytes in the pipe to fd. Returns the bytes moved or -1 on error.
+ */
+ssize_t spliceRelayDrain(struct spliceRelay *relay, int fd);
+
+/*
+ * Closes the pipe, the bytes in it are lost
+ */
+void spliceRelayClose(struct spliceRelay *relay);
+
+#endif
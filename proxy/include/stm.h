@@ -58,6 +58,8 @@ struct state_definition {
 	unsigned (*on_write_ready)(struct selector_key *key);
 	/** ejecutado cuando hay una resolución de nombres lista */
 	unsigned (*on_block_ready)(struct selector_key *key);
+	/** ejecutado cuando vence un timeout armado en el selector */
+	unsigned (*on_timeout)(struct selector_key *key);
 };
 
 /** inicializa el la máquina */
@@ -75,6 +77,10 @@ unsigned stm_handler_write(struct state_machine *stm, struct selector_key *key);
 /** indica que ocurrió el evento block. retorna nuevo id de nuevo estado. */
 unsigned stm_handler_block(struct state_machine *stm, struct selector_key *key);
 
+/** indica que ocurrió el evento timeout. retorna nuevo id de nuevo estado. */
+unsigned stm_handler_timeout(struct state_machine *stm,
+							 struct selector_key *key);
+
 /** indica que ocurrió el evento close. retorna nuevo id de nuevo estado. */
 void stm_handler_close(struct state_machine *stm, struct selector_key *key);
 
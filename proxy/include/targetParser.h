@@ -5,6 +5,7 @@
 #include <buffer.h>
 #include <stdlib.h>
 #include <utilities.h>
+#include <arena.h>
 
 enum targetState {
 	START_T,
@@ -27,19 +28,16 @@ struct targetParser {
 	char *target;
 	unsigned int sizeTarget;
 	int port;
+	/* Where the host and the target are allocated */
+	struct arena *arena;
 };
 
 #define PORT_DEFAULT 80
 
 /*
- * Initialize parser
+ * Initialize parser, the host and the target are allocated from arena
  */
-void parseTargetInit(struct targetParser *parser);
-
-/*
- * Destroy parser
- */
-void parseTargetDestroy(struct targetParser *parser);
+void parseTargetInit(struct targetParser *parser, struct arena *arena);
 
 /*
  * Parse a char
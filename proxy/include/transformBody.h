@@ -2,8 +2,9 @@
 #define TRANSFORM_BODY_H
 
 #include <unchunkParser.h>
-
-#define LIMITATING_CHARS 4 //'\r' and '\n' at begining and end
+#include <chunkWriter.h>
+#include <transformerPool.h>
+#include <httpdPlugin.h>
 
 enum transformCommandStatus {
 	TRANSFORM_COMMAND_OK = 0,
@@ -19,14 +20,21 @@ struct transformBody {
 	int writeToTransformFd;
 	int readFromTransformFd;
 	unsigned commandStatus;
-	uint8_t *chunkedData;
-	buffer chunkedBuffer;
+	struct chunkWriter chunkWriter;
 	uint8_t transformCommandExecuted;
 	uint8_t transformFinished;
 	uint8_t responseFinished;
 	uint8_t transformSelectors;
-	uint8_t lastChunkSent;
+	/* The end of the body was sent to the transform command */
+	uint8_t inputFinished;
 	pid_t commandPid;
+	/* Pooled command running the transformation, NULL if it runs once */
+	struct transformer *transformer;
+	/* Plugin running the transformation in process, NULL if it is a command */
+	const struct httpdPlugin *plugin;
+	/* Keeps the library of the plugin loaded while the body runs on it */
+	struct loadedPlugin *loadedPlugin;
+	void *pluginState;
 };
 
 /*
@@ -35,9 +43,21 @@ struct transformBody {
 void transformBodyInit(const unsigned state, struct selector_key *key);
 
 /*
- * Executes the transformer command and redirect its stdin,
- * stdout and stderr to pipes and specified error file also
- * registers pipes file descriptors to selector if exec success
+ * The transform timeout expired without data moving
+ */
+unsigned transformBodyTimeout(struct selector_key *key);
+
+/*
+ * Releases the plugin state and unregisters the transform command pipes. A
+ * pooled command that finished the body goes back to the pool, otherwise it
+ * is stopped.
+ */
+void transformBodyDestroy(const unsigned state, struct selector_key *key);
+
+/*
+ * Takes a pooled transformer command or executes it for this response only,
+ * with its stdin and stdout redirected to pipes and its stderr to the
+ * specified error file, and registers the pipes in the selector
  */
 int executeTransformCommand(struct selector_key *key);
 
@@ -53,6 +73,16 @@ unsigned transformBodyRead(struct selector_key *key);
  */
 unsigned transformBodyWrite(struct selector_key *key);
 
+/*
+ * Read from origin and runs the plugin over what was read
+ */
+unsigned pluginOriginRead(struct selector_key *key);
+
+/*
+ * Sends to client the chunks framed from the plugin output
+ */
+unsigned pluginClientWrite(struct selector_key *key);
+
 /*
  * Read from origin and writes to write buffer when
  * it wont send to transform and will chunk
@@ -77,8 +107,7 @@ unsigned readFromTransform(struct selector_key *key);
 unsigned readFromOrigin(struct selector_key *key);
 
 /*
- * Read from chunked buffer and writes to client
- * message chunked
+ * Sends to client the chunks framed from write buffer
  */
 unsigned standardClientWrite(struct selector_key *key);
 
@@ -99,8 +128,7 @@ unsigned writeToTransform(struct selector_key *key);
 unsigned writeToTransformChunked(struct selector_key *key);
 
 /*
- * Write to client from chunk buffer after transformation
- * and chunked
+ * Sends to client the chunks framed from the transform command output
  */
 unsigned writeToClient(struct selector_key *key);
 
@@ -121,30 +149,13 @@ unsigned setStandardFdInterestsWithoutChunked(struct selector_key *key);
 unsigned setFdInterestsWithTransformerCommand(struct selector_key *key);
 
 /*
- * Sets every file descriptor used to OP_NOOP before finishing connection
- */
-unsigned setErrorDoneFd(struct selector_key *key);
-
-/*
- * Allocates memory for chunk buffer according to maximum posible size buffer
- * given http buffer size and also initialize its buffer
- */
-void initializeChunkedBuffer(struct transformBody *transformBody, int length);
-
-/*
- * Sets chunk buffer with number of bytes in hexa of the message followed
- * by \r\n(CRLF) and then the data of the message followed by \r\n(CRLF)
- */
-void prepareChunkedBuffer(buffer *chunkBuffer, buffer *inbuffer);
-
-/*
- * Sets chunk buffer with last chunk(0\r\n)
+ * Set file descriptors interests when response is transformed by a plugin
  */
-void sentLastChunked(buffer *chunkBuffer);
+unsigned setFdInterestsWithPlugin(struct selector_key *key);
 
 /*
- * Frees allocated memory for chunk buffer
+ * Sets every file descriptor used to OP_NOOP before finishing connection
  */
-void transformBodyDestroy(const unsigned state, struct selector_key *key);
+unsigned setErrorDoneFd(struct selector_key *key);
 
 #endif
@@ -0,0 +1,32 @@
+#ifndef TRANSFORM_PLUGIN_H
+#define TRANSFORM_PLUGIN_H
+
+#include <httpdPlugin.h>
+
+#define TRANSFORM_PLUGIN_PREFIX "plugin:"
+
+/*
+ * Returns TRUE if command selects a plugin instead of an external command
+ */
+int isTransformPlugin(const char *command);
+
+/* A plugin loaded by a worker */
+struct loadedPlugin;
+
+/*
+ * Returns the plugin selected by command, loading it if it is not loaded,
+ * or NULL if it can not be loaded. Arguments is set to what follows the
+ * path. The body it is returned for keeps it loaded until it calls
+ * transformPluginRelease: each worker unloads a plugin once the command
+ * selects another and no body of the worker uses it.
+ */
+struct loadedPlugin *transformPluginLoad(const char *command,
+										 const char **arguments);
+
+/* Returns the functions of a loaded plugin */
+const struct httpdPlugin *transformPluginGet(struct loadedPlugin *loaded);
+
+/* Releases the plugin a body was started on, NULL is ignored */
+void transformPluginRelease(struct loadedPlugin *loaded);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef TRANSFORMER_POOL_H
+#define TRANSFORMER_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <selector.h>
+#include <transformerSpawn.h>
+
+/*
+ * Long lived transformer processes that handle many bodies in sequence.
+ *
+ * A pooled transformer is started with HTTPD_TRANSFORM_FRAMING=1 in its
+ * environment and has to write TRANSFORMER_GREETING to its stdout. Then each
+ * body is sent as frames, a 4 bytes big endian length followed by that many
+ * bytes, and ends with an empty frame. The transformer answers the
+ * transformed body with frames as well and ends it with an empty frame,
+ * after that it waits for the next body.
+ *
+ * A command that does not greet is run once per response instead. Each
+ * worker has its own pool since the pipes are registered in its selector.
+ */
+
+#define TRANSFORMER_GREETING "HTTPD-FRAMING/1\n"
+
+/* Time (ms) a new transformer has to greet */
+#define TRANSFORMER_GREETING_TIMEOUT 5000
+
+/* Bigger frames are split */
+#define TRANSFORMER_MAX_FRAME (64 * 1024)
+
+#define TRANSFORMER_HEADER_SIZE 4
+
+struct transformer {
+	pid_t pid;
+	/* Stdin and stdout of the process */
+	int toFd;
+	int fromFd;
+	/* Frame being written */
+	uint8_t outHeader[TRANSFORMER_HEADER_SIZE];
+	uint8_t outHeaderLength;
+	uint8_t outHeaderSent;
+	size_t outLeft;
+	/* Frame being read */
+	uint8_t inHeader[TRANSFORMER_HEADER_SIZE];
+	uint8_t inHeaderLength;
+	size_t inLeft;
+	/* Greeting bytes read while it starts */
+	size_t greetingLength;
+	uint8_t isGreeted;
+	/* Taken by a response, it is not in the pool */
+	uint8_t isBusy;
+	/* Changes with the command, older transformers are not kept */
+	unsigned generation;
+	struct transformer *next;
+};
+
+/*
+ * Returns an idle transformer running command, or NULL if there is none.
+ * Its pipes are unregistered from the selector and its framing state is
+ * reset. While the pool is not full a new transformer is started for later
+ * responses.
+ */
+struct transformer *transformerPoolTake(fd_selector s, const char *command);
+
+/*
+ * Gives back a transformer that finished a body. Its pipes must not be
+ * registered in the selector.
+ */
+void transformerPoolPut(fd_selector s, struct transformer *transformer);
+
+/*
+ * Kills a transformer left in the middle of a body. Its pipes must not be
+ * registered in the selector.
+ */
+void transformerPoolDiscard(struct transformer *transformer);
+
+/*
+ * Writes data as frames. Returns the bytes of data written, that can be 0 if
+ * only part of the length was written, or -1 on error.
+ */
+ssize_t transformerWrite(struct transformer *transformer, const uint8_t *data,
+						 size_t size);
+
+/*
+ * Writes the empty frame that ends the body. Returns TRUE once it is
+ * written, FALSE if part of it is pending or -1 on error.
+ */
+int transformerWriteEnd(struct transformer *transformer);
+
+/*
+ * Reads the transformed body without its framing. Returns what read would:
+ * the bytes read, 0 when the body ended or -1 on error (errno EAGAIN if
+ * nothing is ready).
+ */
+ssize_t transformerRead(struct transformer *transformer, uint8_t *data,
+						size_t size);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef TRANSFORMER_SPAWN_H
+#define TRANSFORMER_SPAWN_H
+
+#include <sys/types.h>
+
+/*
+ * Starts "/bin/sh -c command" with posix_spawn, that does not copy the page
+ * tables of the proxy as fork does. Its stdin and stdout are connected to
+ * non blocking pipes, returned in toFd and fromFd, and its stderr is
+ * redirected to errorFd (kept if it is -1). Signals get their default
+ * disposition and the proxy fds are not inherited where the C library
+ * allows closing them. If framed, HTTPD_TRANSFORM_FRAMING=1 is added to its
+ * environment.
+ * Returns the pid or -1 on error.
+ */
+pid_t transformerSpawn(const char *command, int framed, int errorFd,
+					   int *toFd, int *fromFd);
+
+/*
+ * Stops a command started by transformerSpawn, killing it first if isKilled.
+ * Until it is reaped its pid can not be reused, so it is reaped here if it
+ * already exited or by a later transformerReap of the same thread.
+ */
+void transformerStop(pid_t pid, int isKilled);
+
+/* Reaps, without waiting, the commands this thread stopped that exited */
+void transformerReap(void);
+
+#endif
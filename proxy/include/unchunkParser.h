@@ -14,12 +14,14 @@ enum unchunkParserState {
 };
 
 struct unchunkParser {
-	uint8_t unChunkedBufferData[BUFFER_SIZE];
-	uint8_t chunkedBytes[MAX_CHUNKED_ACCEPTED_BYTES + 1];
+	/* A state buffer of the connection */
+	uint8_t *unChunkedBufferData;
+	/* Size of the chunk while parsing its line, then its bytes left */
 	unsigned long long bytes;
 	buffer unchunkedBuffer;
-	int chunkedBytesIndex;
-	uint8_t bytesFinished;
+	uint8_t sizeDigits;
+	/* TRUE once the size ended and the extensions are being skipped */
+	uint8_t sizeFinished;
 	unsigned state;
 };
 
@@ -30,7 +32,9 @@ void unchunkParserInit(struct unchunkParser *unchunkParser,
 					   struct selector_key *key);
 
 /*
- * Parse buffer input and stores data as it wasn't chunked on unchunkedBuffer
+ * Parse buffer input and stores data as it wasn't chunked on unchunkedBuffer.
+ * Only the size lines are parsed byte by byte, the data of each chunk is
+ * copied in blocks as it is, so it may hold any byte.
  */
 void parseChunkedInfo(struct unchunkParser *unchunkParser, buffer *input);
 
@@ -39,9 +43,4 @@ void parseChunkedInfo(struct unchunkParser *unchunkParser, buffer *input);
  */
 void parseChunkedInfoByChar(uint8_t l, struct unchunkParser *unchunkParser);
 
-/*
- * Sets bytes read in hexa in chunkedBytes
- */
-void setBytes(struct unchunkParser *unchunkParser);
-
 #endif
@@ -16,11 +16,6 @@ enum boolean { FALSE = 0, TRUE };
  */
 char *addCharToString(char *string, unsigned int *sizeString, char c);
 
-/*
- * Receives a buffer and a int and write the int in the buffer as a string
- */
-void writeNumber(buffer *chunkBuffer, int bytesRead);
-
 /*
  * Returns the minimum ammount of digits needed to represent number in the
  * received base
@@ -32,10 +27,4 @@ int getDigits(int number, int base);
  */
 int getHexaValue(char l);
 
-/*
- * Given an hexa string in data and the position of it last char returns its
- * decimal value
- */
-unsigned long long hexaToULLong(char *data, int lastPosition);
-
 #endif
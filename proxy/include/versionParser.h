@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <buffer.h>
 #include <stdlib.h>
+#include <arena.h>
 
 enum versionState { // Put _V so it does not collide with others
 	START_V,
@@ -26,14 +27,9 @@ struct versionParser {
 };
 
 /*
- * Initialize parser
+ * Initialize parser, the version is allocated from arena
  */
-void parseVersionInit(struct versionParser *parser);
-
-/*
- * Destroy parser
- */
-void parseVersionDestroy(struct versionParser *parser);
+void parseVersionInit(struct versionParser *parser, struct arena *arena);
 
 /*
  * Parse a char
@@ -0,0 +1,43 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <selector.h>
+
+#define MAX_WORKER_SOCKETS 2
+
+/*
+ * A worker is an independent reactor: it owns its selector, its own
+ * SO_REUSEPORT listening sockets and (thread local) its own pool of
+ * struct http. The kernel balances incoming connections among workers.
+ */
+struct worker {
+	unsigned id;
+	pthread_t thread;
+	bool running;
+	fd_selector selector;
+	int httpSockets[MAX_WORKER_SOCKETS];
+	int httpSocketQty;
+	const volatile bool *done;
+	selector_status status;
+};
+
+/*
+ * Creates the worker selector and registers its listening sockets.
+ * The worker loop runs until *done becomes true.
+ */
+selector_status workerInit(struct worker *worker, unsigned id,
+						   const int *httpSockets, int httpSocketQty,
+						   const volatile bool *done);
+
+/* Runs the worker event loop in a new thread, returns 0 on success */
+int workerStart(struct worker *worker);
+
+/*
+ * Wakes the worker up, waits for its loop to finish and releases
+ * its selector and listening sockets
+ */
+selector_status workerStop(struct worker *worker);
+
+#endif
@@ -0,0 +1,56 @@
+#include <loopClock.h>
+
+/* Microseconds between reads of the wall clock */
+#define WALL_OFFSET_INTERVAL 1000000
+
+struct loopClock {
+	uint64_t monotonicMicros;
+	/* Wall minus monotonic microseconds, as of offsetReadAt */
+	uint64_t wallOffset;
+	uint64_t offsetReadAt;
+	int isUpdated;
+};
+
+static __thread struct loopClock loopClock;
+
+static uint64_t readMicros(clockid_t clock) {
+	struct timespec now;
+	clock_gettime(clock, &now);
+	return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void loopClockUpdate(void) {
+	loopClock.monotonicMicros = readMicros(CLOCK_MONOTONIC);
+
+	// The wall clock only moves apart from the monotonic one when it is set
+	// or slewed, the offset is enough between reads
+	if (!loopClock.isUpdated ||
+		loopClock.monotonicMicros - loopClock.offsetReadAt >=
+			WALL_OFFSET_INTERVAL) {
+		loopClock.wallOffset =
+			readMicros(CLOCK_REALTIME) - loopClock.monotonicMicros;
+		loopClock.offsetReadAt = loopClock.monotonicMicros;
+		loopClock.isUpdated	   = 1;
+	}
+}
+
+uint64_t loopClockMonotonicMicros(void) {
+	return loopClock.isUpdated ? loopClock.monotonicMicros
+							   : readMicros(CLOCK_MONOTONIC);
+}
+
+uint64_t loopClockMonotonicMillis(void) {
+	return loopClockMonotonicMicros() / 1000;
+}
+
+uint64_t loopClockWallMicros(void) {
+	if (!loopClock.isUpdated) {
+		return readMicros(CLOCK_REALTIME);
+	}
+
+	return loopClock.monotonicMicros + loopClock.wallOffset;
+}
+
+time_t loopClockWallSeconds(void) {
+	return loopClockWallMicros() / 1000000;
+}
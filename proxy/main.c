@@ -22,13 +22,21 @@
 #include <commandInterpreter.h>
 #include <protocol.h>
 #include <management.h>
+#include <worker.h>
+#include <transformerSpawn.h>
+#include <resolver.h>
+#include <logger.h>
 
 #define BACKLOG_QTY 20
 #define ERROR -1
 
-const int prepareTCPSocket(unsigned port, char *filterInterface);
+const int prepareTCPSocket(unsigned port, char *filterInterface,
+						   bool reusePort);
+static int prepareHttpSockets(int *httpSockets, unsigned port,
+							  char *httpInterface, bool reusePort,
+							  bool announce);
 
-static bool done = false;
+static volatile bool done = false;
 
 static void sigtermHandler(const int signal) {
 	printf("Signal %d, cleaning up and exiting\n", signal);
@@ -43,36 +51,35 @@ int main(const int argc, const char **argv) {
 	/* Setting signals */
 	signal(SIGTERM, sigtermHandler); /* Handling SIGTERM */
 	signal(SIGINT, sigtermHandler);  /* Handling SIGINT */
+	signal(SIGPIPE, SIG_IGN); /* A kept client may close while it is written */
 
 	close(0); /* Nothing to read from stdin */
 	unsigned proxyPort		  = getHttpPort(getConfiguration());
 	unsigned managementPort   = getManagementPort(getConfiguration());
 	char *httpInterface		  = getHttpInterfaces(getConfiguration());
 	char *managementInterface = getManagementInterfaces(getConfiguration());
+	unsigned workerQty		  = getWorkers(getConfiguration());
 	selector_status ss		  = SELECTOR_SUCCESS;
 	fd_selector selector	  = NULL;
+	struct worker *workers	  = NULL;
 
-	int httpSocketQty;
-	int httpSockets[2];
+	unsigned workersInitialized = 0;
+	bool resolverStarted		= false;
+	int httpSocketQty			= 0;
+	int httpSockets[MAX_WORKER_SOCKETS];
 	int managementSocketQty;
 	char *managementInterfaces[2];
 	int managementSockets[2];
 
-	if (httpInterface == NULL) {
-		httpSocketQty = 2;
-		httpSockets[0] =
-			prepareTCPSocket(proxyPort, DEFAULT_PROXY_IPV4_INTERFACE);
-		httpSockets[1] =
-			prepareTCPSocket(proxyPort, DEFAULT_PROXY_IPV6_INTERFACE);
-	}
-	else {
-		httpSocketQty  = 1;
-		httpSockets[0] = prepareTCPSocket(proxyPort, httpInterface);
-	}
+	if (workerQty <= 1) {
+		/* Single reactor: the main selector serves http and management */
+		httpSocketQty = prepareHttpSockets(httpSockets, proxyPort,
+										   httpInterface, false, true);
 
-	for (int i = 0; i < httpSocketQty; i++) {
-		if (httpSockets[i] == ERROR) {
-			goto finally;
+		for (int i = 0; i < httpSocketQty; i++) {
+			if (httpSockets[i] == ERROR) {
+				goto finally;
+			}
 		}
 	}
 
@@ -118,6 +125,7 @@ int main(const int argc, const char **argv) {
 				.tv_sec  = 10,
 				.tv_nsec = 0,
 			},
+		.backend = getSelectorBackend(getConfiguration()),
 	};
 
 	if (0 != selector_init(&conf)) {
@@ -125,6 +133,17 @@ int main(const int argc, const char **argv) {
 		goto finally;
 	}
 
+	if (resolverPoolInit(RESOLVER_THREADS) == -1) {
+		errorMessage = "Starting resolver threads";
+		goto finally;
+	}
+	resolverStarted = true;
+
+	if (accessLogInit() == -1) {
+		errorMessage = "Starting logger thread";
+		goto finally;
+	}
+
 	selector = selector_new(1024);
 
 	if (selector == NULL) {
@@ -132,6 +151,43 @@ int main(const int argc, const char **argv) {
 		goto finally;
 	}
 
+	if (workerQty > 1) {
+		workers = calloc(workerQty, sizeof(*workers));
+
+		if (workers == NULL) {
+			errorMessage = "Unable to create workers";
+			goto finally;
+		}
+
+		for (unsigned w = 0; w < workerQty; w++) {
+			int workerSockets[MAX_WORKER_SOCKETS];
+			int workerSocketQty = prepareHttpSockets(
+				workerSockets, proxyPort, httpInterface, true, w == 0);
+
+			for (int i = 0; i < workerSocketQty; i++) {
+				if (workerSockets[i] == ERROR) {
+					for (int j = 0; j < workerSocketQty; j++) {
+						if (workerSockets[j] >= 0) {
+							close(workerSockets[j]);
+						}
+					}
+					goto finally;
+				}
+			}
+
+			ss = workerInit(&workers[w], w, workerSockets, workerSocketQty,
+							&done);
+			workersInitialized++;
+
+			if (ss != SELECTOR_SUCCESS) {
+				errorMessage = "Initializing worker";
+				goto finally;
+			}
+		}
+
+		fprintf(stdout, "HTTP Proxy: %u workers\n", workerQty);
+	}
+
 	const struct fd_handler http = {.handle_read  = httpPassiveAccept,
 									.handle_write = NULL,
 									.handle_close = NULL, /* nothing to free */
@@ -162,6 +218,18 @@ int main(const int argc, const char **argv) {
 		}
 	}
 
+	for (unsigned w = 0; w < workersInitialized; w++) {
+		if (workerStart(&workers[w]) != 0) {
+			errorMessage = "Starting worker";
+			goto finally;
+		}
+	}
+
+	if (httpSocketQty > 0 && httpPoolFill() == -1) {
+		errorMessage = "Unable to fill the connection pools";
+		goto finally;
+	}
+
 	while (!done) {
 		errorMessage = NULL;
 		ss			 = selector_select(selector);
@@ -170,6 +238,9 @@ int main(const int argc, const char **argv) {
 			errorMessage = "Serving";
 			goto finally;
 		}
+
+		httpPoolTrim();
+		transformerReap();
 	}
 
 	if (errorMessage == NULL) {
@@ -189,11 +260,27 @@ finally:
 		ret = 1;
 	}
 
+	/* Pending resolutions notify their selectors, so they go first */
+	if (resolverStarted) {
+		resolverPoolDestroy();
+	}
+
+	/* Workers stop once done is set, wake them up and wait for them */
+	done = true;
+
+	for (unsigned w = 0; w < workersInitialized; w++) {
+		workerStop(&workers[w]);
+	}
+
+	free(workers);
+
 	if (selector != NULL) {
 		selector_destroy(selector);
 	}
 
 	selector_close();
+	/* Nobody logs anymore, the queued entries are written */
+	accessLogDestroy();
 	httpPoolDestroy();
 
 	for (int i = 0; i < httpSocketQty; i++) {
@@ -205,7 +292,37 @@ finally:
 	return ret;
 }
 
-const int prepareTCPSocket(unsigned port, char *filterInterface) {
+static int prepareHttpSockets(int *httpSockets, unsigned port,
+							  char *httpInterface, bool reusePort,
+							  bool announce) {
+	char *interfaces[MAX_WORKER_SOCKETS];
+	int httpSocketQty;
+
+	if (httpInterface == NULL) {
+		httpSocketQty = 2;
+		interfaces[0] = DEFAULT_PROXY_IPV4_INTERFACE;
+		interfaces[1] = DEFAULT_PROXY_IPV6_INTERFACE;
+	}
+	else {
+		httpSocketQty = 1;
+		interfaces[0] = httpInterface;
+	}
+
+	for (int i = 0; i < httpSocketQty; i++) {
+		if (announce) {
+			fprintf(stdout,
+					"HTTP Proxy: Listening on TCP interface = %s port = %d\n",
+					interfaces[i], port);
+		}
+
+		httpSockets[i] = prepareTCPSocket(port, interfaces[i], reusePort);
+	}
+
+	return httpSocketQty;
+}
+
+const int prepareTCPSocket(unsigned port, char *filterInterface,
+						   bool reusePort) {
 	struct sockaddr_storage *addr = calloc(1, sizeof(struct sockaddr_storage));
 
 	if (inet_pton(AF_INET, filterInterface,
@@ -235,9 +352,6 @@ const int prepareTCPSocket(unsigned port, char *filterInterface) {
 		return ERROR;
 	}
 
-	fprintf(stdout, "HTTP Proxy: Listening on TCP interface = %s port = %d\n",
-			filterInterface, port);
-
 	if (addr->ss_family == AF_INET6) {
 		/* If AF_INET6, listen in IPv6 only */
 		setsockopt(currentSocket, IPPROTO_IPV6, IPV6_V6ONLY, &(int){1},
@@ -247,6 +361,15 @@ const int prepareTCPSocket(unsigned port, char *filterInterface) {
 	/* If server fails doesn't have to wait to reuse address */
 	setsockopt(currentSocket, SOL_SOCKET, SO_REUSEADDR, &(int){1}, sizeof(int));
 
+	if (reusePort &&
+		setsockopt(currentSocket, SOL_SOCKET, SO_REUSEPORT, &(int){1},
+				   sizeof(int)) < 0) {
+		errorMessage = "Unable to set SO_REUSEPORT";
+		close(currentSocket);
+		free(addr);
+		return ERROR;
+	}
+
 	if (bind(currentSocket, (struct sockaddr *) addr, sizeof(*addr)) < 0) {
 		errorMessage = "Unable to bind socket";
 		free(addr);
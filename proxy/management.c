@@ -1,5 +1,6 @@
 #include <management.h>
 #include <metric.h>
+#include <loopClock.h>
 
 static void handleRead(struct selector_key *key);
 static void handleWrite(struct selector_key *key);
@@ -11,10 +12,20 @@ static void manageGetRequest(manager_t *client);
 static void manageSetRequest(manager_t *client);
 static uint8_t isValidGetId(resId_t id);
 static uint8_t isValidSetId(resId_t id);
+static uint8_t isMetricId(resId_t id);
+static uint8_t isLatencyId(resId_t id);
+static uint8_t isCountersId(resId_t id);
+static uint8_t hasAllocatedData(resId_t id);
 static void manageGetCommandRequest(response_t *response);
 static void manageGetMetricRequest(resId_t id, response_t *response);
 static void manageGetTransformationStatusRequest(response_t *response);
 static void manageGetMediaRangeRequest(response_t *response);
+static void manageGetPoolRequest(response_t *response);
+static void manageGetSamplingRequest(response_t *response);
+static void manageGetLatencyRequest(resId_t id, response_t *response);
+static void manageGetCountersRequest(resId_t id, response_t *response);
+static uint8_t setPoolWatermarks(const uint8_t *data, size_t dataLength);
+static uint8_t setSampling(const uint8_t *data, size_t dataLength);
 
 static const char *errorMessage = "";
 
@@ -26,9 +37,14 @@ static const struct fd_handler managementHandler = {.handle_read  = handleRead,
 													.handle_block = NULL};
 
 timeTag_t generateAndUpdateTimeTag(uint8_t id) {
-	timeTag_t timeTag = time(NULL);
+	timeTag_t timeTag = loopClockWallSeconds();
 
-	timeTags[id] = timeTag;
+	/* May be updated concurrently by every worker, after every send for the
+	 * transferred bytes: only written when the second changed so that the
+	 * workers do not take the cache line from each other */
+	if (__atomic_load_n(&timeTags[id], __ATOMIC_RELAXED) != timeTag) {
+		__atomic_store_n(&timeTags[id], timeTag, __ATOMIC_RELAXED);
+	}
 
 	return timeTag;
 }
@@ -211,11 +227,41 @@ static void manageGetRequest(manager_t *client) {
 		case MTR_CN_ID:
 		case MTR_HS_ID:
 		case MTR_BT_ID:
+		case MTR_DQ_ID:
+		case MTR_DL_ID:
+		case MTR_DH_ID:
+		case MTR_DM_ID:
+		case MTR_UH_ID:
+		case MTR_UM_ID:
+		case MTR_TO_ID:
+		case MTR_PS_ID:
+		case MTR_PH_ID:
+		case MTR_PM_ID:
+		case MTR_LD_ID:
 			manageGetMetricRequest(id, &client->response);
 			break;
 		case TF_ID:
 			manageGetTransformationStatusRequest(&client->response);
 			break;
+		case POOL_ID:
+			manageGetPoolRequest(&client->response);
+			break;
+		case SMP_ID:
+			manageGetSamplingRequest(&client->response);
+			break;
+		case LAT_PR_ID:
+		case LAT_DN_ID:
+		case LAT_CN_ID:
+		case LAT_FB_ID:
+		case LAT_TR_ID:
+		case LAT_RQ_ID:
+			manageGetLatencyRequest(id, &client->response);
+			break;
+		case MTR_RM_ID:
+		case MTR_SC_ID:
+		case MTR_TU_ID:
+			manageGetCountersRequest(id, &client->response);
+			break;
 		default:
 			/* Can't be reached because of isValidGetId check */
 			break;
@@ -237,11 +283,80 @@ static void manageGetTransformationStatusRequest(response_t *response) {
 	response->dataLength		 = sizeof(uint8_t);
 }
 
+/* A copy, the command may be replaced before the response is sent */
 static void manageGetCommandRequest(response_t *response) {
-	char *command = getCommand(getConfiguration());
+	TransformCommandPtr_t command = getCommand(getConfiguration());
+	char *line					  = strdup(getCommandLine(command));
+
+	releaseCommand(command);
+	response->data		 = (void *) line;
+	response->dataLength = line == NULL ? 0 : strlen(line) + 1;
+}
+
+/* The low and the high watermarks, as big-endian 32-bits integers */
+static void manageGetPoolRequest(response_t *response) {
+	uint32_t *watermarks = malloc(2 * sizeof(*watermarks));
+
+	watermarks[0]		 = htobe32(getPoolLowWatermark(getConfiguration()));
+	watermarks[1]		 = htobe32(getPoolHighWatermark(getConfiguration()));
+	response->data		 = (void *) watermarks;
+	response->dataLength = 2 * sizeof(*watermarks);
+}
+
+/* The sample rate and the slow threshold (ms) of the access log, as
+ * big-endian 32-bits integers */
+static void manageGetSamplingRequest(response_t *response) {
+	configurationADT config = getConfiguration();
+	uint32_t *sampling		= malloc(2 * sizeof(*sampling));
+
+	sampling[0]			 = htobe32(getAccessLogSampleRate(config));
+	sampling[1]			 = htobe32(getAccessLogSlowThreshold(config));
+	response->data		 = (void *) sampling;
+	response->dataLength = 2 * sizeof(*sampling);
+}
+
+/* The p50, p90, p99 and p999 in microseconds, as big-endian 64-bits integers */
+static void manageGetLatencyRequest(resId_t id, response_t *response) {
+	uint64_t *percentiles = malloc(LATENCY_PERCENTILES * sizeof(*percentiles));
+
+	getLatencyPercentiles(id - LAT_PR_ID, percentiles);
+	for (unsigned i = 0; i < LATENCY_PERCENTILES; i++) {
+		percentiles[i] = htobe64(percentiles[i]);
+	}
+	response->data		 = (void *) percentiles;
+	response->dataLength = LATENCY_PERCENTILES * sizeof(*percentiles);
+}
+
+/*
+ * The requests by method, the responses by status class or the transformed
+ * bodies by command and by plugin, as big-endian 64-bits integers
+ */
+static void manageGetCountersRequest(resId_t id, response_t *response) {
+	uint64_t *counters;
+	unsigned qty;
+
+	switch (id) {
+		case MTR_RM_ID:
+			qty		 = METHOD_COUNTERS;
+			counters = malloc(qty * sizeof(*counters));
+			getRequestsByMethod(counters);
+			break;
+		case MTR_SC_ID:
+			qty		 = STATUS_CLASS_COUNTERS;
+			counters = malloc(qty * sizeof(*counters));
+			getResponsesByStatusClass(counters);
+			break;
+		default:
+			qty		 = TRANSFORM_USE_QTY;
+			counters = malloc(qty * sizeof(*counters));
+			getTransformUses(counters);
+	}
 
-	response->data		 = (void *) command;
-	response->dataLength = strlen(command) + 1;
+	for (unsigned i = 0; i < qty; i++) {
+		counters[i] = htobe64(counters[i]);
+	}
+	response->data		 = (void *) counters;
+	response->dataLength = qty * sizeof(*counters);
 }
 
 static void manageGetMetricRequest(resId_t id, response_t *response) {
@@ -257,6 +372,39 @@ static void manageGetMetricRequest(resId_t id, response_t *response) {
 		case MTR_BT_ID:
 			*metric = getTransferBytes();
 			break;
+		case MTR_DQ_ID:
+			*metric = getDnsQueueDepth();
+			break;
+		case MTR_DL_ID:
+			*metric = getDnsResolutionLatency();
+			break;
+		case MTR_DH_ID:
+			*metric = getDnsCacheHits();
+			break;
+		case MTR_DM_ID:
+			*metric = getDnsCacheMisses();
+			break;
+		case MTR_UH_ID:
+			*metric = getUpstreamPoolHits();
+			break;
+		case MTR_UM_ID:
+			*metric = getUpstreamPoolMisses();
+			break;
+		case MTR_TO_ID:
+			*metric = getDeadlineExpiries();
+			break;
+		case MTR_PS_ID:
+			*metric = getPoolSize();
+			break;
+		case MTR_PH_ID:
+			*metric = getPoolHits();
+			break;
+		case MTR_PM_ID:
+			*metric = getPoolMisses();
+			break;
+		case MTR_LD_ID:
+			*metric = getAccessLogDrops();
+			break;
 		default:
 			break;
 	}
@@ -268,11 +416,79 @@ static void manageGetMetricRequest(resId_t id, response_t *response) {
 }
 
 static uint8_t isValidGetId(resId_t id) {
-	return id >= MIME_ID && id <= TF_ID;
+	return id >= MIME_ID && id <= MTR_TU_ID;
+}
+
+static uint8_t isMetricId(resId_t id) {
+	return (id >= MTR_CN_ID && id <= MTR_BT_ID) ||
+		   (id >= MTR_DQ_ID && id <= MTR_PM_ID) || id == MTR_LD_ID;
+}
+
+static uint8_t isLatencyId(resId_t id) {
+	return id >= LAT_PR_ID && id <= LAT_RQ_ID;
+}
+
+static uint8_t isCountersId(resId_t id) {
+	return id >= MTR_RM_ID && id <= MTR_TU_ID;
+}
+
+/* Returns TRUE if the data of the response to id was allocated to send it */
+static uint8_t hasAllocatedData(resId_t id) {
+	return isMetricId(id) || isLatencyId(id) || isCountersId(id) ||
+		   id == MIME_ID || id == CMD_ID || id == POOL_ID || id == SMP_ID;
 }
 
 static uint8_t isValidSetId(resId_t id) {
-	return id == MIME_ID || id == CMD_ID || id == TF_ID;
+	return id == MIME_ID || id == CMD_ID || id == TF_ID || id == POOL_ID ||
+		   id == SMP_ID;
+}
+
+/*
+ * Sets the watermarks sent as in manageGetPoolRequest. Returns FALSE if the
+ * data is not two integers or the low watermark exceeds the high one.
+ */
+static uint8_t setPoolWatermarks(const uint8_t *data, size_t dataLength) {
+	uint32_t watermarks[2];
+
+	if (dataLength != sizeof(watermarks)) {
+		return FALSE;
+	}
+
+	memcpy(watermarks, data, sizeof(watermarks));
+	watermarks[0] = be32toh(watermarks[0]);
+	watermarks[1] = be32toh(watermarks[1]);
+
+	if (watermarks[0] > watermarks[1]) {
+		return FALSE;
+	}
+
+	setPoolHighWatermark(getConfiguration(), watermarks[1]);
+	setPoolLowWatermark(getConfiguration(), watermarks[0]);
+	return TRUE;
+}
+
+/*
+ * Sets the sampling sent as in manageGetSamplingRequest. Returns FALSE if the
+ * data is not two integers or the sample rate is 0.
+ */
+static uint8_t setSampling(const uint8_t *data, size_t dataLength) {
+	uint32_t sampling[2];
+
+	if (dataLength != sizeof(sampling)) {
+		return FALSE;
+	}
+
+	memcpy(sampling, data, sizeof(sampling));
+	sampling[0] = be32toh(sampling[0]);
+	sampling[1] = be32toh(sampling[1]);
+
+	if (sampling[0] == 0) {
+		return FALSE;
+	}
+
+	setAccessLogSampleRate(getConfiguration(), sampling[0]);
+	setAccessLogSlowThreshold(getConfiguration(), sampling[1]);
+	return TRUE;
 }
 
 static void manageSetRequest(manager_t *client) {
@@ -292,20 +508,36 @@ static void manageSetRequest(manager_t *client) {
 		switch (id) {
 			case MIME_ID:
 				if (strcmp(client->request.data, "") != 0) {
-					addMediaRange(getMediaRange(getConfiguration()),
-								  (char *) client->request.data);
+					addToMediaRangeList(getConfiguration(),
+										(char *) client->request.data);
 				}
 				else {
 					resetMediaRangeList(getConfiguration());
 				}
 				break;
 			case CMD_ID:
+				// The configuration keeps the string, it is not freed here
 				setCommand(getConfiguration(), (char *) client->request.data);
+				client->request.data = NULL;
 				break;
 			case TF_ID:
 				setTransformationState(getConfiguration(),
 									   *((uint8_t *) client->request.data));
 				break;
+			case POOL_ID:
+				if (!setPoolWatermarks(client->request.data,
+									   client->request.dataLength)) {
+					client->response.status.generalStatus   = ERROR_STATUS;
+					client->response.status.operationStatus = ERROR_STATUS;
+				}
+				break;
+			case SMP_ID:
+				if (!setSampling(client->request.data,
+								 client->request.dataLength)) {
+					client->response.status.generalStatus   = ERROR_STATUS;
+					client->response.status.operationStatus = ERROR_STATUS;
+				}
+				break;
 			default:
 				/* Can't be reached because of isValidSetId check */
 				break;
@@ -388,10 +620,7 @@ static void handleWrite(struct selector_key *key) {
 	if (client->isAuthenticated && client->authResponseSent) {
 		sent = sendResponse(key->fd, client->response);
 
-		if ((client->response.id == MTR_BT_ID ||
-			 client->response.id == MTR_CN_ID ||
-			 client->response.id == MTR_HS_ID) ||
-			(client->response.id == MIME_ID)) {
+		if (hasAllocatedData(client->response.id)) {
 			free(client->response.data);
 		}
 	}
@@ -1,47 +1,46 @@
 #include <mediaRange.h>
 #include <management.h>
 #include <utilities.h>
+#include <ctype.h>
+#include <stdint.h>
 
 #define isOWS(a) (a == ' ' || a == '\t')
 
-enum matchResultOption { CAN, CANT };
+#define NO_CHILD -1
+
+/*
+ * A media type ends at the node, or any subtype follows it: the node of the
+ * slash of a "type/" range with an asterisk, or the root for any type
+ */
+#define NODE_ACCEPTS 0x01
+#define NODE_ANY_SUBTYPE 0x02
 
 typedef struct MediaRanges {
 	char **listMediaTypes;
-	int *canBeMatch;
 	int length;
 } MediaRange_t;
 
-MediaRangePtr_t
-createMediaRangeFromListOfMediaType(MediaRangePtr_t mediaRange) {
-	char **listOfMediaTypes = mediaRange->listMediaTypes;
-	int length				= mediaRange->length;
-	MediaRangePtr_t mrp		= calloc(1, sizeof(MediaRange_t));
-
-	int i, j = 0;
-	while (j < length) {
-		i = -1;
-		if (j % BLOCK == 0) {
-			mrp->listMediaTypes =
-				realloc(mrp->listMediaTypes, j + BLOCK * sizeof(char *));
-			memset(mrp->listMediaTypes + j * sizeof(char *), 0,
-				   BLOCK * sizeof(char *));
-		}
-		do {
-			i++;
-			if (i % BLOCK == 0) {
-				mrp->listMediaTypes[j] =
-					realloc(mrp->listMediaTypes[j], i + BLOCK * sizeof(char));
-			}
-			mrp->listMediaTypes[j][i] = listOfMediaTypes[j][i];
-		} while (listOfMediaTypes[j][i] != '\0');
-		j++;
-	}
+/*
+ * Node of the trie of the media ranges. The children of a node are linked
+ * through their siblings.
+ */
+struct mediaRangeNode {
+	char symbol;
+	uint8_t flags;
+	int child;
+	int sibling;
+};
 
-	mrp->length		= j;
-	mrp->canBeMatch = calloc(mrp->length, sizeof(int));
-	return mrp;
-}
+typedef struct MediaRangeMatcher {
+	unsigned references;
+	/* Nodes used, node 0 is the root */
+	int length;
+	struct mediaRangeNode nodes[];
+} MediaRangeMatcher_t;
+
+static int mediaRangeLength(const char *mediaType);
+static void addToMatcher(MediaRangeMatcherPtr_t matcher, const char *mediaType,
+						 int length);
 
 MediaRangePtr_t createMediaRange(char const *string) {
 	MediaRangePtr_t mrp = calloc(1, sizeof(MediaRange_t));
@@ -49,7 +48,6 @@ MediaRangePtr_t createMediaRange(char const *string) {
 
 	addMediaRange(mrp, string);
 
-	mrp->canBeMatch = calloc(mrp->length, sizeof(int));
 	return mrp;
 }
 
@@ -99,36 +97,6 @@ void addMediaRange(MediaRangePtr_t mrp, char const *string) {
 	generateAndUpdateTimeTag(MIME_ID);
 }
 
-enum matchResult doesMatchAt(int n, char mediaTypeCharAtN,
-							 MediaRangePtr_t mediaRange) {
-	enum matchResult ans = NO;
-	for (int i = 0; i < mediaRange->length; i++) {
-		if (mediaRange->canBeMatch[i] == CAN) {
-			if (mediaRange->listMediaTypes[i][n] == mediaTypeCharAtN) {
-				ans = YES;
-			}
-			else if (mediaRange->listMediaTypes[i][n] == '*') {
-				ans = ALL;
-				return ans;
-			}
-			else {
-				mediaRange->canBeMatch[i] = CANT;
-			}
-		}
-	}
-	return ans;
-}
-
-void resetMediaRange(MediaRangePtr_t mediaRange) {
-	int i = 0;
-	while (i < mediaRange->length) {
-		mediaRange->canBeMatch[i] = CAN;
-		i++;
-	}
-
-	return;
-}
-
 void freeMediaRange(MediaRangePtr_t mrp) {
 	int j = 0;
 	while (j < mrp->length) {
@@ -136,7 +104,6 @@ void freeMediaRange(MediaRangePtr_t mrp) {
 		j++;
 	}
 	free(mrp->listMediaTypes);
-	free(mrp->canBeMatch);
 	free(mrp);
 }
 
@@ -164,3 +131,127 @@ char *getMediaRangeAsString(MediaRangePtr_t mrp) {
 
 	return ans;
 }
+
+MediaRangeMatcherPtr_t compileMediaRange(MediaRangePtr_t mrp) {
+	MediaRangeMatcherPtr_t matcher;
+	int nodes = 1;
+
+	// A node per character is enough for the trie
+	for (int j = 0; j < mrp->length; j++) {
+		nodes += mediaRangeLength(mrp->listMediaTypes[j]);
+	}
+
+	matcher = malloc(sizeof(*matcher) + nodes * sizeof(matcher->nodes[0]));
+	if (matcher == NULL) {
+		return NULL;
+	}
+
+	matcher->references		  = 1;
+	matcher->length			  = 1;
+	matcher->nodes[0].symbol  = '\0';
+	matcher->nodes[0].flags	  = 0;
+	matcher->nodes[0].child	  = NO_CHILD;
+	matcher->nodes[0].sibling = NO_CHILD;
+
+	for (int j = 0; j < mrp->length; j++) {
+		addToMatcher(matcher, mrp->listMediaTypes[j],
+					 mediaRangeLength(mrp->listMediaTypes[j]));
+	}
+
+	return matcher;
+}
+
+/* The type and subtype, without OWS nor parameters */
+static int mediaRangeLength(const char *mediaType) {
+	int length = 0;
+
+	while (mediaType[length] != '\0' && mediaType[length] != ';' &&
+		   !isOWS(mediaType[length])) {
+		length++;
+	}
+	return length;
+}
+
+static void addToMatcher(MediaRangeMatcherPtr_t matcher, const char *mediaType,
+						 int length) {
+	struct mediaRangeNode *nodes = matcher->nodes;
+	const char *slash			 = memchr(mediaType, '/', length);
+	int current					 = 0;
+	int child;
+
+	// Only "type/subtype", "type/*" and "*/*" are media ranges
+	if (slash == NULL || slash == mediaType || slash == mediaType + length - 1) {
+		return;
+	}
+
+	if (length == 3 && strncmp(mediaType, "*/*", 3) == 0) {
+		nodes[0].flags |= NODE_ANY_SUBTYPE;
+		return;
+	}
+
+	if (mediaType[length - 1] == '*' && slash == mediaType + length - 2) {
+		length--;
+	}
+
+	for (int i = 0; i < length; i++) {
+		char symbol = tolower((unsigned char) mediaType[i]);
+
+		child = nodes[current].child;
+		while (child != NO_CHILD && nodes[child].symbol != symbol) {
+			child = nodes[child].sibling;
+		}
+
+		if (child == NO_CHILD) {
+			child					= matcher->length++;
+			nodes[child].symbol		= symbol;
+			nodes[child].flags		= 0;
+			nodes[child].child		= NO_CHILD;
+			nodes[child].sibling	= nodes[current].child;
+			nodes[current].child	= child;
+		}
+		current = child;
+	}
+
+	nodes[current].flags |=
+		mediaType[length] == '*' ? NODE_ANY_SUBTYPE : NODE_ACCEPTS;
+}
+
+void retainMediaRangeMatcher(MediaRangeMatcherPtr_t matcher) {
+	__atomic_add_fetch(&matcher->references, 1, __ATOMIC_RELAXED);
+}
+
+void releaseMediaRangeMatcher(MediaRangeMatcherPtr_t matcher) {
+	if (matcher != NULL &&
+		__atomic_sub_fetch(&matcher->references, 1, __ATOMIC_ACQ_REL) == 0) {
+		free(matcher);
+	}
+}
+
+int mediaRangeMatcherStep(MediaRangeMatcherPtr_t matcher, int state,
+						  char mediaTypeChar) {
+	const struct mediaRangeNode *nodes = matcher->nodes;
+	char symbol = tolower((unsigned char) mediaTypeChar);
+	int child;
+
+	if (state < 0) {
+		return state;
+	}
+
+	// Any subtype, or any type at the root, matches from here on
+	if (nodes[state].flags & NODE_ANY_SUBTYPE) {
+		return MEDIA_RANGE_MATCH_ALL;
+	}
+
+	for (child = nodes[state].child; child != NO_CHILD;
+		 child = nodes[child].sibling) {
+		if (nodes[child].symbol == symbol) {
+			return child;
+		}
+	}
+	return MEDIA_RANGE_NO_MATCH;
+}
+
+int mediaRangeMatcherAccepts(MediaRangeMatcherPtr_t matcher, int state) {
+	return state == MEDIA_RANGE_MATCH_ALL ||
+		   (state >= 0 && (matcher->nodes[state].flags & NODE_ACCEPTS));
+}
@@ -0,0 +1,166 @@
+#include <messageFraming.h>
+#include <utilities.h>
+
+/* More hex digits would not fit in remaining */
+#define MAX_CHUNK_SIZE_DIGITS 15
+
+static int hexValue(uint8_t c);
+
+void messageFramingLength(struct messageFraming *framing,
+						  unsigned long long length) {
+	framing->state		= length == 0 ? FRAMING_DONE : FRAMING_LENGTH;
+	framing->remaining  = length;
+	framing->sizeDigits = 0;
+}
+
+void messageFramingChunked(struct messageFraming *framing) {
+	framing->state		= FRAMING_CHUNK_SIZE;
+	framing->remaining  = 0;
+	framing->sizeDigits = 0;
+}
+
+size_t messageFramingConsume(struct messageFraming *framing,
+							 const uint8_t *data, size_t n) {
+	size_t i = 0;
+
+	while (i < n && framing->state != FRAMING_DONE &&
+		   framing->state != FRAMING_ERROR) {
+		uint8_t c = data[i];
+
+		switch (framing->state) {
+			case FRAMING_LENGTH:
+			case FRAMING_CHUNK_DATA: {
+				/* Data is skipped in bulk */
+				size_t skip = n - i;
+
+				if (skip > framing->remaining) {
+					skip = framing->remaining;
+				}
+
+				framing->remaining -= skip;
+				i += skip;
+
+				if (framing->remaining == 0) {
+					framing->state = framing->state == FRAMING_LENGTH ?
+										 FRAMING_DONE :
+										 FRAMING_CHUNK_DATA_CR;
+				}
+				continue;
+			}
+			case FRAMING_CHUNK_SIZE:
+				if (hexValue(c) >= 0 &&
+					framing->sizeDigits < MAX_CHUNK_SIZE_DIGITS) {
+					framing->remaining = framing->remaining * 16 + hexValue(c);
+					framing->sizeDigits++;
+				}
+				else if (framing->sizeDigits == 0) {
+					framing->state = FRAMING_ERROR;
+				}
+				else if (c == ';' || c == ' ' || c == '\t') {
+					framing->state = FRAMING_CHUNK_EXTENSION;
+				}
+				else if (c == '\r') {
+					framing->state = FRAMING_CHUNK_SIZE_LF;
+				}
+				else if (c == '\n') {
+					framing->state = framing->remaining == 0 ?
+										 FRAMING_TRAILER_START :
+										 FRAMING_CHUNK_DATA;
+				}
+				else {
+					framing->state = FRAMING_ERROR;
+				}
+				break;
+			case FRAMING_CHUNK_EXTENSION:
+				if (c == '\r') {
+					framing->state = FRAMING_CHUNK_SIZE_LF;
+				}
+				else if (c == '\n') {
+					framing->state = framing->remaining == 0 ?
+										 FRAMING_TRAILER_START :
+										 FRAMING_CHUNK_DATA;
+				}
+				break;
+			case FRAMING_CHUNK_SIZE_LF:
+				if (c != '\n') {
+					framing->state = FRAMING_ERROR;
+				}
+				else {
+					framing->state = framing->remaining == 0 ?
+										 FRAMING_TRAILER_START :
+										 FRAMING_CHUNK_DATA;
+				}
+				break;
+			case FRAMING_CHUNK_DATA_CR:
+				framing->state = c == '\r' ? FRAMING_CHUNK_DATA_LF :
+											 FRAMING_ERROR;
+				break;
+			case FRAMING_CHUNK_DATA_LF:
+				framing->state = c == '\n' ? FRAMING_CHUNK_SIZE : FRAMING_ERROR;
+				framing->sizeDigits = 0;
+				break;
+			case FRAMING_TRAILER_START:
+				if (c == '\r') {
+					framing->state = FRAMING_TRAILER_LF;
+				}
+				else if (c == '\n') {
+					framing->state = FRAMING_DONE;
+				}
+				else {
+					framing->state = FRAMING_TRAILER;
+				}
+				break;
+			case FRAMING_TRAILER:
+				if (c == '\n') {
+					framing->state = FRAMING_TRAILER_START;
+				}
+				break;
+			case FRAMING_TRAILER_LF:
+				framing->state = c == '\n' ? FRAMING_DONE : FRAMING_ERROR;
+				break;
+			default:
+				break;
+		}
+
+		i++;
+	}
+
+	return i;
+}
+
+unsigned long long messageFramingSkippable(struct messageFraming *framing) {
+	return framing->state == FRAMING_LENGTH ? framing->remaining : 0;
+}
+
+void messageFramingSkip(struct messageFraming *framing, size_t n) {
+	if (framing->state != FRAMING_LENGTH) {
+		return;
+	}
+
+	framing->remaining -= n < framing->remaining ? n : framing->remaining;
+
+	if (framing->remaining == 0) {
+		framing->state = FRAMING_DONE;
+	}
+}
+
+int messageFramingIsDone(struct messageFraming *framing) {
+	return framing->state == FRAMING_DONE ? TRUE : FALSE;
+}
+
+int messageFramingHasError(struct messageFraming *framing) {
+	return framing->state == FRAMING_ERROR ? TRUE : FALSE;
+}
+
+static int hexValue(uint8_t c) {
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
@@ -1,45 +1,279 @@
 #include <metric.h>
+#include <histogram.h>
+#include <stddef.h>
 
-struct metrics {
+/* More than the threads that count: the workers, the main, the resolver and
+ * the logger threads. Threads beyond share shards. */
+#define METRIC_SHARDS 128
+#define CACHE_LINE_SIZE 64
+
+/*
+ * Each thread adds to the counters of its own shard, relaxed atomics only in
+ * case it shares it, so that the workers do not take the cache lines of the
+ * counters from each other. The getters add up every shard. A gauge, as the
+ * concurrent connections, may be decreased by another thread than the one
+ * that increased it: a shard can wrap below 0 but the sum is right.
+ */
+#define METRIC_ADD(field, n)                                                   \
+	__atomic_add_fetch(&getThreadShard()->field, (n), __ATOMIC_RELAXED)
+#define METRIC_SUB(field, n)                                                   \
+	__atomic_sub_fetch(&getThreadShard()->field, (n), __ATOMIC_RELAXED)
+#define METRIC_GET(field) sumShards(offsetof(struct metricShard, field))
+
+struct metricShard {
 	uint64_t concurrentConections;
 	uint64_t historicAccess;
 	uint64_t transferBytes;
-};
+	uint64_t dnsQueueDepth;
+	uint64_t dnsResolutions;
+	uint64_t dnsResolutionTime;
+	uint64_t dnsCacheHits;
+	uint64_t dnsCacheMisses;
+	uint64_t upstreamPoolHits;
+	uint64_t upstreamPoolMisses;
+	uint64_t deadlineExpiries;
+	uint64_t poolSize;
+	uint64_t poolHits;
+	uint64_t poolMisses;
+	uint64_t accessLogDrops;
+	uint64_t requestsByMethod[METHOD_COUNTERS];
+	uint64_t responsesByStatusClass[STATUS_CLASS_COUNTERS];
+	uint64_t transformUses[TRANSFORM_USE_QTY];
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+static struct metricShard shards[METRIC_SHARDS];
+static unsigned nextShard;
+static __thread struct metricShard *threadShard;
 
-static struct metrics metricSingleton = {
-	.concurrentConections = 0,
-	.historicAccess		  = 0,
-	.transferBytes		  = 0,
-};
+/* Recorded by every worker in the same histograms, they are too big to have
+ * one per shard and are recorded once per request step, not per send */
+static struct histogram latencies[LATENCY_QTY];
+
+static struct metricShard *getThreadShard(void) {
+	if (threadShard == NULL) {
+		unsigned shard =
+			__atomic_fetch_add(&nextShard, 1, __ATOMIC_RELAXED) % METRIC_SHARDS;
+		threadShard = &shards[shard];
+	}
+
+	return threadShard;
+}
+
+/* Adds up the counter at offset of every shard */
+static uint64_t sumShards(size_t offset) {
+	uint64_t sum = 0;
+
+	for (unsigned i = 0; i < METRIC_SHARDS; i++) {
+		sum += __atomic_load_n((uint64_t *) ((char *) &shards[i] + offset),
+							   __ATOMIC_RELAXED);
+	}
+
+	return sum;
+}
+
+/* Adds up the counters array at offset of every shard into values */
+static void sumShardsArray(size_t offset, uint64_t *values, unsigned qty) {
+	for (unsigned i = 0; i < qty; i++) {
+		values[i] = sumShards(offset + i * sizeof(uint64_t));
+	}
+}
+
+/* Thousandths of the values below each of the reported percentiles */
+static const unsigned latencyPerMille[LATENCY_PERCENTILES] = {500, 900, 990,
+															  999};
 
 void increaseConcurrentConections() {
-	metricSingleton.concurrentConections++;
+	METRIC_ADD(concurrentConections, 1);
 	generateAndUpdateTimeTag(MTR_CN_ID);
 }
 
 void decreaseConcurrentConections() {
-	metricSingleton.concurrentConections--;
+	METRIC_SUB(concurrentConections, 1);
 	generateAndUpdateTimeTag(MTR_CN_ID);
 }
 
 void increaseHistoricAccess() {
-	metricSingleton.historicAccess++;
+	METRIC_ADD(historicAccess, 1);
 	generateAndUpdateTimeTag(MTR_HS_ID);
 }
 
 void increaseTransferBytes(uint64_t n) {
-	metricSingleton.transferBytes += n;
+	METRIC_ADD(transferBytes, n);
 	generateAndUpdateTimeTag(MTR_BT_ID);
 }
 
+void increaseDnsQueueDepth() {
+	METRIC_ADD(dnsQueueDepth, 1);
+	generateAndUpdateTimeTag(MTR_DQ_ID);
+}
+
+void decreaseDnsQueueDepth() {
+	METRIC_SUB(dnsQueueDepth, 1);
+	generateAndUpdateTimeTag(MTR_DQ_ID);
+}
+
+void addDnsResolution(uint64_t micros) {
+	METRIC_ADD(dnsResolutionTime, micros);
+	METRIC_ADD(dnsResolutions, 1);
+	generateAndUpdateTimeTag(MTR_DL_ID);
+}
+
+void increaseDnsCacheHits() {
+	METRIC_ADD(dnsCacheHits, 1);
+	generateAndUpdateTimeTag(MTR_DH_ID);
+}
+
+void increaseDnsCacheMisses() {
+	METRIC_ADD(dnsCacheMisses, 1);
+	generateAndUpdateTimeTag(MTR_DM_ID);
+}
+
+void increaseUpstreamPoolHits() {
+	METRIC_ADD(upstreamPoolHits, 1);
+	generateAndUpdateTimeTag(MTR_UH_ID);
+}
+
+void increaseUpstreamPoolMisses() {
+	METRIC_ADD(upstreamPoolMisses, 1);
+	generateAndUpdateTimeTag(MTR_UM_ID);
+}
+
+void increaseDeadlineExpiries() {
+	METRIC_ADD(deadlineExpiries, 1);
+	generateAndUpdateTimeTag(MTR_TO_ID);
+}
+
+void increasePoolSize(uint64_t n) {
+	METRIC_ADD(poolSize, n);
+	generateAndUpdateTimeTag(MTR_PS_ID);
+}
+
+void decreasePoolSize(uint64_t n) {
+	METRIC_SUB(poolSize, n);
+	generateAndUpdateTimeTag(MTR_PS_ID);
+}
+
+void increasePoolHits() {
+	METRIC_ADD(poolHits, 1);
+	generateAndUpdateTimeTag(MTR_PH_ID);
+}
+
+void increasePoolMisses() {
+	METRIC_ADD(poolMisses, 1);
+	generateAndUpdateTimeTag(MTR_PM_ID);
+}
+
+void increaseAccessLogDrops() {
+	METRIC_ADD(accessLogDrops, 1);
+	generateAndUpdateTimeTag(MTR_LD_ID);
+}
+
+void increaseRequestsByMethod(unsigned method) {
+	if (method >= METHOD_COUNTERS) {
+		method = METHOD_COUNTERS - 1;
+	}
+
+	METRIC_ADD(requestsByMethod[method], 1);
+	generateAndUpdateTimeTag(MTR_RM_ID);
+}
+
+void increaseResponsesByStatus(int status) {
+	if (status < 100 || status >= 100 * (STATUS_CLASS_COUNTERS + 1)) {
+		return;
+	}
+
+	METRIC_ADD(responsesByStatusClass[status / 100 - 1], 1);
+	generateAndUpdateTimeTag(MTR_SC_ID);
+}
+
+void increaseTransformUses(enum transformUse use) {
+	METRIC_ADD(transformUses[use], 1);
+	generateAndUpdateTimeTag(MTR_TU_ID);
+}
+
+void recordLatency(enum latency latency, uint64_t micros) {
+	histogramRecord(&latencies[latency], micros);
+	generateAndUpdateTimeTag(LAT_PR_ID + latency);
+}
+
 uint64_t getConcurrentConections() {
-	return metricSingleton.concurrentConections;
+	return METRIC_GET(concurrentConections);
 }
 
 uint64_t getHistoricAccess() {
-	return metricSingleton.historicAccess;
+	return METRIC_GET(historicAccess);
 }
 
 uint64_t getTransferBytes() {
-	return metricSingleton.transferBytes;
+	return METRIC_GET(transferBytes);
+}
+
+uint64_t getDnsQueueDepth() {
+	return METRIC_GET(dnsQueueDepth);
+}
+
+uint64_t getDnsResolutionLatency() {
+	uint64_t resolutions = METRIC_GET(dnsResolutions);
+
+	return resolutions == 0 ? 0 : METRIC_GET(dnsResolutionTime) / resolutions;
+}
+
+uint64_t getDnsCacheHits() {
+	return METRIC_GET(dnsCacheHits);
+}
+
+uint64_t getDnsCacheMisses() {
+	return METRIC_GET(dnsCacheMisses);
+}
+
+uint64_t getUpstreamPoolHits() {
+	return METRIC_GET(upstreamPoolHits);
+}
+
+uint64_t getUpstreamPoolMisses() {
+	return METRIC_GET(upstreamPoolMisses);
+}
+
+uint64_t getDeadlineExpiries() {
+	return METRIC_GET(deadlineExpiries);
+}
+
+uint64_t getPoolSize() {
+	return METRIC_GET(poolSize);
+}
+
+uint64_t getPoolHits() {
+	return METRIC_GET(poolHits);
+}
+
+uint64_t getPoolMisses() {
+	return METRIC_GET(poolMisses);
+}
+
+uint64_t getAccessLogDrops() {
+	return METRIC_GET(accessLogDrops);
+}
+
+void getRequestsByMethod(uint64_t counters[METHOD_COUNTERS]) {
+	sumShardsArray(offsetof(struct metricShard, requestsByMethod), counters,
+				   METHOD_COUNTERS);
+}
+
+void getResponsesByStatusClass(uint64_t counters[STATUS_CLASS_COUNTERS]) {
+	sumShardsArray(offsetof(struct metricShard, responsesByStatusClass),
+				   counters, STATUS_CLASS_COUNTERS);
+}
+
+void getTransformUses(uint64_t counters[TRANSFORM_USE_QTY]) {
+	sumShardsArray(offsetof(struct metricShard, transformUses), counters,
+				   TRANSFORM_USE_QTY);
+}
+
+void getLatencyPercentiles(enum latency latency,
+						   uint64_t percentiles[LATENCY_PERCENTILES]) {
+	struct histogram *histogram = &latencies[latency];
+
+	for (unsigned i = 0; i < LATENCY_PERCENTILES; i++) {
+		percentiles[i] = histogramPercentile(histogram, latencyPerMille[i]);
+	}
 }
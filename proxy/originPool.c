@@ -0,0 +1,219 @@
+#include <originPool.h>
+#include <configuration.h>
+#include <utilities.h>
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+struct idleOrigin {
+	int fd;
+	char *host;
+	unsigned short port;
+	struct sockaddr_storage address;
+	/* Least recently kept first */
+	struct idleOrigin *previous;
+	struct idleOrigin *next;
+};
+
+static void idleRead(struct selector_key *key);
+static void idleTimeout(struct selector_key *key);
+static void idleClose(struct selector_key *key);
+static int isCandidate(const struct sockaddr_storage *address,
+					   struct addrinfo **candidates, unsigned candidateQty);
+static int sameAddress(const struct sockaddr_storage *address,
+					   const struct sockaddr *candidate);
+static int isAlive(int fd);
+static void unlinkIdle(struct idleOrigin *idle);
+
+static const struct fd_handler idleHandler = {
+	.handle_read	= idleRead,
+	.handle_write   = NULL,
+	.handle_close   = idleClose,
+	.handle_block   = NULL,
+	.handle_timeout = idleTimeout,
+};
+
+/* One pool per worker thread, few entries so lookups are linear */
+static __thread struct idleOrigin *oldest = NULL;
+static __thread struct idleOrigin *newest = NULL;
+static __thread unsigned idleQty		  = 0;
+
+int originPoolTake(fd_selector s, const char *host, unsigned short port,
+				   struct addrinfo **candidates, unsigned candidateQty,
+				   struct sockaddr_storage *address) {
+	struct idleOrigin *idle = newest;
+
+	while (idle != NULL) {
+		struct idleOrigin *previous = idle->previous;
+
+		if (idle->port == port && strcasecmp(idle->host, host) == 0 &&
+			isCandidate(&idle->address, candidates, candidateQty)) {
+			int fd	= idle->fd;
+			int alive = isAlive(fd);
+			*address  = idle->address;
+
+			/* Keeps the socket open while it is unregistered */
+			idle->fd = -1;
+			selector_unregister_fd(s, fd);
+
+			if (alive) {
+				return fd;
+			}
+
+			close(fd);
+		}
+
+		idle = previous;
+	}
+
+	return -1;
+}
+
+void originPoolPut(fd_selector s, int fd, const char *host,
+				   unsigned short port, const struct sockaddr_storage *address) {
+	configurationADT config  = getConfiguration();
+	unsigned maxIdle		 = getUpstreamMaxIdle(config);
+	unsigned maxPerOrigin	= getUpstreamMaxPerOrigin(config);
+	struct idleOrigin *idle  = NULL;
+	struct idleOrigin *first = NULL;
+	unsigned sameOrigin		 = 0;
+
+	if (maxIdle == 0 || maxPerOrigin == 0) {
+		close(fd);
+		return;
+	}
+
+	for (idle = oldest; idle != NULL; idle = idle->next) {
+		if (idle->port == port && strcasecmp(idle->host, host) == 0) {
+			if (first == NULL) {
+				first = idle;
+			}
+			sameOrigin++;
+		}
+	}
+
+	/* Unregistering releases the evicted connection */
+	if (sameOrigin >= maxPerOrigin) {
+		selector_unregister_fd(s, first->fd);
+	}
+	else if (idleQty >= maxIdle) {
+		selector_unregister_fd(s, oldest->fd);
+	}
+
+	idle = malloc(sizeof(*idle));
+
+	if (idle == NULL || (idle->host = strdup(host)) == NULL) {
+		free(idle);
+		close(fd);
+		return;
+	}
+
+	idle->fd	  = fd;
+	idle->port	= port;
+	idle->address = *address;
+
+	if (SELECTOR_SUCCESS !=
+		selector_register(s, fd, &idleHandler, OP_READ, idle)) {
+		free(idle->host);
+		free(idle);
+		close(fd);
+		return;
+	}
+
+	idle->previous = newest;
+	idle->next	 = NULL;
+
+	if (newest != NULL) {
+		newest->next = idle;
+	}
+	else {
+		oldest = idle;
+	}
+
+	newest = idle;
+	idleQty++;
+
+	selector_set_timeout(s, fd, getUpstreamIdleTimeout(config));
+}
+
+/* Origin closed the connection or sent something unexpected */
+static void idleRead(struct selector_key *key) {
+	selector_unregister_fd(key->s, key->fd);
+}
+
+static void idleTimeout(struct selector_key *key) {
+	selector_unregister_fd(key->s, key->fd);
+}
+
+static void idleClose(struct selector_key *key) {
+	struct idleOrigin *idle = key->data;
+
+	if (idle->fd != -1) {
+		close(idle->fd);
+	}
+
+	unlinkIdle(idle);
+	free(idle->host);
+	free(idle);
+}
+
+static int isCandidate(const struct sockaddr_storage *address,
+					   struct addrinfo **candidates, unsigned candidateQty) {
+	for (unsigned i = 0; i < candidateQty; i++) {
+		if (sameAddress(address, candidates[i]->ai_addr)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static int sameAddress(const struct sockaddr_storage *address,
+					   const struct sockaddr *candidate) {
+	if (address->ss_family != candidate->sa_family) {
+		return FALSE;
+	}
+
+	switch (candidate->sa_family) {
+		case AF_INET:
+			return memcmp(&((struct sockaddr_in *) address)->sin_addr,
+						  &((struct sockaddr_in *) candidate)->sin_addr,
+						  sizeof(struct in_addr)) == 0;
+		case AF_INET6:
+			return memcmp(&((struct sockaddr_in6 *) address)->sin6_addr,
+						  &((struct sockaddr_in6 *) candidate)->sin6_addr,
+						  sizeof(struct in6_addr)) == 0;
+		default:
+			return FALSE;
+	}
+}
+
+/* The close may not have been noticed by the selector yet */
+static int isAlive(int fd) {
+	uint8_t byte;
+	ssize_t n = recv(fd, &byte, sizeof(byte), MSG_PEEK | MSG_DONTWAIT);
+
+	return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+static void unlinkIdle(struct idleOrigin *idle) {
+	if (idle->previous != NULL) {
+		idle->previous->next = idle->next;
+	}
+	else {
+		oldest = idle->next;
+	}
+
+	if (idle->next != NULL) {
+		idle->next->previous = idle->previous;
+	}
+	else {
+		newest = idle->previous;
+	}
+
+	idleQty--;
+}
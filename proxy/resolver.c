@@ -0,0 +1,525 @@
+#include <resolver.h>
+#include <configuration.h>
+#include <loopClock.h>
+#include <metric.h>
+#include <utilities.h>
+
+#include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define QUEUE_MASK (RESOLVER_QUEUE_SIZE - 1)
+#define BUCKET_MASK (DNS_CACHE_BUCKETS - 1)
+
+enum jobState { JOB_PENDING, JOB_DONE, JOB_CANCELLED };
+
+enum entryState { ENTRY_RESOLVING, ENTRY_READY };
+
+/*
+ * Resolution of a host, shared by every connection to it. The table holds
+ * a reference while the entry is cached and every job holds another one,
+ * so addresses stay valid while a connection uses them even if the entry
+ * expires.
+ */
+struct cacheEntry {
+	struct cacheEntry *next;
+	/* Jobs waiting for the resolution in progress */
+	struct resolverJob *waiters;
+	/* NULL if the name could not be resolved (negative entry) */
+	struct addrinfo *addresses;
+	uint64_t submittedAt;
+	/* Monotonic time (us) when a ready entry stops being used */
+	uint64_t expiresAt;
+	unsigned references;
+	/* enum entryState */
+	int state;
+	int inTable;
+	char host[];
+};
+
+struct resolverJob {
+	fd_selector s;
+	int fd;
+	struct cacheEntry *entry;
+	struct resolverJob *nextWaiter;
+	/* enum jobState, decides who frees the job */
+	int state;
+};
+
+/*
+ * Bounded multi-producer multi-consumer queue (D. Vyukov). Each cell
+ * sequence tells producers and consumers whether it is free or full for
+ * the current lap, so pushing and popping only takes a CAS on the
+ * position. The semaphore only makes idle resolver threads sleep.
+ */
+struct queueCell {
+	uint64_t sequence;
+	struct cacheEntry *entry;
+};
+
+static struct queueCell queue[RESOLVER_QUEUE_SIZE];
+static uint64_t enqueuePosition;
+static uint64_t dequeuePosition;
+static sem_t pendingJobs;
+
+static pthread_t *threads;
+static unsigned threadQty;
+
+/* Host cache, chained hash table guarded by cacheMutex */
+static struct cacheEntry *buckets[DNS_CACHE_BUCKETS];
+static unsigned entryQty;
+static pthread_mutex_t cacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int queuePush(struct cacheEntry *entry);
+static int queuePop(struct cacheEntry **entry);
+static void *resolverRun(void *data);
+static void resolveEntry(struct cacheEntry *entry);
+static struct cacheEntry *lookupEntry(unsigned bucket, const char *host,
+									  uint64_t now);
+static struct cacheEntry *newEntry(unsigned bucket, const char *host,
+								   uint64_t now);
+static void evictEntries(uint64_t now);
+static void releaseEntry(struct cacheEntry *entry);
+static void releaseJob(struct resolverJob *job);
+static int isNameNotFound(int error);
+static unsigned hashHost(const char *host);
+static uint64_t nowMicros(void);
+
+int resolverPoolInit(unsigned threadsToStart) {
+	for (uint64_t i = 0; i < RESOLVER_QUEUE_SIZE; i++) {
+		queue[i].sequence = i;
+	}
+
+	enqueuePosition = 0;
+	dequeuePosition = 0;
+
+	if (sem_init(&pendingJobs, 0, 0) == -1) {
+		return -1;
+	}
+
+	threads = calloc(threadsToStart, sizeof(*threads));
+
+	if (threads == NULL) {
+		return -1;
+	}
+
+	for (threadQty = 0; threadQty < threadsToStart; threadQty++) {
+		if (pthread_create(&threads[threadQty], NULL, resolverRun, NULL) !=
+			0) {
+			resolverPoolDestroy();
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void resolverPoolDestroy(void) {
+	/* A NULL entry tells a resolver thread to finish */
+	for (unsigned i = 0; i < threadQty; i++) {
+		while (!queuePush(NULL)) {
+			sched_yield();
+		}
+		sem_post(&pendingJobs);
+	}
+
+	for (unsigned i = 0; i < threadQty; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	free(threads);
+	threads   = NULL;
+	threadQty = 0;
+	sem_destroy(&pendingJobs);
+
+	for (unsigned i = 0; i < DNS_CACHE_BUCKETS; i++) {
+		while (buckets[i] != NULL) {
+			struct cacheEntry *entry = buckets[i];
+			buckets[i]				 = entry->next;
+			releaseEntry(entry);
+		}
+	}
+
+	entryQty = 0;
+}
+
+resolverJobADT resolverSubmit(fd_selector s, int fd, const char *host) {
+	struct resolverJob *job = malloc(sizeof(*job));
+	uint64_t now			= loopClockMonotonicMicros();
+	unsigned bucket			= hashHost(host);
+	int hit					= TRUE;
+
+	if (job == NULL) {
+		return NULL;
+	}
+
+	job->s			= s;
+	job->fd			= fd;
+	job->nextWaiter = NULL;
+	job->state		= JOB_PENDING;
+
+	pthread_mutex_lock(&cacheMutex);
+
+	struct cacheEntry *entry = lookupEntry(bucket, host, now);
+
+	if (entry == NULL) {
+		entry = newEntry(bucket, host, now);
+		hit   = FALSE;
+
+		/* Pushed with the lock held so nobody joins an entry never queued */
+		if (entry == NULL || !queuePush(entry)) {
+			if (entry != NULL && entry->inTable) {
+				buckets[bucket] = entry->next;
+				entryQty--;
+			}
+			pthread_mutex_unlock(&cacheMutex);
+			free(entry);
+			free(job);
+			return NULL;
+		}
+	}
+
+	__atomic_add_fetch(&entry->references, 1, __ATOMIC_RELAXED);
+	job->entry = entry;
+
+	if (entry->state == ENTRY_READY) {
+		job->state = JOB_DONE;
+	}
+	else {
+		/* Coalesced with the resolution in progress */
+		job->nextWaiter = entry->waiters;
+		entry->waiters  = job;
+	}
+
+	pthread_mutex_unlock(&cacheMutex);
+
+	if (hit) {
+		increaseDnsCacheHits();
+	}
+	else {
+		increaseDnsCacheMisses();
+		increaseDnsQueueDepth();
+		sem_post(&pendingJobs);
+	}
+
+	return job;
+}
+
+int resolverJobIsDone(resolverJobADT job) {
+	return __atomic_load_n(&job->state, __ATOMIC_ACQUIRE) == JOB_DONE ? TRUE :
+																		FALSE;
+}
+
+struct addrinfo *resolverJobAddresses(resolverJobADT job) {
+	return job->entry->addresses;
+}
+
+void resolverJobRelease(resolverJobADT job) {
+	int expected = JOB_PENDING;
+
+	/* If it already finished nobody else is going to free it */
+	if (!__atomic_compare_exchange_n(&job->state, &expected, JOB_CANCELLED,
+									 FALSE, __ATOMIC_ACQ_REL,
+									 __ATOMIC_ACQUIRE)) {
+		releaseJob(job);
+	}
+}
+
+static void *resolverRun(void *data) {
+	struct cacheEntry *entry;
+
+	while (TRUE) {
+		sem_wait(&pendingJobs);
+
+		/* A producer may have taken a position but not yet filled it */
+		while (!queuePop(&entry)) {
+			sched_yield();
+		}
+
+		if (entry == NULL) {
+			break;
+		}
+
+		decreaseDnsQueueDepth();
+		resolveEntry(entry);
+	}
+
+	return NULL;
+}
+
+static void resolveEntry(struct cacheEntry *entry) {
+	struct addrinfo hints;
+	struct addrinfo *addresses = NULL;
+	int error;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags	= AI_PASSIVE;
+
+	error = getaddrinfo(entry->host, NULL, &hints, &addresses);
+	if (error != 0) {
+		addresses = NULL;
+	}
+
+	uint64_t now = nowMicros();
+	uint64_t ttl = getDnsCacheTtl(getConfiguration());
+
+	addDnsResolution(now - entry->submittedAt);
+
+	if (addresses == NULL && !isNameNotFound(error)) {
+		/* A failure that may be transient only answers the waiters */
+		ttl = 0;
+	}
+	else if (addresses == NULL && ttl > DNS_NEGATIVE_TTL) {
+		ttl = DNS_NEGATIVE_TTL;
+	}
+
+	pthread_mutex_lock(&cacheMutex);
+
+	entry->addresses = addresses;
+	entry->expiresAt = now + ttl * 1000000;
+	entry->state	 = ENTRY_READY;
+
+	struct resolverJob *waiter = entry->waiters;
+	entry->waiters			   = NULL;
+
+	pthread_mutex_unlock(&cacheMutex);
+
+	/* The entry may be released together with the last waiter */
+	while (waiter != NULL) {
+		/* The job may be released as soon as it is marked as done */
+		struct resolverJob *next = waiter->nextWaiter;
+		fd_selector s			 = waiter->s;
+		int fd					 = waiter->fd;
+		int expected			 = JOB_PENDING;
+
+		if (__atomic_compare_exchange_n(&waiter->state, &expected, JOB_DONE,
+										FALSE, __ATOMIC_ACQ_REL,
+										__ATOMIC_ACQUIRE)) {
+			selector_notify_block(s, fd);
+		}
+		else {
+			/* Cancelled while it was being resolved */
+			releaseJob(waiter);
+		}
+
+		waiter = next;
+	}
+}
+
+/* Must be called with cacheMutex held, drops expired entries on the way */
+static struct cacheEntry *lookupEntry(unsigned bucket, const char *host,
+									  uint64_t now) {
+	struct cacheEntry **link = &buckets[bucket];
+
+	while (*link != NULL) {
+		struct cacheEntry *entry = *link;
+
+		if (entry->state == ENTRY_READY && entry->expiresAt <= now) {
+			*link		   = entry->next;
+			entry->inTable = FALSE;
+			entryQty--;
+			releaseEntry(entry);
+		}
+		else if (strcasecmp(entry->host, host) == 0) {
+			return entry;
+		}
+		else {
+			link = &entry->next;
+		}
+	}
+
+	return NULL;
+}
+
+/* Must be called with cacheMutex held */
+static struct cacheEntry *newEntry(unsigned bucket, const char *host,
+								   uint64_t now) {
+	size_t hostLength		 = strlen(host) + 1;
+	struct cacheEntry *entry = malloc(sizeof(*entry) + hostLength);
+
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	entry->next		   = NULL;
+	entry->waiters	 = NULL;
+	entry->addresses   = NULL;
+	entry->submittedAt = now;
+	entry->expiresAt   = 0;
+	entry->references  = 0;
+	entry->state	   = ENTRY_RESOLVING;
+	entry->inTable	 = FALSE;
+	memcpy(entry->host, host, hostLength);
+
+	if (entryQty == DNS_CACHE_MAX_ENTRIES) {
+		evictEntries(now);
+	}
+
+	/* If every entry is resolving the resolution is not shared */
+	if (entryQty < DNS_CACHE_MAX_ENTRIES) {
+		entry->next		  = buckets[bucket];
+		entry->inTable	= TRUE;
+		entry->references = 1;
+		buckets[bucket]   = entry;
+		entryQty++;
+	}
+
+	return entry;
+}
+
+/*
+ * Must be called with cacheMutex held. Drops the expired entries, or the
+ * ready one that expires first if none expired. Entries being resolved are
+ * kept.
+ */
+static void evictEntries(uint64_t now) {
+	struct cacheEntry **oldest = NULL;
+	unsigned previousQty	   = entryQty;
+
+	for (unsigned i = 0; i < DNS_CACHE_BUCKETS; i++) {
+		struct cacheEntry **link = &buckets[i];
+
+		while (*link != NULL) {
+			struct cacheEntry *entry = *link;
+
+			if (entry->state != ENTRY_READY) {
+				link = &entry->next;
+			}
+			else if (entry->expiresAt <= now) {
+				*link		   = entry->next;
+				entry->inTable = FALSE;
+				entryQty--;
+				releaseEntry(entry);
+			}
+			else {
+				if (oldest == NULL || entry->expiresAt < (*oldest)->expiresAt) {
+					oldest = link;
+				}
+				link = &entry->next;
+			}
+		}
+	}
+
+	if (entryQty == previousQty && oldest != NULL) {
+		struct cacheEntry *entry = *oldest;
+		*oldest					 = entry->next;
+		entry->inTable			 = FALSE;
+		entryQty--;
+		releaseEntry(entry);
+	}
+}
+
+static void releaseEntry(struct cacheEntry *entry) {
+	if (__atomic_sub_fetch(&entry->references, 1, __ATOMIC_ACQ_REL) == 0) {
+		if (entry->addresses != NULL) {
+			freeaddrinfo(entry->addresses);
+		}
+		free(entry);
+	}
+}
+
+static void releaseJob(struct resolverJob *job) {
+	releaseEntry(job->entry);
+	free(job);
+}
+
+/* Returns TRUE if getaddrinfo failed because the name does not exist */
+static int isNameNotFound(int error) {
+#ifdef EAI_NODATA
+	if (error == EAI_NODATA) {
+		return TRUE;
+	}
+#endif
+	return error == EAI_NONAME ? TRUE : FALSE;
+}
+
+/* FNV-1a, host names are case insensitive */
+static unsigned hashHost(const char *host) {
+	uint32_t hash = 2166136261u;
+
+	for (; *host; host++) {
+		hash ^= (uint8_t) tolower((unsigned char) *host);
+		hash *= 16777619u;
+	}
+
+	return hash & BUCKET_MASK;
+}
+
+static int queuePush(struct cacheEntry *entry) {
+	uint64_t position = __atomic_load_n(&enqueuePosition, __ATOMIC_RELAXED);
+	struct queueCell *cell;
+
+	while (TRUE) {
+		cell			  = &queue[position & QUEUE_MASK];
+		uint64_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+		int64_t diff	  = (int64_t) sequence - (int64_t) position;
+
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&enqueuePosition, &position,
+											position + 1, TRUE,
+											__ATOMIC_RELAXED,
+											__ATOMIC_RELAXED)) {
+				break;
+			}
+		}
+		else if (diff < 0) {
+			/* Full */
+			return FALSE;
+		}
+		else {
+			position = __atomic_load_n(&enqueuePosition, __ATOMIC_RELAXED);
+		}
+	}
+
+	cell->entry = entry;
+	__atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+
+	return TRUE;
+}
+
+static int queuePop(struct cacheEntry **entry) {
+	uint64_t position = __atomic_load_n(&dequeuePosition, __ATOMIC_RELAXED);
+	struct queueCell *cell;
+
+	while (TRUE) {
+		cell			  = &queue[position & QUEUE_MASK];
+		uint64_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+		int64_t diff	  = (int64_t) sequence - (int64_t)(position + 1);
+
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&dequeuePosition, &position,
+											position + 1, TRUE,
+											__ATOMIC_RELAXED,
+											__ATOMIC_RELAXED)) {
+				break;
+			}
+		}
+		else if (diff < 0) {
+			/* Empty */
+			return FALSE;
+		}
+		else {
+			position = __atomic_load_n(&dequeuePosition, __ATOMIC_RELAXED);
+		}
+	}
+
+	*entry = cell->entry;
+	__atomic_store_n(&cell->sequence, position + RESOLVER_QUEUE_SIZE,
+					 __ATOMIC_RELEASE);
+
+	return TRUE;
+}
+
+static uint64_t nowMicros(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -5,6 +5,7 @@
  */
 #include <assert.h> // :)
 #include <errno.h>  // :)
+#include <loopClock.h>
 #include <pthread.h>
 #include <selector.h>
 #include <stdio.h>  // perror
@@ -12,14 +13,35 @@
 #include <string.h> // memset
 
 #include <fcntl.h>
+#include <limits.h> // INT_MAX
 #include <stdint.h> // SIZE_MAX
 #include <sys/select.h>
 #include <sys/signal.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 #define N(x) (sizeof(x) / sizeof((x)[0]))
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#define SELECTOR_HAS_EPOLL
+#define SELECTOR_HAS_EVENTFD
+#endif
+
+/** implementación usada cuando se pide SELECTOR_BACKEND_DEFAULT */
+#ifndef SELECTOR_DEFAULT_BACKEND
+#ifdef SELECTOR_HAS_EPOLL
+#define SELECTOR_DEFAULT_BACKEND SELECTOR_BACKEND_EPOLL
+#else
+#define SELECTOR_DEFAULT_BACKEND SELECTOR_BACKEND_SELECT
+#endif
+#endif
+
+/** cantidad máxima de eventos que se piden a epoll por iteración */
+#define EPOLL_MAX_EVENTS 1024
+
 #define ERROR_DEFAULT_MSG "something failed"
 
 /** retorna una descripción humana del fallo */
@@ -47,6 +69,37 @@ const char *selector_error(const selector_status status) {
 	return msg;
 }
 
+const char *selector_backend_name(const selector_backend backend) {
+	const char *name;
+	switch (backend) {
+		case SELECTOR_BACKEND_SELECT:
+			name = "select";
+			break;
+		case SELECTOR_BACKEND_EPOLL:
+			name = "epoll";
+			break;
+		default:
+			name = selector_backend_name(SELECTOR_DEFAULT_BACKEND);
+	}
+	return name;
+}
+
+int selector_backend_from_name(const char *name, selector_backend *backend) {
+	int ret = 0;
+	if (strcmp(name, "select") == 0) {
+		*backend = SELECTOR_BACKEND_SELECT;
+	}
+#ifdef SELECTOR_HAS_EPOLL
+	else if (strcmp(name, "epoll") == 0) {
+		*backend = SELECTOR_BACKEND_EPOLL;
+	}
+#endif
+	else {
+		ret = -1;
+	}
+	return ret;
+}
+
 static void wake_handler(const int signal) {
 	// nada que hacer. está solo para interrumpir el select
 }
@@ -57,6 +110,9 @@ static sigset_t emptyset, blockset;
 
 selector_status selector_init(const struct selector_init *c) {
 	memcpy(&conf, c, sizeof(conf));
+	if (conf.backend == SELECTOR_BACKEND_DEFAULT) {
+		conf.backend = SELECTOR_DEFAULT_BACKEND;
+	}
 
 	// inicializamos el sistema de comunicación entre threads y el selector
 	// principal. La técnica se encuentra descripta en
@@ -102,6 +158,14 @@ struct item {
 	fd_interest interest;
 	const fd_handler *handler;
 	void *data;
+
+	/** si tiene un timeout armado, y cuándo vence (CLOCK_MONOTONIC en ms) */
+	bool timer_armed;
+	uint64_t deadline;
+	/** casillero de la rueda de timers en el que está el item */
+	int timer_slot;
+	/** lista del casillero. Son índices porque fds se realoca */
+	int timer_prev, timer_next;
 };
 
 /* tarea bloqueante */
@@ -118,6 +182,19 @@ struct blocking_job {
 	struct blocking_job *next;
 };
 
+/**
+ * rueda de timers jerárquica: WHEEL_LEVELS niveles de WHEEL_SLOTS casilleros.
+ * Un casillero del nivel n abarca WHEEL_SLOTS^n ms; al llegar a su comienzo
+ * sus items bajan al nivel que les corresponde según cuánto les falta.
+ * Armar y desarmar un timeout es O(1).
+ */
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+/** casillero extra con los items vencidos que falta despachar */
+#define WHEEL_EXPIRED (WHEEL_LEVELS * WHEEL_SLOTS)
+
 /** marca para usar en item->fd para saber que no está en uso */
 static const int FD_UNUSED = -1;
 
@@ -125,6 +202,11 @@ static const int FD_UNUSED = -1;
 #define ITEM_USED(i) ((FD_UNUSED != (i)->fd))
 
 struct fdselector {
+	/** implementación de multiplexado de este selector */
+	selector_backend backend;
+	/** cantidad máxima de file descriptors que soporta `backend' */
+	size_t max_items;
+
 	// almacenamos en una jump table donde la entrada es el file descriptor.
 	// Asumimos que el espacio de file descriptors no va a ser esparso; pero
 	// esto podría mejorarse utilizando otra estructura de datos
@@ -144,6 +226,15 @@ struct fdselector {
 	/** tambien select() puede cambiar el valor */
 	struct timespec slave_t;
 
+#ifdef SELECTOR_HAS_EPOLL
+	/** instancia de epoll(7), solo con SELECTOR_BACKEND_EPOLL */
+	int epoll_fd;
+	/** eventos listos que retornó la última llamada a epoll_pwait() */
+	struct epoll_event events[EPOLL_MAX_EVENTS];
+	/** cantidad de elementos válidos en `events' */
+	int ready_qty;
+#endif
+
 	// notificaciónes entre blocking jobs y el selector
 	volatile pthread_t selector_thread;
 	/** protege el acceso a resolutions jobs */
@@ -153,19 +244,34 @@ struct fdselector {
 	 * notificados.
 	 */
 	struct blocking_job *resolution_jobs;
+#ifdef SELECTOR_HAS_EVENTFD
+	/**
+	 * eventfd(2) registrado en el propio selector: los trabajos bloqueantes
+	 * lo escriben para despertarlo en vez de enviarle una señal
+	 */
+	int notify_fd;
+#endif
+
+	/** primer item de cada casillero de la rueda, -1 si está vacío */
+	int wheel[WHEEL_EXPIRED + 1];
+	/** bit i del nivel n prendido si el casillero i del nivel n no está vacío */
+	uint64_t wheel_used[WHEEL_LEVELS];
+	/** próximo ms a procesar por la rueda */
+	uint64_t wheel_now;
 };
 
 /** cantidad máxima de file descriptors que la plataforma puede manejar */
 #define ITEMS_MAX_SIZE FD_SETSIZE
 
-// en esta implementación el máximo está dado por el límite natural de
-// select(2).
+// con select(2) el máximo está dado por su límite natural. Con epoll(7) el
+// único límite es el de file descriptors del proceso (RLIMIT_NOFILE).
+#define EPOLL_ITEMS_MAX_SIZE INT_MAX
 
 /**
  * determina el tamaño a crecer, generando algo de slack para no tener
  * que realocar constantemente.
  */
-static size_t next_capacity(const size_t n) {
+static size_t next_capacity(fd_selector s, const size_t n) {
 	unsigned bits = 0;
 	size_t tmp	= n;
 	while (tmp != 0) {
@@ -175,8 +281,8 @@ static size_t next_capacity(const size_t n) {
 	tmp = 1UL << bits;
 
 	assert(tmp >= n);
-	if (tmp > ITEMS_MAX_SIZE) {
-		tmp = ITEMS_MAX_SIZE;
+	if (tmp > s->max_items) {
+		tmp = s->max_items;
 	}
 
 	return tmp + 1;
@@ -186,6 +292,13 @@ static inline void item_init(struct item *item) {
 	item->fd = FD_UNUSED;
 }
 
+/** reloj monotónico en milisegundos, usado para los timeouts */
+static uint64_t monotonic_ms(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
 /**
  * inicializa los nuevos items. `last' es el indice anterior.
  * asume que ya está blanqueada la memoria.
@@ -213,7 +326,67 @@ static int items_max_fd(fd_selector s) {
 	return max;
 }
 
+#ifdef SELECTOR_HAS_EPOLL
+/**
+ * sincroniza el interés de `item' con la instancia de epoll.
+ * `registered' indica si el fd ya fue agregado previamente.
+ *
+ * Un fd sin interés se quita del conjunto: epoll siempre reporta EPOLLERR y
+ * EPOLLHUP, que no se pueden enmascarar, y como nadie lo despacharía
+ * epoll_pwait retornaría en cada iteración. Con select(2) no está en ningún
+ * conjunto. Cuando vuelve a tener interés el MOD falla con ENOENT y se agrega.
+ */
+static selector_status items_update_epoll_for_fd(fd_selector s,
+												 const struct item *item,
+												 const bool registered) {
+	selector_status ret	= SELECTOR_SUCCESS;
+	struct epoll_event ev = {
+		.events  = 0,
+		.data.fd = item->fd,
+	};
+
+	if (item->interest & OP_READ) {
+		ev.events |= EPOLLIN;
+	}
+	if (item->interest & OP_WRITE) {
+		ev.events |= EPOLLOUT;
+	}
+
+	if (ev.events == 0) {
+		// ENOENT: ya estaba fuera del conjunto. EBADF: ya fue cerrado
+		if (registered &&
+			-1 == epoll_ctl(s->epoll_fd, EPOLL_CTL_DEL, item->fd, NULL) &&
+			errno != ENOENT && errno != EBADF) {
+			ret = SELECTOR_IO;
+		}
+		return ret;
+	}
+
+	const int op = registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	if (-1 == epoll_ctl(s->epoll_fd, op, item->fd, &ev)) {
+		if (errno == ENOENT) {
+			if (-1 ==
+				epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, item->fd, &ev)) {
+				ret = SELECTOR_IO;
+			}
+		}
+		else if (errno != EBADF) {
+			// EBADF: el fd ya fue cerrado y el kernel lo quitó del conjunto,
+			// de la misma forma que con select(2) no es un error hasta que
+			// se vuelva a esperar por él.
+			ret = SELECTOR_IO;
+		}
+	}
+
+	return ret;
+}
+#endif
+
 static void items_update_fdset_for_fd(fd_selector s, const struct item *item) {
+	if (s->backend != SELECTOR_BACKEND_SELECT) {
+		return;
+	}
+
 	FD_CLR(item->fd, &s->master_r);
 	FD_CLR(item->fd, &s->master_w);
 
@@ -241,13 +414,13 @@ static selector_status ensure_capacity(fd_selector s, const size_t n) {
 		// nada para hacer, entra...
 		ret = SELECTOR_SUCCESS;
 	}
-	else if (n > ITEMS_MAX_SIZE) {
+	else if (n > s->max_items) {
 		// me estás pidiendo más de lo que se puede.
 		ret = SELECTOR_MAXFD;
 	}
 	else if (NULL == s->fds) {
 		// primera vez.. alocamos
-		const size_t new_size = next_capacity(n);
+		const size_t new_size = next_capacity(s, n);
 
 		s->fds = calloc(new_size, element_size);
 		if (NULL == s->fds) {
@@ -260,7 +433,7 @@ static selector_status ensure_capacity(fd_selector s, const size_t n) {
 	}
 	else {
 		// hay que agrandar...
-		const size_t new_size = next_capacity(n);
+		const size_t new_size = next_capacity(s, n);
 		if (new_size > SIZE_MAX / element_size) { // ver MEM07-C
 			ret = SELECTOR_ENOMEM;
 		}
@@ -282,6 +455,29 @@ static selector_status ensure_capacity(fd_selector s, const size_t n) {
 	return ret;
 }
 
+#ifdef SELECTOR_HAS_EVENTFD
+/** vacía el contador del eventfd, las notificaciones se atienden luego */
+static void notify_fd_read(struct selector_key *key) {
+	uint64_t count;
+	while (read(key->fd, &count, sizeof(count)) > 0) {
+		// nada más que consumir
+	}
+}
+
+static const fd_handler notify_fd_handler = {
+	.handle_read = notify_fd_read,
+};
+
+static selector_status notify_fd_init(fd_selector s) {
+	s->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (s->notify_fd == -1) {
+		return SELECTOR_IO;
+	}
+	return selector_register(s, s->notify_fd, &notify_fd_handler, OP_READ,
+							 NULL);
+}
+#endif
+
 fd_selector selector_new(const size_t initial_elements) {
 	size_t size		= sizeof(struct fdselector);
 	fd_selector ret = malloc(size);
@@ -291,11 +487,41 @@ fd_selector selector_new(const size_t initial_elements) {
 		ret->master_t.tv_nsec = conf.select_timeout.tv_nsec;
 		assert(ret->max_fd == 0);
 		ret->resolution_jobs = 0;
+		for (size_t i = 0; i < N(ret->wheel); i++) {
+			ret->wheel[i] = -1;
+		}
+		ret->wheel_now = monotonic_ms();
 		pthread_mutex_init(&ret->resolution_mutex, 0);
+		ret->backend   = conf.backend == SELECTOR_BACKEND_DEFAULT ?
+							 SELECTOR_DEFAULT_BACKEND :
+							 conf.backend;
+		ret->max_items = ITEMS_MAX_SIZE;
+#ifdef SELECTOR_HAS_EPOLL
+		ret->epoll_fd = -1;
+		if (ret->backend == SELECTOR_BACKEND_EPOLL) {
+			ret->max_items = EPOLL_ITEMS_MAX_SIZE;
+			ret->epoll_fd  = epoll_create1(EPOLL_CLOEXEC);
+			if (ret->epoll_fd == -1) {
+				selector_destroy(ret);
+				return NULL;
+			}
+		}
+#else
+		ret->backend = SELECTOR_BACKEND_SELECT;
+#endif
+#ifdef SELECTOR_HAS_EVENTFD
+		ret->notify_fd = -1;
+#endif
 		if (0 != ensure_capacity(ret, initial_elements)) {
 			selector_destroy(ret);
 			ret = NULL;
 		}
+#ifdef SELECTOR_HAS_EVENTFD
+		else if (SELECTOR_SUCCESS != notify_fd_init(ret)) {
+			selector_destroy(ret);
+			ret = NULL;
+		}
+#endif
 	}
 	return ret;
 }
@@ -319,24 +545,179 @@ void selector_destroy(fd_selector s) {
 			s->fds	 = NULL;
 			s->fd_size = 0;
 		}
+#ifdef SELECTOR_HAS_EPOLL
+		if (s->epoll_fd != -1) {
+			close(s->epoll_fd);
+		}
+#endif
+#ifdef SELECTOR_HAS_EVENTFD
+		if (s->notify_fd != -1) {
+			close(s->notify_fd);
+		}
+#endif
 		free(s);
 	}
 }
 
-#define INVALID_FD(fd) ((fd) < 0 || (fd) >= ITEMS_MAX_SIZE)
+#define INVALID_FD(s, fd) ((fd) < 0 || (size_t)(fd) >= (s)->max_items)
+
+/** agrega el item de `fd' al principio del casillero `slot' */
+static void wheel_push(fd_selector s, const int slot, const int fd) {
+	struct item *item = s->fds + fd;
+
+	item->timer_slot = slot;
+	item->timer_prev = -1;
+	item->timer_next = s->wheel[slot];
+	if (s->wheel[slot] != -1) {
+		s->fds[s->wheel[slot]].timer_prev = fd;
+	}
+	s->wheel[slot] = fd;
+	if (slot != WHEEL_EXPIRED) {
+		s->wheel_used[slot / WHEEL_SLOTS] |= 1ULL << (slot % WHEEL_SLOTS);
+	}
+}
+
+/**
+ * ubica al item de `fd' en el nivel más bajo cuyo alcance cubre lo que falta
+ * para su vencimiento. Si vence más allá de lo que abarca la rueda queda en
+ * el último casillero alcanzable y se reubica al llegar a él.
+ */
+static void wheel_place(fd_selector s, const int fd) {
+	uint64_t when = s->fds[fd].deadline;
+	unsigned level = 0;
+
+	if (when < s->wheel_now) {
+		when = s->wheel_now;
+	}
+	while (level < WHEEL_LEVELS - 1 &&
+		   when - s->wheel_now >= 1ULL << (WHEEL_BITS * (level + 1))) {
+		level++;
+	}
+	if (when - s->wheel_now >= 1ULL << (WHEEL_BITS * WHEEL_LEVELS)) {
+		when = s->wheel_now + (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+	}
+
+	wheel_push(s, level * WHEEL_SLOTS +
+					  ((when >> (WHEEL_BITS * level)) & WHEEL_MASK),
+			   fd);
+}
+
+/** quita a `item' de la rueda de timers */
+static void timer_unlink(fd_selector s, struct item *item) {
+	if (!item->timer_armed) {
+		return;
+	}
+	const int slot = item->timer_slot;
+	if (item->timer_prev != -1) {
+		s->fds[item->timer_prev].timer_next = item->timer_next;
+	}
+	else {
+		s->wheel[slot] = item->timer_next;
+		if (item->timer_next == -1 && slot != WHEEL_EXPIRED) {
+			s->wheel_used[slot / WHEEL_SLOTS] &= ~(1ULL << (slot % WHEEL_SLOTS));
+		}
+	}
+	if (item->timer_next != -1) {
+		s->fds[item->timer_next].timer_prev = item->timer_prev;
+	}
+	item->timer_armed = false;
+}
+
+/**
+ * próximo ms en el que hay que procesar un casillero no vacío: el vencimiento
+ * de uno del nivel 0 o el comienzo de uno de un nivel superior. Se obtiene de
+ * los bitmaps de ocupación sin recorrer los items.
+ * UINT64_MAX si no hay timeouts armados.
+ */
+static uint64_t wheel_next_tick(fd_selector s) {
+	uint64_t next = UINT64_MAX;
+
+	for (unsigned level = 0; level < WHEEL_LEVELS; level++) {
+		uint64_t used = s->wheel_used[level];
+		if (used == 0) {
+			continue;
+		}
+		const unsigned shift  = WHEEL_BITS * level;
+		const uint64_t base   = s->wheel_now >> shift;
+		const unsigned offset = base & WHEEL_MASK;
+		unsigned k;
+
+		// rotamos para que el bit 0 sea el casillero de `wheel_now'
+		if (offset != 0) {
+			used = (used >> offset) | (used << (WHEEL_SLOTS - offset));
+		}
+		if ((s->wheel_now & ((1ULL << shift) - 1)) != 0) {
+			// el casillero actual ya se bajó, lo que tenga es de la vuelta
+			// siguiente
+			used &= ~1ULL;
+			k = used == 0 ? WHEEL_SLOTS : (unsigned) __builtin_ctzll(used);
+		}
+		else {
+			k = __builtin_ctzll(used);
+		}
+		if (((base + k) << shift) < next) {
+			next = (base + k) << shift;
+		}
+	}
+
+	return next;
+}
+
+/** vacía el casillero `slot' y reubica sus items */
+static void wheel_cascade(fd_selector s, const int slot) {
+	int fd = s->wheel[slot];
+
+	s->wheel[slot] = -1;
+	s->wheel_used[slot / WHEEL_SLOTS] &= ~(1ULL << (slot % WHEEL_SLOTS));
+	while (fd != -1) {
+		const int next = s->fds[fd].timer_next;
+		if (slot < WHEEL_SLOTS) {
+			wheel_push(s, WHEEL_EXPIRED, fd);
+		}
+		else {
+			wheel_place(s, fd);
+		}
+		fd = next;
+	}
+}
+
+/**
+ * avanza la rueda hasta `now', saltando directamente entre los casilleros no
+ * vacíos. Los items vencidos quedan en el casillero WHEEL_EXPIRED.
+ */
+static void wheel_advance(fd_selector s, const uint64_t now) {
+	while (s->wheel_now <= now) {
+		const uint64_t tick = wheel_next_tick(s);
+		if (tick > now) {
+			s->wheel_now = now + 1;
+			break;
+		}
+
+		s->wheel_now = tick;
+		for (unsigned level = WHEEL_LEVELS - 1; level > 0; level--) {
+			const unsigned shift = WHEEL_BITS * level;
+			if ((tick & ((1ULL << shift) - 1)) == 0) {
+				wheel_cascade(s, level * WHEEL_SLOTS +
+									 ((tick >> shift) & WHEEL_MASK));
+			}
+		}
+		wheel_cascade(s, tick & WHEEL_MASK);
+		s->wheel_now = tick + 1;
+	}
+}
 
 selector_status selector_register(fd_selector s, const int fd,
 								  const fd_handler *handler,
 								  const fd_interest interest, void *data) {
 	selector_status ret = SELECTOR_SUCCESS;
 	// 0. validación de argumentos
-	if (s == NULL || INVALID_FD(fd) || handler == NULL) {
+	if (s == NULL || INVALID_FD(s, fd) || handler == NULL) {
 		ret = SELECTOR_IARGS;
 		goto finally;
 	}
 	// 1. tenemos espacio?
 	size_t ufd = (size_t) fd;
-	if (ufd > s->fd_size) {
+	if (ufd >= s->fd_size) {
 		ret = ensure_capacity(s, ufd);
 		if (SELECTOR_SUCCESS != ret) {
 			goto finally;
@@ -360,6 +741,15 @@ selector_status selector_register(fd_selector s, const int fd,
 			s->max_fd = fd;
 		}
 		items_update_fdset_for_fd(s, item);
+#ifdef SELECTOR_HAS_EPOLL
+		if (s->backend == SELECTOR_BACKEND_EPOLL) {
+			ret = items_update_epoll_for_fd(s, item, false);
+			if (SELECTOR_SUCCESS != ret) {
+				memset(item, 0x00, sizeof(*item));
+				item_init(item);
+			}
+		}
+#endif
 	}
 
 finally:
@@ -369,7 +759,7 @@ finally:
 selector_status selector_unregister_fd(fd_selector s, const int fd) {
 	selector_status ret = SELECTOR_SUCCESS;
 
-	if (NULL == s || INVALID_FD(fd)) {
+	if (NULL == s || INVALID_FD(s, fd) || (size_t) fd >= s->fd_size) {
 		ret = SELECTOR_IARGS;
 		goto finally;
 	}
@@ -390,7 +780,15 @@ selector_status selector_unregister_fd(fd_selector s, const int fd) {
 	}
 
 	item->interest = OP_NOOP;
+	timer_unlink(s, item);
 	items_update_fdset_for_fd(s, item);
+#ifdef SELECTOR_HAS_EPOLL
+	if (s->backend == SELECTOR_BACKEND_EPOLL) {
+		// puede fallar si el fd ya fue cerrado, en ese caso el kernel ya lo
+		// quitó del conjunto
+		epoll_ctl(s->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+	}
+#endif
 
 	memset(item, 0x00, sizeof(*item));
 	item_init(item);
@@ -403,7 +801,7 @@ finally:
 selector_status selector_set_interest(fd_selector s, int fd, fd_interest i) {
 	selector_status ret = SELECTOR_SUCCESS;
 
-	if (NULL == s || INVALID_FD(fd)) {
+	if (NULL == s || INVALID_FD(s, fd) || (size_t) fd >= s->fd_size) {
 		ret = SELECTOR_IARGS;
 		goto finally;
 	}
@@ -414,8 +812,18 @@ selector_status selector_set_interest(fd_selector s, int fd, fd_interest i) {
 		goto finally;
 	}
 
+	if (item->interest == i) {
+		// nada cambió, evitamos la syscall en epoll
+		goto finally;
+	}
+
 	item->interest = i;
 	items_update_fdset_for_fd(s, item);
+#ifdef SELECTOR_HAS_EPOLL
+	if (s->backend == SELECTOR_BACKEND_EPOLL) {
+		ret = items_update_epoll_for_fd(s, item, true);
+	}
+#endif
 finally:
 	return ret;
 }
@@ -424,7 +832,7 @@ selector_status selector_set_interest_key(struct selector_key *key,
 										  fd_interest i) {
 	selector_status ret;
 
-	if (NULL == key || NULL == key->s || INVALID_FD(key->fd)) {
+	if (NULL == key || NULL == key->s || INVALID_FD(key->s, key->fd)) {
 		ret = SELECTOR_IARGS;
 	}
 	else {
@@ -473,6 +881,84 @@ static void handle_iteration(fd_selector s) {
 	}
 }
 
+selector_status selector_set_timeout(fd_selector s, const int fd,
+									 const unsigned ms) {
+	selector_status ret = SELECTOR_SUCCESS;
+
+	if (NULL == s || INVALID_FD(s, fd) || (size_t) fd >= s->fd_size) {
+		ret = SELECTOR_IARGS;
+		goto finally;
+	}
+
+	struct item *item = s->fds + fd;
+	if (!ITEM_USED(item) || item->handler->handle_timeout == NULL) {
+		ret = SELECTOR_IARGS;
+		goto finally;
+	}
+
+	timer_unlink(s, item);
+	// el reloj de la iteración alcanza para la resolución de la rueda
+	item->deadline	= loopClockMonotonicMillis() + ms;
+	item->timer_armed = true;
+	wheel_place(s, fd);
+
+finally:
+	return ret;
+}
+
+selector_status selector_clear_timeout(fd_selector s, const int fd) {
+	selector_status ret = SELECTOR_SUCCESS;
+
+	if (NULL == s || INVALID_FD(s, fd) || (size_t) fd >= s->fd_size) {
+		ret = SELECTOR_IARGS;
+	}
+	else {
+		timer_unlink(s, s->fds + fd);
+	}
+
+	return ret;
+}
+
+/**
+ * tiempo máximo de bloqueo de la próxima espera: el timeout del selector o
+ * lo que falta para el próximo casillero de la rueda de timers.
+ */
+static void wait_timeout(fd_selector s, struct timespec *timeout) {
+	memcpy(timeout, &s->master_t, sizeof(*timeout));
+
+	const uint64_t next = wheel_next_tick(s);
+	if (next == UINT64_MAX) {
+		return;
+	}
+
+	const uint64_t now  = monotonic_ms();
+	const uint64_t wait = next > now ? next - now : 0;
+	if (wait < (uint64_t) timeout->tv_sec * 1000 + timeout->tv_nsec / 1000000) {
+		timeout->tv_sec  = wait / 1000;
+		timeout->tv_nsec = (wait % 1000) * 1000000;
+	}
+}
+
+/**
+ * despacha los timeouts vencidos. Un handler puede armar, desarmar o
+ * desregistrar otros items, incluso alguno de los vencidos, por eso se toma
+ * siempre el primero del casillero.
+ */
+static void handle_timeouts(fd_selector s) {
+	struct selector_key key = {
+		.s = s,
+	};
+
+	wheel_advance(s, loopClockMonotonicMillis());
+	while (s->wheel[WHEEL_EXPIRED] != -1) {
+		struct item *item = s->fds + s->wheel[WHEEL_EXPIRED];
+		timer_unlink(s, item);
+		key.fd   = item->fd;
+		key.data = item->data;
+		item->handler->handle_timeout(&key);
+	}
+}
+
 static void handle_block_notifications(fd_selector s) {
 	struct selector_key key = {
 		.s = s,
@@ -514,23 +1000,121 @@ selector_status selector_notify_block(fd_selector s, const int fd) {
 	pthread_mutex_unlock(&s->resolution_mutex);
 
 	// notificamos al hilo principal
+#ifdef SELECTOR_HAS_EVENTFD
+	const uint64_t one = 1;
+	if (write(s->notify_fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+		ret = SELECTOR_IO;
+	}
+#else
 	pthread_kill(s->selector_thread, conf.signal);
+#endif
+
+finally:
+	return ret;
+}
+
+#ifdef SELECTOR_HAS_EPOLL
+/**
+ * igual a handle_iteration pero solo recorre los descriptores que epoll
+ * reportó como listos.
+ */
+static void handle_iteration_epoll(fd_selector s) {
+	struct selector_key key = {
+		.s = s,
+	};
+
+	for (int i = 0; i < s->ready_qty; i++) {
+		const int fd	  = s->events[i].data.fd;
+		const uint32_t ev = s->events[i].events;
+		// un error o hangup se reporta como listo para leer y escribir, igual
+		// que lo hace select(2)
+		const bool readable = ev & (EPOLLIN | EPOLLERR | EPOLLHUP);
+		const bool writable = ev & (EPOLLOUT | EPOLLERR | EPOLLHUP);
+
+		if ((size_t) fd >= s->fd_size) {
+			continue;
+		}
+		struct item *item = s->fds + fd;
+		// un handler anterior de esta iteración pudo haberlo desregistrado
+		if (!ITEM_USED(item)) {
+			continue;
+		}
+		key.fd   = item->fd;
+		key.data = item->data;
+		if (readable && (OP_READ & item->interest)) {
+			if (0 == item->handler->handle_read) {
+				assert(("OP_READ arrived but no handler. bug!" == 0));
+			}
+			else {
+				item->handler->handle_read(&key);
+			}
+		}
+		if (writable && ITEM_USED(item) && (OP_WRITE & item->interest)) {
+			key.data = item->data;
+			if (0 == item->handler->handle_write) {
+				assert(("OP_WRITE arrived but no handler. bug!" == 0));
+			}
+			else {
+				item->handler->handle_write(&key);
+			}
+		}
+	}
+}
+
+static selector_status selector_select_epoll(fd_selector s) {
+	selector_status ret = SELECTOR_SUCCESS;
+
+	wait_timeout(s, &s->slave_t);
+	const int timeout = s->slave_t.tv_sec * 1000 + s->slave_t.tv_nsec / 1000000;
 
+	s->selector_thread = pthread_self();
+	s->ready_qty	   = 0;
+
+	int fds = epoll_pwait(s->epoll_fd, s->events, EPOLL_MAX_EVENTS, timeout,
+						  &emptyset);
+	// una lectura del reloj para todos los handlers de esta iteración
+	loopClockUpdate();
+	if (-1 == fds) {
+		switch (errno) {
+			case EAGAIN:
+			case EINTR:
+				// si una señal nos interrumpio. ok!
+				break;
+			default:
+				ret = SELECTOR_IO;
+				goto finally;
+		}
+	}
+	else {
+		s->ready_qty = fds;
+		handle_iteration_epoll(s);
+	}
+	handle_timeouts(s);
+	handle_block_notifications(s);
 finally:
 	return ret;
 }
+#endif
 
 selector_status selector_select(fd_selector s) {
 	selector_status ret = SELECTOR_SUCCESS;
 
+#ifdef SELECTOR_HAS_EPOLL
+	if (s->backend == SELECTOR_BACKEND_EPOLL) {
+		return selector_select_epoll(s);
+	}
+#endif
+
 	memcpy(&s->slave_r, &s->master_r, sizeof(s->slave_r));
 	memcpy(&s->slave_w, &s->master_w, sizeof(s->slave_w));
-	memcpy(&s->slave_t, &s->master_t, sizeof(s->slave_t));
+	wait_timeout(s, &s->slave_t);
 
 	s->selector_thread = pthread_self();
 
 	int fds = pselect(s->max_fd + 1, &s->slave_r, &s->slave_w, 0, &s->slave_t,
 					  &emptyset);
+	// una lectura del reloj para todos los handlers de esta iteración
+	loopClockUpdate();
 	if (-1 == fds) {
 		switch (errno) {
 			case EAGAIN:
@@ -559,6 +1143,7 @@ selector_status selector_select(fd_selector s) {
 		handle_iteration(s);
 	}
 	if (ret == SELECTOR_SUCCESS) {
+		handle_timeouts(s);
 		handle_block_notifications(s);
 	}
 finally:
@@ -580,5 +1165,15 @@ int selector_fd_set_nio(const int fd) {
 }
 
 int IsFdSet(int fd, fd_selector s) {
+#ifdef SELECTOR_HAS_EPOLL
+	if (s->backend == SELECTOR_BACKEND_EPOLL) {
+		for (int i = 0; i < s->ready_qty; i++) {
+			if (s->events[i].data.fd == fd) {
+				return (s->events[i].events & EPOLLIN) != 0;
+			}
+		}
+		return 0;
+	}
+#endif
 	return FD_ISSET(fd, &s->slave_r);
 }
@@ -0,0 +1,106 @@
+#include <slabPool.h>
+#include <configuration.h>
+#include <loopClock.h>
+#include <metric.h>
+
+#include <stdlib.h>
+
+static time_t now(void) {
+	return loopClockMonotonicMillis() / 1000;
+}
+
+/* Takes the first free object, the pool can not be empty */
+static void *pop(struct slabPool *pool) {
+	void *object = pool->free;
+
+	pool->free = *(void **) object;
+	pool->size--;
+	if (pool->size < pool->idle) {
+		pool->idle = pool->size;
+	}
+	if (pool->isMeasured) {
+		decreasePoolSize(1);
+	}
+	return object;
+}
+
+static void push(struct slabPool *pool, void *object) {
+	*(void **) object = pool->free;
+	pool->free		  = object;
+	pool->size++;
+	if (pool->isMeasured) {
+		increasePoolSize(1);
+	}
+}
+
+void *slabPoolGet(struct slabPool *pool) {
+	if (pool->free == NULL) {
+		if (pool->isMeasured) {
+			increasePoolMisses();
+		}
+		return malloc(pool->objectSize);
+	}
+
+	if (pool->isMeasured) {
+		increasePoolHits();
+	}
+	return pop(pool);
+}
+
+void slabPoolPut(struct slabPool *pool, void *object) {
+	if (pool->size >= getPoolHighWatermark(getConfiguration())) {
+		free(object);
+		return;
+	}
+
+	push(pool, object);
+}
+
+int slabPoolFill(struct slabPool *pool) {
+	unsigned low = getPoolLowWatermark(getConfiguration());
+	void *object;
+
+	while (pool->size < low) {
+		if ((object = malloc(pool->objectSize)) == NULL) {
+			return -1;
+		}
+		push(pool, object);
+	}
+
+	pool->idle	   = pool->size;
+	pool->lastTrim = now();
+	return 0;
+}
+
+void slabPoolTrim(struct slabPool *pool) {
+	unsigned low  = getPoolLowWatermark(getConfiguration());
+	unsigned high = getPoolHighWatermark(getConfiguration());
+	unsigned keep;
+	time_t current = now();
+
+	if (current - pool->lastTrim < SLAB_POOL_TRIM_INTERVAL) {
+		return;
+	}
+
+	// The objects used since the last trim are kept, the others can go
+	keep = pool->size - pool->idle;
+	if (keep < low) {
+		keep = low;
+	}
+	if (keep > high) {
+		keep = high;
+	}
+
+	while (pool->size > keep) {
+		free(pop(pool));
+	}
+
+	pool->idle	   = pool->size;
+	pool->lastTrim = current;
+}
+
+void slabPoolDestroy(struct slabPool *pool) {
+	while (pool->free != NULL) {
+		free(pop(pool));
+	}
+}
@@ -0,0 +1,106 @@
+/* splice(2) and F_SETPIPE_SZ are GNU extensions */
+#define _GNU_SOURCE
+#include <spliceRelay.h>
+#include <utilities.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#define RELAY_HAS_SPLICE
+#endif
+
+void spliceRelayInit(struct spliceRelay *relay) {
+	relay->pipe[0]  = -1;
+	relay->pipe[1]  = -1;
+	relay->buffered = 0;
+	relay->capacity = 0;
+}
+
+int spliceRelayOpen(struct spliceRelay *relay) {
+#ifdef RELAY_HAS_SPLICE
+	int size;
+
+	if (relay->pipe[0] != -1) {
+		return 0;
+	}
+
+	if (pipe2(relay->pipe, O_NONBLOCK | O_CLOEXEC) == -1) {
+		relay->pipe[0] = relay->pipe[1] = -1;
+		return -1;
+	}
+
+	/* A bigger pipe means less wake ups per byte */
+	fcntl(relay->pipe[1], F_SETPIPE_SZ, SPLICE_PIPE_SIZE);
+	size = fcntl(relay->pipe[1], F_GETPIPE_SZ);
+
+	relay->buffered = 0;
+	relay->capacity = size > 0 ? (size_t) size : 0;
+
+	if (relay->capacity == 0) {
+		spliceRelayClose(relay);
+		return -1;
+	}
+
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+int spliceRelayIsOpen(struct spliceRelay *relay) {
+	return relay->pipe[0] != -1;
+}
+
+int spliceRelayCanFill(struct spliceRelay *relay) {
+	return relay->buffered < relay->capacity;
+}
+
+ssize_t spliceRelayFill(struct spliceRelay *relay, int fd, size_t max) {
+#ifdef RELAY_HAS_SPLICE
+	size_t space = relay->capacity - relay->buffered;
+	ssize_t n;
+
+	if (max > space) {
+		max = space;
+	}
+
+	n = splice(fd, NULL, relay->pipe[1], NULL, max,
+			   SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+	if (n > 0) {
+		relay->buffered += n;
+	}
+
+	return n;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+ssize_t spliceRelayDrain(struct spliceRelay *relay, int fd) {
+#ifdef RELAY_HAS_SPLICE
+	ssize_t n = splice(relay->pipe[0], NULL, fd, NULL, relay->buffered,
+					   SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+	if (n > 0) {
+		relay->buffered -= n;
+	}
+
+	return n;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+void spliceRelayClose(struct spliceRelay *relay) {
+	if (relay->pipe[0] != -1) {
+		close(relay->pipe[0]);
+		close(relay->pipe[1]);
+	}
+
+	spliceRelayInit(relay);
+}
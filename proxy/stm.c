@@ -78,7 +78,9 @@ unsigned stm_handler_block(struct state_machine *stm,
 						   struct selector_key *key) {
 	handle_first(stm, key);
 	if (stm->current->on_block_ready == 0) {
-		abort();
+		// la notificación llegó tarde: el trabajo era de un dueño anterior
+		// del fd o el estado ya no la espera. No hay transición
+		return stm->current->state;
 	}
 	const unsigned int ret = stm->current->on_block_ready(key);
 	jump(stm, ret, key);
@@ -86,6 +88,20 @@ unsigned stm_handler_block(struct state_machine *stm,
 	return ret;
 }
 
+unsigned stm_handler_timeout(struct state_machine *stm,
+							 struct selector_key *key) {
+	handle_first(stm, key);
+	if (stm->current->on_timeout == 0) {
+		// el estado no espera timeouts, puede haber vencido uno armado por
+		// un estado anterior: no hay transición
+		return stm->current->state;
+	}
+	const unsigned int ret = stm->current->on_timeout(key);
+	jump(stm, ret, key);
+
+	return ret;
+}
+
 void stm_handler_close(struct state_machine *stm, struct selector_key *key) {
 	if (stm->current != NULL && stm->current->on_departure != NULL) {
 		stm->current->on_departure(stm->current->state, key);
@@ -15,7 +15,7 @@ static enum targetState portTransition(struct targetParser *parser, char l);
 static enum targetState startPortTransition(struct targetParser *parser,
 											char l);
 
-void parseTargetInit(struct targetParser *parser) {
+void parseTargetInit(struct targetParser *parser, struct arena *arena) {
 	parser->state		   = START_T;
 	parser->charactersRead = 0;
 	parser->host		   = NULL;
@@ -23,12 +23,7 @@ void parseTargetInit(struct targetParser *parser) {
 	parser->target		   = NULL;
 	parser->sizeTarget	 = 0;
 	parser->port		   = PORT_DEFAULT;
-}
-
-void parseTargetDestroy(struct targetParser *parser) {
-	if (parser->target != NULL) {
-		free(parser->target);
-	}
+	parser->arena		   = arena;
 }
 
 int parseTargetChar(struct targetParser *parser, char l) {
@@ -37,13 +32,14 @@ int parseTargetChar(struct targetParser *parser, char l) {
 
 	if (l == ' ') {
 		parser->state = END_T;
-		parser->target =
-			addCharToString(parser->target, &parser->sizeTarget, '\0');
-		parser->host = addCharToString(parser->host, &parser->sizeHost, '\0');
+		parser->target = arenaAddChar(parser->arena, parser->target,
+									  &parser->sizeTarget, '\0');
+		parser->host =
+			arenaAddChar(parser->arena, parser->host, &parser->sizeHost, '\0');
 	}
 	else {
-		parser->target =
-			addCharToString(parser->target, &parser->sizeTarget, l);
+		parser->target = arenaAddChar(parser->arena, parser->target,
+									  &parser->sizeTarget, l);
 	}
 	switch (parser->state) {
 		case START_T:
@@ -104,7 +100,6 @@ enum targetState startTTransition(struct targetParser *parser, char l) {
 	enum targetState state;
 	if (l == '/') {
 		state = A_AUTH;
-		free(parser->host);
 		parser->host	 = NULL;
 		parser->sizeHost = 0;
 	}
@@ -113,7 +108,8 @@ enum targetState startTTransition(struct targetParser *parser, char l) {
 	}
 	else {
 		state		 = START_T;
-		parser->host = addCharToString(parser->host, &parser->sizeHost, l);
+		parser->host =
+			arenaAddChar(parser->arena, parser->host, &parser->sizeHost, l);
 	}
 	return state;
 }
@@ -126,13 +122,11 @@ enum targetState aAuthOrASchemaTransition(struct targetParser *parser, char l) {
 	}
 	else if (l == '/') {
 		state = BAR_A_SCHEMA;
-		free(parser->host);
 		parser->host	 = NULL;
 		parser->sizeHost = 0;
 	}
 	else {
 		state = A_AUTH;
-		free(parser->host);
 		parser->host	 = NULL;
 		parser->sizeHost = 0;
 	}
@@ -157,7 +151,6 @@ enum targetState DBarASchemaTransition(struct targetParser *parser, char l) {
 	}
 	else if (l == '@') {
 		state = A_USERINFO;
-		free(parser->host);
 		parser->host	 = NULL;
 		parser->sizeHost = 0;
 	}
@@ -166,7 +159,8 @@ enum targetState DBarASchemaTransition(struct targetParser *parser, char l) {
 	}
 	else {
 		state		 = D_BAR_A_SCHEMA;
-		parser->host = addCharToString(parser->host, &parser->sizeHost, l);
+		parser->host =
+			arenaAddChar(parser->arena, parser->host, &parser->sizeHost, l);
 	}
 	return state;
 }
@@ -181,7 +175,8 @@ enum targetState AUserinfoTransition(struct targetParser *parser, char l) {
 	}
 	else {
 		state		 = A_USERINFO;
-		parser->host = addCharToString(parser->host, &parser->sizeHost, l);
+		parser->host =
+			arenaAddChar(parser->arena, parser->host, &parser->sizeHost, l);
 	}
 	return state;
 }
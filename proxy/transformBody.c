@@ -5,36 +5,155 @@
 #include <configuration.h>
 #include <handleParsers.h>
 #include <http.h>
+#include <transformerPool.h>
+#include <transformPlugin.h>
 #include <signal.h>
-#include <wait.h>
 #include <stdio.h>
 #include <errno.h>
 #include <logger.h>
-
-static int getLength(buffer *buffer);
+#include <unistd.h>
+
+/*
+ * Restarts the transform timeout on the client fd, data is moving
+ */
+static void armTransformTimer(struct selector_key *key);
+
+/*
+ * Lets the transform command know the body ended: closes its stdin or, if
+ * it is pooled, sends the empty frame. Returns -1 on error.
+ */
+static int finishTransformInput(struct selector_key *key);
+
+/*
+ * Writes to the transform command, framed if it is pooled
+ */
+static ssize_t writeTransformInput(struct transformBody *transformBody,
+								   const uint8_t *data, size_t size);
+
+/*
+ * Reads from the transform command, without the framing if it is pooled
+ */
+static ssize_t readTransformOutput(struct transformBody *transformBody,
+								   uint8_t *data, size_t size);
+
+/*
+ * Loads the plugin selected by the command and starts the body on it
+ */
+static int startTransformPlugin(struct selector_key *key);
+
+/*
+ * Runs the plugin over the body read from origin while its output can be
+ * framed, and sets the interests
+ */
+static unsigned runTransformPlugin(struct selector_key *key);
+
+/*
+ * Sets the interest of a transform command pipe, unless it was closed
+ */
+static selector_status setTransformInterest(fd_selector s, int fd,
+											fd_interest interest);
 
 void transformBodyInit(const unsigned state, struct selector_key *key) {
 	signal(SIGPIPE, SIG_IGN);
 	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
 	unchunkParserInit(&(transformBody->unchunkParser), key);
 	buffer_reset(getReadBuffer(GET_DATA(key)));
-	int length = getLength(getReadBuffer(GET_DATA(key)));
-	initializeChunkedBuffer(transformBody, length);
-	transformBody->transformSelectors = FALSE;
+	chunkWriterInit(&transformBody->chunkWriter);
+	transformBody->transformSelectors  = FALSE;
+	transformBody->transformer		   = NULL;
+	transformBody->writeToTransformFd  = -1;
+	transformBody->readFromTransformFd = -1;
+	transformBody->inputFinished	   = FALSE;
+	transformBody->plugin			   = NULL;
+	transformBody->loadedPlugin		   = NULL;
+	transformBody->pluginState		   = NULL;
 
 	if (getTransformContent(GET_DATA(key))) {
-		transformBody->commandStatus = executeTransformCommand(key);
+		TransformCommandPtr_t command = getCommand(getConfiguration());
+
+		startLatency(GET_DATA(key), TRANSFORM_LATENCY);
+		if (isTransformPlugin(getCommandLine(command))) {
+			increaseTransformUses(PLUGIN_TRANSFORM_USE);
+			transformBody->commandStatus = startTransformPlugin(key);
+		}
+		else {
+			increaseTransformUses(COMMAND_TRANSFORM_USE);
+			transformBody->commandStatus = executeTransformCommand(key);
+		}
+		releaseCommand(command);
 	}
 	transformBody->transformCommandExecuted = FALSE;
 	transformBody->transformFinished		= FALSE;
 	transformBody->responseFinished			= FALSE;
-	transformBody->lastChunkSent			= FALSE;
+	armTransformTimer(key);
+}
+
+unsigned transformBodyTimeout(struct selector_key *key) {
+	increaseDeadlineExpiries();
+	return ERROR;
 }
 
 void transformBodyDestroy(const unsigned state, struct selector_key *key) {
 	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
-	if (transformBody->chunkedData != NULL) {
-		free(transformBody->chunkedData);
+	struct transformer *transformer		= transformBody->transformer;
+	int fds[] = {transformBody->writeToTransformFd,
+				 transformBody->readFromTransformFd};
+
+	stopLatency(GET_DATA(key), TRANSFORM_LATENCY);
+	if (transformBody->pluginState != NULL) {
+		transformBody->plugin->destroy(transformBody->pluginState);
+		transformBody->pluginState = NULL;
+	}
+	// The plugin may be unloaded from now on
+	transformPluginRelease(transformBody->loadedPlugin);
+	transformBody->loadedPlugin = NULL;
+	transformBody->plugin		= NULL;
+
+	if (!transformBody->transformSelectors) {
+		return;
+	}
+
+	transformBody->transformSelectors  = FALSE;
+	transformBody->transformer		   = NULL;
+	transformBody->writeToTransformFd  = -1;
+	transformBody->readFromTransformFd = -1;
+
+	// Unregistering releases the references the pipes kept
+	for (unsigned i = 0; i < SIZE_OF_ARRAY(fds); i++) {
+		if (fds[i] != -1) {
+			selector_unregister_fd(key->s, fds[i]);
+			if (transformer == NULL) {
+				close(fds[i]);
+			}
+		}
+	}
+
+	// A command that ran once exits by itself once it read the whole body,
+	// it is killed if it was left in the middle of one
+	if (transformer == NULL) {
+		transformerStop(transformBody->commandPid,
+						!(transformBody->inputFinished &&
+						  transformBody->transformFinished));
+		return;
+	}
+
+	// A pooled command left in the middle of a body can not be reused
+	if (transformBody->inputFinished && transformBody->transformFinished) {
+		transformerPoolPut(key->s, transformer);
+	}
+	else {
+		transformerPoolDiscard(transformer);
+	}
+}
+
+static void armTransformTimer(struct selector_key *key) {
+	unsigned timeout = getTransformTimeout(getConfiguration());
+
+	if (timeout == 0) {
+		selector_clear_timeout(key->s, getClientFd(GET_DATA(key)));
+	}
+	else {
+		selector_set_timeout(key->s, getClientFd(GET_DATA(key)), timeout);
 	}
 }
 
@@ -43,14 +162,10 @@ unsigned transformBodyRead(struct selector_key *key) {
 	struct transformBody *transformBody = getTransformBodyState(state);
 	unsigned ret;
 
-	if (transformBody->chunkedData == NULL) {
-		setErrorDoneFd(key);
-		logError("Cannot allocate memory", CUSTOM_ERROR);
-		ret = ERROR;
-	}
-	else if (!getTransformContent(state) ||
-			 transformBody->commandStatus != TRANSFORM_COMMAND_OK ||
-			 !transformBody->transformSelectors) {
+	armTransformTimer(key);
+
+	if (!getTransformContent(state) ||
+			 transformBody->commandStatus != TRANSFORM_COMMAND_OK) {
 		if (getIsChunked(state)) {
 			ret = standardOriginReadWithoutChunked(key);
 		}
@@ -58,6 +173,9 @@ unsigned transformBodyRead(struct selector_key *key) {
 			ret = standardOriginRead(key);
 		}
 	}
+	else if (transformBody->plugin != NULL) {
+		ret = pluginOriginRead(key);
+	}
 	else if (key->fd == transformBody->readFromTransformFd) {
 		ret = readFromTransform(key);
 	}
@@ -77,18 +195,19 @@ unsigned transformBodyWrite(struct selector_key *key) {
 	struct transformBody *transformBody = getTransformBodyState(state);
 	unsigned ret;
 
-	if (transformBody->chunkedData == NULL) {
-		setErrorDoneFd(key);
-		logError("Cannot allocate memory", CUSTOM_ERROR);
-		ret = ERROR;
-	}
-	else if (!getTransformContent(state) ||
-			 transformBody->commandStatus != TRANSFORM_COMMAND_OK ||
-			 !transformBody->transformSelectors) {
+	armTransformTimer(key);
+
+	if (!getTransformContent(state) ||
+			 transformBody->commandStatus != TRANSFORM_COMMAND_OK) {
 		if (getIsChunked(state)) {
 			ret = standardClientWriteWithoutChunked(key);
 		}
-		ret = standardClientWrite(key);
+		else {
+			ret = standardClientWrite(key);
+		}
+	}
+	else if (transformBody->plugin != NULL) {
+		ret = pluginClientWrite(key);
 	}
 	else if (key->fd == transformBody->writeToTransformFd) {
 		if (getIsChunked(state)) {
@@ -109,21 +228,80 @@ unsigned transformBodyWrite(struct selector_key *key) {
 	return ret;
 }
 
+unsigned pluginOriginRead(struct selector_key *key) {
+	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
+	buffer *writeBuffer					= getWriteBuffer(GET_DATA(key));
+	uint8_t *pointer;
+	size_t count;
+	ssize_t bytesRead;
+
+	// If there is no space to read, the plugin must consume what was read
+	if (!buffer_can_write(writeBuffer)) {
+		return runTransformPlugin(key);
+	}
+
+	pointer   = buffer_write_ptr(writeBuffer, &count);
+	bytesRead = recv(key->fd, pointer, count, 0);
+
+	if (bytesRead > 0) {
+		buffer_write_adv(writeBuffer, bytesRead);
+	}
+	else if (bytesRead == 0) {
+		transformBody->responseFinished = TRUE;
+	}
+	else {
+		setErrorDoneFd(key);
+		logError("", SYS_ERROR);
+		return ERROR;
+	}
+
+	return runTransformPlugin(key);
+}
+
+unsigned pluginClientWrite(struct selector_key *key) {
+	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
+	struct chunkWriter *chunkWriter		= &transformBody->chunkWriter;
+	ssize_t bytesSent;
+
+	// If every chunk was sent
+	if (!chunkWriterHasData(chunkWriter)) {
+		return runTransformPlugin(key);
+	}
+
+	bytesSent = chunkWriterSend(chunkWriter, key->fd);
+
+	if (bytesSent <= 0) {
+		setErrorDoneFd(key);
+		logError("", SYS_ERROR);
+		return ERROR;
+	}
+	addBytesToClient(GET_DATA(key), bytesSent);
+
+	// The last chunk is added when the plugin finished the body
+	if (transformBody->transformFinished && !chunkWriterHasData(chunkWriter)) {
+		setErrorDoneFd(key);
+		return DONE;
+	}
+
+	return runTransformPlugin(key);
+}
+
 unsigned standardOriginRead(struct selector_key *key) {
 	buffer *inBuffer					= getWriteBuffer(GET_DATA(key));
 	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
-	buffer *chunkBuffer					= &transformBody->chunkedBuffer;
+	struct chunkWriter *chunkWriter		= &transformBody->chunkWriter;
 	uint8_t *pointer;
 	size_t count;
 	ssize_t bytesRead;
 	unsigned ret;
-	if (!buffer_can_write(inBuffer) && buffer_can_read(inBuffer) &&
-		buffer_can_write(chunkBuffer)) {
-		prepareChunkedBuffer(chunkBuffer, inBuffer);
+
+	// The data of the previous chunk is still in the buffer until it is sent
+	if (chunkWriterHasData(chunkWriter)) {
 		return setStandardFdInterests(key);
 	}
 	// If there is no space to read, it should write what it already read
 	else if (!buffer_can_write(inBuffer)) {
+		chunkWriterPrepare(chunkWriter, inBuffer);
 		return setStandardFdInterests(key);
 	}
 
@@ -132,18 +310,13 @@ unsigned standardOriginRead(struct selector_key *key) {
 
 	if (bytesRead > 0) {
 		buffer_write_adv(inBuffer, bytesRead);
-		prepareChunkedBuffer(chunkBuffer, inBuffer);
+		chunkWriterPrepare(chunkWriter, inBuffer);
 		ret = setStandardFdInterests(key);
 	}
 	else if (bytesRead == 0) {
 		transformBody->responseFinished = TRUE;
-
-		if (!buffer_can_read(inBuffer)) {
-			sentLastChunked(chunkBuffer);
-		}
-		else {
-			prepareChunkedBuffer(chunkBuffer, inBuffer);
-		}
+		chunkWriterPrepare(chunkWriter, inBuffer);
+		chunkWriterFinish(chunkWriter);
 		ret = setStandardFdInterests(key);
 	}
 	else {
@@ -191,27 +364,35 @@ unsigned standardOriginReadWithoutChunked(struct selector_key *key) {
 unsigned readFromTransform(struct selector_key *key) {
 	buffer *inbuffer					= getReadBuffer(GET_DATA(key));
 	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
-	buffer *chunkBuffer					= &transformBody->chunkedBuffer;
+	struct chunkWriter *chunkWriter		= &transformBody->chunkWriter;
 	uint8_t *pointer;
 	size_t count;
 	ssize_t bytesRead;
 	unsigned ret;
 
-	// If there is no space to read, it should write what it already read
-	if (!buffer_can_write(inbuffer)) {
+	// If there is no space to read, or the previous chunk was not sent yet, it
+	// should write what it already read
+	if (!buffer_can_write(inbuffer) || chunkWriterHasData(chunkWriter)) {
 		return setFdInterestsWithTransformerCommand(key);
 	}
 
 	pointer   = buffer_write_ptr(inbuffer, &count);
-	bytesRead = read(key->fd, pointer, count);
+	bytesRead = readTransformOutput(transformBody, pointer, count);
 
 	if (bytesRead > 0) {
 		buffer_write_adv(inbuffer, bytesRead);
-		prepareChunkedBuffer(chunkBuffer, inbuffer);
+		chunkWriterPrepare(chunkWriter, inbuffer);
 		ret = setFdInterestsWithTransformerCommand(key);
 	}
 	else if (bytesRead == 0) {
+		// Everything the transform command outputs was read, the last chunk
+		// goes after it
 		transformBody->transformFinished = TRUE;
+		chunkWriterFinish(chunkWriter);
+		ret = setFdInterestsWithTransformerCommand(key);
+	}
+	else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+		// Only part of a frame length arrived
 		ret = setFdInterestsWithTransformerCommand(key);
 	}
 	else {
@@ -220,14 +401,6 @@ unsigned readFromTransform(struct selector_key *key) {
 		ret = ERROR;
 	}
 
-	if (transformBody->transformFinished && !buffer_can_read(chunkBuffer)) {
-		// We read and sent everything that transform command outputs so we sent
-		// last chunked
-		sentLastChunked(chunkBuffer);
-		transformBody->lastChunkSent = TRUE;
-		ret = setFdInterestsWithTransformerCommand(key);
-	}
-
 	return ret;
 }
 
@@ -253,8 +426,12 @@ unsigned readFromOrigin(struct selector_key *key) {
 	}
 	else if (bytesRead == 0) {
 		transformBody->responseFinished = TRUE;
-		if (!buffer_can_read(writeBuffer)) {
-			close(transformBody->writeToTransformFd);
+		if (!buffer_can_read(writeBuffer) &&
+			!buffer_can_read(&transformBody->unchunkParser.unchunkedBuffer) &&
+			finishTransformInput(key) == -1) {
+			setErrorDoneFd(key);
+			logError("", SYS_ERROR);
+			return ERROR;
 		}
 		ret = setFdInterestsWithTransformerCommand(key);
 	}
@@ -269,28 +446,24 @@ unsigned readFromOrigin(struct selector_key *key) {
 
 unsigned standardClientWrite(struct selector_key *key) {
 	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
-	buffer *writeBuffer					= &transformBody->chunkedBuffer;
+	struct chunkWriter *chunkWriter		= &transformBody->chunkWriter;
 	unsigned ret						= TRANSFORM_BODY;
-	uint8_t *pointer;
-	size_t count;
-	ssize_t bytesRead;
+	ssize_t bytesSent;
 
-	// If everything is read on buffer
-	if (!buffer_can_read(writeBuffer)) {
+	// Everything read from origin is framed already, the last chunk goes next
+	if (transformBody->responseFinished) {
+		chunkWriterFinish(chunkWriter);
+	}
+
+	// If every chunk was sent
+	if (!chunkWriterHasData(chunkWriter)) {
 		return setStandardFdInterests(key);
 	}
 
-	pointer   = buffer_read_ptr(writeBuffer, &count);
-	bytesRead = send(key->fd, pointer, count, 0);
+	bytesSent = chunkWriterSend(chunkWriter, key->fd);
 
-	if (bytesRead > 0) {
-		buffer_read_adv(writeBuffer, bytesRead);
-		if (!buffer_can_read(writeBuffer) && transformBody->responseFinished &&
-			!transformBody->lastChunkSent) {
-			transformBody->lastChunkSent = TRUE;
-			sentLastChunked(writeBuffer);
-		}
-		increaseTransferBytes(bytesRead);
+	if (bytesSent > 0) {
+		addBytesToClient(GET_DATA(key), bytesSent);
 		ret = setStandardFdInterests(key);
 	}
 	else {
@@ -299,7 +472,7 @@ unsigned standardClientWrite(struct selector_key *key) {
 		ret = ERROR;
 	}
 
-	if (transformBody->responseFinished && !buffer_can_read(writeBuffer)) {
+	if (transformBody->responseFinished && !chunkWriterHasData(chunkWriter)) {
 		setErrorDoneFd(key);
 		ret = DONE;
 	}
@@ -325,7 +498,7 @@ unsigned standardClientWriteWithoutChunked(struct selector_key *key) {
 
 	if (bytesRead > 0) {
 		buffer_read_adv(writeBuffer, bytesRead);
-		increaseTransferBytes(bytesRead);
+		addBytesToClient(GET_DATA(key), bytesRead);
 		ret = setStandardFdInterestsWithoutChunked(key);
 	}
 	else {
@@ -345,7 +518,6 @@ unsigned standardClientWriteWithoutChunked(struct selector_key *key) {
 unsigned writeToTransform(struct selector_key *key) {
 	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
 	buffer *inbuffer					= getWriteBuffer(GET_DATA(key));
-	buffer *chunkBuffer					= &transformBody->chunkedBuffer;
 	unsigned ret						= TRANSFORM_BODY;
 	uint8_t *pointer;
 	size_t count;
@@ -353,39 +525,36 @@ unsigned writeToTransform(struct selector_key *key) {
 
 	// If everything is read on buffer
 	if (!buffer_can_read(inbuffer)) {
+		if (transformBody->responseFinished &&
+			finishTransformInput(key) == -1) {
+			setErrorDoneFd(key);
+			logError("", SYS_ERROR);
+			return ERROR;
+		}
 		return setFdInterestsWithTransformerCommand(key);
 	}
 
 	pointer   = buffer_read_ptr(inbuffer, &count);
-	bytesRead = write(key->fd, pointer, count);
+	bytesRead = writeTransformInput(transformBody, pointer, count);
 
-	if (bytesRead > 0) {
+	if (bytesRead >= 0) {
 		if (transformBody->transformCommandExecuted == FALSE) {
 			transformBody->transformCommandExecuted = TRUE;
 		}
 		buffer_read_adv(inbuffer, bytesRead);
-		if (!buffer_can_read(inbuffer) && transformBody->responseFinished) {
-			close(transformBody->writeToTransformFd);
-		}
 		ret = setFdInterestsWithTransformerCommand(key);
 	}
 	else if (transformBody->transformCommandExecuted == TRUE) {
 		setErrorDoneFd(key);
-		sentLastChunked(chunkBuffer);
 		logError("", SYS_ERROR);
 		ret = ERROR;
 	}
 	else {
 		transformBody->commandStatus = EXEC_ERROR;
-		prepareChunkedBuffer(chunkBuffer, inbuffer);
+		chunkWriterPrepare(&transformBody->chunkWriter, inbuffer);
 		ret = setStandardFdInterests(key);
 	}
 
-	if (transformBody->responseFinished && !buffer_can_read(inbuffer)) {
-		// Closing pipe so that transform command finishes
-		close(transformBody->writeToTransformFd);
-	}
-
 	return ret;
 }
 
@@ -393,7 +562,6 @@ unsigned writeToTransformChunked(struct selector_key *key) {
 	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
 	struct unchunkParser *unchunkParser = &transformBody->unchunkParser;
 	buffer *inbuffer					= getWriteBuffer(GET_DATA(key));
-	buffer *chunkBuffer					= &transformBody->chunkedBuffer;
 	buffer *unchunkData					= &unchunkParser->unchunkedBuffer;
 	unsigned ret						= TRANSFORM_BODY;
 	uint8_t *pointer;
@@ -402,20 +570,23 @@ unsigned writeToTransformChunked(struct selector_key *key) {
 	parseChunkedInfo(unchunkParser, inbuffer);
 	// if everything is read on buffer
 	if (!buffer_can_read(unchunkData)) {
+		if (transformBody->responseFinished && !buffer_can_read(inbuffer) &&
+			finishTransformInput(key) == -1) {
+			setErrorDoneFd(key);
+			logError("", SYS_ERROR);
+			return ERROR;
+		}
 		return setFdInterestsWithTransformerCommand(key);
 	}
 
 	pointer   = buffer_read_ptr(unchunkData, &count);
-	bytesRead = write(key->fd, pointer, count);
+	bytesRead = writeTransformInput(transformBody, pointer, count);
 
-	if (bytesRead > 0) {
+	if (bytesRead >= 0) {
 		if (transformBody->transformCommandExecuted == FALSE) {
 			transformBody->transformCommandExecuted = TRUE;
 		}
 		buffer_read_adv(unchunkData, bytesRead);
-		if (!buffer_can_read(unchunkData) && transformBody->responseFinished) {
-			close(transformBody->writeToTransformFd);
-		}
 		ret = setFdInterestsWithTransformerCommand(key);
 	}
 	else if (transformBody->transformCommandExecuted == TRUE) {
@@ -425,37 +596,28 @@ unsigned writeToTransformChunked(struct selector_key *key) {
 	}
 	else {
 		transformBody->commandStatus = EXEC_ERROR;
-		prepareChunkedBuffer(chunkBuffer, unchunkData);
+		chunkWriterPrepare(&transformBody->chunkWriter, unchunkData);
 		ret = setStandardFdInterests(key);
 	}
 
-	if (transformBody->responseFinished && !buffer_can_read(inbuffer)) {
-		// closing pipe so that transform command finishes
-		close(transformBody->writeToTransformFd);
-	}
-
 	return ret;
 }
 
 unsigned writeToClient(struct selector_key *key) {
 	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
-	buffer *buffer						= &transformBody->chunkedBuffer;
+	struct chunkWriter *chunkWriter		= &transformBody->chunkWriter;
 	unsigned ret						= TRANSFORM_BODY;
-	uint8_t *pointer;
-	size_t count;
-	ssize_t bytesRead;
+	ssize_t bytesSent;
 
-	// If everything is read on buffer
-	if (!buffer_can_read(buffer)) {
+	// If every chunk was sent
+	if (!chunkWriterHasData(chunkWriter)) {
 		return setFdInterestsWithTransformerCommand(key);
 	}
 
-	pointer   = buffer_read_ptr(buffer, &count);
-	bytesRead = send(key->fd, pointer, count, 0);
+	bytesSent = chunkWriterSend(chunkWriter, key->fd);
 
-	if (bytesRead > 0) {
-		buffer_read_adv(buffer, bytesRead);
-		increaseTransferBytes(bytesRead);
+	if (bytesSent > 0) {
+		addBytesToClient(GET_DATA(key), bytesSent);
 		ret = setFdInterestsWithTransformerCommand(key);
 	}
 	else {
@@ -464,16 +626,15 @@ unsigned writeToClient(struct selector_key *key) {
 		ret = ERROR;
 	}
 
-	if (transformBody->transformFinished && !buffer_can_read(buffer)) {
-		if (!transformBody->lastChunkSent) {
-			sentLastChunked(buffer);
-		}
+	// The last chunk is added when the transform command output ends
+	if (transformBody->transformFinished && !chunkWriterHasData(chunkWriter)) {
 		setErrorDoneFd(key);
 		ret = DONE;
 	}
 
 	return ret;
 }
+
 unsigned setStandardFdInterestsWithoutChunked(struct selector_key *key) {
 	httpADT_t state						= GET_DATA(key);
 	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
@@ -501,12 +662,12 @@ unsigned setStandardFdInterestsWithoutChunked(struct selector_key *key) {
 	}
 
 	if (transformBody->transformSelectors) {
-		if (SELECTOR_SUCCESS != selector_set_interest(
+		if (SELECTOR_SUCCESS != setTransformInterest(
 									key->s, transformBody->readFromTransformFd,
 									transformReadInterest) ||
-			SELECTOR_SUCCESS !=
-				selector_set_interest(key->s, transformBody->writeToTransformFd,
-									  transformWriteInterest)) {
+			SELECTOR_SUCCESS != setTransformInterest(
+									key->s, transformBody->writeToTransformFd,
+									transformWriteInterest)) {
 			return ERROR;
 		}
 	}
@@ -517,8 +678,7 @@ unsigned setStandardFdInterestsWithoutChunked(struct selector_key *key) {
 unsigned setStandardFdInterests(struct selector_key *key) {
 	httpADT_t state						= GET_DATA(key);
 	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
-	buffer *writeBuffer					= getWriteBuffer(GET_DATA(key));
-	buffer *chunkBuffer					= &transformBody->chunkedBuffer;
+	struct chunkWriter *chunkWriter		= &transformBody->chunkWriter;
 
 	unsigned ret			   = TRANSFORM_BODY;
 	int clientInterest		   = OP_NOOP;
@@ -526,13 +686,11 @@ unsigned setStandardFdInterests(struct selector_key *key) {
 	int transformReadInterest  = OP_NOOP;
 	int transformWriteInterest = OP_NOOP;
 
-	if (buffer_can_read(chunkBuffer)) {
+	if (chunkWriterHasData(chunkWriter)) {
 		clientInterest |= OP_WRITE;
 	}
-
-	if ((buffer_can_write(writeBuffer) || buffer_can_read(writeBuffer)) &&
-		buffer_can_write(chunkBuffer) && !buffer_can_read(chunkBuffer) &&
-		!transformBody->responseFinished) {
+	// The data of the chunk being sent is still in the buffer
+	else if (!transformBody->responseFinished) {
 		originInterest |= OP_READ;
 	}
 
@@ -544,12 +702,12 @@ unsigned setStandardFdInterests(struct selector_key *key) {
 	}
 
 	if (transformBody->transformSelectors) {
-		if (SELECTOR_SUCCESS != selector_set_interest(
+		if (SELECTOR_SUCCESS != setTransformInterest(
 									key->s, transformBody->readFromTransformFd,
 									transformReadInterest) ||
-			SELECTOR_SUCCESS !=
-				selector_set_interest(key->s, transformBody->writeToTransformFd,
-									  transformWriteInterest)) {
+			SELECTOR_SUCCESS != setTransformInterest(
+									key->s, transformBody->writeToTransformFd,
+									transformWriteInterest)) {
 			return ERROR;
 		}
 	}
@@ -562,7 +720,7 @@ unsigned setFdInterestsWithTransformerCommand(struct selector_key *key) {
 	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
 	buffer *readBuffer					= getReadBuffer(GET_DATA(key));
 	buffer *writeBuffer					= getWriteBuffer(GET_DATA(key));
-	buffer *chunkBuffer					= &transformBody->chunkedBuffer;
+	struct chunkWriter *chunkWriter		= &transformBody->chunkWriter;
 	buffer *unchunkBuffer = &transformBody->unchunkParser.unchunkedBuffer;
 
 	unsigned ret			   = TRANSFORM_BODY;
@@ -582,16 +740,22 @@ unsigned setFdInterestsWithTransformerCommand(struct selector_key *key) {
 		}
 	}
 
-	if (buffer_can_read(chunkBuffer)) {
+	// The end of the body is still to be sent to a pooled command
+	if (transformBody->responseFinished && !transformBody->inputFinished) {
+		transformWriteInterest |= OP_WRITE;
+	}
+
+	if (chunkWriterHasData(chunkWriter)) {
 		clientInterest |= OP_WRITE;
 	}
 
-	if (buffer_can_write(readBuffer) && !transformBody->transformFinished) {
+	if (buffer_can_write(readBuffer) && !chunkWriterHasData(chunkWriter) &&
+		!transformBody->transformFinished) {
 		transformReadInterest |= OP_READ;
 	}
 
 	if (buffer_can_write(writeBuffer) && !transformBody->responseFinished &&
-		!buffer_can_read(chunkBuffer) && !buffer_can_read(writeBuffer)) {
+		!chunkWriterHasData(chunkWriter) && !buffer_can_read(writeBuffer)) {
 		originInterest |= OP_READ;
 	}
 
@@ -600,11 +764,11 @@ unsigned setFdInterestsWithTransformerCommand(struct selector_key *key) {
 		SELECTOR_SUCCESS !=
 			selector_set_interest(key->s, getOriginFd(state), originInterest) ||
 		SELECTOR_SUCCESS !=
-			selector_set_interest(key->s, transformBody->readFromTransformFd,
-								  transformReadInterest) ||
+			setTransformInterest(key->s, transformBody->readFromTransformFd,
+								 transformReadInterest) ||
 		SELECTOR_SUCCESS !=
-			selector_set_interest(key->s, transformBody->writeToTransformFd,
-								  transformWriteInterest)) {
+			setTransformInterest(key->s, transformBody->writeToTransformFd,
+								 transformWriteInterest)) {
 		return ERROR;
 	}
 
@@ -617,6 +781,33 @@ unsigned setFdInterestsWithTransformerCommand(struct selector_key *key) {
 	return ret;
 }
 
+unsigned setFdInterestsWithPlugin(struct selector_key *key) {
+	httpADT_t state						= GET_DATA(key);
+	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
+	buffer *writeBuffer					= getWriteBuffer(GET_DATA(key));
+	struct chunkWriter *chunkWriter		= &transformBody->chunkWriter;
+
+	int clientInterest = OP_NOOP;
+	int originInterest = OP_NOOP;
+
+	if (chunkWriterHasData(chunkWriter)) {
+		clientInterest |= OP_WRITE;
+	}
+
+	if (buffer_can_write(writeBuffer) && !transformBody->responseFinished) {
+		originInterest |= OP_READ;
+	}
+
+	if (SELECTOR_SUCCESS !=
+			selector_set_interest(key->s, getClientFd(state), clientInterest) ||
+		SELECTOR_SUCCESS !=
+			selector_set_interest(key->s, getOriginFd(state), originInterest)) {
+		return ERROR;
+	}
+
+	return TRANSFORM_BODY;
+}
+
 unsigned setErrorDoneFd(struct selector_key *key) {
 	httpADT_t state						= GET_DATA(key);
 	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
@@ -634,12 +825,12 @@ unsigned setErrorDoneFd(struct selector_key *key) {
 		return ERROR;
 	}
 	if (transformBody->transformSelectors) {
-		if (SELECTOR_SUCCESS != selector_set_interest(
+		if (SELECTOR_SUCCESS != setTransformInterest(
 									key->s, transformBody->readFromTransformFd,
 									transformReadInterest) ||
-			SELECTOR_SUCCESS !=
-				selector_set_interest(key->s, transformBody->writeToTransformFd,
-									  transformWriteInterest)) {
+			SELECTOR_SUCCESS != setTransformInterest(
+									key->s, transformBody->writeToTransformFd,
+									transformWriteInterest)) {
 			return ERROR;
 		}
 	}
@@ -650,112 +841,207 @@ unsigned setErrorDoneFd(struct selector_key *key) {
 int executeTransformCommand(struct selector_key *key) {
 	httpADT_t state						= GET_DATA(key);
 	struct transformBody *transformBody = getTransformBodyState(state);
-	int inputPipe[]						= {-1, -1};
-	int outputPipe[]					= {-1, -1};
-	int errorFd =
-		open(getCommandStderrPath(getConfiguration()), OP_WRITE | OP_READ);
-	char *commandPath = getCommand(getConfiguration());
-	pid_t commandPid;
-
-	if (pipe(inputPipe) == -1 || pipe(outputPipe) == -1) {
-		return PIPE_CREATION_ERROR;
+	struct transformer *transformer		= NULL;
+	TransformCommandPtr_t command		= getCommand(getConfiguration());
+	const char *commandPath				= getCommandLine(command);
+	int toFd, fromFd;
+
+	// A pooled command is used if one is idle, otherwise it runs once
+	transformer = transformerPoolTake(key->s, commandPath);
+	if (transformer != NULL) {
+		transformBody->commandPid = transformer->pid;
+		toFd					  = transformer->toFd;
+		fromFd					  = transformer->fromFd;
+	}
+	else {
+		transformBody->commandPid = transformerSpawn(
+			commandPath, FALSE, getCommandStderrFd(getConfiguration()), &toFd,
+			&fromFd);
 	}
+	releaseCommand(command);
 
-	commandPid = fork();
-	if (commandPid == -1) {
+	if (transformBody->commandPid == -1) {
 		return FORK_ERROR;
 	}
-	else if (commandPid == 0) {
-		dup2(inputPipe[0], 0);  // Setting pipe as stdin
-		dup2(outputPipe[1], 1); // Setting pipe as stdout
-		dup2(errorFd, 2);		// Setting errorFd as stderr
-		close(inputPipe[1]);	// Closing write end of input pipe
-		close(outputPipe[0]);   // Closing read end of output pipe
-
-		putenv("HTTPD_VERSION=1.0.0");
-		if (execl("/bin/sh", "sh", "-c", commandPath, (char *) 0) == -1) {
-			// closing other pipes end
-			printf("In son\n");
-			close(inputPipe[0]);
-			close(outputPipe[1]);
-			fprintf(stderr, "Exec error finishing\n");
-			exit(-1);
-		}
+
+	if (SELECTOR_SUCCESS !=
+		selector_register(key->s, toFd, getHttpHandler(), OP_WRITE, state)) {
+		goto fail;
+	}
+	if (SELECTOR_SUCCESS !=
+		selector_register(key->s, fromFd, getHttpHandler(), OP_READ, state)) {
+		selector_unregister_fd(key->s, toFd);
+		goto fail;
+	}
+
+	// Each pipe keeps a reference until transformBodyDestroy unregisters it
+	incrementReferences(state);
+	incrementReferences(state);
+
+	transformBody->transformer		   = transformer;
+	transformBody->writeToTransformFd  = toFd;
+	transformBody->readFromTransformFd = fromFd;
+	transformBody->transformSelectors  = TRUE;
+
+	return TRANSFORM_COMMAND_OK;
+
+fail:
+	if (transformer != NULL) {
+		transformerPoolDiscard(transformer);
 	}
 	else {
-		// In father process
-		close(inputPipe[0]);  // closing read end of input pipe
-		close(outputPipe[1]); // closing write end of output pipe
-		if (selector_fd_set_nio(inputPipe[1]) == -1 ||
-			selector_fd_set_nio(outputPipe[0]) == -1) {
-			return NONBLOCKING_ERROR;
+		close(toFd);
+		close(fromFd);
+		transformerStop(transformBody->commandPid, TRUE);
+	}
+	return SELECT_ERROR;
+}
+
+static int startTransformPlugin(struct selector_key *key) {
+	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
+	TransformCommandPtr_t command		= getCommand(getConfiguration());
+	struct loadedPlugin *loaded;
+	const struct httpdPlugin *plugin;
+	const char *arguments;
+
+	// The arguments point into the command line, kept until init is done
+	loaded = transformPluginLoad(getCommandLine(command), &arguments);
+	if (loaded == NULL) {
+		releaseCommand(command);
+		return EXEC_ERROR;
+	}
+
+	// Released by transformBodyDestroy, even if the body does not start
+	transformBody->loadedPlugin = loaded;
+	plugin						= transformPluginGet(loaded);
+	transformBody->pluginState	= plugin->init(arguments);
+	releaseCommand(command);
+	if (transformBody->pluginState == NULL) {
+		logError("The plugin could not start the body", CUSTOM_ERROR);
+		return EXEC_ERROR;
+	}
+
+	transformBody->plugin = plugin;
+	return TRANSFORM_COMMAND_OK;
+}
+
+static unsigned runTransformPlugin(struct selector_key *key) {
+	httpADT_t state						= GET_DATA(key);
+	struct transformBody *transformBody = getTransformBodyState(state);
+	const struct httpdPlugin *plugin	= transformBody->plugin;
+	struct chunkWriter *chunkWriter		= &transformBody->chunkWriter;
+	buffer *readBuffer					= getReadBuffer(state);
+	buffer *input						= getWriteBuffer(state);
+	size_t inLength, outLength, consumed, produced;
+	uint8_t *in, *out;
+	int status;
+
+	if (getIsChunked(state)) {
+		input = &transformBody->unchunkParser.unchunkedBuffer;
+	}
+
+	// The output is left in the read buffer until its chunk is sent, the
+	// plugin runs again once it is
+	while (!chunkWriterHasData(chunkWriter) &&
+		   !transformBody->transformFinished) {
+		if (getIsChunked(state)) {
+			parseChunkedInfo(&transformBody->unchunkParser,
+							 getWriteBuffer(state));
 		}
 
-		int status = 0;
+		out		 = buffer_write_ptr(readBuffer, &outLength);
+		inLength = 0;
+		consumed = 0;
+		produced = 0;
 
-		if (waitpid(commandPid, &status, WNOHANG) == commandPid) {
-			return EXEC_ERROR;
+		if (buffer_can_read(input)) {
+			in	   = buffer_read_ptr(input, &inLength);
+			status = plugin->process(transformBody->pluginState, in, inLength,
+									 &consumed, out, outLength, &produced);
+		}
+		else if (transformBody->responseFinished) {
+			status = plugin->finish(transformBody->pluginState, out,
+									outLength, &produced);
+			if (status == HTTPD_PLUGIN_OK) {
+				transformBody->transformFinished = TRUE;
+			}
+		}
+		else {
+			break;
 		}
 
-		transformBody->commandPid		   = commandPid;
-		transformBody->writeToTransformFd  = inputPipe[1];
-		transformBody->readFromTransformFd = outputPipe[0];
-
-		if (SELECTOR_SUCCESS != selector_register(key->s, inputPipe[1],
-												  getHttpHandler(), OP_WRITE,
-												  state) ||
-			SELECTOR_SUCCESS != selector_register(key->s, outputPipe[0],
-												  getHttpHandler(), OP_READ,
-												  state)) {
-			return SELECT_ERROR;
+		// A plugin that does not move data would never finish the body
+		if (status == HTTPD_PLUGIN_ERROR || produced > outLength ||
+			consumed > inLength ||
+			(consumed == 0 && produced == 0 &&
+			 !transformBody->transformFinished)) {
+			setErrorDoneFd(key);
+			logError("The plugin failed transforming the body", CUSTOM_ERROR);
+			return ERROR;
 		}
 
-		transformBody->transformSelectors = TRUE;
-		incrementReferences(state);
-		incrementReferences(state);
+		buffer_read_adv(input, consumed);
+		buffer_write_adv(readBuffer, produced);
+		chunkWriterPrepare(chunkWriter, readBuffer);
 	}
-	return TRANSFORM_COMMAND_OK;
-}
 
-static int getLength(buffer *buffer) {
-	int bufferLength = buffer->limit - buffer->write;
-	int digits		 = getDigits(bufferLength, 10);
+	if (transformBody->transformFinished) {
+		chunkWriterFinish(chunkWriter);
+	}
 
-	return digits + bufferLength + LIMITATING_CHARS;
+	return setFdInterestsWithPlugin(key);
 }
 
-void initializeChunkedBuffer(struct transformBody *transformBody, int length) {
-	transformBody->chunkedData = malloc(sizeof(char) * length);
-	if (transformBody->chunkedData != NULL) {
-		buffer_init(&transformBody->chunkedBuffer, length,
-					transformBody->chunkedData);
+static int finishTransformInput(struct selector_key *key) {
+	struct transformBody *transformBody = getTransformBodyState(GET_DATA(key));
+	int fd								= transformBody->writeToTransformFd;
+	int ret;
+
+	if (transformBody->inputFinished || fd == -1) {
+		return 0;
+	}
+
+	if (transformBody->transformer != NULL) {
+		ret = transformerWriteEnd(transformBody->transformer);
+		if (ret == -1) {
+			return -1;
+		}
+		transformBody->inputFinished = ret;
+		return 0;
 	}
+
+	// Closing pipe so that transform command finishes
+	transformBody->writeToTransformFd = -1;
+	transformBody->inputFinished	  = TRUE;
+	selector_unregister_fd(key->s, fd);
+	close(fd);
+
+	return 0;
 }
 
-void prepareChunkedBuffer(buffer *chunkBuffer, buffer *inbuffer) {
-	size_t count, bytes;
-	uint8_t *writePointer, *readPointer;
-	writePointer = buffer_write_ptr(inbuffer, &count);
-	readPointer  = buffer_read_ptr(inbuffer, &count);
-	bytes		 = writePointer - readPointer;
+static ssize_t writeTransformInput(struct transformBody *transformBody,
+								   const uint8_t *data, size_t size) {
+	if (transformBody->transformer != NULL) {
+		return transformerWrite(transformBody->transformer, data, size);
+	}
 
-	writeNumber(chunkBuffer, bytes);
-	buffer_write(chunkBuffer, '\r');
-	buffer_write(chunkBuffer, '\n');
+	return write(transformBody->writeToTransformFd, data, size);
+}
 
-	while (bytes) {
-		buffer_write(chunkBuffer, buffer_read(inbuffer));
-		bytes--;
+static ssize_t readTransformOutput(struct transformBody *transformBody,
+								   uint8_t *data, size_t size) {
+	if (transformBody->transformer != NULL) {
+		return transformerRead(transformBody->transformer, data, size);
 	}
 
-	buffer_write(chunkBuffer, '\r');
-	buffer_write(chunkBuffer, '\n');
+	return read(transformBody->readFromTransformFd, data, size);
 }
 
-void sentLastChunked(buffer *chunkBuffer) {
-	writeNumber(chunkBuffer, 0);
-	buffer_write(chunkBuffer, '\r');
-	buffer_write(chunkBuffer, '\n');
-	buffer_write(chunkBuffer, '\r');
-	buffer_write(chunkBuffer, '\n');
+static selector_status setTransformInterest(fd_selector s, int fd,
+											fd_interest interest) {
+	if (fd == -1) {
+		return SELECTOR_SUCCESS;
+	}
+
+	return selector_set_interest(s, fd, interest);
 }
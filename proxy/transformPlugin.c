@@ -0,0 +1,132 @@
+#include <transformPlugin.h>
+#include <httpProxyADT.h>
+#include <logger.h>
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PLUGIN_ERROR_LENGTH 256
+
+/* A plugin loaded by a worker, with the bodies it is transforming */
+struct loadedPlugin {
+	char *command;
+	void *handle;
+	const struct httpdPlugin *plugin;
+	unsigned bodies;
+	struct loadedPlugin *next;
+};
+
+/*
+ * The plugins each worker loaded that are still in use, and the one the
+ * current command selects. One that is neither is unloaded.
+ */
+static __thread struct loadedPlugin *loadedPlugins;
+static __thread struct loadedPlugin *selectedPlugin;
+
+static void unloadIfUnused(struct loadedPlugin *loaded);
+static const struct httpdPlugin *loadPlugin(const char *path, void **handle);
+
+int isTransformPlugin(const char *command) {
+	return command != NULL &&
+		   strncmp(command, TRANSFORM_PLUGIN_PREFIX,
+				   sizeof(TRANSFORM_PLUGIN_PREFIX) - 1) == 0;
+}
+
+struct loadedPlugin *transformPluginLoad(const char *command,
+										 const char **arguments) {
+	const char *path = command + sizeof(TRANSFORM_PLUGIN_PREFIX) - 1;
+	struct loadedPlugin *loaded;
+	struct loadedPlugin *previous;
+	size_t pathLength;
+	char *pathCopy;
+
+	pathLength = strcspn(path, " ");
+	*arguments = path + pathLength + strspn(path + pathLength, " ");
+
+	if (selectedPlugin == NULL || strcmp(selectedPlugin->command, command)) {
+		loaded	 = calloc(1, sizeof(*loaded));
+		pathCopy = strndup(path, pathLength);
+		if (loaded == NULL || pathCopy == NULL ||
+			(loaded->command = strdup(command)) == NULL) {
+			free(loaded);
+			free(pathCopy);
+			return NULL;
+		}
+		// A failed load is kept selected so that it is not retried every body
+		loaded->plugin = loadPlugin(pathCopy, &loaded->handle);
+		free(pathCopy);
+
+		// The bodies started by the previous plugin keep running on it
+		loaded->next   = loadedPlugins;
+		loadedPlugins  = loaded;
+		previous	   = selectedPlugin;
+		selectedPlugin = loaded;
+		unloadIfUnused(previous);
+	}
+
+	if (selectedPlugin->plugin == NULL) {
+		return NULL;
+	}
+
+	selectedPlugin->bodies++;
+	return selectedPlugin;
+}
+
+const struct httpdPlugin *transformPluginGet(struct loadedPlugin *loaded) {
+	return loaded->plugin;
+}
+
+void transformPluginRelease(struct loadedPlugin *loaded) {
+	if (loaded != NULL) {
+		loaded->bodies--;
+		unloadIfUnused(loaded);
+	}
+}
+
+static void unloadIfUnused(struct loadedPlugin *loaded) {
+	struct loadedPlugin **link = &loadedPlugins;
+
+	if (loaded == NULL || loaded == selectedPlugin || loaded->bodies > 0) {
+		return;
+	}
+
+	while (*link != loaded) {
+		link = &(*link)->next;
+	}
+	*link = loaded->next;
+
+	if (loaded->handle != NULL) {
+		dlclose(loaded->handle);
+	}
+	free(loaded->command);
+	free(loaded);
+}
+
+static const struct httpdPlugin *loadPlugin(const char *path, void **handle) {
+	char message[PLUGIN_ERROR_LENGTH];
+	const struct httpdPlugin *loaded;
+
+	*handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if (*handle == NULL) {
+		snprintf(message, sizeof(message), "Can not load plugin: %s",
+				 dlerror());
+		logError(message, CUSTOM_ERROR);
+		return NULL;
+	}
+
+	loaded = dlsym(*handle, HTTPD_PLUGIN_SYMBOL);
+	if (loaded == NULL || loaded->apiVersion != HTTPD_PLUGIN_API_VERSION ||
+		loaded->init == NULL || loaded->process == NULL ||
+		loaded->finish == NULL || loaded->destroy == NULL) {
+		snprintf(message, sizeof(message),
+				 "Plugin %s does not export a valid " HTTPD_PLUGIN_SYMBOL
+				 " version %d",
+				 path, HTTPD_PLUGIN_API_VERSION);
+		logError(message, CUSTOM_ERROR);
+		return NULL;
+	}
+
+	return loaded;
+}
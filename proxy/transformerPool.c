@@ -0,0 +1,390 @@
+#include <transformerPool.h>
+#include <configuration.h>
+#include <utilities.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define GREETING_LENGTH (sizeof(TRANSFORMER_GREETING) - 1)
+
+static void transformerPoolRead(struct selector_key *key);
+static void transformerPoolTimeout(struct selector_key *key);
+static void transformerPoolClose(struct selector_key *key);
+static void startTransformer(fd_selector s, const char *command);
+static void dropTransformers(fd_selector s);
+static void unlinkTransformer(struct transformer *transformer);
+static void resetFraming(struct transformer *transformer);
+static int isAlive(struct transformer *transformer);
+
+static const struct fd_handler transformerHandler = {
+	.handle_read	= transformerPoolRead,
+	.handle_write   = NULL,
+	.handle_close   = transformerPoolClose,
+	.handle_block   = NULL,
+	.handle_timeout = transformerPoolTimeout,
+};
+
+/* One pool per worker thread, few entries so lookups are linear */
+static __thread struct transformer *transformers = NULL;
+static __thread unsigned transformerQty			 = 0;
+static __thread char *poolCommand				 = NULL;
+static __thread unsigned generation				 = 0;
+/* The command did not greet, it runs once per response */
+static __thread uint8_t isUnframed = FALSE;
+
+struct transformer *transformerPoolTake(fd_selector s, const char *command) {
+	unsigned poolSize = getTransformPoolSize(getConfiguration());
+	struct transformer *transformer;
+	struct transformer *next;
+
+	if (poolSize == 0 || poolCommand == NULL ||
+		strcmp(poolCommand, command) != 0) {
+		dropTransformers(s);
+		free(poolCommand);
+		poolCommand = poolSize == 0 ? NULL : strdup(command);
+		isUnframed  = FALSE;
+		generation++;
+
+		if (poolCommand == NULL) {
+			return NULL;
+		}
+	}
+
+	if (isUnframed) {
+		return NULL;
+	}
+
+	for (transformer = transformers; transformer != NULL;
+		 transformer = next) {
+		next = transformer->next;
+
+		if (!transformer->isGreeted) {
+			continue;
+		}
+
+		unlinkTransformer(transformer);
+		transformer->isBusy = TRUE;
+		selector_unregister_fd(s, transformer->fromFd);
+
+		if (isAlive(transformer)) {
+			resetFraming(transformer);
+			return transformer;
+		}
+
+		transformerPoolDiscard(transformer);
+	}
+
+	if (transformerQty < poolSize) {
+		startTransformer(s, command);
+	}
+
+	return NULL;
+}
+
+void transformerPoolPut(fd_selector s, struct transformer *transformer) {
+	if (transformer->generation != generation ||
+		transformerQty > getTransformPoolSize(getConfiguration())) {
+		transformerPoolDiscard(transformer);
+		return;
+	}
+
+	transformer->isBusy = FALSE;
+	transformer->next   = transformers;
+	transformers		= transformer;
+
+	if (SELECTOR_SUCCESS != selector_register(s, transformer->fromFd,
+											  &transformerHandler, OP_READ,
+											  transformer)) {
+		unlinkTransformer(transformer);
+		transformerPoolDiscard(transformer);
+	}
+}
+
+void transformerPoolDiscard(struct transformer *transformer) {
+	if (transformer->toFd != -1) {
+		close(transformer->toFd);
+	}
+	close(transformer->fromFd);
+	transformerStop(transformer->pid, TRUE);
+	free(transformer);
+	transformerQty--;
+}
+
+ssize_t transformerWrite(struct transformer *transformer, const uint8_t *data,
+						 size_t size) {
+	struct iovec iov[2];
+	size_t count = 0;
+	size_t headerLeft;
+	ssize_t bytesSent;
+
+	if (transformer->outLeft == 0) {
+		size_t length =
+			size < TRANSFORMER_MAX_FRAME ? size : TRANSFORMER_MAX_FRAME;
+
+		if (length == 0) {
+			return 0;
+		}
+
+		transformer->outHeader[0]	 = (length >> 24) & 0xFF;
+		transformer->outHeader[1]	 = (length >> 16) & 0xFF;
+		transformer->outHeader[2]	 = (length >> 8) & 0xFF;
+		transformer->outHeader[3]	 = length & 0xFF;
+		transformer->outHeaderLength = TRANSFORMER_HEADER_SIZE;
+		transformer->outHeaderSent	 = 0;
+		transformer->outLeft		 = length;
+	}
+
+	headerLeft = transformer->outHeaderLength - transformer->outHeaderSent;
+	if (headerLeft > 0) {
+		iov[count].iov_base =
+			transformer->outHeader + transformer->outHeaderSent;
+		iov[count++].iov_len = headerLeft;
+	}
+
+	iov[count].iov_base = (void *) data;
+	iov[count++].iov_len =
+		size < transformer->outLeft ? size : transformer->outLeft;
+
+	bytesSent = writev(transformer->toFd, iov, count);
+
+	if (bytesSent < 0) {
+		return bytesSent;
+	}
+
+	/* Consumes the sent bytes from the length and then from the data */
+	if ((size_t) bytesSent < headerLeft) {
+		transformer->outHeaderSent += bytesSent;
+		return 0;
+	}
+
+	transformer->outHeaderSent = transformer->outHeaderLength;
+	bytesSent -= headerLeft;
+	transformer->outLeft -= bytesSent;
+
+	return bytesSent;
+}
+
+int transformerWriteEnd(struct transformer *transformer) {
+	ssize_t bytesSent;
+
+	/* The last frame must be sent whole before the end */
+	if (transformer->outLeft > 0) {
+		errno = EPROTO;
+		return -1;
+	}
+
+	if (transformer->outHeaderSent == transformer->outHeaderLength) {
+		memset(transformer->outHeader, 0, TRANSFORMER_HEADER_SIZE);
+		transformer->outHeaderLength = TRANSFORMER_HEADER_SIZE;
+		transformer->outHeaderSent	 = 0;
+	}
+
+	bytesSent =
+		write(transformer->toFd,
+			  transformer->outHeader + transformer->outHeaderSent,
+			  transformer->outHeaderLength - transformer->outHeaderSent);
+
+	if (bytesSent < 0) {
+		return errno == EAGAIN || errno == EWOULDBLOCK ? FALSE : -1;
+	}
+
+	transformer->outHeaderSent += bytesSent;
+
+	if (transformer->outHeaderSent < transformer->outHeaderLength) {
+		return FALSE;
+	}
+
+	/* Nothing is pending for the next body */
+	transformer->outHeaderLength = 0;
+	transformer->outHeaderSent	 = 0;
+	return TRUE;
+}
+
+ssize_t transformerRead(struct transformer *transformer, uint8_t *data,
+						size_t size) {
+	ssize_t bytesRead;
+
+	if (transformer->inLeft == 0) {
+		bytesRead = read(transformer->fromFd,
+						 transformer->inHeader + transformer->inHeaderLength,
+						 TRANSFORMER_HEADER_SIZE - transformer->inHeaderLength);
+
+		if (bytesRead <= 0) {
+			if (bytesRead == 0) {
+				/* It must not exit in the middle of a body */
+				errno = EPIPE;
+			}
+			return -1;
+		}
+
+		transformer->inHeaderLength += bytesRead;
+
+		if (transformer->inHeaderLength < TRANSFORMER_HEADER_SIZE) {
+			errno = EAGAIN;
+			return -1;
+		}
+
+		transformer->inHeaderLength = 0;
+		transformer->inLeft			= (size_t) transformer->inHeader[0] << 24 |
+							  (size_t) transformer->inHeader[1] << 16 |
+							  (size_t) transformer->inHeader[2] << 8 |
+							  (size_t) transformer->inHeader[3];
+
+		if (transformer->inLeft == 0) {
+			return 0;
+		}
+	}
+
+	bytesRead = read(transformer->fromFd, data,
+					 size < transformer->inLeft ? size : transformer->inLeft);
+
+	if (bytesRead == 0) {
+		errno = EPIPE;
+		return -1;
+	}
+	if (bytesRead > 0) {
+		transformer->inLeft -= bytesRead;
+	}
+
+	return bytesRead;
+}
+
+/* Reads the greeting, anything else means it exited or does not frame */
+static void transformerPoolRead(struct selector_key *key) {
+	struct transformer *transformer = key->data;
+	uint8_t greeting[GREETING_LENGTH];
+	ssize_t bytesRead;
+
+	if (!transformer->isGreeted) {
+		bytesRead = read(key->fd, greeting,
+						 GREETING_LENGTH - transformer->greetingLength);
+
+		if (bytesRead > 0 &&
+			memcmp(greeting,
+				   TRANSFORMER_GREETING + transformer->greetingLength,
+				   bytesRead) == 0) {
+			transformer->greetingLength += bytesRead;
+			if (transformer->greetingLength < GREETING_LENGTH) {
+				return;
+			}
+			if (transformer->toFd != -1) {
+				transformer->isGreeted = TRUE;
+				selector_clear_timeout(key->s, key->fd);
+				return;
+			}
+			/* It frames but it was too slow, its stdin is closed already */
+		}
+		else if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return;
+		}
+		else if (transformer->generation == generation) {
+			isUnframed = TRUE;
+		}
+	}
+
+	selector_unregister_fd(key->s, key->fd);
+}
+
+/*
+ * It did not greet in time. It may be a filter waiting for its input, that
+ * exits once its stdin is closed, or just slow, that greets anyway.
+ */
+static void transformerPoolTimeout(struct selector_key *key) {
+	struct transformer *transformer = key->data;
+
+	if (transformer->toFd != -1) {
+		close(transformer->toFd);
+		transformer->toFd = -1;
+		selector_set_timeout(key->s, key->fd, TRANSFORMER_GREETING_TIMEOUT);
+		return;
+	}
+
+	if (transformer->generation == generation) {
+		isUnframed = TRUE;
+	}
+
+	selector_unregister_fd(key->s, key->fd);
+}
+
+static void transformerPoolClose(struct selector_key *key) {
+	struct transformer *transformer = key->data;
+
+	/* A taken transformer is only unregistered */
+	if (!transformer->isBusy) {
+		unlinkTransformer(transformer);
+		transformerPoolDiscard(transformer);
+	}
+}
+
+static void startTransformer(fd_selector s, const char *command) {
+	struct transformer *transformer = calloc(1, sizeof(*transformer));
+
+	if (transformer == NULL) {
+		return;
+	}
+
+	transformer->pid = transformerSpawn(command, TRUE,
+										getCommandStderrFd(getConfiguration()),
+										&transformer->toFd,
+										&transformer->fromFd);
+	if (transformer->pid == -1) {
+		free(transformer);
+		return;
+	}
+
+	transformer->generation = generation;
+	transformer->next		= transformers;
+	transformers			= transformer;
+	transformerQty++;
+
+	if (SELECTOR_SUCCESS != selector_register(s, transformer->fromFd,
+											  &transformerHandler, OP_READ,
+											  transformer)) {
+		unlinkTransformer(transformer);
+		transformerPoolDiscard(transformer);
+		return;
+	}
+
+	selector_set_timeout(s, transformer->fromFd, TRANSFORMER_GREETING_TIMEOUT);
+}
+
+/* Unregistering releases every transformer in the pool */
+static void dropTransformers(fd_selector s) {
+	while (transformers != NULL) {
+		selector_unregister_fd(s, transformers->fromFd);
+	}
+}
+
+static void unlinkTransformer(struct transformer *transformer) {
+	struct transformer **link = &transformers;
+
+	while (*link != NULL && *link != transformer) {
+		link = &(*link)->next;
+	}
+
+	if (*link != NULL) {
+		*link = transformer->next;
+	}
+
+	transformer->next = NULL;
+}
+
+static void resetFraming(struct transformer *transformer) {
+	transformer->outHeaderLength = 0;
+	transformer->outHeaderSent	 = 0;
+	transformer->outLeft		 = 0;
+	transformer->inHeaderLength  = 0;
+	transformer->inLeft			 = 0;
+}
+
+/* The exit may not have been noticed by the selector yet */
+static int isAlive(struct transformer *transformer) {
+	struct pollfd pfd = {.fd = transformer->fromFd, .events = POLLIN};
+
+	return poll(&pfd, 1, 0) == 0;
+}
@@ -0,0 +1,182 @@
+#define _GNU_SOURCE
+#include <transformerSpawn.h>
+#include <selector.h>
+#include <utilities.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define VERSION_VARIABLE "HTTPD_VERSION="
+#define FRAMING_VARIABLE "HTTPD_TRANSFORM_FRAMING="
+#define MAX_STOPPED 64
+
+extern char **environ;
+
+/* The commands each worker stopped that had not exited yet */
+static __thread pid_t stoppedPids[MAX_STOPPED];
+static __thread unsigned stoppedQty = 0;
+
+static char **buildEnvironment(int framed);
+static int spawnCommand(pid_t *pid, const char *command, char **environment,
+						int inputFd, int outputFd, int errorFd);
+
+pid_t transformerSpawn(const char *command, int framed, int errorFd,
+					   int *toFd, int *fromFd) {
+	int inputPipe[]	   = {-1, -1};
+	int outputPipe[]   = {-1, -1};
+	char **environment = NULL;
+	pid_t pid		   = -1;
+
+	/* Other workers may be spawning, they must not inherit these ends */
+	if (pipe2(inputPipe, O_CLOEXEC) == -1 ||
+		pipe2(outputPipe, O_CLOEXEC) == -1 ||
+		(environment = buildEnvironment(framed)) == NULL ||
+		spawnCommand(&pid, command, environment, inputPipe[0], outputPipe[1],
+					 errorFd) != 0) {
+		pid = -1;
+		goto finally;
+	}
+
+	if (selector_fd_set_nio(inputPipe[1]) == -1 ||
+		selector_fd_set_nio(outputPipe[0]) == -1) {
+		transformerStop(pid, TRUE);
+		pid = -1;
+		goto finally;
+	}
+
+	*toFd		  = inputPipe[1];
+	*fromFd		  = outputPipe[0];
+	inputPipe[1]  = -1;
+	outputPipe[0] = -1;
+
+finally:
+	for (unsigned i = 0; i < 2; i++) {
+		if (inputPipe[i] != -1) {
+			close(inputPipe[i]);
+		}
+		if (outputPipe[i] != -1) {
+			close(outputPipe[i]);
+		}
+	}
+	free(environment);
+	return pid;
+}
+
+void transformerStop(pid_t pid, int isKilled) {
+	// The pid is still ours, even if the command exited, as it is not reaped
+	if (isKilled) {
+		kill(pid, SIGKILL);
+	}
+
+	if (waitpid(pid, NULL, WNOHANG) != 0) {
+		return;
+	}
+
+	if (stoppedQty < MAX_STOPPED) {
+		stoppedPids[stoppedQty++] = pid;
+	}
+	else {
+		// Too many left to reap, this one is waited for
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+	}
+}
+
+void transformerReap(void) {
+	unsigned i = 0;
+
+	while (i < stoppedQty) {
+		if (waitpid(stoppedPids[i], NULL, WNOHANG) != 0) {
+			stoppedPids[i] = stoppedPids[--stoppedQty];
+		}
+		else {
+			i++;
+		}
+	}
+}
+
+/* The proxy environment plus the variables of the transform commands */
+static char **buildEnvironment(int framed) {
+	static char version[] = VERSION_VARIABLE "1.0.0";
+	static char framing[] = FRAMING_VARIABLE "1";
+	size_t count		  = 0;
+	size_t used			  = 0;
+	char **environment;
+
+	while (environ[count] != NULL) {
+		count++;
+	}
+
+	environment = malloc((count + 3) * sizeof(*environment));
+	if (environment == NULL) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (strncmp(environ[i], VERSION_VARIABLE,
+					sizeof(VERSION_VARIABLE) - 1) != 0 &&
+			strncmp(environ[i], FRAMING_VARIABLE,
+					sizeof(FRAMING_VARIABLE) - 1) != 0) {
+			environment[used++] = environ[i];
+		}
+	}
+
+	environment[used++] = version;
+	if (framed) {
+		environment[used++] = framing;
+	}
+	environment[used] = NULL;
+
+	return environment;
+}
+
+/* Returns 0 or the error number, as posix_spawn does */
+static int spawnCommand(pid_t *pid, const char *command, char **environment,
+						int inputFd, int outputFd, int errorFd) {
+	char *const argv[] = {"sh", "-c", (char *) command, NULL};
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attributes;
+	sigset_t signals;
+	int ret;
+
+	if ((ret = posix_spawn_file_actions_init(&actions)) != 0) {
+		return ret;
+	}
+	if ((ret = posix_spawnattr_init(&attributes)) != 0) {
+		posix_spawn_file_actions_destroy(&actions);
+		return ret;
+	}
+
+	/* dup2 clears the close on exec flag of the new fds */
+	posix_spawn_file_actions_adddup2(&actions, inputFd, STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, outputFd, STDOUT_FILENO);
+	if (errorFd != -1) {
+		posix_spawn_file_actions_adddup2(&actions, errorFd, STDERR_FILENO);
+	}
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 34)
+	/* The sockets of the proxy are not opened with close on exec */
+	posix_spawn_file_actions_addclosefrom_np(&actions, STDERR_FILENO + 1);
+#endif
+
+	/* Ignored signals and the mask survive exec */
+	sigemptyset(&signals);
+	posix_spawnattr_setsigmask(&attributes, &signals);
+	sigaddset(&signals, SIGPIPE);
+	sigaddset(&signals, SIGCHLD);
+	posix_spawnattr_setsigdefault(&attributes, &signals);
+	posix_spawnattr_setflags(&attributes,
+							 POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+	ret = posix_spawn(pid, "/bin/sh", &actions, &attributes, argv,
+					  environment);
+
+	posix_spawnattr_destroy(&attributes);
+	posix_spawn_file_actions_destroy(&actions);
+	return ret;
+}
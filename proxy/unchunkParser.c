@@ -1,63 +1,67 @@
 #include <stdint.h>
+#include <string.h>
 #include <buffer.h>
-#include <limits.h>
 #include <unchunkParser.h>
-
-#define ISHEXA(x)                                                              \
-	(((x) >= '0' && (x) <= '9') || ((x) >= 'a' && (x) <= 'f') ||               \
-	 ((x) >= 'A' && (x) <= 'F'))
+#include <utilities.h>
 
 void unchunkParserInit(struct unchunkParser *unchunkParser,
 					   struct selector_key *key) {
-	memset(unchunkParser->unChunkedBufferData, 0, BUFFER_SIZE);
+	unchunkParser->unChunkedBufferData = getStateBuffer(GET_DATA(key), 0);
 	buffer_init(&(unchunkParser->unchunkedBuffer), BUFFER_SIZE,
 				unchunkParser->unChunkedBufferData);
-	unchunkParser->state			 = CHUNKED_SIZE;
-	unchunkParser->chunkedBytesIndex = 0;
-	unchunkParser->bytesFinished	 = FALSE;
+	unchunkParser->state		= CHUNKED_SIZE;
+	unchunkParser->bytes		= 0;
+	unchunkParser->sizeDigits	= 0;
+	unchunkParser->sizeFinished = FALSE;
 }
 
 void parseChunkedInfo(struct unchunkParser *unchunkParser, buffer *input) {
-	if (!buffer_can_write(&unchunkParser->unchunkedBuffer)) {
-		return;
-	}
-
-	uint8_t l = buffer_read(input);
+	buffer *output = &unchunkParser->unchunkedBuffer;
+	uint8_t *in, *out;
+	size_t inLength, outLength, length;
 
-	while (l) {
-		parseChunkedInfoByChar(l, unchunkParser);
+	while (buffer_can_read(input) && buffer_can_write(output)) {
+		if (unchunkParser->state != CHUNK_DATA || unchunkParser->bytes == 0) {
+			parseChunkedInfoByChar(buffer_read(input), unchunkParser);
+			continue;
+		}
 
-		if (!buffer_can_write(&unchunkParser->unchunkedBuffer)) {
-			return;
+		// The data of the chunk is copied at once, as much as fits
+		in	   = buffer_read_ptr(input, &inLength);
+		out	   = buffer_write_ptr(output, &outLength);
+		length = inLength < outLength ? inLength : outLength;
+		if (length > unchunkParser->bytes) {
+			length = unchunkParser->bytes;
 		}
 
-		l = buffer_read(input);
+		memcpy(out, in, length);
+		buffer_read_adv(input, length);
+		buffer_write_adv(output, length);
+		unchunkParser->bytes -= length;
 	}
 }
 
 void parseChunkedInfoByChar(uint8_t l, struct unchunkParser *unchunkParser) {
-	int state = unchunkParser->state;
-	switch (state) {
+	int value;
+
+	switch (unchunkParser->state) {
 		case CHUNKED_SIZE:
-			if (unchunkParser->chunkedBytesIndex ==
-				MAX_CHUNKED_ACCEPTED_BYTES) {
-				unchunkParser->state = CHUNKED_ERROR;
+			value = getHexaValue(l);
+			if (value != -1 && !unchunkParser->sizeFinished) {
+				if (unchunkParser->sizeDigits == MAX_CHUNKED_ACCEPTED_BYTES) {
+					unchunkParser->state = CHUNKED_ERROR;
+					break;
+				}
+				unchunkParser->bytes = (unchunkParser->bytes << 4) | value;
+				unchunkParser->sizeDigits++;
 			}
-			else if (ISHEXA(l)) {
-				unchunkParser
-					->chunkedBytes[unchunkParser->chunkedBytesIndex++] = l;
+			else if (l == '\n') {
+				unchunkParser->sizeFinished = FALSE;
+				unchunkParser->state		= CHUNK_DATA;
 			}
 			else {
-				if (!unchunkParser->bytesFinished) {
-					unchunkParser
-						->chunkedBytes[unchunkParser->chunkedBytesIndex] = 0;
-					setBytes(unchunkParser);
-					unchunkParser->bytesFinished = TRUE;
-				}
-				if (l == '\n') {
-					unchunkParser->bytesFinished = FALSE;
-					unchunkParser->state		 = CHUNK_DATA;
-				}
+				// The extensions are ignored
+				unchunkParser->sizeFinished = TRUE;
 			}
 			break;
 
@@ -67,15 +71,9 @@ void parseChunkedInfoByChar(uint8_t l, struct unchunkParser *unchunkParser) {
 				unchunkParser->bytes--;
 			}
 			else if (l == '\n') {
-				unchunkParser->chunkedBytesIndex = 0;
-				unchunkParser->state			 = CHUNKED_SIZE;
+				unchunkParser->sizeDigits = 0;
+				unchunkParser->state	  = CHUNKED_SIZE;
 			}
-
 			break;
 	}
 }
-
-void setBytes(struct unchunkParser *unchunkParser) {
-	unchunkParser->bytes = hexaToULLong((char *) unchunkParser->chunkedBytes,
-										unchunkParser->chunkedBytesIndex - 1);
-}
\ No newline at end of file
@@ -1,5 +1,4 @@
 #include <utilities.h>
-#include <stdio.h>
 
 char *addCharToString(char *string, unsigned int *sizeString, char c) {
 	char *ret = string;
@@ -29,29 +28,6 @@ inline int getDigits(int number, int base) {
 	return digits;
 }
 
-void writeNumber(buffer *buffer, int number) {
-	int size = getDigits(number, 16);
-	char numberString[size];
-	int i;
-	sprintf(numberString, "%x", number);
-
-	for (i = 0; i < size; i++) {
-		buffer_write(buffer, numberString[i]);
-	}
-}
-
-unsigned long long hexaToULLong(char *data, int lastPosition) {
-	unsigned long long bytes = 0;
-	unsigned long long pot   = 1;
-	int position			 = lastPosition;
-	while (position >= 0) {
-		bytes += pot * getHexaValue(data[position]);
-		position--;
-		pot *= 16;
-	}
-	return bytes;
-}
-
 int getHexaValue(char l) {
 	if (l >= '0' && l <= '9') {
 		return l - '0';
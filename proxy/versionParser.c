@@ -16,14 +16,12 @@ static enum versionState dotTransition(struct versionParser *parser, char l);
 static enum versionState versionTwoTransition(struct versionParser *parser,
 											  char l);
 
-void parseVersionInit(struct versionParser *parser) {
+void parseVersionInit(struct versionParser *parser, struct arena *arena) {
 	parser->state		   = START_V;
 	parser->charactersRead = 0;
-	parser->version		   = calloc(2, sizeof(int));
-}
-
-void parseVersionDestroy(struct versionParser *parser) {
-	free(parser->version);
+	parser->version		   = arenaAlloc(arena, 2 * sizeof(int));
+	parser->version[0]	   = 0;
+	parser->version[1]	   = 0;
 }
 
 unsigned getVersionState(struct versionParser *parser) {
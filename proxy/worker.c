@@ -0,0 +1,126 @@
+#include <worker.h>
+#include <http.h>
+#include <httpProxyADT.h>
+#include <transformerSpawn.h>
+
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/* Same signal the selector is initialized with in main */
+#define WORKER_WAKEUP_SIGNAL SIGALRM
+
+static const struct fd_handler workerHttpHandler = {
+	.handle_read  = httpPassiveAccept,
+	.handle_write = NULL,
+	.handle_close = NULL, /* nothing to free */
+	.handle_block = NULL,
+};
+
+static void *workerRun(void *data);
+
+selector_status workerInit(struct worker *worker, unsigned id,
+						   const int *httpSockets, int httpSocketQty,
+						   const volatile bool *done) {
+	worker->id			  = id;
+	worker->running		  = false;
+	worker->done		  = done;
+	worker->status		  = SELECTOR_SUCCESS;
+	worker->httpSocketQty = 0;
+
+	/* From now on the sockets belong to the worker */
+	for (int i = 0; i < httpSocketQty && i < MAX_WORKER_SOCKETS; i++) {
+		worker->httpSockets[worker->httpSocketQty++] = httpSockets[i];
+	}
+
+	worker->selector = selector_new(1024);
+
+	if (worker->selector == NULL) {
+		return SELECTOR_ENOMEM;
+	}
+
+	for (int i = 0; i < worker->httpSocketQty; i++) {
+		selector_status ss =
+			selector_register(worker->selector, worker->httpSockets[i],
+							  &workerHttpHandler, OP_READ, NULL);
+
+		if (ss != SELECTOR_SUCCESS) {
+			return ss;
+		}
+	}
+
+	return SELECTOR_SUCCESS;
+}
+
+int workerStart(struct worker *worker) {
+	sigset_t terminationSignals, previous;
+
+	/* Termination signals are handled by the main thread only */
+	sigemptyset(&terminationSignals);
+	sigaddset(&terminationSignals, SIGTERM);
+	sigaddset(&terminationSignals, SIGINT);
+	pthread_sigmask(SIG_BLOCK, &terminationSignals, &previous);
+
+	int ret = pthread_create(&worker->thread, NULL, workerRun, worker);
+
+	pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+	if (ret != 0) {
+		return -1;
+	}
+
+	worker->running = true;
+
+	return 0;
+}
+
+selector_status workerStop(struct worker *worker) {
+	if (worker->running) {
+		pthread_kill(worker->thread, WORKER_WAKEUP_SIGNAL);
+		pthread_join(worker->thread, NULL);
+		worker->running = false;
+	}
+
+	if (worker->selector != NULL) {
+		selector_destroy(worker->selector);
+		worker->selector = NULL;
+	}
+
+	for (int i = 0; i < worker->httpSocketQty; i++) {
+		if (worker->httpSockets[i] >= 0) {
+			close(worker->httpSockets[i]);
+		}
+	}
+
+	worker->httpSocketQty = 0;
+
+	return worker->status;
+}
+
+static void *workerRun(void *data) {
+	struct worker *worker = (struct worker *) data;
+
+	if (httpPoolFill() == -1) {
+		worker->status = SELECTOR_ENOMEM;
+		fprintf(stderr, "Worker %u: %s\n", worker->id,
+				selector_error(worker->status));
+	}
+
+	while (!*worker->done && worker->status == SELECTOR_SUCCESS) {
+		worker->status = selector_select(worker->selector);
+
+		if (worker->status != SELECTOR_SUCCESS) {
+			fprintf(stderr, "Worker %u: %s\n", worker->id,
+					selector_error(worker->status));
+			break;
+		}
+
+		httpPoolTrim();
+		transformerReap();
+	}
+
+	/* The pools are thread local, each worker releases its own */
+	httpPoolDestroy();
+
+	return NULL;
+}
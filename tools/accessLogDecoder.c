@@ -0,0 +1,126 @@
+/**
+ * Converts the binary access log of the proxy (access.bin, written with
+ * -F binary) to text: to the lines of access.log, a request line with the
+ * method and a response line with the status for each served request, or to
+ * CSV with every field of the records.
+ */
+#include <endian.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <accessLogRecord.h>
+#include <methodParser.h>
+
+#define MAX_ADDR_SIZE INET6_ADDRSTRLEN
+
+static const char *methodNames[] = {
+	[GET_METHOD] = "GET",	[HEAD_METHOD] = "HEAD",		[POST_METHOD] = "POST",
+	[PUT_METHOD] = "PUT",	[DELETE_METHOD] = "DELETE", [NO_METHOD] = "-",
+};
+
+static const char *methodName(uint8_t method) {
+	return method <= NO_METHOD ? methodNames[method] : "-";
+}
+
+static void formatAddress(uint8_t family, const uint8_t *raw, char *address) {
+	if (family == ACCESS_LOG_FAMILY_IPV4) {
+		inet_ntop(AF_INET, raw, address, MAX_ADDR_SIZE);
+	}
+	else if (family == ACCESS_LOG_FAMILY_IPV6) {
+		inet_ntop(AF_INET6, raw, address, MAX_ADDR_SIZE);
+	}
+	else {
+		strcpy(address, "-");
+	}
+}
+
+/* The two lines access.log has for a request, as the proxy formats them */
+static void printText(const struct accessLogRecord *record,
+					  const char *client, const char *origin) {
+	time_t seconds = be64toh(record->time) / 1000000;
+	char date[64];
+
+	ctime_r(&seconds, date);
+	date[strlen(date) - 1] = '\0';
+
+	printf("[%s] [%s --> %s] - '%s'\n", date, client, origin,
+		   methodName(record->method));
+	printf("[%s] [%s --> %s] - '%u'\n", date, origin, client,
+		   be16toh(record->status));
+}
+
+static void printCsvHeader(void) {
+	printf("time_us,client,client_port,origin,origin_port,method,status,"
+		   "bytes_to_origin,bytes_to_client,parse_us,dns_us,connect_us,"
+		   "first_byte_us,transform_us,request_us\n");
+}
+
+static void printCsv(const struct accessLogRecord *record, const char *client,
+					 const char *origin) {
+	printf("%" PRIu64 ",%s,%u,%s,%u,%s,%u,%" PRIu64 ",%" PRIu64,
+		   be64toh(record->time), client, ntohs(record->clientPort), origin,
+		   ntohs(record->originPort), methodName(record->method),
+		   be16toh(record->status), be64toh(record->bytesToOrigin),
+		   be64toh(record->bytesToClient));
+	for (unsigned i = 0; i < ACCESS_LOG_DURATIONS; i++) {
+		printf(",%" PRIu32, be32toh(record->durations[i]));
+	}
+	printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+	struct accessLogRecord record;
+	char client[MAX_ADDR_SIZE], origin[MAX_ADDR_SIZE];
+	const char *path = "logs/access.bin";
+	int csv			 = 0;
+	FILE *file;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-c") == 0) {
+			csv = 1;
+		}
+		else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+			fprintf(stderr, "Usage: %s [-c] [access.bin | -]\n", argv[0]);
+			return 1;
+		}
+		else {
+			path = argv[i];
+		}
+	}
+
+	file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+	if (file == NULL) {
+		perror(path);
+		return 1;
+	}
+
+	if (csv) {
+		printCsvHeader();
+	}
+
+	while (fread(&record, sizeof(record), 1, file) == 1) {
+		if (record.version != ACCESS_LOG_RECORD_VERSION) {
+			fprintf(stderr, "Unknown record version %u\n", record.version);
+			return 1;
+		}
+
+		formatAddress(record.clientFamily, record.clientAddress, client);
+		formatAddress(record.originFamily, record.originAddress, origin);
+		if (csv) {
+			printCsv(&record, client, origin);
+		}
+		else {
+			printText(&record, client, origin);
+		}
+	}
+
+	if (file != stdin) {
+		fclose(file);
+	}
+	return 0;
+}